@@ -39,7 +39,17 @@ public:
         // reserve [100, 199], assuming there won't be more than 100
         // links between any two nodes.
         PATCH_LINK = 100,
-        PARALLEL_MEMORY_WRITER = 200
+        PARALLEL_MEMORY_WRITER = 200,
+        GRID_MIGRATION = 300,
+        // collectives don't use tags, but this is where pending
+        // non-blocking reductions get filed for wait()/test():
+        GLOBAL_REDUCTION = 400,
+        // ping-pong used by HiParSimulator to measure link latency
+        // and bandwidth:
+        GHOST_ZONE_CALIBRATION = 500,
+        // reserve [600, 601] for StreamingCollectingWriter's double
+        // buffered chunks:
+        COLLECTING_WRITER = 600
     };
 
     typedef std::map<int, std::vector<MPI_Request> > RequestsMap;
@@ -172,13 +182,19 @@ public:
         }
     }
 
-    void test(int testTag)
+    /**
+     * checks whether the communication requests tagged with testTag
+     * have completed, without blocking.
+     */
+    bool test(int testTag)
     {
-        int flag;
+        int flag = true;
         std::vector<MPI_Request>& requestVec = requests[testTag];
         if(requestVec.size() > 0) {
             MPI_Testall(requestVec.size(), &requestVec[0], &flag, MPI_STATUSES_IGNORE);
         }
+
+        return flag;
     }
 
     void barrier()
@@ -378,7 +394,41 @@ public:
             comm);
     }
 
-    // fixme: add mpi_allreduce for minighost, add global reduction api for production code
+    /**
+     * Combines source from all nodes via op (e.g. MPI_SUM, MPI_MIN
+     * or a custom operator created by MPI_Op_create()) and returns
+     * the result on all nodes.
+     */
+    template<typename T>
+    inline T allReduce(
+        const T& source,
+        MPI_Op op,
+        const MPI_Datatype& datatype = Typemaps::lookup<T>()) const
+    {
+        T result;
+        MPI_Allreduce(const_cast<T*>(&source), &result, 1, datatype, op, comm);
+        return result;
+    }
+
+    /**
+     * Non-blocking counterpart to allReduce(): the reduction will
+     * proceed in the background, the request is filed under waitTag
+     * so it can be completed via wait() or test(). Neither source
+     * nor target may be touched before that.
+     */
+    template<typename T>
+    inline void allReduce(
+        const T *source,
+        T *target,
+        int num,
+        MPI_Op op,
+        int waitTag = GLOBAL_REDUCTION,
+        const MPI_Datatype& datatype = Typemaps::lookup<T>())
+    {
+        MPI_Request req;
+        MPI_Iallreduce(const_cast<T*>(source), target, num, datatype, op, comm, &req);
+        requests[waitTag].push_back(req);
+    }
 
     template<typename T>
     inline std::vector<T> gather(
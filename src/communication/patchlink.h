@@ -5,6 +5,7 @@
 #ifdef LIBGEODECOMP_WITH_MPI
 
 #include <deque>
+#include <map>
 #include <libgeodecomp/communication/mpilayer.h>
 #include <libgeodecomp/storage/patchaccepter.h>
 #include <libgeodecomp/storage/patchprovider.h>
@@ -75,7 +76,7 @@ public:
             mpiLayer.wait(tag);
         }
 
-        inline void cancel()
+        virtual void cancel()
         {
             mpiLayer.cancelAll();
         }
@@ -106,16 +107,69 @@ public:
         using PatchAccepter<GRID_TYPE>::pushRequest;
         using PatchAccepter<GRID_TYPE>::requestedNanoSteps;
 
+        /**
+         * With persistentRequests set, fixed size cells are sent via
+         * persistent requests: cells with AoS layout straight from
+         * the grid (via a derived datatype describing the region),
+         * SoA cells from two alternating buffers, so that sends stay
+         * in flight while the Stepper carries on. They are only
+         * completed once their buffer is needed again or upon
+         * cleanup().
+         */
         inline Accepter(
             const Region<DIM>& region,
             const int dest,
             const int tag,
             const MPI_Datatype& cellMPIDatatype,
-            MPI_Comm communicator = MPI_COMM_WORLD) :
+            MPI_Comm communicator = MPI_COMM_WORLD,
+            bool persistentRequests = false) :
             Link(region, tag, communicator),
             dest(dest),
-            cellMPIDatatype(cellMPIDatatype)
-        {}
+            cellMPIDatatype(cellMPIDatatype),
+            persistentRequests(persistentRequests),
+            currentSend(0),
+            regionDatatype(MPI_DATATYPE_NULL)
+        {
+            for (int i = 0; i < 2; ++i) {
+                sendRequests[i] = MPI_REQUEST_NULL;
+                sendInFlight[i] = false;
+            }
+        }
+
+        virtual ~Accepter()
+        {
+            wait();
+            cleanup();
+            for (int i = 0; i < 2; ++i) {
+                if (sendRequests[i] != MPI_REQUEST_NULL) {
+                    MPI_Request_free(&sendRequests[i]);
+                }
+            }
+
+            for (typename DirectSendMap::iterator i = directSends.begin(); i != directSends.end(); ++i) {
+                MPI_Request_free(&i->second);
+            }
+            if (regionDatatype != MPI_DATATYPE_NULL) {
+                MPI_Type_free(&regionDatatype);
+            }
+        }
+
+        virtual void cleanup()
+        {
+            for (int i = 0; i < 2; ++i) {
+                completeSend(i);
+            }
+        }
+
+        virtual void cancel()
+        {
+            Link::cancel();
+            for (int i = 0; i < 2; ++i) {
+                if (sendInFlight[i]) {
+                    MPI_Cancel(&sendRequests[i]);
+                }
+            }
+        }
 
         virtual void charge(std::size_t next, std::size_t last, std::size_t newStride)
         {
@@ -134,10 +188,11 @@ public:
                 return;
             }
 
-            wait();
-            GridVecConv::gridToVector(grid, &buffer, region);
-            sendHeader(FixedSize());
-            mpiLayer.send(&buffer[0], dest, buffer.size(), tag, cellMPIDatatype);
+            if (persistentRequests) {
+                sendPersistent(grid, FixedSize());
+            } else {
+                send(grid);
+            }
 
             std::size_t nextNanoStep = (min)(requestedNanoSteps) + stride;
             if ((lastNanoStep == infinity()) ||
@@ -152,6 +207,144 @@ public:
         int dest;
         int dataSize;
         MPI_Datatype cellMPIDatatype;
+        bool persistentRequests;
+        int currentSend;
+        BufferType secondBuffer;
+        MPI_Request sendRequests[2];
+        bool sendInFlight[2];
+        MPI_Datatype regionDatatype;
+        // one persistent request per grid (Steppers alternate between
+        // two), keyed by the address of the region's first cell:
+        typedef std::map<const CellType*, MPI_Request> DirectSendMap;
+        DirectSendMap directSends;
+
+        void send(const GRID_TYPE& grid)
+        {
+            wait();
+            GridVecConv::gridToVector(grid, &buffer, region);
+            sendHeader(FixedSize());
+            mpiLayer.send(&buffer[0], dest, buffer.size(), tag, cellMPIDatatype);
+        }
+
+        void sendPersistent(const GRID_TYPE& grid, APITraits::FalseType)
+        {
+            send(grid);
+        }
+
+        void sendPersistent(const GRID_TYPE& grid, APITraits::TrueType)
+        {
+            sendPersistent(grid, APITraits::TrueType(), typename APITraits::SelectSoA<CellType>::Value());
+        }
+
+        /**
+         * Sends the region straight from the grid, without packing
+         * it first. The Stepper may overwrite the grid once put()
+         * returns, so the send is completed right away -- the
+         * Provider on the other end has posted the matching receive
+         * in advance.
+         */
+        void sendPersistent(const GRID_TYPE& grid, APITraits::TrueType, APITraits::FalseType)
+        {
+            if (region.empty()) {
+                send(grid);
+                return;
+            }
+
+            const CellType *base = &grid[region.beginStreak()->origin];
+            typename DirectSendMap::iterator request = directSends.find(base);
+
+            if (request == directSends.end()) {
+                if (regionDatatype == MPI_DATATYPE_NULL) {
+                    initRegionDatatype(grid, base);
+                }
+
+                MPI_Request newRequest;
+                MPI_Send_init(
+                    const_cast<CellType*>(base),
+                    1,
+                    regionDatatype,
+                    dest,
+                    tag,
+                    mpiLayer.communicator(),
+                    &newRequest);
+                request = directSends.insert(std::make_pair(base, newRequest)).first;
+            }
+
+            MPI_Start(&request->second);
+            MPI_Wait(&request->second, MPI_STATUS_IGNORE);
+        }
+
+        /**
+         * SoA grids don't store cells contiguously, so we still need
+         * to copy them. But with two buffers the send may remain in
+         * flight until the next but one put().
+         */
+        void sendPersistent(const GRID_TYPE& grid, APITraits::TrueType, APITraits::TrueType)
+        {
+            BufferType& sendBuffer = (currentSend == 0) ? buffer : secondBuffer;
+            completeSend(currentSend);
+
+            if (sendRequests[currentSend] == MPI_REQUEST_NULL) {
+                sendBuffer.resize(buffer.size());
+                if (sendBuffer.empty()) {
+                    // MPI_Send_init() needs a valid address even for
+                    // empty messages:
+                    send(grid);
+                    return;
+                }
+
+                MPI_Send_init(
+                    &sendBuffer[0],
+                    sendBuffer.size(),
+                    cellMPIDatatype,
+                    dest,
+                    tag,
+                    mpiLayer.communicator(),
+                    &sendRequests[currentSend]);
+            }
+
+            GridVecConv::gridToVector(grid, &sendBuffer, region);
+            MPI_Start(&sendRequests[currentSend]);
+            sendInFlight[currentSend] = true;
+            currentSend = 1 - currentSend;
+        }
+
+        /**
+         * Describes the region's streaks relative to its first cell.
+         * As the Stepper's grids share their layout, the datatype
+         * fits all of them.
+         */
+        void initRegionDatatype(const GRID_TYPE& grid, const CellType *base)
+        {
+            std::vector<int> lengths;
+            std::vector<MPI_Aint> displacements;
+            MPI_Aint baseAddress;
+            MPI_Get_address(const_cast<CellType*>(base), &baseAddress);
+
+            for (typename Region<DIM>::StreakIterator i = region.beginStreak();
+                 i != region.endStreak(); ++i) {
+                MPI_Aint address;
+                MPI_Get_address(const_cast<CellType*>(&grid[i->origin]), &address);
+                lengths << i->length();
+                displacements << (address - baseAddress);
+            }
+
+            MPI_Type_create_hindexed(
+                lengths.size(),
+                &lengths[0],
+                &displacements[0],
+                cellMPIDatatype,
+                &regionDatatype);
+            MPI_Type_commit(&regionDatatype);
+        }
+
+        void completeSend(int index)
+        {
+            if (sendInFlight[index]) {
+                MPI_Wait(&sendRequests[index], MPI_STATUS_IGNORE);
+                sendInFlight[index] = false;
+            }
+        }
 
         void sendHeader(APITraits::TrueType)
         {
@@ -192,14 +385,35 @@ public:
             int source,
             int tag,
             const MPI_Datatype& cellMPIDatatype,
-            MPI_Comm communicator = MPI_COMM_WORLD) :
+            MPI_Comm communicator = MPI_COMM_WORLD,
+            bool persistentRequests = false) :
             Link(region, tag, communicator),
             source(source),
             dataSize(0),
             cellMPIDatatype(cellMPIDatatype),
-            transmissionInFlight(false)
+            transmissionInFlight(false),
+            persistentRequests(persistentRequests),
+            recvInFlight(false),
+            recvRequest(MPI_REQUEST_NULL)
         {}
 
+        virtual ~Provider()
+        {
+            wait();
+            completeRecv();
+            if (recvRequest != MPI_REQUEST_NULL) {
+                MPI_Request_free(&recvRequest);
+            }
+        }
+
+        virtual void cancel()
+        {
+            Link::cancel();
+            if (recvInFlight) {
+                MPI_Cancel(&recvRequest);
+            }
+        }
+
         virtual void cleanup()
         {
             if (transmissionInFlight) {
@@ -253,10 +467,34 @@ public:
         int dataSize;
         MPI_Datatype cellMPIDatatype;
         bool transmissionInFlight;
+        bool persistentRequests;
+        bool recvInFlight;
+        MPI_Request recvRequest;
 
+        /**
+         * Fixed size payloads always arrive in the same buffer,
+         * hence we may reuse a persistent request.
+         */
         void recvFirstPart(APITraits::TrueType)
         {
-            mpiLayer.recv(&buffer[0], source, buffer.size(), tag, cellMPIDatatype);
+            if (!persistentRequests || buffer.empty()) {
+                mpiLayer.recv(&buffer[0], source, buffer.size(), tag, cellMPIDatatype);
+                return;
+            }
+
+            if (recvRequest == MPI_REQUEST_NULL) {
+                MPI_Recv_init(
+                    &buffer[0],
+                    buffer.size(),
+                    cellMPIDatatype,
+                    source,
+                    tag,
+                    mpiLayer.communicator(),
+                    &recvRequest);
+            }
+
+            MPI_Start(&recvRequest);
+            recvInFlight = true;
         }
 
         void recvFirstPart(APITraits::FalseType)
@@ -266,7 +504,9 @@ public:
 
         void recvSecondPart(APITraits::TrueType)
         {
-            // no second receive neccessary for fixed size payloads
+            // no second receive neccessary for fixed size payloads,
+            // but we may need to complete the persistent request:
+            completeRecv();
         }
 
         void recvSecondPart(APITraits::FalseType)
@@ -275,6 +515,14 @@ public:
             mpiLayer.recv(&buffer[0], source, dataSize, tag, cellMPIDatatype);
             wait();
         }
+
+        void completeRecv()
+        {
+            if (recvInFlight) {
+                MPI_Wait(&recvRequest, MPI_STATUS_IGNORE);
+                recvInFlight = false;
+            }
+        }
     };
 
 };
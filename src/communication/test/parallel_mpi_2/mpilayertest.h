@@ -237,6 +237,32 @@ public:
         }
     }
 
+    void testAllReduce()
+    {
+        MPILayer layer;
+        TS_ASSERT_EQUALS(layer.size() * (layer.size() + 1) / 2,
+                         layer.allReduce(layer.rank() + 1, MPI_SUM));
+        TS_ASSERT_EQUALS(0.5, layer.allReduce(layer.rank() + 0.5, MPI_MIN));
+        TS_ASSERT_EQUALS(layer.size() - 1, layer.allReduce(layer.rank(), MPI_MAX));
+    }
+
+    void testAllReduceNonBlocking()
+    {
+        MPILayer layer;
+        std::vector<double> source;
+        source << layer.rank() << 10.0 * layer.rank();
+        std::vector<double> target(2, -1);
+
+        layer.allReduce(&source[0], &target[0], 2, MPI_MAX);
+        layer.wait(MPILayer::GLOBAL_REDUCTION);
+        TS_ASSERT(layer.test(MPILayer::GLOBAL_REDUCTION));
+
+        std::vector<double> expected;
+        expected << layer.size() - 1
+                 << 10.0 * (layer.size() - 1);
+        TS_ASSERT_EQUALS(expected, target);
+    }
+
     void testCancel()
     {
         if (MPILayer().rank() == 0) {
@@ -166,6 +166,70 @@ public:
         }
     }
 
+    void testPersistentRequests()
+    {
+        // steppers swap two grids and overwrite them in place right
+        // after put(), while persistent sends may still be in
+        // flight. The Accepter needs to pick up the current contents
+        // of whichever grid gets passed in:
+        std::vector<boost::shared_ptr<PatchAccepterType> > accepters;
+        std::vector<boost::shared_ptr<PatchProviderType> > providers;
+        std::size_t maxNanoSteps = 10;
+        CoordBox<2> displacedBox(Coord<2>(1, 1), Coord<2>(8, 6));
+        GridType grids[] = { GridType(displacedBox, 0), GridType(displacedBox, 0) };
+
+        for (int i = 0; i < mpiLayer->size(); ++i) {
+            if (i != mpiLayer->rank()) {
+                accepters << boost::shared_ptr<PatchAccepterType>(
+                    new PatchAccepterType(
+                        region1,
+                        i,
+                        genTag(mpiLayer->rank(), i),
+                        MPI_INT,
+                        MPI_COMM_WORLD,
+                        true));
+
+                providers << boost::shared_ptr<PatchProviderType>(
+                    new PatchProviderType(
+                        region1,
+                        i,
+                        genTag(i, mpiLayer->rank()),
+                        MPI_INT,
+                        MPI_COMM_WORLD,
+                        true));
+            }
+        }
+
+        for (int i = 0; i < mpiLayer->size() - 1; ++i) {
+            accepters[i]->charge(0, maxNanoSteps, 1);
+            providers[i]->charge(0, maxNanoSteps, 1);
+        }
+
+        for (std::size_t nanoStep = 0; nanoStep < maxNanoSteps; ++nanoStep) {
+            GridType& sendGrid = grids[nanoStep % 2];
+            for (Region<2>::Iterator i = region1.begin(); i != region1.end(); ++i) {
+                sendGrid[*i] = mpiLayer->rank() * 10000 + nanoStep * 100 + i->y() * 10 + i->x();
+            }
+
+            for (int i = 0; i < mpiLayer->size() - 1; ++i) {
+                accepters[i]->put(sendGrid, boundingRegion, boundingBox.dimensions, nanoStep, mpiLayer->rank());
+            }
+
+            for (int i = 0; i < mpiLayer->size() - 1; ++i) {
+                std::size_t senderRank = i >= mpiLayer->rank() ? i + 1 : i;
+                GridType expected = markGrid(region1, senderRank * 10000 + nanoStep * 100);
+                GridType actual = zeroGrid;
+                providers[i]->get(&actual, boundingRegion, boundingBox.dimensions, nanoStep, senderRank);
+
+                TS_ASSERT_EQUALS(actual, expected);
+            }
+        }
+
+        for (int i = 0; i < mpiLayer->size() - 1; ++i) {
+            accepters[i]->cleanup();
+        }
+    }
+
     void testMultiple2()
     {
         std::vector<boost::shared_ptr<PatchAccepterType> > accepters;
@@ -1,21 +1,26 @@
 #include <libgeodecomp.h>
+#include <libgeodecomp/geometry/partitions/recursivebisectionpartition.h>
+#include <libgeodecomp/io/bovwriter.h>
+#include <libgeodecomp/io/reductionwriter.h>
+#include <libgeodecomp/io/simpleinitializer.h>
+#include <libgeodecomp/io/tracingwriter.h>
+#include <libgeodecomp/parallelization/hiparsimulator.h>
 
 using namespace LibGeoDecomp;
 
-class TemperatureRecorder;
 class RainMaker;
 
 class BushFireCell
 {
 public:
     friend void runSimulation();
-    friend class TemperatureRecorder;
     friend class RainMaker;
 
     enum State {BURNING, GUTTED};
 
     class API :
-        public APITraits::HasFixedCoordsOnlyUpdate
+        public APITraits::HasFixedCoordsOnlyUpdate,
+        public APITraits::HasOpaqueMPIDataType<BushFireCell>
     {};
 
     inline
@@ -224,38 +229,16 @@ private:
     }
 };
 
-class TemperatureRecorder : public Clonable<Writer<BushFireCell>, TemperatureRecorder>
-{
-public:
-    typedef Writer<BushFireCell>::GridType GridType;
-
-    explicit TemperatureRecorder(const unsigned outputPeriod) :
-        Clonable<Writer<BushFireCell>, TemperatureRecorder>("", outputPeriod),
-        avrgTemperature(0)
-    {}
-
-    void stepFinished(const GridType& grid, unsigned step, WriterEvent event)
-    {
-        avrgTemperature = 0;
-
-        CoordBox<2> box = grid.boundingBox();
-        for (CoordBox<2>::Iterator i = box.begin(); i != box.end(); ++i) {
-            avrgTemperature += grid.get(*i).temperature;
-        }
-
-        avrgTemperature /= box.dimensions.prod();
-        std::cout << "averageTemperature(" << step << ") = " << avrgTemperature << "\n";
-    }
-
-    double averageTemperature() const
-    {
-        return avrgTemperature;
-    }
-
-private:
-    double avrgTemperature;
-};
+typedef ReductionWriter<BushFireCell, double> TemperatureRecorder;
 
+/**
+ * Starts rain once the average temperature exceeds a threshold. The
+ * sum of all temperatures is computed by a ReductionWriter. Its
+ * non-blocking MPI_Iallreduce() overlaps with the next time steps,
+ * which is why the RainMaker sees the result of the previous output
+ * step. As the result is identical on all nodes, all of them will
+ * agree on when it's going to rain.
+ */
 class RainMaker : public Steerer<BushFireCell>
 {
 public:
@@ -279,7 +262,13 @@ public:
         bool lastCall,
         SteererFeedback *feedback)
     {
-        if (waterAvailable && (trigger->averageTemperature() > 250)) {
+        double averageTemperature = trigger->result() / globalDimensions.prod();
+        if ((rank == 0) && lastCall) {
+            std::cout << "averageTemperature(" << trigger->resultStep() << ") = "
+                      << averageTemperature << "\n";
+        }
+
+        if (waterAvailable && (averageTemperature > 250)) {
             std::cout << "WARNING---------------------------------------------------\n"
                       << "WARNING: initiating rain at time step " << step << "\n"
                       << "WARNING---------------------------------------------------\n";
@@ -311,20 +300,31 @@ void runSimulation()
     int maxSteps = 15000;
     int outputPeriod = 5;
 
-    SerialSimulator<BushFireCell> sim(new BushFireInitializer(dim, maxSteps));
+    HiParSimulator<BushFireCell, RecursiveBisectionPartition<2> > sim(
+        new BushFireInitializer(dim, maxSteps));
 
-    sim.addWriter(new SerialBOVWriter<BushFireCell>(&BushFireCell::humidity,    "humidity",
+    sim.addWriter(new BOVWriter<BushFireCell>(
+                      Selector<BushFireCell>(&BushFireCell::humidity,    "humidity"),
+                      "humidity",
                       outputPeriod));
-    sim.addWriter(new SerialBOVWriter<BushFireCell>(&BushFireCell::fuel,        "fuel",
+    sim.addWriter(new BOVWriter<BushFireCell>(
+                      Selector<BushFireCell>(&BushFireCell::fuel,        "fuel"),
+                      "fuel",
                       outputPeriod));
-    sim.addWriter(new SerialBOVWriter<BushFireCell>(&BushFireCell::temperature, "temperature",
+    sim.addWriter(new BOVWriter<BushFireCell>(
+                      Selector<BushFireCell>(&BushFireCell::temperature, "temperature"),
+                      "temperature",
                       outputPeriod));
-    sim.addWriter(new SerialBOVWriter<BushFireCell>(&BushFireCell::state,       "state",
+    sim.addWriter(new BOVWriter<BushFireCell>(
+                      Selector<BushFireCell>(&BushFireCell::state,       "state"),
+                      "state",
                       outputPeriod));
 
-    sim.addWriter(new TracingWriter<BushFireCell>(500, maxSteps));
+    if (MPILayer().rank() == 0) {
+        sim.addWriter(new TracingWriter<BushFireCell>(500, maxSteps));
+    }
 
-    TemperatureRecorder *temperatureRecorder = new TemperatureRecorder(100);
+    TemperatureRecorder *temperatureRecorder = new TemperatureRecorder(&BushFireCell::temperature, 100);
     sim.addWriter(temperatureRecorder);
     sim.addSteerer(new RainMaker(100, temperatureRecorder));
 
@@ -333,6 +333,10 @@ void runSimulation()
 
 int main(int argc, char **argv)
 {
+    MPI_Init(&argc, &argv);
+
     runSimulation();
+
+    MPI_Finalize();
     return 0;
 }
@@ -1,4 +1,7 @@
 #include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
 #include <mpi.h>
 
 #include <libgeodecomp.h>
@@ -10,7 +13,9 @@
 #include <libgeodecomp/loadbalancer/tracingbalancer.h>
 #include <libgeodecomp/loadbalancer/noopbalancer.h>
 #include <libgeodecomp/misc/apitraits.h>
+#include <libgeodecomp/misc/scopedtimer.h>
 #include <libgeodecomp/parallelization/hiparsimulator.h>
+#include <libgeodecomp/parallelization/nesting/wavefrontstepper.h>
 
 using namespace LibGeoDecomp;
 
@@ -41,17 +46,38 @@ public:
     double temp;
 };
 
-class CellInitializer : public SimpleInitializer<Cell>
+/**
+ * Same as Cell, but with fixed boundaries. Used for benchmarking
+ * temporal blocking on a single node: on a torus the
+ * WavefrontStepper needs a domain decomposition along the z-axis to
+ * find a plane it may start at.
+ */
+class CubeCell : public Cell
 {
 public:
-    using SimpleInitializer<Cell>::gridDimensions;
+    class API :
+        public APITraits::HasFixedCoordsOnlyUpdate,
+        public APITraits::HasStencil<Stencils::VonNeumann<3, 1> >,
+        public APITraits::HasCubeTopology<3>,
+        public APITraits::HasPredefinedMPIDataType<double>
+    {};
+
+    inline explicit CubeCell(double v = 0) : Cell(v)
+    {}
+};
+
+template<typename CELL>
+class CellInitializer : public SimpleInitializer<CELL>
+{
+public:
+    using SimpleInitializer<CELL>::gridDimensions;
 
     CellInitializer(int size, int maxSteps) :
-        SimpleInitializer<Cell>(
+        SimpleInitializer<CELL>(
             Coord<3>::diagonal(128) * size, maxSteps)
     {}
 
-    virtual void grid(GridBase<Cell, 3> *ret)
+    virtual void grid(GridBase<CELL, 3> *ret)
     {
         CoordBox<3> box = ret->boundingBox();
         Coord<3> offset =
@@ -64,7 +90,7 @@ public:
                 for (int x = 0; x < size; ++x) {
                     Coord<3> c = offset + Coord<3>(x, y, z);
                     if (box.inBounds(c)) {
-                        ret->set(c, Cell(0.99999999999));
+                        ret->set(c, CELL(0.99999999999));
                     }
                 }
             }
@@ -78,7 +104,7 @@ void runSimulation()
     int numSteps = 10000;
     int factor = pow(MPILayer().size(), 1.0 / 3.0);
 
-    CellInitializer *init = new CellInitializer(factor, numSteps);
+    CellInitializer<Cell> *init = new CellInitializer<Cell>(factor, numSteps);
 
     HiParSimulator<Cell, RecursiveBisectionPartition<3> > sim(
         init,
@@ -110,11 +136,62 @@ void runSimulation()
     sim.run();
 }
 
+template<typename CELL, typename STEPPER>
+void runBenchmark(const std::string& name, unsigned ghostZoneWidth, int numSteps)
+{
+    int factor = pow(MPILayer().size(), 1.0 / 3.0);
+    CellInitializer<CELL> *init = new CellInitializer<CELL>(factor, numSteps);
+    double updates = double(init->gridDimensions().prod()) * numSteps;
+
+    HiParSimulator<CELL, RecursiveBisectionPartition<3>, STEPPER> sim(
+        init,
+        0,
+        numSteps,
+        ghostZoneWidth);
+
+    MPILayer().barrier();
+    double t0 = ScopedTimer::time();
+    sim.run();
+    MPILayer().barrier();
+    double seconds = ScopedTimer::time() - t0;
+
+    if (MPILayer().rank() == 0) {
+        std::cout << name << " ghostZoneWidth=" << ghostZoneWidth
+                  << " time=" << seconds << "s"
+                  << " GLUPS=" << (updates / seconds * 1e-9) << "\n";
+    }
+}
+
+/**
+ * Compares the VanillaStepper to the WavefrontStepper (temporal
+ * blocking) for both, the periodic and the fixed boundary variant
+ * of the stencil.
+ */
+void runBenchmarks(unsigned ghostZoneWidth, int numSteps)
+{
+    typedef UpdateFunctorHelpers::ConcurrencyEnableOpenMP ConcurrencySpec;
+
+    runBenchmark<Cell, VanillaStepper<Cell, ConcurrencySpec> >(
+        "torus vanilla  ", ghostZoneWidth, numSteps);
+    runBenchmark<Cell, WavefrontStepper<Cell, ConcurrencySpec> >(
+        "torus wavefront", ghostZoneWidth, numSteps);
+    runBenchmark<CubeCell, VanillaStepper<CubeCell, ConcurrencySpec> >(
+        "cube  vanilla  ", ghostZoneWidth, numSteps);
+    runBenchmark<CubeCell, WavefrontStepper<CubeCell, ConcurrencySpec> >(
+        "cube  wavefront", ghostZoneWidth, numSteps);
+}
+
 int main(int argc, char *argv[])
 {
     MPI_Init(&argc, &argv);
 
-    runSimulation();
+    if ((argc > 1) && (std::string(argv[1]) == "benchmark")) {
+        unsigned ghostZoneWidth = (argc > 2) ? atoi(argv[2]) : 4;
+        int numSteps = (argc > 3) ? atoi(argv[3]) : 100;
+        runBenchmarks(ghostZoneWidth, numSteps);
+    } else {
+        runSimulation();
+    }
 
     MPI_Finalize();
     return 0;
@@ -357,21 +357,16 @@ void runSimulation()
         MPILayer().rank() ? 0 : new TracingBalancer(new NoOpBalancer()),
         1000000);
 
+    // one writer for all variables, so the grid is read only once
+    // per snapshot:
+    std::vector<Selector<Cell> > selectors;
+    selectors << Selector<Cell>(&Cell::density,   "density")
+              << Selector<Cell>(&Cell::velocityX, "velocityX")
+              << Selector<Cell>(&Cell::velocityY, "velocityY")
+              << Selector<Cell>(&Cell::velocityZ, "velocityZ");
     sim.addWriter(
-        new BOVWriter<Cell>(Selector<Cell>(&Cell::density,   "density"),
-                            "lbm.density",
-                            outputFrequency));
-    sim.addWriter(
-        new BOVWriter<Cell>(Selector<Cell>(&Cell::velocityX, "velocityX"),
-                            "lbm.velocityX",
-                            outputFrequency));
-    sim.addWriter(
-        new BOVWriter<Cell>(Selector<Cell>(&Cell::velocityY, "velocityY"),
-                            "lbm.velocityY",
-                            outputFrequency));
-    sim.addWriter(
-        new BOVWriter<Cell>(Selector<Cell>(&Cell::velocityZ, "velocityZ"),
-                            "lbm.velocityZ",
+        new BOVWriter<Cell>(selectors,
+                            "lbm",
                             outputFrequency));
 
     if (MPILayer().rank() == 0) {
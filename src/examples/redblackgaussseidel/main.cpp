@@ -3,10 +3,10 @@
  * solving a heat transfer problem with Dirichlet-boundary cells
  */
 #include <libgeodecomp.h>
-#include <libgeodecomp/io/collectingwriter.h>
 #include <libgeodecomp/io/simpleinitializer.h>
 #include <libgeodecomp/io/ppmwriter.h>
 #include <libgeodecomp/io/simplecellplotter.h>
+#include <libgeodecomp/io/streamingcollectingwriter.h>
 #include <libgeodecomp/io/tracingwriter.h>
 #include <libgeodecomp/parallelization/stripingsimulator.h>
 
@@ -163,7 +163,7 @@ void runSimulation()
             Coord<2>(1, 1));
     }
 
-    CollectingWriter<Cell> *ppmAdapter = new CollectingWriter<Cell>(
+    StreamingCollectingWriter<Cell> *ppmAdapter = new StreamingCollectingWriter<Cell>(
         ppmWriter);
     sim.addWriter(ppmAdapter);
 
@@ -6,6 +6,7 @@
 #include <libgeodecomp/geometry/dummyadjacencymanufacturer.h>
 #include <libgeodecomp/geometry/region.h>
 #include <libgeodecomp/geometry/regionbasedadjacency.h>
+#include <libgeodecomp/geometry/regionexpansion.h>
 
 #include <boost/shared_ptr.hpp>
 
@@ -16,6 +17,11 @@ namespace LibGeoDecomp {
  * subdomain (as defined by a Partition) and the inner and outer ghost
  * regions (halos) which are used for synchronization with neighboring
  * subdomains.
+ *
+ * Expanded Regions are stored as a RegionExpansion per node, i.e. as
+ * shells rather than as full copies per expansion width. This keeps
+ * memory consumption and setup time low for wide ghost zones and
+ * many neighbors (e.g. with unstructured grids).
  */
 template<typename TOPOLOGY>
 class PartitionManager
@@ -27,6 +33,7 @@ public:
     typedef TOPOLOGY Topology;
     static const int DIM = Topology::DIM;
     typedef std::map<int, std::vector<Region<DIM> > > RegionVecMap;
+    typedef std::map<int, RegionExpansion<DIM> > RegionExpansionMap;
 
     enum AccessCode {
         OUTGROUP = -1
@@ -148,20 +155,17 @@ public:
         int node,
         unsigned expansionWidth)
     {
-        if (regions.count(node) == 0) {
-            fillRegion(node);
-        }
-        return regions[node][expansionWidth];
+        return getExpansion(node).level(expansionWidth);
     }
 
     inline const Region<DIM>& ownRegion(unsigned expansionWidth = 0)
     {
-        return regions[myRank][expansionWidth];
+        return regions[myRank].level(expansionWidth);
     }
 
     inline const Region<DIM>& ownExpandedRegion()
     {
-        return regions[myRank].back();
+        return regions[myRank].level(getGhostZoneWidth());
     }
 
     /**
@@ -242,7 +246,7 @@ private:
     Region<DIM> outerRim;
     Region<DIM> volatileKernel;
     Region<DIM> innerRim;
-    RegionVecMap regions;
+    RegionExpansionMap regions;
     RegionVecMap outerGhostZoneFragments;
     RegionVecMap innerGhostZoneFragments;
     std::vector<Region<DIM> > ownRims;
@@ -251,86 +255,75 @@ private:
     unsigned ghostZoneWidth;
     std::vector<CoordBox<DIM> > boundingBoxes;
 
-    const boost::shared_ptr<Adjacency> adjacency(const Region<DIM>& region) const
+    inline const RegionExpansion<DIM>& getExpansion(int node)
     {
-        return adjacencyManufacturer->getAdjacency(region);
+        typename RegionExpansionMap::iterator i = regions.find(node);
+        if (i == regions.end()) {
+            i = regions.insert(std::make_pair(node, fillRegion(node))).first;
+        }
+
+        return i->second;
     }
 
-    inline void fillRegion(unsigned node)
+    inline RegionExpansion<DIM> fillRegion(unsigned node)
     {
-        std::vector<Region<DIM> >& regionExpansion = regions[node];
-        regionExpansion.resize(getGhostZoneWidth() + 1);
-        regionExpansion[0] = partition->getRegion(node);
-        for (std::size_t i = 1; i <= getGhostZoneWidth(); ++i) {
-            Region<DIM> expanded;
-            const Region<DIM>& reg = regionExpansion[i - 1];
-            expanded = reg.expandWithTopology(
-                1,
-                simulationArea.dimensions,
-                Topology(),
-                *adjacency(reg));
-            regionExpansion[i] = expanded;
-        }
+        RegionExpansion<DIM> ret(partition->getRegion(node));
+        ret.expand(getGhostZoneWidth(), simulationArea.dimensions, Topology(), *adjacencyManufacturer);
+        return ret;
     }
 
     inline void fillOwnRegion()
     {
-        fillRegion(myRank);
-        Region<DIM> surface(
-            ownRegion().expandWithTopology(
-                1,
-                simulationArea.dimensions,
-                Topology(),
-                *adjacency(ownRegion())) - ownRegion());
-        Region<DIM> kernel(
-            ownRegion() -
-            surface.expandWithTopology(
-                getGhostZoneWidth(),
-                simulationArea.dimensions,
-                Topology(),
-                *adjacency(surface)));
+        regions[myRank] = fillRegion(myRank);
+        RegionExpansion<DIM>& own = regions[myRank];
+        // we need the surface even without ghost zones:
+        own.expand(1, simulationArea.dimensions, Topology(), *adjacencyManufacturer);
+        const Region<DIM>& surface = own.delta(1);
         outerRim = ownExpandedRegion() - ownRegion();
         ownRims.resize(getGhostZoneWidth() + 1);
         ownInnerSets.resize(getGhostZoneWidth() + 1);
 
-        ownRims.back() = ownRegion() - kernel;
-        for (int i = getGhostZoneWidth() - 1; i >= 0; --i) {
-            ownRims[i] = ownRims[i + 1].expandWithTopology(
-                1,
-                simulationArea.dimensions,
-                Topology(),
-                *adjacency(ownRims[i + 1]));
-        }
-
+        // surface and ownRegion() are disjoint, so each inner set
+        // only needs to exclude the next shell around the surface:
+        RegionExpansion<DIM> surfaceExpansion(surface);
+        surfaceExpansion.expand(getGhostZoneWidth(), simulationArea.dimensions, Topology(), *adjacencyManufacturer);
         ownInnerSets.front() = ownRegion();
-        Region<DIM> minuend = surface.expandWithTopology(
-            1,
-            simulationArea.dimensions,
-            Topology(),
-            *adjacency(surface));
-
         for (std::size_t i = 1; i <= getGhostZoneWidth(); ++i) {
-            ownInnerSets[i] = ownInnerSets[i - 1] - minuend;
-            minuend = minuend.expandWithTopology(
-                1,
-                simulationArea.dimensions,
-                Topology(),
-                *adjacency(minuend));
+            ownInnerSets[i] = ownInnerSets[i - 1] - surfaceExpansion.delta(i);
+        }
+
+        // the last inner set is what remains of ownRegion() once the
+        // ghost zone has been updated, i.e. the kernel:
+        RegionExpansion<DIM> rimExpansion(ownRegion() - ownInnerSets.back());
+        rimExpansion.expand(getGhostZoneWidth(), simulationArea.dimensions, Topology(), *adjacencyManufacturer);
+        ownRims.back() = rimExpansion.delta(0);
+        for (int i = getGhostZoneWidth() - 1; i >= 0; --i) {
+            ownRims[i] = ownRims[i + 1] + rimExpansion.delta(getGhostZoneWidth() - i);
         }
 
         volatileKernel = ownInnerSets.back() & rim(0);
         innerRim       = ownInnerSets.back() & rim(0);
     }
 
+    /**
+     * Builds the fragments incrementally from the shells of both
+     * expansions, so intermediate expansion levels are never
+     * assembled.
+     */
     inline void intersect(unsigned node)
     {
+        const RegionExpansion<DIM>& own = getExpansion(myRank);
+        const RegionExpansion<DIM>& other = getExpansion(node);
         std::vector<Region<DIM> >& outerGhosts = outerGhostZoneFragments[node];
         std::vector<Region<DIM> >& innerGhosts = innerGhostZoneFragments[node];
         outerGhosts.resize(getGhostZoneWidth() + 1);
         innerGhosts.resize(getGhostZoneWidth() + 1);
-        for (unsigned i = 0; i <= getGhostZoneWidth(); ++i) {
-            outerGhosts[i] = getRegion(myRank, i) & getRegion(node, 0);
-            innerGhosts[i] = getRegion(myRank, 0) & getRegion(node, i);
+
+        outerGhosts[0] = own.delta(0) & other.delta(0);
+        innerGhosts[0] = outerGhosts[0];
+        for (unsigned i = 1; i <= getGhostZoneWidth(); ++i) {
+            outerGhosts[i] = outerGhosts[i - 1] + (own.delta(i) & other.delta(0));
+            innerGhosts[i] = innerGhosts[i - 1] + (own.delta(0) & other.delta(i));
         }
     }
 };
@@ -526,7 +526,8 @@ public:
         const Coord<2>& origin=Coord<2>(0, 0),
         const Coord<2>& dimensions=Coord<2>(0, 0),
         const long& offset=0,
-        const std::vector<std::size_t>& weights=std::vector<std::size_t>(2)) :
+        const std::vector<std::size_t>& weights=std::vector<std::size_t>(2),
+        const boost::shared_ptr<Adjacency>& /* unused: adjacency */ = boost::make_shared<RegionBasedAdjacency>()) :
         SpaceFillingCurve<2>(offset, weights),
         origin(origin),
         dimensions(dimensions)
@@ -3,6 +3,7 @@
 
 #include <libgeodecomp/geometry/floatcoord.h>
 #include <libgeodecomp/geometry/partitions/partition.h>
+#include <libgeodecomp/loadbalancer/costmap.h>
 #include <libgeodecomp/misc/math.h>
 
 namespace LibGeoDecomp {
@@ -12,6 +13,11 @@ namespace LibGeoDecomp {
  * yields perfectly rectangular domains which can be acutely tuned to
  * match load profiles, but small changes in the load vector may lead
  * to huge communication volumes for rebalanciation.
+ *
+ * If a CostMap is given, the weights are interpreted as shares of the
+ * total cost (rather than numbers of cells) and cuts are placed so
+ * that each node receives its share of the cost according to the
+ * map.
  */
 template<int DIM>
 class RecursiveBisectionPartition : public Partition<DIM>
@@ -26,11 +32,13 @@ public:
         const long& offset = 0,
         const SizeTVec weights = SizeTVec(),
         const boost::shared_ptr<Adjacency>& adjacency = boost::make_shared<RegionBasedAdjacency>(),
-        const Coord<DIM>& dimWeights = Coord<DIM>::diagonal(1)) :
+        const Coord<DIM>& dimWeights = Coord<DIM>::diagonal(1),
+        const boost::shared_ptr<const CostMap<DIM> >& costMap = boost::shared_ptr<const CostMap<DIM> >()) :
         Partition<DIM>(0, weights),
         origin(origin),
         dimensions(dimensions),
-        dimWeights(dimWeights)
+        dimWeights(dimWeights),
+        costMap(costMap)
     {
         if (dimensions.prod() == 0) {
             throw std::invalid_argument("size of simulation space may not be zero");
@@ -56,6 +64,7 @@ private:
     Coord<DIM> origin;
     Coord<DIM> dimensions;
     Coord<DIM> dimWeights;
+    boost::shared_ptr<const CostMap<DIM> > costMap;
 
     /**
      * returns the CoordBox which belongs to the node whose weight is
@@ -115,12 +124,42 @@ private:
             }
         }
 
-        int offset = round(ratio * dim[longestDim]);
+        int offset = costMap ?
+            costAwareOffset(oldBox, longestDim, ratio) :
+            round(ratio * dim[longestDim]);
         int remainder = dim[longestDim] - offset;
         newBoxes[0].dimensions[longestDim] = offset;
         newBoxes[1].dimensions[longestDim] = remainder;
         newBoxes[1].origin[longestDim] += offset;
     }
+
+    /**
+     * Picks the slice boundary along dimension dim at which the
+     * accumulated cost of box is closest to the given fraction.
+     */
+    inline int costAwareOffset(const CoordBox<DIM>& box, int dim, double ratio) const
+    {
+        std::vector<double> slices = costMap->sliceCosts(box, dim);
+        double total = 0;
+        for (std::size_t i = 0; i < slices.size(); ++i) {
+            total += slices[i];
+        }
+        if (total <= 0) {
+            return round(ratio * box.dimensions[dim]);
+        }
+
+        double target = ratio * total;
+        double accumulated = 0;
+        int offset = 0;
+        for (; offset < int(slices.size()); ++offset) {
+            if ((accumulated + 0.5 * slices[offset]) >= target) {
+                break;
+            }
+            accumulated += slices[offset];
+        }
+
+        return offset;
+    }
 };
 
 template<typename _CharT, typename _Traits, int _Dim>
@@ -86,6 +86,37 @@ public:
         checkCuboid(weights, 3, Coord<2>(48, 16), Coord<2>(48, 16), dim, dimWeights);
     }
 
+    void testCostMap()
+    {
+        std::vector<std::size_t> weights;
+        weights += 1, 1;
+        CoordBox<2> box(Coord<2>(10, 20), Coord<2>(30, 20));
+
+        // cells in the left third are three times as expensive, so
+        // of two equal shares the left one should receive only 8
+        // columns (cost 480 vs. 520; 9 columns would yield 540 vs. 460):
+        boost::shared_ptr<CostMap<2> > costMap(new CostMap<2>(box, Coord<2>(5, 5)));
+        costMap->setDensity(CoordBox<2>(Coord<2>(10, 20), Coord<2>(10, 20)), 3.0);
+
+        RecursiveBisectionPartition<2> p(
+            box.origin,
+            box.dimensions,
+            0,
+            weights,
+            boost::make_shared<RegionBasedAdjacency>(),
+            Coord<2>::diagonal(1),
+            costMap);
+
+        TS_ASSERT_EQUALS(
+            genRegion2D(10, 20, 8, 20),
+            p.getRegion(0));
+        TS_ASSERT_EQUALS(
+            genRegion2D(18, 20, 22, 20),
+            p.getRegion(1));
+        TS_ASSERT_EQUALS(costMap->cost(p.getRegion(0)), 3.0 * 8 * 20);
+        TS_ASSERT_EQUALS(costMap->cost(p.getRegion(1)), 3.0 * 2 * 20 + 20 * 20);
+    }
+
     void testDegradedDimensions()
     {
         std::vector<std::size_t> weights;
@@ -120,6 +151,13 @@ public:
                 CoordBox<2>(origin, dimensions)));
     }
 
+    Region<2> genRegion2D(int o1, int o2, int d1, int d2)
+    {
+        Region<2> r;
+        r << CoordBox<2>(Coord<2>(o1, o2), Coord<2>(d1, d2));
+        return r;
+    }
+
     Region<3> genRegion(int o1, int o2, int o3, int d1, int d2, int d3)
     {
         CoordBox<3> box(Coord<3>(o1, o2, o3), Coord<3>(d1, d2, d3));
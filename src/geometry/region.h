@@ -481,15 +481,134 @@ public:
     }
 };
 
+/**
+ * Set operations of Regions are computed level by level (see
+ * RegionSetOpHelper). These classes define how the streaks of a
+ * single row (i.e. all upper coordinates are equal) are combined and
+ * whether rows (or planes etc.) found in only one of the operands
+ * are kept.
+ */
+class RegionUnionOperation : public RegionCommonHelper
+{
+public:
+    static const bool KEEP_LHS = true;
+    static const bool KEEP_RHS = true;
+
+    inline void operator()(
+        IndexVectorType::const_iterator lhs,
+        const IndexVectorType::const_iterator& lhsEnd,
+        IndexVectorType::const_iterator rhs,
+        const IndexVectorType::const_iterator& rhsEnd,
+        IndexVectorType *target) const
+    {
+        std::size_t rowBegin = target->size();
+
+        while ((lhs != lhsEnd) || (rhs != rhsEnd)) {
+            IndexVectorType::const_iterator next;
+            if ((rhs == rhsEnd) || ((lhs != lhsEnd) && (lhs->first < rhs->first))) {
+                next = lhs++;
+            } else {
+                next = rhs++;
+            }
+
+            if ((target->size() > rowBegin) && (next->first <= target->back().second)) {
+                target->back().second = (std::max)(target->back().second, next->second);
+            } else {
+                target->push_back(*next);
+            }
+        }
+    }
+};
+
+/**
+ * see above
+ */
+class RegionIntersectionOperation : public RegionCommonHelper
+{
+public:
+    static const bool KEEP_LHS = false;
+    static const bool KEEP_RHS = false;
+
+    inline void operator()(
+        IndexVectorType::const_iterator lhs,
+        const IndexVectorType::const_iterator& lhsEnd,
+        IndexVectorType::const_iterator rhs,
+        const IndexVectorType::const_iterator& rhsEnd,
+        IndexVectorType *target) const
+    {
+        while ((lhs != lhsEnd) && (rhs != rhsEnd)) {
+            int begin = (std::max)(lhs->first,  rhs->first);
+            int end   = (std::min)(lhs->second, rhs->second);
+            if (begin < end) {
+                target->push_back(IntPair(begin, end));
+            }
+
+            if (lhs->second < rhs->second) {
+                ++lhs;
+            } else {
+                ++rhs;
+            }
+        }
+    }
+};
+
+/**
+ * see above
+ */
+class RegionDifferenceOperation : public RegionCommonHelper
+{
+public:
+    static const bool KEEP_LHS = true;
+    static const bool KEEP_RHS = false;
+
+    inline void operator()(
+        IndexVectorType::const_iterator lhs,
+        const IndexVectorType::const_iterator& lhsEnd,
+        IndexVectorType::const_iterator rhs,
+        const IndexVectorType::const_iterator& rhsEnd,
+        IndexVectorType *target) const
+    {
+        for (; lhs != lhsEnd; ++lhs) {
+            int begin = lhs->first;
+            int end = lhs->second;
+
+            while ((rhs != rhsEnd) && (rhs->second <= begin)) {
+                ++rhs;
+            }
+
+            // rhs may overlap the following streak of lhs, too, so
+            // we don't advance it permanently here:
+            for (IndexVectorType::const_iterator i = rhs;
+                 (i != rhsEnd) && (i->first < end) && (begin < end);
+                 ++i) {
+                if (i->first > begin) {
+                    target->push_back(IntPair(begin, i->first));
+                }
+                begin = (std::max)(begin, i->second);
+            }
+
+            if (begin < end) {
+                target->push_back(IntPair(begin, end));
+            }
+        }
+    }
+};
+
 template<int DIM>
 class RegionLookupHelper;
 
+template<int DIM>
+class RegionSetOperationHelper;
+
 template<int DIM>
 class RegionInsertHelper;
 
 template<int DIM>
 class RegionRemoveHelper;
 
+template<int DIM>
+class RegionAppendHelper;
+
 }
 
 /**
@@ -509,6 +628,8 @@ public:
     template<int MY_DIM> friend class RegionHelpers::RegionLookupHelper;
     template<int MY_DIM> friend class RegionHelpers::RegionInsertHelper;
     template<int MY_DIM> friend class RegionHelpers::RegionRemoveHelper;
+    template<int MY_DIM> friend class RegionHelpers::RegionAppendHelper;
+    template<int MY_DIM> friend class RegionHelpers::RegionSetOperationHelper;
     friend class LibGeoDecomp::RegionTest;
 
     typedef std::pair<int, int> IntPair;
@@ -836,7 +957,12 @@ public:
 #endif
 #endif
 
-        RegionHelpers::RegionInsertHelper<DIM - 1>()(this, s);
+        // most Regions are built in order (e.g. from CoordBoxes or
+        // as results of set operations), so we try a cheap append
+        // first and fall back to the generic insert:
+        if (!RegionHelpers::RegionAppendHelper<DIM - 1>()(this, s)) {
+            RegionHelpers::RegionInsertHelper<DIM - 1>()(this, s);
+        }
         geometryCacheTainted = true;
         return *this;
     }
@@ -856,9 +982,7 @@ public:
             buf << *i;
         }
 
-        Region mergeBuf;
-        merge2way(mergeBuf, beginStreak(), endStreak(), buf.beginStreak(), buf.endStreak());
-        swap(*this, mergeBuf);
+        *this += buf;
 
         return *this;
     }
@@ -912,68 +1036,24 @@ public:
      */
     inline Region operator-(const Region& other) const
     {
-        using std::max;
-        using std::min;
-        Region ret;
-        // these conditionals are less a shortcut but more a guarantee
-        // that the derefernce below will succeed:
-        if (this->empty()) {
-            return ret;
-        }
-        if (other.empty()) {
+        if (empty() || other.empty()) {
             return *this;
         }
 
-        StreakIterator myIter = beginStreak();
-        StreakIterator otherIter = other.beginStreak();
-
-        StreakIterator myEnd = endStreak();
-        StreakIterator otherEnd = other.endStreak();
-
-        Streak<DIM> cursor = *myIter;
-
-        for (;;) {
-            if (RegionHelpers::RegionIntersectHelper<DIM - 1>::intersects(cursor, *otherIter)) {
-                int intersectionOriginX = max(cursor.origin.x(), otherIter->origin.x());
-                int intersectionEndX = min(cursor.endX, otherIter->endX);
-
-                ret << Streak<DIM>(cursor.origin, intersectionOriginX);
-                cursor.origin.x() = intersectionEndX;
-            }
-
-            if (RegionHelpers::RegionIntersectHelper<DIM - 1>::lessThan(cursor, *otherIter)) {
-                ret << cursor;
-                ++myIter;
-
-                if (myIter == myEnd) {
-                    break;
-                } else {
-                    cursor = *myIter;
-                }
-            } else {
-                ++otherIter;
-                if (otherIter == otherEnd) {
-                    break;
-                }
-            }
-        }
-
-        // don't loose the remainder
-        ret << cursor;
-        if (myIter != myEnd) {
-            ++myIter;
-            for (; myIter != myEnd; ++myIter) {
-                ret << *myIter;
-            }
-        }
+        Region ret;
+        ret.reserveIndices(*this, other, RegionHelpers::RegionDifferenceOperation());
+        RegionHelpers::RegionSetOperationHelper<DIM - 1>()(
+            *this, other, &ret, RegionHelpers::RegionDifferenceOperation());
+        ret.geometryCacheTainted = true;
 
         return ret;
     }
 
     inline void operator&=(const Region& other)
     {
-        Region intersection = other & *this;
-        *this = intersection;
+        using std::swap;
+        Region intersection = *this & other;
+        swap(*this, intersection);
     }
 
     /**
@@ -981,35 +1061,16 @@ public:
      */
     inline Region operator&(const Region& other) const
     {
-        using std::max;
-        using std::min;
         Region ret;
-        StreakIterator myIter = beginStreak();
-        StreakIterator otherIter = other.beginStreak();
-
-        StreakIterator myEnd = endStreak();
-        StreakIterator otherEnd = other.endStreak();
-
-        for (;;) {
-            if ((myIter == myEnd) ||
-                (otherIter == otherEnd)) {
-                break;
-            }
-
-            if (RegionHelpers::RegionIntersectHelper<DIM - 1>::intersects(*myIter, *otherIter)) {
-                Streak<DIM> intersection = *myIter;
-                intersection.origin.x() = max(myIter->origin.x(), otherIter->origin.x());
-                intersection.endX = min(myIter->endX, otherIter->endX);
-                ret << intersection;
-            }
-
-            if (RegionHelpers::RegionIntersectHelper<DIM - 1>::lessThan(*myIter, *otherIter)) {
-                ++myIter;
-            } else {
-                ++otherIter;
-            }
+        if (empty() || other.empty()) {
+            return ret;
         }
 
+        ret.reserveIndices(*this, other, RegionHelpers::RegionIntersectionOperation());
+        RegionHelpers::RegionSetOperationHelper<DIM - 1>()(
+            *this, other, &ret, RegionHelpers::RegionIntersectionOperation());
+        ret.geometryCacheTainted = true;
+
         return ret;
     }
 
@@ -1079,11 +1140,10 @@ public:
 
         // else: normal merge
         Region ret;
-
-        merge2way(
-            ret,
-            this->beginStreak(), this->endStreak(),
-            other.beginStreak(), other.endStreak());
+        ret.reserveIndices(*this, other, RegionHelpers::RegionUnionOperation());
+        RegionHelpers::RegionSetOperationHelper<DIM - 1>()(
+            *this, other, &ret, RegionHelpers::RegionUnionOperation());
+        ret.geometryCacheTainted = true;
 
         return ret;
     }
@@ -1467,31 +1527,71 @@ private:
 
 #undef LIBGEODECOMP_REGION_ADVANCE_ITERATOR
 
+    /**
+     * Reserves enough memory in the index vectors to hold the result
+     * of the given set operation. This avoids repeated reallocations
+     * while the result is being assembled.
+     */
+    template<typename OPERATION>
+    inline void reserveIndices(const Region& lhs, const Region& rhs, const OPERATION& /* unused */)
+    {
+        // Each streak of rhs may split at most one streak of lhs:
+        indices[0].reserve(lhs.indices[0].size() + rhs.indices[0].size());
+
+        for (int d = 1; d < DIM; ++d) {
+            std::size_t size = 0;
+            if (OPERATION::KEEP_LHS) {
+                size += lhs.indices[d].size();
+            }
+            if (OPERATION::KEEP_RHS) {
+                size += rhs.indices[d].size();
+            }
+            if (!OPERATION::KEEP_LHS && !OPERATION::KEEP_RHS) {
+                size = (std::min)(lhs.indices[d].size(), rhs.indices[d].size());
+            }
+
+            indices[d].reserve(size);
+        }
+    }
+
     inline void determineGeometry() const
     {
         if (empty()) {
             mySize = 0;
             myBoundingBox = CoordBox<DIM>();
-        } else {
-            Streak<DIM> someStreak = *beginStreak();
-            Coord<DIM> minCoord = someStreak.origin;
-            Coord<DIM> maxCoord = someStreak.origin;
+            return;
+        }
 
-            mySize = 0;
-            for (StreakIterator i = beginStreak();
-                 i != endStreak(); ++i) {
-                Coord<DIM> left = i->origin;
-                Coord<DIM> right = i->origin;
-                right.x() = i->endX - 1;
-
-                minCoord = (minCoord.min)(left);
-                maxCoord = (maxCoord.max)(right);
-                mySize += i->endX - i->origin.x();
-            }
+        // all coordinates of a dimension are stored in the index
+        // vector of the same level, so we can simply scan those
+        // instead of iterating through all streaks. These loops are
+        // simple enough to be vectorized by the compiler.
+        Coord<DIM> minCoord;
+        Coord<DIM> maxCoord;
+        std::size_t size = 0;
+        int minX = indices[0].front().first;
+        int maxX = indices[0].front().second;
+
+        for (IndexVectorType::const_iterator i = indices[0].begin(); i != indices[0].end(); ++i) {
+            size += i->second - i->first;
+            minX = (std::min)(minX, i->first);
+            maxX = (std::max)(maxX, i->second);
+        }
+        minCoord[0] = minX;
+        maxCoord[0] = maxX - 1;
+
+        for (int d = 1; d < DIM; ++d) {
+            minCoord[d] = indices[d].front().first;
+            maxCoord[d] = indices[d].front().first;
 
-            myBoundingBox =
-                CoordBox<DIM>(minCoord, maxCoord - minCoord + Coord<DIM>::diagonal(1));
+            for (IndexVectorType::const_iterator i = indices[d].begin(); i != indices[d].end(); ++i) {
+                minCoord[d] = (std::min)(minCoord[d], i->first);
+                maxCoord[d] = (std::max)(maxCoord[d], i->first);
+            }
         }
+
+        mySize = size;
+        myBoundingBox = CoordBox<DIM>(minCoord, maxCoord - minCoord + Coord<DIM>::diagonal(1));
     }
 
     inline void resetGeometryCache() const
@@ -2051,6 +2151,268 @@ private:
     }
 };
 
+/**
+ * Appends a Streak to the end of a Region if it's located behind
+ * (or touches/overlaps) the Region's last Streak. Returns false if
+ * the Streak needs to be inserted elsewhere.
+ */
+template<int DIM>
+class RegionAppendHelper
+{
+public:
+    typedef Region<1>::IntPair IntPair;
+    typedef Region<1>::IndexVectorType IndexVectorType;
+
+    template<int MY_DIM>
+    inline bool operator()(Region<MY_DIM> *region, const Streak<MY_DIM>& s)
+    {
+        IndexVectorType& indices = region->indices[DIM];
+        int c = s.origin[DIM];
+
+        if (indices.empty() || (c > indices.back().first)) {
+            append(region, s);
+            return true;
+        }
+
+        if (c < indices.back().first) {
+            return false;
+        }
+
+        return RegionAppendHelper<DIM - 1>()(region, s);
+    }
+
+    template<int MY_DIM>
+    inline void append(Region<MY_DIM> *region, const Streak<MY_DIM>& s)
+    {
+        region->indices[DIM] << IntPair(s.origin[DIM], region->indices[DIM - 1].size());
+        RegionAppendHelper<DIM - 1>().append(region, s);
+    }
+};
+
+/**
+ * see above
+ */
+template<>
+class RegionAppendHelper<0>
+{
+public:
+    typedef Region<1>::IntPair IntPair;
+    typedef Region<1>::IndexVectorType IndexVectorType;
+
+    template<int MY_DIM>
+    inline bool operator()(Region<MY_DIM> *region, const Streak<MY_DIM>& s)
+    {
+        IndexVectorType& indices = region->indices[0];
+
+        if (indices.empty() || (s.origin.x() > indices.back().second)) {
+            append(region, s);
+            return true;
+        }
+
+        if (s.origin.x() < indices.back().first) {
+            return false;
+        }
+
+        indices.back().second = (std::max)(indices.back().second, s.endX);
+        return true;
+    }
+
+    template<int MY_DIM>
+    inline void append(Region<MY_DIM> *region, const Streak<MY_DIM>& s)
+    {
+        region->indices[0] << IntPair(s.origin.x(), s.endX);
+    }
+};
+
+/**
+ * Computes union, intersection and difference of two Regions
+ * directly on their index vectors: coordinates present in both
+ * operands are merged recursively while subtrees found in only one
+ * operand are either skipped or copied en bloc -- which boils down
+ * to a memcpy() plus a vectorizable offset adjustment. The result
+ * is appended to the target, which is expected to be empty.
+ */
+template<int DIM>
+class RegionSetOperationHelper
+{
+public:
+    typedef Region<1>::IntPair IntPair;
+    typedef Region<1>::IndexVectorType IndexVectorType;
+
+    template<int MY_DIM, typename OPERATION>
+    inline void operator()(
+        const Region<MY_DIM>& lhs,
+        const Region<MY_DIM>& rhs,
+        Region<MY_DIM> *target,
+        const OPERATION& operation)
+    {
+        (*this)(lhs, 0, lhs.indices[DIM].size(), rhs, 0, rhs.indices[DIM].size(), target, operation);
+    }
+
+    template<int MY_DIM, typename OPERATION>
+    void operator()(
+        const Region<MY_DIM>& lhs,
+        std::size_t lhsBegin,
+        std::size_t lhsEnd,
+        const Region<MY_DIM>& rhs,
+        std::size_t rhsBegin,
+        std::size_t rhsEnd,
+        Region<MY_DIM> *target,
+        const OPERATION& operation)
+    {
+        const IndexVectorType& lhsIndices = lhs.indices[DIM];
+        const IndexVectorType& rhsIndices = rhs.indices[DIM];
+        IndexVectorType& targetIndices = target->indices[DIM];
+        std::size_t i = lhsBegin;
+        std::size_t j = rhsBegin;
+
+        while ((i != lhsEnd) && (j != rhsEnd)) {
+            if (lhsIndices[i].first < rhsIndices[j].first) {
+                std::size_t next = i + 1;
+                while ((next != lhsEnd) && (lhsIndices[next].first < rhsIndices[j].first)) {
+                    ++next;
+                }
+                if (OPERATION::KEEP_LHS) {
+                    copy(lhs, i, next, target);
+                }
+                i = next;
+                continue;
+            }
+
+            if (lhsIndices[i].first > rhsIndices[j].first) {
+                std::size_t next = j + 1;
+                while ((next != rhsEnd) && (rhsIndices[next].first < lhsIndices[i].first)) {
+                    ++next;
+                }
+                if (OPERATION::KEEP_RHS) {
+                    copy(rhs, j, next, target);
+                }
+                j = next;
+                continue;
+            }
+
+            std::size_t childOffset = target->indices[DIM - 1].size();
+            targetIndices << IntPair(lhsIndices[i].first, childOffset);
+            RegionSetOperationHelper<DIM - 1>()(
+                lhs, lhsIndices[i].second, childEnd(lhs, i),
+                rhs, rhsIndices[j].second, childEnd(rhs, j),
+                target,
+                operation);
+
+            // drop empty rows/planes, e.g. if an intersection is empty:
+            if (target->indices[DIM - 1].size() == childOffset) {
+                targetIndices.pop_back();
+            }
+
+            ++i;
+            ++j;
+        }
+
+        if (OPERATION::KEEP_LHS) {
+            copy(lhs, i, lhsEnd, target);
+        }
+        if (OPERATION::KEEP_RHS) {
+            copy(rhs, j, rhsEnd, target);
+        }
+    }
+
+    /**
+     * Appends the entries [begin, end) of the source's index vector
+     * of this level (plus all entries on lower levels which they
+     * refer to) to the target.
+     */
+    template<int MY_DIM>
+    inline void copy(
+        const Region<MY_DIM>& source,
+        std::size_t begin,
+        std::size_t end,
+        Region<MY_DIM> *target)
+    {
+        if (begin == end) {
+            return;
+        }
+
+        const IndexVectorType& sourceIndices = source.indices[DIM];
+        IndexVectorType& targetIndices = target->indices[DIM];
+        std::size_t childBegin = sourceIndices[begin].second;
+        int delta = int(target->indices[DIM - 1].size()) - int(childBegin);
+
+        std::size_t offset = targetIndices.size();
+        targetIndices.insert(targetIndices.end(), sourceIndices.begin() + begin, sourceIndices.begin() + end);
+        IntPair *cursor = &targetIndices[offset];
+        for (std::size_t k = 0; k < (end - begin); ++k) {
+            cursor[k].second += delta;
+        }
+
+        RegionSetOperationHelper<DIM - 1>().copy(source, childBegin, childEnd(source, end - 1), target);
+    }
+
+private:
+    template<int MY_DIM>
+    inline std::size_t childEnd(const Region<MY_DIM>& region, std::size_t index) const
+    {
+        const IndexVectorType& indices = region.indices[DIM];
+        if ((index + 1) == indices.size()) {
+            return region.indices[DIM - 1].size();
+        }
+
+        return indices[index + 1].second;
+    }
+};
+
+/**
+ * see above
+ */
+template<>
+class RegionSetOperationHelper<0>
+{
+public:
+    typedef Region<1>::IntPair IntPair;
+    typedef Region<1>::IndexVectorType IndexVectorType;
+
+    template<int MY_DIM, typename OPERATION>
+    inline void operator()(
+        const Region<MY_DIM>& lhs,
+        const Region<MY_DIM>& rhs,
+        Region<MY_DIM> *target,
+        const OPERATION& operation)
+    {
+        (*this)(lhs, 0, lhs.indices[0].size(), rhs, 0, rhs.indices[0].size(), target, operation);
+    }
+
+    template<int MY_DIM, typename OPERATION>
+    inline void operator()(
+        const Region<MY_DIM>& lhs,
+        std::size_t lhsBegin,
+        std::size_t lhsEnd,
+        const Region<MY_DIM>& rhs,
+        std::size_t rhsBegin,
+        std::size_t rhsEnd,
+        Region<MY_DIM> *target,
+        const OPERATION& operation)
+    {
+        operation(
+            lhs.indices[0].begin() + lhsBegin,
+            lhs.indices[0].begin() + lhsEnd,
+            rhs.indices[0].begin() + rhsBegin,
+            rhs.indices[0].begin() + rhsEnd,
+            &target->indices[0]);
+    }
+
+    template<int MY_DIM>
+    inline void copy(
+        const Region<MY_DIM>& source,
+        std::size_t begin,
+        std::size_t end,
+        Region<MY_DIM> *target)
+    {
+        target->indices[0].insert(
+            target->indices[0].end(),
+            source.indices[0].begin() + begin,
+            source.indices[0].begin() + end);
+    }
+};
+
 }
 
 template<int DIM>
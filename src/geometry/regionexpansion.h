@@ -0,0 +1,130 @@
+#ifndef LIBGEODECOMP_GEOMETRY_REGIONEXPANSION_H
+#define LIBGEODECOMP_GEOMETRY_REGIONEXPANSION_H
+
+#include <libgeodecomp/geometry/adjacencymanufacturer.h>
+#include <libgeodecomp/geometry/region.h>
+
+#include <map>
+#include <vector>
+
+namespace LibGeoDecomp {
+
+/**
+ * RegionExpansion represents a Region together with its successive
+ * expansions by 1, 2, ... cells (level 0 being the original Region).
+ * Instead of storing each level in full (which is what makes wide
+ * ghost zones expensive), only the shells are kept: delta(i) holds
+ * those cells which were added by expanding level i - 1 by 1, while
+ * delta(0) is the original Region.
+ *
+ * As expansion distributes over union, level i can be derived from
+ * the outermost shell alone, so expanding the whole hierarchy costs
+ * roughly as much as expanding the outermost level once. Levels are
+ * only assembled from the deltas once they're requested via level()
+ * and are then kept for later calls.
+ */
+template<int DIM>
+class RegionExpansion
+{
+public:
+    friend class RegionExpansionTest;
+
+    explicit RegionExpansion(const Region<DIM>& base = Region<DIM>()) :
+        deltas(1, base)
+    {}
+
+    /**
+     * Computes the missing shells up to the given width. The Topology
+     * and AdjacencyManufacturer need to match those used for
+     * Region::expandWithTopology().
+     */
+    template<typename TOPOLOGY>
+    void expand(
+        unsigned width,
+        const Coord<DIM>& globalDimensions,
+        TOPOLOGY topology,
+        const AdjacencyManufacturer<DIM>& adjacencyManufacturer)
+    {
+        if (width < deltas.size()) {
+            return;
+        }
+
+        Region<DIM> current = assemble(deltas.size() - 1);
+
+        while (deltas.size() <= width) {
+            const Region<DIM>& shell = deltas.back();
+            Region<DIM> next = shell.expandWithTopology(
+                1,
+                globalDimensions,
+                topology,
+                *adjacencyManufacturer.getAdjacency(shell));
+            next -= current;
+            current += next;
+            deltas.push_back(next);
+        }
+    }
+
+    /**
+     * Number of available levels, i.e. maximum expansion width + 1.
+     */
+    inline std::size_t size() const
+    {
+        return deltas.size();
+    }
+
+    inline const Region<DIM>& delta(unsigned i) const
+    {
+        return deltas[i];
+    }
+
+    /**
+     * Returns the original Region expanded by i cells, which requires
+     * expand() to have been called with width >= i.
+     */
+    const Region<DIM>& level(unsigned i) const
+    {
+        if (i == 0) {
+            return deltas[0];
+        }
+
+        typename LevelMap::iterator iter = levels.find(i);
+        if (iter != levels.end()) {
+            return iter->second;
+        }
+
+        return levels[i] = assemble(i);
+    }
+
+private:
+    typedef std::map<unsigned, Region<DIM> > LevelMap;
+
+    std::vector<Region<DIM> > deltas;
+    mutable LevelMap levels;
+
+    /**
+     * Sums up the deltas up to level i, continuing from the widest
+     * level assembled so far which doesn't exceed i. The result is
+     * not stored, so expand() won't populate the cache.
+     */
+    Region<DIM> assemble(unsigned i) const
+    {
+        unsigned start = 0;
+        Region<DIM> ret = deltas[0];
+        typename LevelMap::const_iterator iter = levels.upper_bound(i);
+        if (iter != levels.begin()) {
+            --iter;
+            start = iter->first;
+            ret = iter->second;
+        }
+
+        for (unsigned j = start + 1; j <= i; ++j) {
+            ret += deltas[j];
+        }
+
+        return ret;
+    }
+};
+
+}
+
+#endif
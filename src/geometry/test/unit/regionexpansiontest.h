@@ -0,0 +1,139 @@
+#include <libgeodecomp/geometry/dummyadjacencymanufacturer.h>
+#include <libgeodecomp/geometry/regionexpansion.h>
+
+#include <cxxtest/TestSuite.h>
+
+using namespace LibGeoDecomp;
+
+namespace LibGeoDecomp {
+
+/**
+ * Hands out the same Adjacency for any Region.
+ */
+class FixedAdjacencyManufacturer : public AdjacencyManufacturer<1>
+{
+public:
+    explicit FixedAdjacencyManufacturer(boost::shared_ptr<Adjacency> adjacency) :
+        adjacency(adjacency)
+    {}
+
+    boost::shared_ptr<Adjacency> getAdjacency(const Region<1>& region) const
+    {
+        return adjacency;
+    }
+
+private:
+    boost::shared_ptr<Adjacency> adjacency;
+};
+
+class RegionExpansionTest : public CxxTest::TestSuite
+{
+public:
+    void testLevelsMatchExpansionOnCube()
+    {
+        typedef Topologies::Cube<2>::Topology Topology;
+        Coord<2> dim(30, 20);
+        Region<2> base;
+        base << CoordBox<2>(Coord<2>(3, 4), Coord<2>(5, 2))
+             << Streak<2>(Coord<2>(10, 10), 17)
+             << Coord<2>(25, 18);
+
+        checkLevels(base, dim, Topology(), DummyAdjacencyManufacturer<2>(), 6);
+    }
+
+    void testLevelsMatchExpansionOnTorus()
+    {
+        typedef Topologies::Torus<3>::Topology Topology;
+        Coord<3> dim(10, 8, 6);
+        Region<3> base;
+        base << CoordBox<3>(Coord<3>(0, 0, 0), Coord<3>(2, 3, 1))
+             << Coord<3>(9, 7, 5);
+
+        checkLevels(base, dim, Topology(), DummyAdjacencyManufacturer<3>(), 4);
+    }
+
+    void testLevelsMatchExpansionWithAdjacency()
+    {
+        // a directed graph: 0 -> 1 -> 2 -> ... -> 9 -> 0, plus some
+        // shortcuts. As edges are directed, cells may be reached
+        // before their predecessors.
+        boost::shared_ptr<RegionBasedAdjacency> adjacency(new RegionBasedAdjacency);
+        for (int i = 0; i < 10; ++i) {
+            adjacency->insert(i, (i + 1) % 10);
+        }
+        adjacency->insert(2, 7);
+        adjacency->insert(8, 3);
+        adjacency->insert(5, 0);
+
+        Region<1> base;
+        base << Coord<1>(4);
+        checkLevels(
+            base,
+            Coord<1>(10),
+            Topologies::Unstructured::Topology(),
+            FixedAdjacencyManufacturer(adjacency),
+            7);
+    }
+
+    void testIncrementalExpansionAndCaching()
+    {
+        typedef Topologies::Cube<2>::Topology Topology;
+        Coord<2> dim(40, 40);
+        Region<2> base;
+        base << Coord<2>(20, 20);
+        DummyAdjacencyManufacturer<2> manufacturer;
+
+        RegionExpansion<2> expansion(base);
+        TS_ASSERT_EQUALS(std::size_t(1), expansion.size());
+        TS_ASSERT_EQUALS(base, expansion.level(0));
+
+        expansion.expand(2, dim, Topology(), manufacturer);
+        TS_ASSERT_EQUALS(std::size_t(3), expansion.size());
+        expansion.expand(5, dim, Topology(), manufacturer);
+        TS_ASSERT_EQUALS(std::size_t(6), expansion.size());
+        // shrinking is a no-op:
+        expansion.expand(1, dim, Topology(), manufacturer);
+        TS_ASSERT_EQUALS(std::size_t(6), expansion.size());
+        // levels are only assembled on demand:
+        TS_ASSERT(expansion.levels.empty());
+
+        Region<2> expected;
+        expected << CoordBox<2>(Coord<2>(17, 17), Coord<2>(7, 7));
+        TS_ASSERT_EQUALS(expected, expansion.level(3));
+        TS_ASSERT_EQUALS(&expansion.level(3), &expansion.level(3));
+        TS_ASSERT_EQUALS(std::size_t(1), expansion.levels.size());
+
+        // the outermost shell holds just the cells at distance 5:
+        TS_ASSERT_EQUALS(std::size_t(11 * 11 - 9 * 9), expansion.delta(5).size());
+    }
+
+private:
+    template<int DIM, typename TOPOLOGY>
+    void checkLevels(
+        const Region<DIM>& base,
+        const Coord<DIM>& dim,
+        TOPOLOGY topology,
+        const AdjacencyManufacturer<DIM>& manufacturer,
+        unsigned width)
+    {
+        RegionExpansion<DIM> expansion(base);
+        expansion.expand(width, dim, topology, manufacturer);
+        TS_ASSERT_EQUALS(std::size_t(width + 1), expansion.size());
+
+        Region<DIM> expected = base;
+        for (unsigned i = 0; i <= width; ++i) {
+            TS_ASSERT_EQUALS(expected, expansion.level(i));
+            TS_ASSERT_EQUALS(
+                base.expandWithTopology(i, dim, topology, *manufacturer.getAdjacency(base)),
+                expansion.level(i));
+
+            if (i > 0) {
+                TS_ASSERT((expansion.delta(i) & expansion.level(i - 1)).empty());
+            }
+
+            expected = expected.expandWithTopology(1, dim, topology, *manufacturer.getAdjacency(expected));
+        }
+    }
+};
+
+}
@@ -1,10 +1,14 @@
 #include <libgeodecomp/geometry/partitions/stripingpartition.h>
 #include <libgeodecomp/geometry/region.h>
 #include <libgeodecomp/misc/chronometer.h>
+#include <libgeodecomp/misc/random.h>
 #include <libgeodecomp/storage/displacedgrid.h>
 
 #include <boost/assign/std/vector.hpp>
 #include <boost/filesystem.hpp>
+#include <algorithm>
+#include <iterator>
+#include <set>
 #include <cxxtest/TestSuite.h>
 
 using namespace boost::assign;
@@ -1410,6 +1414,103 @@ public:
         TS_ASSERT_EQUALS(mergerFL - leftCube,  frontCube);
     }
 
+    void testBooleanRandom3D()
+    {
+        Random::seed(1234);
+
+        for (int run = 0; run < 10; ++run) {
+            Region<3> a = randomRegion();
+            Region<3> b = randomRegion();
+            std::set<Coord<3> > setA = toSet(a);
+            std::set<Coord<3> > setB = toSet(b);
+
+            std::set<Coord<3> > expectedUnion;
+            std::set<Coord<3> > expectedIntersection;
+            std::set<Coord<3> > expectedDifference;
+            std::set_union(
+                setA.begin(), setA.end(), setB.begin(), setB.end(),
+                std::inserter(expectedUnion, expectedUnion.begin()));
+            std::set_intersection(
+                setA.begin(), setA.end(), setB.begin(), setB.end(),
+                std::inserter(expectedIntersection, expectedIntersection.begin()));
+            std::set_difference(
+                setA.begin(), setA.end(), setB.begin(), setB.end(),
+                std::inserter(expectedDifference, expectedDifference.begin()));
+
+            TS_ASSERT_EQUALS(expectedUnion,        toSet(a + b));
+            TS_ASSERT_EQUALS(expectedIntersection, toSet(a & b));
+            TS_ASSERT_EQUALS(expectedDifference,   toSet(a - b));
+
+            // results need to be normalized, i.e. equal to a Region
+            // which was constructed coordinate by coordinate:
+            TS_ASSERT_EQUALS(fromSet(expectedUnion),        a + b);
+            TS_ASSERT_EQUALS(fromSet(expectedIntersection), a & b);
+            TS_ASSERT_EQUALS(fromSet(expectedDifference),   a - b);
+
+            TS_ASSERT_EQUALS(expectedUnion.size(),        (a + b).size());
+            TS_ASSERT_EQUALS(expectedIntersection.size(), (a & b).size());
+            TS_ASSERT_EQUALS(expectedDifference.size(),   (a - b).size());
+            TS_ASSERT_EQUALS(fromSet(expectedUnion).boundingBox(), (a + b).boundingBox());
+
+            Region<3> c = a;
+            c &= b;
+            TS_ASSERT_EQUALS(fromSet(expectedIntersection), c);
+            TS_ASSERT_EQUALS(expectedIntersection.size(), c.size());
+            TS_ASSERT_EQUALS(fromSet(expectedIntersection).boundingBox(), c.boundingBox());
+        }
+    }
+
+    void testAndAssignmentSplittingStreaks()
+    {
+        // each of the long Streaks gets split by the holes in the
+        // comb, so the intersection has more Streaks than original:
+        Region<2> original;
+        Region<2> comb;
+        Region<2> expected;
+
+        for (int y = 0; y < 20; ++y) {
+            original << Streak<2>(Coord<2>(0, y), 100);
+            if (y % 3 == 0) {
+                original << Streak<2>(Coord<2>(200, y), 210);
+            }
+
+            for (int x = 0; x < 100; x += 10) {
+                comb << Streak<2>(Coord<2>(x + 2, y), x + 5);
+                expected << Streak<2>(Coord<2>(x + 2, y), x + 5);
+            }
+        }
+
+        original &= comb;
+        TS_ASSERT_EQUALS(expected, original);
+        TS_ASSERT_EQUALS(expected.numStreaks(), original.numStreaks());
+
+        Region<2> region = expected;
+        region &= region;
+        TS_ASSERT_EQUALS(expected, region);
+
+        region &= Region<2>();
+        TS_ASSERT(region.empty());
+    }
+
+    void testAppendFusesStreaks()
+    {
+        Region<2> actual;
+        actual << Streak<2>(Coord<2>(10, 5), 20)
+               << Streak<2>(Coord<2>(20, 5), 30)
+               << Streak<2>(Coord<2>(15, 5), 25)
+               << Streak<2>(Coord<2>(40, 5), 50)
+               << Streak<2>(Coord<2>( 1, 6), 2)
+               << Streak<2>(Coord<2>(35, 5), 45);
+
+        Region<2> expected;
+        expected << Streak<2>(Coord<2>(10, 5), 30)
+                 << Streak<2>(Coord<2>(35, 5), 50)
+                 << Streak<2>(Coord<2>( 1, 6), 2);
+
+        TS_ASSERT_EQUALS(expected, actual);
+        TS_ASSERT_EQUALS(std::size_t(3), actual.numStreaks());
+    }
+
     void testSwap()
     {
         using std::swap;
@@ -2196,6 +2297,32 @@ public:
     }
 
 private:
+    Region<3> randomRegion()
+    {
+        Region<3> ret;
+        for (int i = 0; i < 50; ++i) {
+            Coord<3> origin(Random::gen_u(20), Random::gen_u(8), Random::gen_u(8));
+            ret << Streak<3>(origin, origin.x() + 1 + Random::gen_u(10));
+        }
+
+        return ret;
+    }
+
+    std::set<Coord<3> > toSet(const Region<3>& region)
+    {
+        return std::set<Coord<3> >(region.begin(), region.end());
+    }
+
+    Region<3> fromSet(const std::set<Coord<3> >& set)
+    {
+        Region<3> ret;
+        for (std::set<Coord<3> >::const_reverse_iterator i = set.rbegin(); i != set.rend(); ++i) {
+            ret << *i;
+        }
+
+        return ret;
+    }
+
     Region<2> c;
     CoordVector bigInsertOrdered;
     CoordVector bigInsertShuffled;
@@ -0,0 +1,419 @@
+#include <libgeodecomp/config.h>
+#ifdef LIBGEODECOMP_WITH_THREADS
+#ifndef LIBGEODECOMP_IO_ASYNCPARALLELWRITER_H
+#define LIBGEODECOMP_IO_ASYNCPARALLELWRITER_H
+
+#include <libgeodecomp/io/parallelwriter.h>
+#include <libgeodecomp/misc/chronometer.h>
+#include <libgeodecomp/misc/scopedtimer.h>
+#include <libgeodecomp/storage/gridtypeselector.h>
+
+#ifdef LIBGEODECOMP_WITH_MPI
+#include <mpi.h>
+#endif
+
+#include <boost/exception_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <deque>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+namespace LibGeoDecomp {
+
+namespace AsyncParallelWriterHelpers {
+
+/**
+ * Copies a Region from the simulator's grid into a snapshot buffer.
+ * Works for arbitrary source grids, but uses the cheapest path
+ * available: structured grids with AoS layout are copied
+ * Streak-wise, SoA grids are copied member by member via
+ * saveRegion()/loadRegion() to avoid the detour via AoS cells.
+ */
+template<typename BUFFER_GRID_TYPE>
+class CopyRegion
+{
+public:
+    typedef typename BUFFER_GRID_TYPE::CellType CellType;
+    static const int DIM = BUFFER_GRID_TYPE::DIM;
+
+    void operator()(
+        const GridBase<CellType, DIM>& source,
+        BUFFER_GRID_TYPE *target,
+        const Region<DIM>& region)
+    {
+        for (typename Region<DIM>::StreakIterator i = region.beginStreak();
+             i != region.endStreak();
+             ++i) {
+            cells.resize(i->length());
+            source.get(*i, &cells[0]);
+            target->set(*i, &cells[0]);
+        }
+    }
+
+private:
+    std::vector<CellType> cells;
+};
+
+/**
+ * see above
+ */
+template<typename CELL_TYPE, typename TOPOLOGY, bool TOPOLOGICALLY_CORRECT>
+class CopyRegion<SoAGrid<CELL_TYPE, TOPOLOGY, TOPOLOGICALLY_CORRECT> >
+{
+public:
+    typedef SoAGrid<CELL_TYPE, TOPOLOGY, TOPOLOGICALLY_CORRECT> BufferGridType;
+    static const int DIM = BufferGridType::DIM;
+
+    void operator()(
+        const GridBase<CELL_TYPE, DIM>& source,
+        BufferGridType *target,
+        const Region<DIM>& region)
+    {
+        const BufferGridType *soaSource = dynamic_cast<const BufferGridType*>(&source);
+        if (soaSource == 0) {
+            fallback(source, target, region);
+            return;
+        }
+
+        buffer.resize(region.size() * BufferGridType::AGGREGATED_MEMBER_SIZE);
+        if (buffer.empty()) {
+            return;
+        }
+
+        soaSource->saveRegion(&buffer[0], region);
+        target->loadRegion(&buffer[0], region);
+    }
+
+private:
+    std::vector<char> buffer;
+    std::vector<CELL_TYPE> cells;
+
+    void fallback(
+        const GridBase<CELL_TYPE, DIM>& source,
+        BufferGridType *target,
+        const Region<DIM>& region)
+    {
+        for (typename Region<DIM>::StreakIterator i = region.beginStreak();
+             i != region.endStreak();
+             ++i) {
+            cells.resize(i->length());
+            source.get(*i, &cells[0]);
+            target->set(*i, &cells[0]);
+        }
+    }
+};
+
+}
+
+/**
+ * AsyncParallelWriter decouples a ParallelWriter from the simulation:
+ * each call to stepFinished() merely copies the valid region into a
+ * snapshot buffer, which is then handed over to a background thread
+ * that feeds the wrapped writer. This way expensive I/O (e.g. via
+ * BOVWriter or ParallelMPIIOWriter) overlaps with the computation of
+ * the following time steps.
+ *
+ * Partial calls of one time step (e.g. ghost zone and inner set)
+ * are merged into one snapshot, so the wrapped writer is called once
+ * per step, with lastCall set. Calls for different steps may be
+ * interleaved (HiParSimulator delivers the rims of several upcoming
+ * steps before the current inner set), hence partial snapshots are
+ * kept per step. Snapshots only cover the bounding box
+ * of the writer's region (see setRegion()), not the simulator's
+ * whole grid including its ghost zones.
+ *
+ * Snapshot buffers are pooled; at most queueLength time steps are in
+ * flight, plus those which are still being assembled. The simulator will only be blocked if all buffers are in
+ * use, i.e. if the I/O can't keep up with the requested output
+ * frequency. Output is always complete once the simulation has
+ * finished, as the final call (WRITER_ALL_DONE) waits for the queue
+ * to drain.
+ *
+ * Time spent copying is recorded as TimeOutputCopy, time spent
+ * waiting for a free buffer as TimeOutput, and the time the
+ * background thread spent inside the wrapped writer as
+ * TimeOutputDrain. See statistics().
+ *
+ * If MPI has been initialized, it needs to provide
+ * MPI_THREAD_MULTIPLE as the wrapped writer may use MPI (e.g. for
+ * collective I/O) while the simulator continues to communicate from
+ * its own thread. The constructor throws otherwise.
+ */
+template<typename CELL_TYPE>
+class AsyncParallelWriter : public ParallelWriter<CELL_TYPE>
+{
+public:
+    typedef typename ParallelWriter<CELL_TYPE>::GridType GridType;
+    typedef typename ParallelWriter<CELL_TYPE>::Topology Topology;
+    typedef typename APITraits::SelectSoA<CELL_TYPE>::Value SupportsSoA;
+    typedef typename GridTypeSelector<CELL_TYPE, Topology, false, SupportsSoA>::Value BufferGridType;
+    static const int DIM = Topology::DIM;
+
+    /**
+     * Takes ownership of the delegate.
+     */
+    explicit AsyncParallelWriter(
+        ParallelWriter<CELL_TYPE> *delegate,
+        const std::size_t queueLength = 2) :
+        ParallelWriter<CELL_TYPE>(delegate->getPrefix(), delegate->getPeriod()),
+        delegate(delegate),
+        queueLength(queueLength),
+        numBuffers(0),
+        busy(false),
+        shutdown(false)
+    {
+        if (queueLength == 0) {
+            throw std::invalid_argument("queueLength must be positive");
+        }
+        checkThreadSupport();
+
+        thread = boost::thread(&AsyncParallelWriter::drainQueue, this);
+    }
+
+    ~AsyncParallelWriter()
+    {
+        {
+            boost::lock_guard<boost::mutex> lock(mutex);
+            shutdown = true;
+        }
+        jobAdded.notify_one();
+        thread.join();
+    }
+
+    ParallelWriter<CELL_TYPE> *clone() const
+    {
+        return new AsyncParallelWriter(delegate->clone(), queueLength);
+    }
+
+    virtual void setRegion(const Region<DIM>& newRegion)
+    {
+        drain();
+        ParallelWriter<CELL_TYPE>::setRegion(newRegion);
+        delegate->setRegion(newRegion);
+    }
+
+    virtual void stepFinished(
+        const GridType& grid,
+        const Region<DIM>& validRegion,
+        const Coord<DIM>& globalDimensions,
+        unsigned step,
+        WriterEvent event,
+        std::size_t rank,
+        bool lastCall)
+    {
+        typename std::map<unsigned, Job>::iterator pending = pendingJobs.find(step);
+        if (pending == pendingJobs.end()) {
+            CoordBox<DIM> box = region.empty() ? grid.boundingBox() : region.boundingBox();
+            Job job;
+            job.buffer = acquireBuffer(box, grid.getEdge(), grid.topologicalDimensions());
+            pending = pendingJobs.insert(std::make_pair(step, job)).first;
+        }
+        Job& job = pending->second;
+
+        {
+            TimeOutputCopy t(&chronometer);
+            Region<DIM> snapshotRegion = region.empty() ? validRegion : (validRegion & region);
+            copyRegion(grid, &*job.buffer, snapshotRegion);
+            job.validRegion += snapshotRegion;
+        }
+
+        if (!lastCall) {
+            return;
+        }
+
+        job.globalDimensions = globalDimensions;
+        job.step = step;
+        job.event = event;
+        job.rank = rank;
+
+        {
+            boost::lock_guard<boost::mutex> lock(mutex);
+            jobs.push_back(job);
+        }
+        jobAdded.notify_one();
+        pendingJobs.erase(pending);
+
+        if ((event == WRITER_ALL_DONE) && lastCall) {
+            drain();
+        }
+    }
+
+    /**
+     * Blocks until the background thread has handed all pending
+     * snapshots to the wrapped writer. Rethrows any exception the
+     * wrapped writer may have thrown in the meantime.
+     */
+    void drain()
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        while (!jobs.empty() || busy) {
+            jobDone.wait(lock);
+        }
+
+        rethrowError();
+    }
+
+    /**
+     * Copy (TimeOutputCopy), back-pressure (TimeOutput) and
+     * background I/O times (TimeOutputDrain). If
+     * output_time_drain exceeds output_time the I/O was overlapped
+     * with the computation.
+     */
+    Chronometer statistics() const
+    {
+        boost::lock_guard<boost::mutex> lock(mutex);
+        return chronometer + drainChronometer;
+    }
+
+private:
+    /**
+     * A snapshot of one time step, assembled from all calls to
+     * stepFinished() for that step.
+     */
+    class Job
+    {
+    public:
+        boost::shared_ptr<BufferGridType> buffer;
+        Region<DIM> validRegion;
+        Coord<DIM> globalDimensions;
+        unsigned step;
+        WriterEvent event;
+        std::size_t rank;
+    };
+
+    using ParallelWriter<CELL_TYPE>::region;
+
+    boost::shared_ptr<ParallelWriter<CELL_TYPE> > delegate;
+    std::size_t queueLength;
+    std::size_t numBuffers;
+    bool busy;
+    bool shutdown;
+    // snapshots which still await their step's last call:
+    std::map<unsigned, Job> pendingJobs;
+    std::deque<Job> jobs;
+    std::vector<boost::shared_ptr<BufferGridType> > freeBuffers;
+    AsyncParallelWriterHelpers::CopyRegion<BufferGridType> copyRegion;
+    boost::exception_ptr error;
+    Chronometer chronometer;
+    Chronometer drainChronometer;
+    mutable boost::mutex mutex;
+    boost::condition_variable jobAdded;
+    boost::condition_variable jobDone;
+    boost::thread thread;
+
+    boost::shared_ptr<BufferGridType> acquireBuffer(
+        const CoordBox<DIM>& box,
+        const CELL_TYPE& edgeCell,
+        const Coord<DIM>& topologicalDimensions)
+    {
+        boost::shared_ptr<BufferGridType> ret;
+
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            rethrowError();
+
+            // buffers held by pending snapshots won't be released
+            // before further calls, so these don't count:
+            std::size_t maxBuffers = queueLength + pendingJobs.size();
+            if (freeBuffers.empty() && (numBuffers >= maxBuffers)) {
+                TimeOutput t(&chronometer);
+                while (freeBuffers.empty()) {
+                    jobDone.wait(lock);
+                }
+            }
+
+            if (!freeBuffers.empty()) {
+                ret = freeBuffers.back();
+                freeBuffers.pop_back();
+            } else {
+                ++numBuffers;
+            }
+        }
+
+        // the grid's shape may change, e.g. due to load balancing:
+        if (!ret || (ret->boundingBox() != box)) {
+            ret.reset(new BufferGridType(box, CELL_TYPE(), edgeCell, topologicalDimensions));
+        }
+        ret->setEdge(edgeCell);
+
+        return ret;
+    }
+
+    void drainQueue()
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+
+        for (;;) {
+            while (jobs.empty() && !shutdown) {
+                jobAdded.wait(lock);
+            }
+            if (jobs.empty()) {
+                return;
+            }
+
+            Job job = jobs.front();
+            jobs.pop_front();
+            busy = true;
+            double seconds = 0;
+
+            lock.unlock();
+            try {
+                ScopedTimer t(&seconds);
+                delegate->stepFinished(
+                    *job.buffer,
+                    job.validRegion,
+                    job.globalDimensions,
+                    job.step,
+                    job.event,
+                    job.rank,
+                    true);
+            } catch (...) {
+                lock.lock();
+                error = boost::current_exception();
+                lock.unlock();
+            }
+            lock.lock();
+
+            drainChronometer.addTime<TimeOutputDrain>(seconds);
+            freeBuffers.push_back(job.buffer);
+            busy = false;
+            jobDone.notify_all();
+        }
+    }
+
+    void checkThreadSupport()
+    {
+#ifdef LIBGEODECOMP_WITH_MPI
+        int initialized = 0;
+        MPI_Initialized(&initialized);
+        if (!initialized) {
+            return;
+        }
+
+        int provided = MPI_THREAD_SINGLE;
+        MPI_Query_thread(&provided);
+        if (provided < MPI_THREAD_MULTIPLE) {
+            throw std::logic_error("AsyncParallelWriter requires MPI to be initialized with MPI_THREAD_MULTIPLE");
+        }
+#endif
+    }
+
+    /**
+     * Expects mutex to be locked.
+     */
+    void rethrowError()
+    {
+        if (error) {
+            boost::exception_ptr e = error;
+            error = boost::exception_ptr();
+            boost::rethrow_exception(e);
+        }
+    }
+};
+
+}
+
+#endif
+#endif
@@ -0,0 +1,165 @@
+#ifndef LIBGEODECOMP_IO_BLOCKCOMPRESSOR_H
+#define LIBGEODECOMP_IO_BLOCKCOMPRESSOR_H
+
+#include <libgeodecomp/io/deltacodec.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+namespace LibGeoDecomp {
+
+/**
+ * Lossless compression stage for the raw buffers writers produce
+ * (e.g. the output of a Selector). The data is cut into blocks of
+ * roughly blockSize bytes which are compressed independently with
+ * DeltaCodec's byte shuffling and zero run-length encoding (against
+ * an all-zero base). This is most effective when combined with
+ * filters which produce zero bytes, such as TruncatingFilter,
+ * QuantizingFilter or DeltaZigZagFilter, and cheap enough to keep up
+ * with parallel file systems.
+ *
+ * BlockCompressor is a standalone stage: no writer invokes it yet.
+ * Callers compress the buffers they extracted via Selectors
+ * themselves and store the streams (e.g. back to back, see
+ * decompress()). BOVWriter deliberately stays uncompressed, as its
+ * files need to remain readable by VisIt and ParaView.
+ *
+ * Stream layout (all integers are DeltaCodec varints):
+ *
+ *   length, elementSize, blockElements,
+ *   then per block: mode byte, payload length, payload
+ *
+ * where mode is one of ZERO_BLOCK (no payload), ENCODED_BLOCK or
+ * RAW_BLOCK (stored as is, if encoding didn't pay off).
+ */
+class BlockCompressor
+{
+public:
+    enum BlockMode {
+        ZERO_BLOCK = 0,
+        ENCODED_BLOCK = 1,
+        RAW_BLOCK = 2
+    };
+
+    /**
+     * elementSize should match the size of the values to be
+     * compressed so that shuffling groups their bytes by
+     * significance.
+     */
+    explicit BlockCompressor(std::size_t elementSize = 1, std::size_t blockSize = 1 << 16) :
+        elementSize(elementSize),
+        blockElements(std::max<std::size_t>(1, blockSize / std::max<std::size_t>(1, elementSize)))
+    {
+        if (elementSize == 0) {
+            throw std::invalid_argument("BlockCompressor needs a positive element size");
+        }
+    }
+
+    /**
+     * Appends the compressed representation of length bytes at
+     * source to target. length needs to be a multiple of the element
+     * size.
+     */
+    void compress(const char *source, std::size_t length, std::vector<char> *target)
+    {
+        if (length % elementSize) {
+            throw std::invalid_argument("BlockCompressor: length is not a multiple of the element size");
+        }
+
+        DeltaCodec::writeVarint(length, target);
+        DeltaCodec::writeVarint(elementSize, target);
+        DeltaCodec::writeVarint(blockElements, target);
+
+        std::size_t elements = length / elementSize;
+        zeros.resize(std::min(elements, blockElements) * elementSize, 0);
+
+        for (std::size_t offset = 0; offset < elements; offset += blockElements) {
+            std::size_t count = std::min(blockElements, elements - offset);
+            std::size_t blockLength = count * elementSize;
+            const char *block = source + offset * elementSize;
+
+            encoded.clear();
+            if (!codec.encode(&zeros[0], block, elementSize, count, &encoded)) {
+                target->push_back(ZERO_BLOCK);
+                DeltaCodec::writeVarint(0, target);
+            } else if (encoded.size() < blockLength) {
+                target->push_back(ENCODED_BLOCK);
+                DeltaCodec::writeVarint(encoded.size(), target);
+                target->insert(target->end(), encoded.begin(), encoded.end());
+            } else {
+                target->push_back(RAW_BLOCK);
+                DeltaCodec::writeVarint(blockLength, target);
+                target->insert(target->end(), block, block + blockLength);
+            }
+        }
+    }
+
+    /**
+     * Reverses compress(), appending the original data to target.
+     * Returns the number of bytes consumed from source, so that
+     * multiple streams can be stored back to back.
+     */
+    std::size_t decompress(const char *source, std::size_t sourceLength, std::vector<char> *target)
+    {
+        const char *cursor = source;
+        const char *end = source + sourceLength;
+        std::size_t length = DeltaCodec::readVarint(&cursor, end);
+        std::size_t streamElementSize = DeltaCodec::readVarint(&cursor, end);
+        std::size_t streamBlockElements = DeltaCodec::readVarint(&cursor, end);
+        if ((streamElementSize == 0) || (streamBlockElements == 0) || (length % streamElementSize)) {
+            throw std::logic_error("corrupt block compressor header");
+        }
+
+        std::size_t elements = length / streamElementSize;
+        std::size_t outputOffset = target->size();
+        target->resize(outputOffset + length);
+
+        for (std::size_t offset = 0; offset < elements; offset += streamBlockElements) {
+            std::size_t count = std::min(streamBlockElements, elements - offset);
+            std::size_t blockLength = count * streamElementSize;
+            char *block = &(*target)[0] + outputOffset + offset * streamElementSize;
+
+            if (cursor == end) {
+                throw std::logic_error("truncated block compressor stream");
+            }
+            char mode = *cursor++;
+            std::size_t payload = DeltaCodec::readVarint(&cursor, end);
+            if (payload > std::size_t(end - cursor)) {
+                throw std::logic_error("truncated block compressor stream");
+            }
+
+            switch (mode) {
+            case ZERO_BLOCK:
+                std::fill(block, block + blockLength, 0);
+                break;
+            case ENCODED_BLOCK:
+                codec.decode(cursor, payload, streamElementSize, count, block);
+                break;
+            case RAW_BLOCK:
+                if (payload != blockLength) {
+                    throw std::logic_error("corrupt raw block in block compressor stream");
+                }
+                std::copy(cursor, cursor + payload, block);
+                break;
+            default:
+                throw std::logic_error("unknown block mode in block compressor stream");
+            }
+            cursor += payload;
+        }
+
+        return cursor - source;
+    }
+
+private:
+    std::size_t elementSize;
+    std::size_t blockElements;
+    DeltaCodec codec;
+    std::vector<char> zeros;
+    std::vector<char> encoded;
+};
+
+}
+
+#endif
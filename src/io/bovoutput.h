@@ -27,7 +27,35 @@ public:
         int step,
         const CoordBox<DIM>& boundingBox,
         const Coord<3>& brickletDim,
-        const Selector<CELL_TYPE>& selector)
+        const Selector<CELL_TYPE>& selector,
+        std::size_t byteOffset = 0)
+    {
+        writeHeader(
+            filenameBOV,
+            filenameData,
+            step,
+            boundingBox,
+            brickletDim,
+            selector.typeName(),
+            selector.name(),
+            selector.arity(),
+            byteOffset);
+    }
+
+    /**
+     * Writes a header for data with the given number of components
+     * per cell, e.g. if multiple Selectors were combined.
+     */
+    static void writeHeader(
+        const std::string& filenameBOV,
+        const std::string& filenameData,
+        int step,
+        const CoordBox<DIM>& boundingBox,
+        const Coord<3>& brickletDim,
+        const std::string& typeName,
+        const std::string& variableName,
+        int components,
+        std::size_t byteOffset = 0)
     {
         std::ofstream file;
         file.open(filenameBOV.c_str());
@@ -49,14 +77,17 @@ public:
         file << "TIME: " << step << "\n"
              << "DATA_FILE: " << filenameData << "\n"
              << "DATA_SIZE: " << bovDim.x() << " " << bovDim.y() << " " << bovDim.z() << "\n"
-             << "DATA_FORMAT: " << selector.typeName() << "\n"
-             << "VARIABLE: " << selector.name() << "\n"
+             << "DATA_FORMAT: " << typeName << "\n"
+             << "VARIABLE: " << variableName << "\n"
              << "DATA_ENDIAN: LITTLE\n"
              << "BRICK_ORIGIN: " << bovOrigin.x() << " " << bovOrigin.y() << " " << bovOrigin.z() << "\n"
              << "BRICK_SIZE: " << bovDim.x() << " " << bovDim.y() << " " << bovDim.z() << "\n"
              << "DIVIDE_BRICK: true\n"
              << "DATA_BRICKLETS: " << bricDim.x() << " " << bricDim.y() << " " << bricDim.z() << "\n"
-             << "DATA_COMPONENTS: " << selector.arity() << "\n";
+             << "DATA_COMPONENTS: " << components << "\n";
+        if (byteOffset != 0) {
+            file << "BYTE_OFFSET: " << byteOffset << "\n";
+        }
 
         file.close();
     }
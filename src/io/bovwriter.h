@@ -5,19 +5,125 @@
 #ifdef LIBGEODECOMP_WITH_MPI
 
 #include <libgeodecomp/communication/typemaps.h>
+#include <libgeodecomp/io/bovoutput.h>
 #include <libgeodecomp/io/mpiio.h>
 #include <libgeodecomp/io/parallelwriter.h>
 #include <libgeodecomp/misc/clonable.h>
 #include <libgeodecomp/storage/selector.h>
 
+#include <algorithm>
 #include <iomanip>
+#include <map>
 
 namespace LibGeoDecomp {
 
+namespace BOVWriterHelpers {
+
+/**
+ * Owns the MPI resources which BOVWriter keeps across time steps.
+ * Copies start out empty, so clones of a BOVWriter never share (and
+ * double-free) file handles or datatypes.
+ */
+template<int DIM>
+class IOCache
+{
+public:
+    IOCache() :
+        file(MPI_FILE_NULL),
+        fileType(MPI_DATATYPE_NULL),
+        memoryType(MPI_DATATYPE_NULL)
+    {}
+
+    IOCache(const IOCache& /* other */) :
+        file(MPI_FILE_NULL),
+        fileType(MPI_DATATYPE_NULL),
+        memoryType(MPI_DATATYPE_NULL)
+    {}
+
+    ~IOCache()
+    {
+        closeFile();
+        freeTypes();
+    }
+
+    IOCache& operator=(const IOCache& /* other */)
+    {
+        closeFile();
+        freeTypes();
+        return *this;
+    }
+
+    void closeFile()
+    {
+        if (file != MPI_FILE_NULL) {
+            MPI_File_close(&file);
+        }
+    }
+
+    void freeTypes()
+    {
+        if (fileType != MPI_DATATYPE_NULL) {
+            MPI_Type_free(&fileType);
+        }
+        if (memoryType != MPI_DATATYPE_NULL) {
+            MPI_Type_free(&memoryType);
+        }
+        regions.clear();
+    }
+
+    MPI_File file;
+    MPI_Datatype fileType;
+    MPI_Datatype memoryType;
+    // the regions (one per stepFinished() call) which the types
+    // were built for:
+    std::vector<Region<DIM> > regions;
+};
+
+/**
+ * The data which has been packed for a time step which hasn't been
+ * written yet.
+ */
+template<int DIM>
+class PendingSnapshot
+{
+public:
+    std::vector<char> buffer;
+    // one Region per stepFinished() call, in the order of buffer:
+    std::vector<Region<DIM> > regions;
+};
+
+}
+
 /**
  * writes simulation snapshots compatible with VisIt's Brick of Values
  * (BOV) format using MPI-IO. Uses a selector which maps a cell to a
  * primitive data type so that it can be fed into VisIt or ParaView.
+ *
+ * As a ParallelWriter may be called multiple times per time step
+ * (e.g. for the ghost zone and the inner set), each call merely
+ * packs the selected member of its region into a buffer. Buffers are
+ * kept per step as calls for different steps may be interleaved
+ * (e.g. HiParSimulator may deliver the rims of several upcoming steps
+ * before the inner set of the current one). On a step's last call
+ * each rank sets a file view which matches its regions and the data
+ * is written with a single collective call, which lets the MPI-IO
+ * layer aggregate the accesses (two-phase I/O) instead of issuing one
+ * small write per streak. The derived datatypes are
+ * reused as long as the regions don't change, i.e. until the domain
+ * is repartitioned. Only rank 0 touches the header.
+ *
+ * Multiple Selectors can be combined into one multi-component brick
+ * (e.g. density and velocity of a fluid), their values are then
+ * interleaved per cell. The members are extracted in chunks of a few
+ * streaks, one Selector after another, so that each chunk is still
+ * cached when the next Selector reads it. Hence the grid is swept
+ * only once, regardless of the number of Selectors. All Selectors
+ * need to yield the same primitive type.
+ *
+ * With singleDataFile set all snapshots are appended to one data file
+ * (prefix.data), which is opened only once. The headers reference
+ * their snapshot via BYTE_OFFSET. This avoids creating a new file
+ * per snapshot, which is expensive on parallel file systems.
  */
 template<typename CELL_TYPE>
 class BOVWriter : public Clonable<ParallelWriter<CELL_TYPE>, BOVWriter<CELL_TYPE> >
@@ -32,30 +138,63 @@ public:
 
     static const int DIM = Topology::DIM;
 
+    /**
+     * Number of cells extracted per chunk when combining multiple
+     * Selectors.
+     */
+    static const std::size_t CHUNK_CELLS = 1024;
+
     template<typename MEMBER>
     BOVWriter(
         MEMBER CELL_TYPE:: *member,
         const std::string& prefix,
         const unsigned period,
         const Coord<3>& brickletDim = Coord<3>(),
-        const MPI_Comm& communicator = MPI_COMM_WORLD) :
+        const MPI_Comm& communicator = MPI_COMM_WORLD,
+        bool singleDataFile = false) :
         Clonable<ParallelWriter<CELL_TYPE>, BOVWriter<CELL_TYPE> >(prefix, period),
-        selector(member, "var"),
-        brickletDim(brickletDim)
-    {}
+        selectors(1, Selector<CELL_TYPE>(member, "var")),
+        brickletDim(brickletDim),
+        comm(communicator),
+        singleDataFile(singleDataFile),
+        snapshots(0)
+    {
+        init();
+    }
 
     BOVWriter(
         const Selector<CELL_TYPE>& selector,
         const std::string& prefix,
         const unsigned period,
         const Coord<3>& brickletDim = Coord<3>(),
-        const MPI_Comm& communicator = MPI_COMM_WORLD) :
+        const MPI_Comm& communicator = MPI_COMM_WORLD,
+        bool singleDataFile = false) :
         Clonable<ParallelWriter<CELL_TYPE>, BOVWriter<CELL_TYPE> >(prefix, period),
-        selector(selector),
+        selectors(1, selector),
         brickletDim(brickletDim),
         comm(communicator),
-        datatype(selector.mpiDatatype())
-    {}
+        singleDataFile(singleDataFile),
+        snapshots(0)
+    {
+        init();
+    }
+
+    BOVWriter(
+        const std::vector<Selector<CELL_TYPE> >& selectors,
+        const std::string& prefix,
+        const unsigned period,
+        const Coord<3>& brickletDim = Coord<3>(),
+        const MPI_Comm& communicator = MPI_COMM_WORLD,
+        bool singleDataFile = false) :
+        Clonable<ParallelWriter<CELL_TYPE>, BOVWriter<CELL_TYPE> >(prefix, period),
+        selectors(selectors),
+        brickletDim(brickletDim),
+        comm(communicator),
+        singleDataFile(singleDataFile),
+        snapshots(0)
+    {
+        init();
+    }
 
     virtual void stepFinished(
         const typename ParallelWriter<CELL_TYPE>::GridType& grid,
@@ -70,17 +209,65 @@ public:
             return;
         }
 
-        writeHeader(step, globalDimensions);
-        writeRegion(step, globalDimensions, grid, validRegion);
-    }
+        Snapshot& snapshot = pending[step];
+        packRegion(grid, validRegion, &snapshot);
 
+        if (lastCall) {
+            writeHeader(step, globalDimensions);
+            writeRegions(step, globalDimensions, snapshot);
+            pending.erase(step);
+            ++snapshots;
+        }
+    }
 
 private:
+    typedef BOVWriterHelpers::PendingSnapshot<DIM> Snapshot;
+
     MPIIO<CELL_TYPE, Topology> mpiio;
-    Selector<CELL_TYPE> selector;
+    std::vector<Selector<CELL_TYPE> > selectors;
     Coord<3> brickletDim;
     MPI_Comm comm;
     MPI_Datatype datatype;
+    bool singleDataFile;
+    std::size_t snapshots;
+    // bytes per cell and components per cell of all selectors combined:
+    std::size_t cellSize;
+    int components;
+    std::map<unsigned, Snapshot> pending;
+    std::vector<char> scratch;
+    BOVWriterHelpers::IOCache<DIM> cache;
+
+    void init()
+    {
+        if (selectors.empty()) {
+            throw std::invalid_argument("BOVWriter needs at least one Selector");
+        }
+
+        datatype = selectors[0].mpiDatatype();
+        cellSize = 0;
+        components = 0;
+        for (std::size_t i = 0; i < selectors.size(); ++i) {
+            if (selectors[i].typeName() != selectors[0].typeName()) {
+                throw std::invalid_argument(
+                    "BOV requires all components to be of the same type, but Selector " +
+                    selectors[i].name() + " yields " + selectors[i].typeName() +
+                    " instead of " + selectors[0].typeName());
+            }
+
+            cellSize += selectors[i].sizeOfExternal();
+            components += selectors[i].arity();
+        }
+    }
+
+    std::string variableName() const
+    {
+        std::string ret = selectors[0].name();
+        for (std::size_t i = 1; i < selectors.size(); ++i) {
+            ret += "_" + selectors[i].name();
+        }
+
+        return ret;
+    }
 
     std::string filename(unsigned step, const std::string& suffix) const
     {
@@ -89,84 +276,196 @@ private:
         return buf.str();
     }
 
-    void writeHeader(unsigned step, const Coord<DIM>& dimensions)
+    std::string dataFilename(unsigned step) const
     {
-        MPI_File file = mpiio.openFileForWrite(
-            filename(step, "bov"), comm);
-        // fixme: deduce from stepFinished()
-        int rank;
-        MPI_Comm_rank(comm, &rank);
+        return singleDataFile ? (prefix + ".data") : filename(step, "data");
+    }
 
-        if (rank == 0) {
-            // BOV only accepts 3D data, so we'll have to inflate 1D
-            // and 2D dimensions.
-            Coord<DIM> c = dimensions;
-            Coord<3> bovDim = Coord<3>::diagonal(1);
-            for (int i = 0; i < DIM; ++i) {
-                bovDim[i] = c[i];
-            }
+    MPI_Offset snapshotOffset(const Coord<DIM>& dimensions) const
+    {
+        if (!singleDataFile) {
+            return 0;
+        }
+
+        return MPI_Offset(snapshots) * dimensions.prod() * cellSize;
+    }
 
-            Coord<3> bricDim = (brickletDim == Coord<3>()) ? bovDim : brickletDim;
+    template<typename GRID_TYPE>
+    void packRegion(const GRID_TYPE& grid, const Region<DIM>& region, Snapshot *snapshot)
+    {
+        std::vector<char>& buffer = snapshot->buffer;
+        std::size_t offset = buffer.size();
+        buffer.resize(offset + region.size() * cellSize);
+        snapshot->regions << region;
 
-            std::ostringstream buf;
-            buf << "TIME: " << step << "\n"
-                << "DATA_FILE: " << filename(step, "data") << "\n"
-                << "DATA_SIZE: "
-                << bovDim.x() << " " << bovDim.y() << " " << bovDim.z() << "\n"
-                << "DATA_FORMAT: " << selector.typeName() << "\n"
-                << "VARIABLE: " << selector.name() << "\n"
-                << "DATA_ENDIAN: LITTLE\n"
-                << "BRICK_ORIGIN: 0 0 0\n"
-                << "BRICK_SIZE: "
-                << bovDim.x() << " " << bovDim.y() << " " << bovDim.z() << "\n"
-                << "DIVIDE_BRICK: true\n"
-                << "DATA_BRICKLETS: "
-                << bricDim.x() << " " << bricDim.y() << " " << bricDim.z() << "\n"
-                << "DATA_COMPONENTS: " << selector.arity() << "\n";
-            std::string s = buf.str();
-            MPI_File_write(file, const_cast<char*>(s.c_str()), s.length(), MPI_CHAR, MPI_STATUS_IGNORE);
+        if (region.empty()) {
+            return;
         }
 
-        MPI_File_close(&file);
+        if (selectors.size() == 1) {
+            grid.saveMemberUnchecked(&buffer[offset], MemoryLocation::HOST, selectors[0], region);
+            return;
+        }
+
+        Region<DIM> chunk;
+        for (typename Region<DIM>::StreakIterator i = region.beginStreak(); i != region.endStreak(); ++i) {
+            chunk << *i;
+            if (chunk.size() >= CHUNK_CELLS) {
+                offset = packChunk(grid, chunk, offset, &buffer);
+                chunk.clear();
+            }
+        }
+
+        if (!chunk.empty()) {
+            packChunk(grid, chunk, offset, &buffer);
+        }
     }
 
+    /**
+     * Extracts all Selectors' members for the cells in chunk and
+     * interleaves them in buffer, starting at offset. Returns the
+     * offset for the next chunk.
+     */
     template<typename GRID_TYPE>
-    void writeRegion(
-        unsigned step,
-        const Coord<DIM>& dimensions,
+    std::size_t packChunk(
         const GRID_TYPE& grid,
-        const Region<DIM>& region)
-    {
-        MPI_File file = mpiio.openFileForWrite(
-            filename(step, "data"), comm);
-        MPI_Aint varLength = mpiio.getLength(datatype);
-        std::vector<char> buffer;
-
-        for (typename Region<DIM>::StreakIterator i = region.beginStreak();
-             i != region.endStreak();
-             ++i) {
-            // the coords need to be normalized because on torus
-            // topologies the coordnates may exceed the bounding box
-            // (especially negative coordnates may occurr).
-            Coord<DIM> coord = Topology::normalize(i->origin, dimensions);
-            int dataComponents = selector.arity();
-            MPI_Offset index = coord.toIndex(dimensions) * varLength * dataComponents;
-            MPI_File_seek(file, index, MPI_SEEK_SET);
-            int length = i->endX - i->origin.x();
-            std::size_t byteSize = length * selector.sizeOfExternal();
-
-            if (buffer.size() != byteSize) {
-                buffer.resize(byteSize);
+        const Region<DIM>& chunk,
+        std::size_t offset,
+        std::vector<char> *buffer)
+    {
+        std::size_t cells = chunk.size();
+        std::size_t memberOffset = 0;
+
+        for (std::size_t i = 0; i < selectors.size(); ++i) {
+            std::size_t memberSize = selectors[i].sizeOfExternal();
+            scratch.resize(cells * memberSize);
+            grid.saveMemberUnchecked(&scratch[0], MemoryLocation::HOST, selectors[i], chunk);
+
+            const char *source = &scratch[0];
+            char *target = &(*buffer)[offset + memberOffset];
+            for (std::size_t c = 0; c < cells; ++c) {
+                std::copy(source, source + memberSize, target);
+                source += memberSize;
+                target += cellSize;
             }
 
-            Region<DIM> tempRegion;
-            tempRegion << *i;
-            grid.saveMemberUnchecked(&buffer[0], MemoryLocation::HOST, selector, tempRegion);
+            memberOffset += memberSize;
+        }
+
+        return offset + cells * cellSize;
+    }
+
+    void writeHeader(unsigned step, const Coord<DIM>& dimensions)
+    {
+        int rank;
+        MPI_Comm_rank(comm, &rank);
+        if (rank != 0) {
+            return;
+        }
+
+        BOVOutput<CELL_TYPE, DIM>::writeHeader(
+            filename(step, "bov"),
+            dataFilename(step),
+            step,
+            CoordBox<DIM>(Coord<DIM>(), dimensions),
+            brickletDim,
+            selectors[0].typeName(),
+            variableName(),
+            components,
+            snapshotOffset(dimensions));
+    }
+
+    /**
+     * Collective operation, writes the buffer which packRegion() has
+     * filled for this time step.
+     */
+    void writeRegions(unsigned step, const Coord<DIM>& dimensions, const Snapshot& snapshot)
+    {
+        if (snapshot.regions != cache.regions) {
+            cache.freeTypes();
+            buildTypes(dimensions, snapshot.regions);
+            cache.regions = snapshot.regions;
+        }
+
+        MPI_File file = cache.file;
+        if (file == MPI_FILE_NULL) {
+            file = mpiio.openFileForWrite(dataFilename(step), comm);
+        }
+
+        MPI_File_set_view(
+            file,
+            snapshotOffset(dimensions),
+            datatype,
+            cache.fileType,
+            const_cast<char*>("native"),
+            MPI_INFO_NULL);
+        // the buffer may be empty, but MPI wants a valid address:
+        char dummy = 0;
+        char *data = snapshot.buffer.empty() ? &dummy : const_cast<char*>(&snapshot.buffer[0]);
+        MPI_File_write_all(file, data, 1, cache.memoryType, MPI_STATUS_IGNORE);
+
+        if (singleDataFile) {
+            cache.file = file;
+        } else {
+            MPI_File_close(&file);
+        }
+    }
+
+    /**
+     * The file type maps the streaks of all regions packed during a
+     * time step to their location in the global grid. MPI requires
+     * monotonically increasing displacements in file views, hence the
+     * streaks get sorted, the memory type then gathers them from the
+     * buffer in that order.
+     */
+    void buildTypes(const Coord<DIM>& dimensions, const std::vector<Region<DIM> >& regions)
+    {
+        typedef std::pair<MPI_Aint, std::pair<MPI_Aint, int> > Block;
+        std::vector<Block> blocks;
+        MPI_Aint bufferOffset = 0;
+
+        for (typename std::vector<Region<DIM> >::const_iterator r = regions.begin();
+             r != regions.end();
+             ++r) {
+            for (typename Region<DIM>::StreakIterator i = r->beginStreak(); i != r->endStreak(); ++i) {
+                // the coords need to be normalized because on torus
+                // topologies the coordnates may exceed the bounding box
+                // (especially negative coordnates may occurr).
+                Coord<DIM> coord = Topology::normalize(i->origin, dimensions);
+                MPI_Aint fileOffset = MPI_Aint(coord.toIndex(dimensions)) * cellSize;
+                blocks << std::make_pair(fileOffset, std::make_pair(bufferOffset, i->length() * components));
+                bufferOffset += i->length() * cellSize;
+            }
+        }
+        std::sort(blocks.begin(), blocks.end());
 
-            MPI_File_write(file, &buffer[0], length, datatype, MPI_STATUS_IGNORE);
+        std::vector<int> lengths;
+        std::vector<MPI_Aint> fileDisplacements;
+        std::vector<MPI_Aint> memoryDisplacements;
+        lengths.reserve(blocks.size());
+        fileDisplacements.reserve(blocks.size());
+        memoryDisplacements.reserve(blocks.size());
+        for (std::vector<Block>::iterator i = blocks.begin(); i != blocks.end(); ++i) {
+            fileDisplacements << i->first;
+            memoryDisplacements << i->second.first;
+            lengths << i->second.second;
         }
 
-        MPI_File_close(&file);
+        int *lengthsData = lengths.empty() ? 0 : &lengths[0];
+        MPI_Type_create_hindexed(
+            lengths.size(),
+            lengthsData,
+            fileDisplacements.empty() ? 0 : &fileDisplacements[0],
+            datatype,
+            &cache.fileType);
+        MPI_Type_commit(&cache.fileType);
+        MPI_Type_create_hindexed(
+            lengths.size(),
+            lengthsData,
+            memoryDisplacements.empty() ? 0 : &memoryDisplacements[0],
+            datatype,
+            &cache.memoryType);
+        MPI_Type_commit(&cache.memoryType);
     }
 };
 
@@ -14,7 +14,8 @@ namespace LibGeoDecomp {
  * Adapter class whose purpose is to use legacy Writer objects
  * together with a DistributedSimulator. Good for testing, but doesn't
  * scale, as all memory is concentrated on one node and IO is
- * serialized to that node. Use with care!
+ * serialized to that node. Use with care! StreamingCollectingWriter
+ * avoids this for writers which traverse the grid in order.
  */
 template<typename CELL_TYPE>
 class CollectingWriter : public Clonable<ParallelWriter<CELL_TYPE>, CollectingWriter<CELL_TYPE> >
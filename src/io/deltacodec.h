@@ -0,0 +1,162 @@
+#ifndef LIBGEODECOMP_IO_DELTACODEC_H
+#define LIBGEODECOMP_IO_DELTACODEC_H
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+namespace LibGeoDecomp {
+
+/**
+ * DeltaCodec implements a simple, lossless block compression for the
+ * difference of two arrays of equally sized elements (e.g. cells of
+ * two checkpoints). Both arrays are XORed byte by byte and the result
+ * is shuffled so that byte j of all elements is stored
+ * consecutively. Members which didn't change and the exponent/high
+ * order bytes of slowly changing floating point values thus yield
+ * long runs of zeros, which are then run-length encoded.
+ *
+ * The encoded stream is a sequence of pairs (number of zero bytes,
+ * number of literal bytes), both stored as variable length integers,
+ * each followed by the literal bytes themselves.
+ */
+class DeltaCodec
+{
+public:
+    /**
+     * Appends the encoded difference between base and current (each
+     * consisting of count elements of elementSize bytes) to target.
+     * Returns false and leaves target untouched if both are identical.
+     */
+    bool encode(
+        const char *base,
+        const char *current,
+        std::size_t elementSize,
+        std::size_t count,
+        std::vector<char> *target)
+    {
+        std::size_t length = elementSize * count;
+        buffer.resize(length);
+
+        bool changed = false;
+        for (std::size_t i = 0; i < count; ++i) {
+            for (std::size_t j = 0; j < elementSize; ++j) {
+                std::size_t index = i * elementSize + j;
+                char c = base[index] ^ current[index];
+                buffer[j * count + i] = c;
+                changed |= (c != 0);
+            }
+        }
+        if (!changed) {
+            return false;
+        }
+
+        std::size_t i = 0;
+        while (i < length) {
+            std::size_t zeros = 0;
+            while ((i < length) && (buffer[i] == 0)) {
+                ++zeros;
+                ++i;
+            }
+
+            // single zero bytes aren't worth terminating a literal:
+            std::size_t literalStart = i;
+            while ((i < length) &&
+                   ((buffer[i] != 0) ||
+                    ((i + 1 < length) && (buffer[i + 1] != 0)))) {
+                ++i;
+            }
+
+            writeVarint(zeros, target);
+            writeVarint(i - literalStart, target);
+            target->insert(target->end(), &buffer[0] + literalStart, &buffer[0] + i);
+        }
+
+        return true;
+    }
+
+    /**
+     * Reverses encode(): writes the (unshuffled) XOR difference
+     * encoded in source to diff, which needs to hold count elements
+     * of elementSize bytes. Applying it via applyDiff() to the base
+     * yields the current data.
+     */
+    void decode(
+        const char *source,
+        std::size_t sourceLength,
+        std::size_t elementSize,
+        std::size_t count,
+        char *diff)
+    {
+        std::size_t length = elementSize * count;
+        buffer.resize(length);
+
+        const char *end = source + sourceLength;
+        std::size_t i = 0;
+        while (source < end) {
+            std::size_t zeros = readVarint(&source, end);
+            std::size_t literals = readVarint(&source, end);
+            if ((i + zeros + literals > length) || (literals > std::size_t(end - source))) {
+                throw std::logic_error("corrupt delta stream");
+            }
+
+            std::fill(&buffer[0] + i, &buffer[0] + i + zeros, 0);
+            i += zeros;
+            std::copy(source, source + literals, &buffer[0] + i);
+            i += literals;
+            source += literals;
+        }
+        if (i != length) {
+            throw std::logic_error("truncated delta stream");
+        }
+
+        for (std::size_t e = 0; e < count; ++e) {
+            for (std::size_t j = 0; j < elementSize; ++j) {
+                diff[e * elementSize + j] = buffer[j * count + e];
+            }
+        }
+    }
+
+    static void applyDiff(const char *diff, char *target, std::size_t length)
+    {
+        for (std::size_t i = 0; i < length; ++i) {
+            target[i] ^= diff[i];
+        }
+    }
+
+    /**
+     * Variable length integer encoding as used within the stream,
+     * exposed so that container formats can use it for headers.
+     */
+    static void writeVarint(std::size_t value, std::vector<char> *target)
+    {
+        while (value >= 0x80) {
+            target->push_back(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        target->push_back(static_cast<char>(value));
+    }
+
+    static std::size_t readVarint(const char **source, const char *end)
+    {
+        std::size_t ret = 0;
+        for (int shift = 0; *source < end; shift += 7) {
+            unsigned char c = static_cast<unsigned char>(**source);
+            ++*source;
+            ret |= std::size_t(c & 0x7f) << shift;
+            if ((c & 0x80) == 0) {
+                return ret;
+            }
+        }
+
+        throw std::logic_error("truncated varint in delta stream");
+    }
+
+private:
+    std::vector<char> buffer;
+};
+
+}
+
+#endif
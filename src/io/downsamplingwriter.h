@@ -0,0 +1,374 @@
+#ifndef LIBGEODECOMP_IO_DOWNSAMPLINGWRITER_H
+#define LIBGEODECOMP_IO_DOWNSAMPLINGWRITER_H
+
+#include <libgeodecomp/io/parallelwriter.h>
+#include <libgeodecomp/misc/clonable.h>
+#include <libgeodecomp/misc/stdcontaineroverloads.h>
+#include <libgeodecomp/storage/displacedgrid.h>
+#include <libgeodecomp/storage/selector.h>
+
+#include <boost/shared_ptr.hpp>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+namespace LibGeoDecomp {
+
+/**
+ * DownsamplingWriter reduces the data a ParallelWriter has to handle
+ * before it ever reaches it: only cells within a region of interest
+ * (ROI) are considered, and of these only every stride[d]-th cell
+ * along each axis d is passed on. The wrapped writer sees a coarse
+ * grid whose origin corresponds to the origin of the ROI's bounding
+ * box and whose dimensions are the ROI's dimensions divided by the
+ * stride (rounded up). A stride of 1 yields a pure ROI writer, an
+ * empty ROI stands for the whole simulation domain.
+ *
+ * By default a coarse cell is a copy of the first cell of its block
+ * (strided downsampling). Members registered via addAveragedMember()
+ * are replaced by the mean over the block instead. Averaging is done
+ * in situ, without communication, so blocks which straddle a
+ * subdomain boundary are averaged over the part owned by the rank
+ * which owns the block's first cell.
+ *
+ * Each rank intersects its subdomain with the ROI. If
+ * skipEmptyRanks is set, ranks whose subdomain doesn't touch the ROI
+ * never call the wrapped writer. This must not be used with writers
+ * which rely on collective operations (e.g. BOVWriter) as these need
+ * all ranks to participate.
+ *
+ * Calls for partial regions of one time step are merged: the wrapped
+ * writer is invoked once per step, with lastCall set. As calls for
+ * different steps may be interleaved (e.g. HiParSimulator delivers
+ * the rims of several upcoming steps before the current inner set),
+ * the coarse grid and the accumulators are kept per step.
+ *
+ * Like CollectingWriter, clones share the wrapped writer.
+ */
+template<typename CELL_TYPE>
+class DownsamplingWriter : public Clonable<ParallelWriter<CELL_TYPE>, DownsamplingWriter<CELL_TYPE> >
+{
+public:
+    typedef typename ParallelWriter<CELL_TYPE>::GridType GridType;
+    typedef typename ParallelWriter<CELL_TYPE>::Topology Topology;
+    typedef DisplacedGrid<CELL_TYPE, Topology> CoarseGridType;
+    static const int DIM = Topology::DIM;
+
+    using ParallelWriter<CELL_TYPE>::period;
+
+    /**
+     * Takes ownership of the delegate.
+     */
+    explicit DownsamplingWriter(
+        ParallelWriter<CELL_TYPE> *delegate,
+        const Coord<DIM>& stride = Coord<DIM>::diagonal(1),
+        const Region<DIM>& regionOfInterest = Region<DIM>(),
+        bool skipEmptyRanks = false) :
+        Clonable<ParallelWriter<CELL_TYPE>, DownsamplingWriter<CELL_TYPE> >(
+            delegate->getPrefix(), delegate->getPeriod()),
+        delegate(delegate),
+        stride(stride),
+        regionOfInterest(regionOfInterest),
+        skipEmptyRanks(skipEmptyRanks),
+        numComponents(0)
+    {
+        for (int d = 0; d < DIM; ++d) {
+            if (stride[d] <= 0) {
+                throw std::invalid_argument("DownsamplingWriter: stride must be positive");
+            }
+        }
+
+        if (!regionOfInterest.empty()) {
+            origin = regionOfInterest.boundingBox().origin;
+        }
+    }
+
+    /**
+     * Requests the given member to be averaged over each block
+     * rather than sampled. The Selector needs to yield float or
+     * double values, arrays are averaged element-wise.
+     */
+    void addAveragedMember(const Selector<CELL_TYPE>& selector)
+    {
+        if (!selector.template checkTypeID<double>() && !selector.template checkTypeID<float>()) {
+            throw std::invalid_argument("DownsamplingWriter can only average float or double members");
+        }
+
+        averagedMembers << selector;
+        numComponents += selector.arity();
+    }
+
+    virtual void setRegion(const Region<DIM>& newRegion)
+    {
+        ParallelWriter<CELL_TYPE>::setRegion(newRegion);
+
+        Region<DIM> sampledRegion = clip(newRegion);
+        localCoarseRegion = coarsen(sampledRegion);
+        touchedBox = coarseBox(sampledRegion.boundingBox());
+        pendingSteps.clear();
+
+        delegate->setRegion(localCoarseRegion);
+    }
+
+    virtual void stepFinished(
+        const GridType& grid,
+        const Region<DIM>& validRegion,
+        const Coord<DIM>& globalDimensions,
+        unsigned step,
+        WriterEvent event,
+        std::size_t rank,
+        bool lastCall)
+    {
+        if ((event == WRITER_STEP_FINISHED) && (step % period != 0)) {
+            return;
+        }
+        if (skipEmptyRanks && localCoarseRegion.empty()) {
+            return;
+        }
+
+        typename std::map<unsigned, PendingStep>::iterator iter = pendingSteps.find(step);
+        if (iter == pendingSteps.end()) {
+            iter = pendingSteps.insert(std::make_pair(step, PendingStep())).first;
+            initPendingStep(&iter->second);
+        }
+        PendingStep& pending = iter->second;
+
+        Region<DIM> sampledRegion = clip(validRegion);
+        Region<DIM> newCoarseRegion = coarsen(sampledRegion);
+        for (typename Region<DIM>::Iterator i = newCoarseRegion.begin(); i != newCoarseRegion.end(); ++i) {
+            pending.coarseGrid[*i] = grid.get(fineCoord(*i));
+        }
+        pending.region += newCoarseRegion;
+
+        if (!averagedMembers.empty()) {
+            accumulate(grid, sampledRegion, &pending);
+        }
+
+        if (!lastCall) {
+            return;
+        }
+
+        if (!averagedMembers.empty()) {
+            storeAverages(&pending);
+        }
+
+        pending.coarseGrid.setEdge(grid.getEdge());
+        Coord<DIM> dimensions = regionOfInterest.empty() ?
+            globalDimensions : regionOfInterest.boundingBox().dimensions;
+        delegate->stepFinished(
+            pending.coarseGrid,
+            pending.region,
+            coarseDimensions(dimensions),
+            step,
+            event,
+            rank,
+            true);
+        pendingSteps.erase(iter);
+    }
+
+    /**
+     * Maps a region of the simulation grid to the coarse cells it
+     * provides (i.e. those whose block's first cell it contains).
+     */
+    Region<DIM> coarsen(const Region<DIM>& fineRegion) const
+    {
+        Region<DIM> ret;
+        for (typename Region<DIM>::StreakIterator i = fineRegion.beginStreak();
+             i != fineRegion.endStreak();
+             ++i) {
+            Coord<DIM> relativeOrigin = i->origin - origin;
+            bool aligned = true;
+            for (int d = 1; d < DIM; ++d) {
+                aligned &= (relativeOrigin[d] % stride[d] == 0);
+            }
+            if (!aligned) {
+                continue;
+            }
+
+            int startX = (relativeOrigin.x() + stride.x() - 1) / stride.x();
+            int endX   = (i->endX - origin.x() + stride.x() - 1) / stride.x();
+            if (startX < endX) {
+                Coord<DIM> coarseOrigin = divide(relativeOrigin);
+                coarseOrigin.x() = startX;
+                ret << Streak<DIM>(coarseOrigin, endX);
+            }
+        }
+
+        return ret;
+    }
+
+    /**
+     * Returns the dimensions of the coarse grid for a region of
+     * interest (or simulation domain) of the given size.
+     */
+    Coord<DIM> coarseDimensions(const Coord<DIM>& fineDimensions) const
+    {
+        return divide(fineDimensions + stride - Coord<DIM>::diagonal(1));
+    }
+
+private:
+    /**
+     * Coarse cells and accumulated averages of a time step whose last
+     * call is still outstanding.
+     */
+    class PendingStep
+    {
+    public:
+        CoarseGridType coarseGrid;
+        Region<DIM> region;
+        std::vector<double> sums;
+        std::vector<int> counts;
+    };
+
+    boost::shared_ptr<ParallelWriter<CELL_TYPE> > delegate;
+    Coord<DIM> stride;
+    Region<DIM> regionOfInterest;
+    bool skipEmptyRanks;
+    Coord<DIM> origin;
+    std::vector<Selector<CELL_TYPE> > averagedMembers;
+    int numComponents;
+
+    Region<DIM> localCoarseRegion;
+    CoordBox<DIM> touchedBox;
+    std::map<unsigned, PendingStep> pendingSteps;
+    std::vector<CELL_TYPE> cellBuffer;
+    std::vector<char> memberBuffer;
+
+    Region<DIM> clip(const Region<DIM>& region) const
+    {
+        return regionOfInterest.empty() ? region : (region & regionOfInterest);
+    }
+
+    /**
+     * Component-wise division by the stride, relative coordinates
+     * are never negative.
+     */
+    Coord<DIM> divide(const Coord<DIM>& relativeCoord) const
+    {
+        Coord<DIM> ret;
+        for (int d = 0; d < DIM; ++d) {
+            ret[d] = relativeCoord[d] / stride[d];
+        }
+
+        return ret;
+    }
+
+    Coord<DIM> fineCoord(const Coord<DIM>& coarseCoord) const
+    {
+        return origin + coarseCoord.scale(stride);
+    }
+
+    /**
+     * Coarse cells touched by any fine cell within box.
+     */
+    CoordBox<DIM> coarseBox(const CoordBox<DIM>& box) const
+    {
+        if (box.dimensions.prod() == 0) {
+            return CoordBox<DIM>();
+        }
+
+        Coord<DIM> first = divide(box.origin - origin);
+        Coord<DIM> last = divide(box.origin + box.dimensions - Coord<DIM>::diagonal(1) - origin);
+        return CoordBox<DIM>(first, last - first + Coord<DIM>::diagonal(1));
+    }
+
+    void initPendingStep(PendingStep *pending) const
+    {
+        pending->coarseGrid.resize(localCoarseRegion.boundingBox());
+        if (averagedMembers.empty()) {
+            return;
+        }
+
+        std::size_t size = touchedBox.dimensions.prod();
+        pending->sums.assign(size * numComponents, 0);
+        pending->counts.assign(size, 0);
+    }
+
+    std::size_t accumulatorIndex(const Coord<DIM>& coarseCoord) const
+    {
+        return (coarseCoord - touchedBox.origin).toIndex(touchedBox.dimensions);
+    }
+
+    void accumulate(const GridType& grid, const Region<DIM>& sampledRegion, PendingStep *pending)
+    {
+        std::vector<double>& sums = pending->sums;
+        std::vector<int>& counts = pending->counts;
+
+        for (typename Region<DIM>::StreakIterator i = sampledRegion.beginStreak();
+             i != sampledRegion.endStreak();
+             ++i) {
+            std::size_t length = i->length();
+            cellBuffer.resize(length);
+            grid.get(*i, &cellBuffer[0]);
+
+            std::vector<std::size_t> indices(length);
+            Coord<DIM> c = i->origin;
+            for (std::size_t j = 0; j < length; ++j, ++c.x()) {
+                indices[j] = accumulatorIndex(divide(c - origin));
+                ++counts[indices[j]];
+            }
+
+            int component = 0;
+            for (typename std::vector<Selector<CELL_TYPE> >::iterator selector = averagedMembers.begin();
+                 selector != averagedMembers.end();
+                 ++selector) {
+                int arity = selector->arity();
+                memberBuffer.resize(length * arity * selector->sizeOfExternal());
+                selector->copyMemberOut(
+                    &cellBuffer[0], MemoryLocation::HOST, &memberBuffer[0], MemoryLocation::HOST, length);
+
+                for (std::size_t j = 0; j < length; ++j) {
+                    double *sum = &sums[indices[j] * numComponents + component];
+                    for (int k = 0; k < arity; ++k) {
+                        sum[k] += value(*selector, j * arity + k);
+                    }
+                }
+                component += arity;
+            }
+        }
+    }
+
+    void storeAverages(PendingStep *pending)
+    {
+        for (typename Region<DIM>::Iterator i = pending->region.begin(); i != pending->region.end(); ++i) {
+            std::size_t index = accumulatorIndex(*i);
+            double count = pending->counts[index];
+
+            int component = 0;
+            for (typename std::vector<Selector<CELL_TYPE> >::iterator selector = averagedMembers.begin();
+                 selector != averagedMembers.end();
+                 ++selector) {
+                int arity = selector->arity();
+                memberBuffer.resize(arity * selector->sizeOfExternal());
+                for (int k = 0; k < arity; ++k) {
+                    setValue(*selector, k, pending->sums[index * numComponents + component + k] / count);
+                }
+
+                selector->copyMemberIn(
+                    &memberBuffer[0], MemoryLocation::HOST, &pending->coarseGrid[*i], MemoryLocation::HOST, 1);
+                component += arity;
+            }
+        }
+    }
+
+    double value(const Selector<CELL_TYPE>& selector, std::size_t index) const
+    {
+        if (selector.template checkTypeID<double>()) {
+            return reinterpret_cast<const double*>(&memberBuffer[0])[index];
+        }
+        return reinterpret_cast<const float*>(&memberBuffer[0])[index];
+    }
+
+    void setValue(const Selector<CELL_TYPE>& selector, std::size_t index, double value)
+    {
+        if (selector.template checkTypeID<double>()) {
+            reinterpret_cast<double*>(&memberBuffer[0])[index] = value;
+        } else {
+            reinterpret_cast<float*>(&memberBuffer[0])[index] = value;
+        }
+    }
+};
+
+}
+
+#endif
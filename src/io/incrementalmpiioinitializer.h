@@ -0,0 +1,107 @@
+#ifndef LIBGEODECOMP_IO_INCREMENTALMPIIOINITIALIZER_H
+#define LIBGEODECOMP_IO_INCREMENTALMPIIOINITIALIZER_H
+
+#include <libgeodecomp/config.h>
+#ifdef LIBGEODECOMP_WITH_MPI
+
+#include <libgeodecomp/communication/typemaps.h>
+#include <libgeodecomp/io/initializer.h>
+#include <libgeodecomp/io/mpiio.h>
+
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/has_trivial_copy.hpp>
+#include <iomanip>
+#include <sstream>
+
+namespace LibGeoDecomp {
+
+/**
+ * Restarts a simulation from a checkpoint written by
+ * IncrementalMPIIOWriter. The filename may either refer to a full
+ * snapshot (.mpiio) or to a delta (.delta). In the latter case the
+ * corresponding snapshot is expected next to it and is read first,
+ * then the delta is applied on top of it. As deltas are applied byte
+ * by byte, CELL_TYPE needs to be trivially copyable.
+ */
+template<typename CELL_TYPE>
+class IncrementalMPIIOInitializer : public Initializer<CELL_TYPE>
+{
+public:
+    typedef typename APITraits::SelectTopology<CELL_TYPE>::Value Topology;
+    static const int DIM = Topology::DIM;
+    BOOST_STATIC_ASSERT(boost::has_trivial_copy<CELL_TYPE>::value);
+
+    explicit IncrementalMPIIOInitializer(
+        const std::string& filename,
+        const MPI_Comm& comm = MPI_COMM_WORLD) :
+        file(filename),
+        baseFile(filename),
+        communicator(comm)
+    {
+        mpiio.readMetadata(
+            &dimensions, &currentStep, &maximumSteps, file, communicator);
+
+        std::string deltaSuffix = formatStep(currentStep) + ".delta";
+        if ((file.size() >= deltaSuffix.size()) &&
+            (file.compare(file.size() - deltaSuffix.size(), deltaSuffix.size(), deltaSuffix) == 0)) {
+            unsigned baseStep = mpiio.template readDeltaBaseStep<DIM>(file, communicator);
+            baseFile =
+                file.substr(0, file.size() - deltaSuffix.size()) +
+                formatStep(baseStep) + ".mpiio";
+        }
+    }
+
+    virtual void grid(GridBase<CELL_TYPE, DIM> *target)
+    {
+        Region<DIM> region;
+        region << target->boundingBox();
+        mpiio.readRegion(
+            target, baseFile, region, communicator,
+            APITraits::SelectMPIDataType<CELL_TYPE>::value());
+
+        if (baseFile != file) {
+            mpiio.readDelta(target, file, region, communicator);
+        }
+    }
+
+    virtual Coord<DIM> gridDimensions() const
+    {
+        return dimensions;
+    }
+
+    virtual unsigned maxSteps() const
+    {
+        return maximumSteps;
+    }
+
+    virtual unsigned startStep() const
+    {
+        return currentStep;
+    }
+
+    const std::string& baseFilename() const
+    {
+        return baseFile;
+    }
+
+private:
+    std::string file;
+    std::string baseFile;
+    MPI_Comm communicator;
+    MPIIO<CELL_TYPE> mpiio;
+    unsigned currentStep;
+    unsigned maximumSteps;
+    Coord<DIM> dimensions;
+
+    static std::string formatStep(unsigned step)
+    {
+        std::ostringstream buf;
+        buf << std::setfill('0') << std::setw(5) << step;
+        return buf.str();
+    }
+};
+
+}
+
+#endif
+#endif
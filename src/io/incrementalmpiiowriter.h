@@ -0,0 +1,288 @@
+#ifndef LIBGEODECOMP_IO_INCREMENTALMPIIOWRITER_H
+#define LIBGEODECOMP_IO_INCREMENTALMPIIOWRITER_H
+
+#include <libgeodecomp/config.h>
+#ifdef LIBGEODECOMP_WITH_MPI
+
+#include <libgeodecomp/communication/typemaps.h>
+#include <libgeodecomp/io/deltacodec.h>
+#include <libgeodecomp/io/mpiio.h>
+#include <libgeodecomp/io/parallelwriter.h>
+#include <libgeodecomp/misc/clonable.h>
+#include <libgeodecomp/storage/displacedgrid.h>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/has_trivial_copy.hpp>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+namespace LibGeoDecomp {
+
+/**
+ * IncrementalMPIIOWriter is a drop-in replacement for
+ * ParallelMPIIOWriter for large-scale runs where writing full
+ * checkpoints is prohibitively expensive. Only every baseInterval-th
+ * checkpoint is a full snapshot (prefixNNNNN.mpiio, identical to
+ * ParallelMPIIOWriter's format). All other checkpoints
+ * (prefixNNNNN.delta) merely store the difference to the preceding
+ * snapshot: cells are grouped into blocks of up to blockSize cells,
+ * unchanged blocks are skipped and all others are compressed with
+ * DeltaCodec, which also suppresses unchanged members. On slowly
+ * evolving fields this reduces the checkpoint volume by an order of
+ * magnitude or more.
+ *
+ * Deltas always refer to a snapshot, never to other deltas, so a
+ * restart (via IncrementalMPIIOInitializer) needs to read exactly two
+ * files. The price is memory: each node retains a copy of its part of
+ * the latest snapshot.
+ *
+ * Cells are compared and restored byte by byte, so CELL_TYPE needs to
+ * be trivially copyable (no pointers or containers). Padding bytes
+ * are part of the comparison, hence cells should be initialized
+ * consistently (e.g. by copying) to avoid spurious differences.
+ */
+template<typename CELL_TYPE>
+class IncrementalMPIIOWriter : public Clonable<ParallelWriter<CELL_TYPE>, IncrementalMPIIOWriter<CELL_TYPE> >
+{
+public:
+    friend class IncrementalMPIIOWriterTest;
+    typedef typename ParallelWriter<CELL_TYPE>::GridType GridType;
+    typedef typename APITraits::SelectTopology<CELL_TYPE>::Value Topology;
+    typedef MPIIOHelpers::DeltaBlock<Topology::DIM> DeltaBlock;
+    static const int DIM = Topology::DIM;
+    BOOST_STATIC_ASSERT(boost::has_trivial_copy<CELL_TYPE>::value);
+    using ParallelWriter<CELL_TYPE>::period;
+    using ParallelWriter<CELL_TYPE>::prefix;
+
+    IncrementalMPIIOWriter(
+        const std::string& prefix,
+        const unsigned period,
+        const unsigned maxSteps,
+        const unsigned baseInterval = 10,
+        const unsigned blockSize = 4096,
+        const MPI_Comm& communicator = MPI_COMM_WORLD) :
+        Clonable<ParallelWriter<CELL_TYPE>, IncrementalMPIIOWriter<CELL_TYPE> >(prefix, period),
+        maxSteps(maxSteps),
+        baseInterval(baseInterval),
+        blockSize(blockSize),
+        firstStep(0),
+        comm(communicator)
+    {
+        if (baseInterval == 0) {
+            throw std::invalid_argument("baseInterval must be positive");
+        }
+        if (blockSize == 0) {
+            throw std::invalid_argument("blockSize must be positive");
+        }
+    }
+
+    virtual void stepFinished(
+        const GridType& grid,
+        const Region<Topology::DIM>& validRegion,
+        const Coord<Topology::DIM>& globalDimensions,
+        unsigned step,
+        WriterEvent event,
+        std::size_t rank,
+        bool lastCall)
+    {
+        if ((event == WRITER_STEP_FINISHED) && (step % period != 0)) {
+            return;
+        }
+        if (event == WRITER_INITIALIZED) {
+            firstStep = step;
+        }
+
+        unsigned base = baseStep(step);
+        if (base == step) {
+            mpiio.writeRegion(
+                grid,
+                globalDimensions,
+                step,
+                maxSteps,
+                filename(step, "mpiio"),
+                validRegion,
+                APITraits::SelectMPIDataType<CELL_TYPE>::value(),
+                comm);
+            storeSnapshot(grid, validRegion, step);
+            return;
+        }
+
+        Delta& delta = deltas[step];
+        encode(grid, validRegion, globalDimensions, base, &delta);
+        if (!lastCall) {
+            return;
+        }
+
+        mpiio.writeDelta(
+            globalDimensions,
+            step,
+            maxSteps,
+            base,
+            filename(step, "delta"),
+            delta.blocks,
+            delta.payload,
+            comm);
+        deltas.erase(step);
+
+        // older snapshots won't be referenced anymore:
+        snapshots.erase(snapshots.begin(), snapshots.find(base));
+    }
+
+private:
+    /**
+     * A node's part of a full checkpoint.
+     */
+    class Snapshot
+    {
+    public:
+        DisplacedGrid<CELL_TYPE, Topology> grid;
+        Region<DIM> region;
+    };
+
+    /**
+     * Blocks and payload of a delta checkpoint which is still being
+     * assembled (ghost zone and inner set are delivered separately).
+     */
+    class Delta
+    {
+    public:
+        std::vector<DeltaBlock> blocks;
+        std::vector<char> payload;
+    };
+
+    MPIIO<CELL_TYPE> mpiio;
+    unsigned maxSteps;
+    unsigned baseInterval;
+    unsigned blockSize;
+    unsigned firstStep;
+    MPI_Comm comm;
+    std::map<unsigned, boost::shared_ptr<Snapshot> > snapshots;
+    std::map<unsigned, Delta> deltas;
+    std::vector<CELL_TYPE> buffer;
+    std::vector<CELL_TYPE> baseBuffer;
+    DeltaCodec codec;
+
+    /**
+     * The base step is a function of the step only so that all nodes
+     * agree on it without communication, even if calls for
+     * different steps are interleaved.
+     */
+    unsigned baseStep(unsigned step) const
+    {
+        unsigned stride = period * baseInterval;
+        unsigned ret = step / stride * stride;
+        return (std::max)(ret, firstStep);
+    }
+
+    void storeSnapshot(const GridType& grid, const Region<DIM>& validRegion, unsigned step)
+    {
+        boost::shared_ptr<Snapshot>& snapshot = snapshots[step];
+        if (!snapshot) {
+            snapshot.reset(new Snapshot);
+            snapshot->grid.resize(grid.boundingBox());
+        }
+        if (snapshot->grid.boundingBox() != grid.boundingBox()) {
+            throw std::logic_error("grid changed shape while storing snapshot");
+        }
+
+        copy(grid, &snapshot->grid, validRegion);
+        snapshot->region += validRegion;
+    }
+
+    /**
+     * Load balancing may shift cells to nodes which didn't hold them
+     * when the snapshot was taken. These are read back from disk.
+     */
+    Snapshot& fetchSnapshot(const GridType& grid, const Region<DIM>& validRegion, unsigned base)
+    {
+        boost::shared_ptr<Snapshot>& snapshot = snapshots[base];
+        if (!snapshot) {
+            snapshot.reset(new Snapshot);
+        }
+
+        Region<DIM> missing = validRegion - snapshot->region;
+        if (missing.empty()) {
+            return *snapshot;
+        }
+
+        if (snapshot->grid.boundingBox() != grid.boundingBox()) {
+            DisplacedGrid<CELL_TYPE, Topology> newGrid(grid.boundingBox());
+            Region<DIM> retained = snapshot->region & validRegion;
+            copy(snapshot->grid, &newGrid, retained);
+            snapshot->grid = newGrid;
+            snapshot->region = retained;
+            missing = validRegion - retained;
+        }
+
+        mpiio.readRegion(&snapshot->grid, filename(base, "mpiio"), missing, MPI_COMM_SELF);
+        snapshot->region += missing;
+        return *snapshot;
+    }
+
+    void encode(
+        const GridType& grid,
+        const Region<DIM>& validRegion,
+        const Coord<DIM>& globalDimensions,
+        unsigned base,
+        Delta *delta)
+    {
+        Snapshot& snapshot = fetchSnapshot(grid, validRegion, base);
+
+        for (typename Region<DIM>::StreakIterator i = validRegion.beginStreak();
+             i != validRegion.endStreak();
+             ++i) {
+            for (int x = i->origin.x(); x < i->endX; x += blockSize) {
+                Coord<DIM> origin = i->origin;
+                origin.x() = x;
+                Streak<DIM> streak(origin, (std::min)(i->endX, int(x + blockSize)));
+                int length = streak.length();
+
+                buffer.resize(length);
+                baseBuffer.resize(length);
+                grid.get(streak, &buffer[0]);
+                snapshot.grid.get(streak, &baseBuffer[0]);
+
+                std::size_t offset = delta->payload.size();
+                bool changed = codec.encode(
+                    reinterpret_cast<const char*>(&baseBuffer[0]),
+                    reinterpret_cast<const char*>(&buffer[0]),
+                    sizeof(CELL_TYPE),
+                    length,
+                    &delta->payload);
+                if (changed) {
+                    delta->blocks << DeltaBlock(
+                        Topology::normalize(origin, globalDimensions),
+                        length,
+                        offset,
+                        delta->payload.size() - offset);
+                }
+            }
+        }
+    }
+
+    template<typename SOURCE_GRID, typename TARGET_GRID>
+    void copy(const SOURCE_GRID& source, TARGET_GRID *target, const Region<DIM>& region)
+    {
+        for (typename Region<DIM>::StreakIterator i = region.beginStreak();
+             i != region.endStreak();
+             ++i) {
+            buffer.resize(i->length());
+            source.get(*i, &buffer[0]);
+            target->set(*i, &buffer[0]);
+        }
+    }
+
+    std::string filename(unsigned step, const std::string& suffix) const
+    {
+        std::ostringstream buf;
+        buf << prefix << std::setfill('0') << std::setw(5) << step << "." << suffix;
+        return buf.str();
+    }
+};
+
+}
+
+#endif
+#endif
@@ -0,0 +1,631 @@
+#include <libgeodecomp/config.h>
+#include <libgeodecomp/io/ioexception.h>
+#include <libgeodecomp/io/logger.h>
+#include <libgeodecomp/io/matrixmarketreader.h>
+#include <libgeodecomp/misc/stringops.h>
+
+#ifdef LIBGEODECOMP_WITH_THREADS
+#include <omp.h>
+#endif
+
+#ifndef __WIN32__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/make_shared.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace LibGeoDecomp {
+
+namespace {
+
+/**
+ * Read-only view of a whole file. Where available the file is
+ * memory-mapped, otherwise it's read into a buffer.
+ */
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string& fileName) :
+        myData(0),
+        mySize(0)
+    {
+#ifndef __WIN32__
+        int fd = open(fileName.c_str(), O_RDONLY);
+        if (fd == -1) {
+            throw FileOpenException(fileName);
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            throw FileReadException(fileName);
+        }
+
+        mySize = info.st_size;
+        if (mySize > 0) {
+            void *address = mmap(0, mySize, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address == MAP_FAILED) {
+                close(fd);
+                throw FileReadException(fileName);
+            }
+
+            myData = static_cast<const char*>(address);
+            madvise(address, mySize, MADV_SEQUENTIAL);
+        }
+
+        // the mapping remains valid after closing the descriptor:
+        close(fd);
+#else
+        std::ifstream file(fileName.c_str(), std::ios::binary);
+        if (!file) {
+            throw FileOpenException(fileName);
+        }
+
+        buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        mySize = buffer.size();
+        myData = buffer.empty() ? 0 : &buffer[0];
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifndef __WIN32__
+        if (myData) {
+            munmap(const_cast<char*>(myData), mySize);
+        }
+#endif
+    }
+
+    inline const char *data() const
+    {
+        return myData;
+    }
+
+    inline std::size_t size() const
+    {
+        return mySize;
+    }
+
+private:
+    const char *myData;
+    std::size_t mySize;
+#ifdef __WIN32__
+    std::vector<char> buffer;
+#endif
+
+    MappedFile(const MappedFile&);
+    void operator=(const MappedFile&);
+};
+
+/**
+ * Layout of the cache file: the header is followed by the row
+ * pointers and column indices (both int) and the values (double),
+ * which start at the next multiple of 8 bytes. As the file is mapped
+ * at page boundaries, all arrays are suitably aligned.
+ */
+class CacheHeader
+{
+public:
+    char magic[8];
+    boost::uint64_t sourceSize;
+    boost::int64_t sourceModificationTime;
+    boost::int32_t rows;
+    boost::int32_t columns;
+    boost::int32_t nonZeros;
+    boost::int32_t valueSize;
+};
+
+const char CACHE_MAGIC[8] = { 'L', 'G', 'D', 'C', 'S', 'R', 0, 1 };
+
+std::size_t valuesOffset(const CacheHeader& header)
+{
+    std::size_t offset = sizeof(CacheHeader) +
+        sizeof(int) * (std::size_t(header.rows) + 1 + header.nonZeros);
+    return (offset + 7) / 8 * 8;
+}
+
+void fillHeader(const std::string& fileName, CacheHeader *header)
+{
+    std::memset(header, 0, sizeof(CacheHeader));
+    std::copy(CACHE_MAGIC, CACHE_MAGIC + 8, header->magic);
+    header->sourceSize = boost::filesystem::file_size(fileName);
+    header->sourceModificationTime = boost::filesystem::last_write_time(fileName);
+    header->valueSize = sizeof(double);
+}
+
+/**
+ * Minimal scanner for the body of a Matrix Market file. Unlike
+ * strtol() & friends it never reads past end, which is important as
+ * the mapped file isn't NUL-terminated.
+ */
+class Scanner
+{
+public:
+    Scanner(const char *begin, const char *end) :
+        cursor(begin),
+        end(end)
+    {}
+
+    inline bool atEnd() const
+    {
+        return cursor == end;
+    }
+
+    inline void skipBlanks()
+    {
+        while ((cursor != end) && ((*cursor == ' ') || (*cursor == '\t') || (*cursor == '\r'))) {
+            ++cursor;
+        }
+    }
+
+    /**
+     * Moves to the first character of the next line.
+     */
+    inline void nextLine()
+    {
+        cursor = std::find(cursor, end, '\n');
+        if (cursor != end) {
+            ++cursor;
+        }
+    }
+
+    /**
+     * true if the current line contains only blanks or is a comment.
+     */
+    inline bool skippableLine()
+    {
+        skipBlanks();
+        return (cursor == end) || (*cursor == '\n') || (*cursor == '%');
+    }
+
+    inline bool readInt(long *value)
+    {
+        skipBlanks();
+        bool negative = false;
+        if ((cursor != end) && ((*cursor == '-') || (*cursor == '+'))) {
+            negative = (*cursor == '-');
+            ++cursor;
+        }
+
+        if ((cursor == end) || !std::isdigit(static_cast<unsigned char>(*cursor))) {
+            return false;
+        }
+
+        long ret = 0;
+        for (; (cursor != end) && std::isdigit(static_cast<unsigned char>(*cursor)); ++cursor) {
+            int digit = *cursor - '0';
+            if (ret > (std::numeric_limits<long>::max() - digit) / 10) {
+                return false;
+            }
+            ret = ret * 10 + digit;
+        }
+
+        *value = negative ? -ret : ret;
+        return true;
+    }
+
+    inline bool readDouble(double *value)
+    {
+        skipBlanks();
+        char buffer[64];
+        std::size_t length = 0;
+        while ((cursor != end) && (length < (sizeof(buffer) - 1)) &&
+               !std::isspace(static_cast<unsigned char>(*cursor))) {
+            buffer[length++] = *cursor++;
+        }
+        buffer[length] = 0;
+
+        char *tail;
+        *value = std::strtod(buffer, &tail);
+        return (length > 0) && (tail == buffer + length);
+    }
+
+    inline std::string readLine()
+    {
+        const char *lineEnd = std::find(cursor, end, '\n');
+        std::string ret(cursor, lineEnd);
+        cursor = lineEnd;
+        nextLine();
+        return ret;
+    }
+
+    inline const char *position() const
+    {
+        return cursor;
+    }
+
+private:
+    const char *cursor;
+    const char *end;
+};
+
+/**
+ * Entries parsed by one thread, in file order.
+ */
+class Entries
+{
+public:
+    std::vector<int> rows;
+    std::vector<int> columns;
+    std::vector<double> values;
+};
+
+inline bool compareColumns(const std::pair<int, double>& a, const std::pair<int, double>& b)
+{
+    return a.first < b.first;
+}
+
+/**
+ * Parses all entries in [begin, end), which needs to start at a line
+ * boundary. Returns false on malformed input.
+ */
+bool parseEntries(
+    const char *begin,
+    const char *end,
+    bool pattern,
+    long matrixRows,
+    long matrixColumns,
+    Entries *entries)
+{
+    Scanner scanner(begin, end);
+
+    while (!scanner.atEnd()) {
+        if (scanner.skippableLine()) {
+            scanner.nextLine();
+            continue;
+        }
+
+        long row;
+        long column;
+        double value = 1.0;
+
+        if (!scanner.readInt(&row) || !scanner.readInt(&column)) {
+            return false;
+        }
+
+        if (!pattern && !scanner.readDouble(&value)) {
+            return false;
+        }
+
+        // Matrix Market indices are 1-based:
+        if ((row < 1) || (row > matrixRows) || (column < 1) || (column > matrixColumns)) {
+            return false;
+        }
+
+        entries->rows.push_back(row - 1);
+        entries->columns.push_back(column - 1);
+        entries->values.push_back(value);
+        scanner.nextLine();
+    }
+
+    return true;
+}
+
+}
+
+CSRMatrix<double> MatrixMarketReader::read(const std::string& fileName, bool useCache)
+{
+    CSRMatrix<double> ret;
+    if (useCache && loadCache(fileName, &ret)) {
+        LOG(Logger::INFO, "MatrixMarketReader loaded " << fileName << " from cache");
+        return ret;
+    }
+
+    ret = parse(fileName);
+    if (useCache && !writeCache(fileName, ret)) {
+        LOG(Logger::WARN, "MatrixMarketReader could not write cache " << cacheFileName(fileName));
+    }
+
+    return ret;
+}
+
+CSRMatrix<double> MatrixMarketReader::parse(const std::string& fileName)
+{
+    MappedFile file(fileName);
+    const char *end = file.data() + file.size();
+    Scanner scanner(file.data(), end);
+
+    std::string banner = scanner.readLine();
+    std::transform(banner.begin(), banner.end(), banner.begin(), ::tolower);
+    std::vector<std::string> tokens = StringOps::tokenize(banner, " \t\r");
+    if ((tokens.size() != 5) || (tokens[0] != "%%matrixmarket") || (tokens[1] != "matrix")) {
+        throw IOException("Could not process Matrix Market banner in " + fileName);
+    }
+
+    const std::string& format = tokens[2];
+    const std::string& field = tokens[3];
+    const std::string& symmetry = tokens[4];
+    if ((format != "coordinate") ||
+        ((field != "real") && (field != "double") && (field != "integer") && (field != "pattern")) ||
+        ((symmetry != "general") && (symmetry != "symmetric") && (symmetry != "skew-symmetric"))) {
+        throw IOException("Unsupported Matrix Market type \"" + banner + "\" in " + fileName);
+    }
+    bool pattern = (field == "pattern");
+    bool mirror = (symmetry != "general");
+    double mirrorFactor = (symmetry == "skew-symmetric") ? -1 : 1;
+
+    while (scanner.skippableLine() && !scanner.atEnd()) {
+        scanner.nextLine();
+    }
+
+    long rows;
+    long columns;
+    long declaredEntries;
+    if (!scanner.readInt(&rows) || !scanner.readInt(&columns) || !scanner.readInt(&declaredEntries) ||
+        (rows < 0) || (columns < 0) || (declaredEntries < 0) ||
+        (rows >= std::numeric_limits<int>::max()) || (columns > std::numeric_limits<int>::max())) {
+        throw IOException("Could not read dimensions of matrix in " + fileName);
+    }
+    // CSRMatrix counts non-zero entries in an int:
+    if (declaredEntries > std::numeric_limits<int>::max()) {
+        throw IOException("Too many non-zero entries in " + fileName);
+    }
+    scanner.nextLine();
+
+    // split the body into chunks of roughly equal size, each
+    // starting at a line boundary:
+    const char *body = scanner.position();
+    int numChunks = 1;
+#ifdef LIBGEODECOMP_WITH_THREADS
+    numChunks = omp_get_max_threads();
+#endif
+    std::vector<const char*> boundaries(numChunks + 1, end);
+    boundaries[0] = body;
+    for (int i = 1; i < numChunks; ++i) {
+        const char *start = body + (end - body) * i / numChunks;
+        start = (std::max)(start, boundaries[i - 1]);
+        Scanner lineFinder(start, end);
+        if ((start != body) && (start[-1] != '\n')) {
+            lineFinder.nextLine();
+        }
+        boundaries[i] = lineFinder.position();
+    }
+
+    std::vector<Entries> entries(numChunks);
+    std::vector<char> success(numChunks, 0);
+
+#ifdef LIBGEODECOMP_WITH_THREADS
+#pragma omp parallel for schedule(static, 1)
+#endif
+    for (int i = 0; i < numChunks; ++i) {
+        entries[i].rows.reserve(declaredEntries / numChunks + 1);
+        entries[i].columns.reserve(declaredEntries / numChunks + 1);
+        entries[i].values.reserve(declaredEntries / numChunks + 1);
+        success[i] = parseEntries(
+            boundaries[i], boundaries[i + 1], pattern, rows, columns, &entries[i]);
+    }
+
+    long parsedEntries = 0;
+    for (int i = 0; i < numChunks; ++i) {
+        if (!success[i]) {
+            throw IOException("Failed to parse Matrix Market entries in " + fileName);
+        }
+        parsedEntries += entries[i].rows.size();
+    }
+    if (parsedEntries != declaredEntries) {
+        std::stringstream buf;
+        buf << "Expected " << declaredEntries << " entries, but found "
+            << parsedEntries << " in " << fileName;
+        throw IOException(buf.str());
+    }
+
+    // count entries per row, including mirrored ones:
+    std::vector<long> rowLengths(rows + 1, 0);
+    for (int i = 0; i < numChunks; ++i) {
+        for (std::size_t j = 0; j < entries[i].rows.size(); ++j) {
+            ++rowLengths[entries[i].rows[j] + 1];
+            if (mirror && (entries[i].rows[j] != entries[i].columns[j])) {
+                ++rowLengths[entries[i].columns[j] + 1];
+            }
+        }
+    }
+    for (long row = 0; row < rows; ++row) {
+        rowLengths[row + 1] += rowLengths[row];
+    }
+    if (rowLengths[rows] > std::numeric_limits<int>::max()) {
+        throw IOException("Too many non-zero entries in " + fileName);
+    }
+
+    std::vector<int> rowPointers(rowLengths.begin(), rowLengths.end());
+    std::vector<int> columnIndices(rowLengths[rows]);
+    std::vector<double> values(rowLengths[rows]);
+    std::vector<long>().swap(rowLengths);
+
+    // scattering in file order retains the order of columns within
+    // each row for column-major files, which is the common case:
+    std::vector<int> cursors(rowPointers.begin(), rowPointers.end() - 1);
+    for (int i = 0; i < numChunks; ++i) {
+        const Entries& chunk = entries[i];
+        for (std::size_t j = 0; j < chunk.rows.size(); ++j) {
+            int index = cursors[chunk.rows[j]]++;
+            columnIndices[index] = chunk.columns[j];
+            values[index] = chunk.values[j];
+
+            if (mirror && (chunk.rows[j] != chunk.columns[j])) {
+                index = cursors[chunk.columns[j]]++;
+                columnIndices[index] = chunk.rows[j];
+                values[index] = mirrorFactor * chunk.values[j];
+            }
+        }
+    }
+    std::vector<Entries>().swap(entries);
+
+    // sort each row by column. Duplicate entries (which the format
+    // doesn't rule out, e.g. (i, j) and (j, i) in a symmetric file)
+    // are summed up, so each row ends up with strictly increasing
+    // columns and a possibly shorter length:
+    std::vector<int> uniqueLengths(rows);
+#ifdef LIBGEODECOMP_WITH_THREADS
+#pragma omp parallel for schedule(dynamic, 1024)
+#endif
+    for (long row = 0; row < rows; ++row) {
+        uniqueLengths[row] = rowPointers[row + 1] - rowPointers[row];
+        if (uniqueLengths[row] == 0) {
+            continue;
+        }
+
+        int *columnsBegin = &columnIndices[0] + rowPointers[row];
+        int *columnsEnd   = &columnIndices[0] + rowPointers[row + 1];
+        if (std::adjacent_find(columnsBegin, columnsEnd, std::greater_equal<int>()) == columnsEnd) {
+            continue;
+        }
+
+        double *valuesBegin = &values[0] + rowPointers[row];
+        std::vector<std::pair<int, double> > buffer;
+        for (int *i = columnsBegin; i != columnsEnd; ++i) {
+            buffer.push_back(std::make_pair(*i, valuesBegin[i - columnsBegin]));
+        }
+
+        std::stable_sort(buffer.begin(), buffer.end(), compareColumns);
+
+        int length = 0;
+        for (std::size_t i = 0; i < buffer.size(); ++i) {
+            if ((length > 0) && (columnsBegin[length - 1] == buffer[i].first)) {
+                valuesBegin[length - 1] += buffer[i].second;
+                continue;
+            }
+
+            columnsBegin[length] = buffer[i].first;
+            valuesBegin[length] = buffer[i].second;
+            ++length;
+        }
+        uniqueLengths[row] = length;
+    }
+
+    // close the gaps left by merged duplicates:
+    int nonZeros = 0;
+    for (long row = 0; row < rows; ++row) {
+        int begin = rowPointers[row];
+        rowPointers[row] = nonZeros;
+        if (begin != nonZeros) {
+            std::copy(
+                columnIndices.begin() + begin,
+                columnIndices.begin() + begin + uniqueLengths[row],
+                columnIndices.begin() + nonZeros);
+            std::copy(
+                values.begin() + begin,
+                values.begin() + begin + uniqueLengths[row],
+                values.begin() + nonZeros);
+        }
+        nonZeros += uniqueLengths[row];
+    }
+    rowPointers[rows] = nonZeros;
+    columnIndices.resize(nonZeros);
+    values.resize(nonZeros);
+
+    return CSRMatrix<double>(rows, columns, &rowPointers, &columnIndices, &values);
+}
+
+std::string MatrixMarketReader::cacheFileName(const std::string& fileName)
+{
+    return fileName + ".lgdcsr";
+}
+
+bool MatrixMarketReader::loadCache(const std::string& fileName, CSRMatrix<double> *matrix)
+{
+    std::string cacheName = cacheFileName(fileName);
+    if (!boost::filesystem::exists(cacheName) || !boost::filesystem::exists(fileName)) {
+        return false;
+    }
+
+    boost::shared_ptr<MappedFile> file = boost::make_shared<MappedFile>(cacheName);
+    if (file->size() < sizeof(CacheHeader)) {
+        return false;
+    }
+
+    CacheHeader expected;
+    fillHeader(fileName, &expected);
+    CacheHeader header;
+    std::memcpy(&header, file->data(), sizeof(CacheHeader));
+
+    if (!std::equal(header.magic, header.magic + 8, expected.magic) ||
+        (header.sourceSize != expected.sourceSize) ||
+        (header.sourceModificationTime != expected.sourceModificationTime) ||
+        (header.valueSize != expected.valueSize) ||
+        (header.rows < 0) ||
+        (header.nonZeros < 0) ||
+        (file->size() != valuesOffset(header) + sizeof(double) * header.nonZeros)) {
+        return false;
+    }
+
+    const int *rowPointers = reinterpret_cast<const int*>(file->data() + sizeof(CacheHeader));
+    *matrix = CSRMatrix<double>(
+        header.rows,
+        header.columns,
+        header.nonZeros,
+        rowPointers,
+        rowPointers + header.rows + 1,
+        reinterpret_cast<const double*>(file->data() + valuesOffset(header)),
+        file);
+
+    return true;
+}
+
+bool MatrixMarketReader::writeCache(const std::string& fileName, const CSRMatrix<double>& matrix)
+{
+    CacheHeader header;
+    fillHeader(fileName, &header);
+    header.rows = matrix.rows();
+    header.columns = matrix.columns();
+    header.nonZeros = matrix.nonZeros();
+
+    // concurrent readers (e.g. multiple MPI ranks) must never see a
+    // partially written cache, hence the rename:
+    std::string cacheName = cacheFileName(fileName);
+    std::string tempName = boost::filesystem::unique_path(cacheName + ".%%%%-%%%%-%%%%.tmp").string();
+    {
+        std::ofstream file(tempName.c_str(), std::ios::binary);
+        if (!file) {
+            return false;
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(
+            reinterpret_cast<const char*>(matrix.rowPointers()),
+            sizeof(int) * (matrix.rows() + 1));
+        file.write(
+            reinterpret_cast<const char*>(matrix.columnIndices()),
+            sizeof(int) * matrix.nonZeros());
+
+        std::size_t padding = valuesOffset(header) - sizeof(header) -
+            sizeof(int) * (matrix.rows() + 1 + matrix.nonZeros());
+        const char zeros[8] = { 0 };
+        file.write(zeros, padding);
+        file.write(
+            reinterpret_cast<const char*>(matrix.values()),
+            sizeof(double) * matrix.nonZeros());
+
+        if (!file) {
+            file.close();
+            boost::filesystem::remove(tempName);
+            return false;
+        }
+    }
+
+    boost::system::error_code error;
+    boost::filesystem::rename(tempName, cacheName, error);
+    if (error) {
+        boost::filesystem::remove(tempName, error);
+        return false;
+    }
+
+    return true;
+}
+
+}
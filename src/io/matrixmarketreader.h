@@ -0,0 +1,64 @@
+#ifndef LIBGEODECOMP_IO_MATRIXMARKETREADER_H
+#define LIBGEODECOMP_IO_MATRIXMARKETREADER_H
+
+#include <libgeodecomp/storage/csrmatrix.h>
+
+#include <string>
+
+namespace LibGeoDecomp {
+
+/**
+ * MatrixMarketReader loads sparse matrices stored in the Matrix
+ * Market coordinate format (see
+ * http://math.nist.gov/MatrixMarket/formats.html), e.g. to set up the
+ * adjacency of an UnstructuredSoAGrid via GridBase::setWeights().
+ * Real, integer and pattern matrices with general, symmetric and
+ * skew-symmetric storage are supported, symmetric matrices are
+ * expanded to their full form. Duplicate entries are summed up.
+ *
+ * For multi-GB matrices parsing the text representation easily
+ * takes longer than the actual simulation, hence:
+ *
+ * - the file is memory-mapped and split into line-aligned chunks,
+ *   which are parsed by all OpenMP threads in parallel,
+ *
+ * - read() stores the resulting CSR arrays in a binary cache file
+ *   next to the input (see cacheFileName()). Subsequent runs map
+ *   that file and return a CSRMatrix which refers directly to the
+ *   mapping, so no parsing or copying takes place. The cache is
+ *   invalidated whenever the size or modification time of the
+ *   input file changes.
+ */
+class MatrixMarketReader
+{
+public:
+    /**
+     * Returns the matrix stored in fileName, using (and, if
+     * necessary, creating) the binary cache if useCache is set. A
+     * failure to write the cache is not fatal.
+     */
+    static CSRMatrix<double> read(const std::string& fileName, bool useCache = true);
+
+    /**
+     * Parses the Matrix Market file, ignoring any cache.
+     */
+    static CSRMatrix<double> parse(const std::string& fileName);
+
+    static std::string cacheFileName(const std::string& fileName);
+
+    /**
+     * Loads the cache for fileName into matrix. Returns false if
+     * there is no cache or if it doesn't match the input file.
+     */
+    static bool loadCache(const std::string& fileName, CSRMatrix<double> *matrix);
+
+    /**
+     * Stores matrix as the cache for fileName. Returns false if the
+     * cache couldn't be written.
+     */
+    static bool writeCache(const std::string& fileName, const CSRMatrix<double>& matrix);
+};
+
+}
+
+#endif
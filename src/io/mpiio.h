@@ -8,10 +8,80 @@
 #include <libgeodecomp/communication/mpilayer.h>
 #include <libgeodecomp/communication/typemaps.h>
 #include <libgeodecomp/geometry/region.h>
+#include <libgeodecomp/io/deltacodec.h>
 #include <libgeodecomp/loadbalancer/randombalancer.h>
 
+#include <cstring>
+#include <map>
+
 namespace LibGeoDecomp {
 
+namespace MPIIOHelpers {
+
+/**
+ * Entry of the block table in a delta file: a Streak (in normalized
+ * coordinates) and the location of its DeltaCodec-encoded payload,
+ * relative to the beginning of the payload section.
+ *
+ * Entries are stored field by field (see save() and load()), so the
+ * file layout doesn't depend on the padding the compiler inserts
+ * between length and offset.
+ */
+template<int DIM>
+class DeltaBlock
+{
+public:
+    static const std::size_t SERIALIZED_SIZE =
+        (DIM + 1) * sizeof(int) + 2 * sizeof(unsigned long long);
+
+    DeltaBlock(
+        const Coord<DIM>& origin = Coord<DIM>(),
+        int length = 0,
+        unsigned long long offset = 0,
+        unsigned long long size = 0) :
+        origin(origin),
+        length(length),
+        offset(offset),
+        size(size)
+    {}
+
+    void save(char *target) const
+    {
+        for (int d = 0; d < DIM; ++d) {
+            int c = origin[d];
+            std::memcpy(target, &c, sizeof(int));
+            target += sizeof(int);
+        }
+        std::memcpy(target, &length, sizeof(int));
+        target += sizeof(int);
+        std::memcpy(target, &offset, sizeof(unsigned long long));
+        target += sizeof(unsigned long long);
+        std::memcpy(target, &size, sizeof(unsigned long long));
+    }
+
+    void load(const char *source)
+    {
+        for (int d = 0; d < DIM; ++d) {
+            int c;
+            std::memcpy(&c, source, sizeof(int));
+            origin[d] = c;
+            source += sizeof(int);
+        }
+        std::memcpy(&length, source, sizeof(int));
+        source += sizeof(int);
+        std::memcpy(&offset, source, sizeof(unsigned long long));
+        source += sizeof(unsigned long long);
+        std::memcpy(&size, source, sizeof(unsigned long long));
+    }
+
+    Coord<DIM> origin;
+    int length;
+    unsigned long long offset;
+    unsigned long long size;
+};
+
+}
+
 /**
  * Utility class which bundles common MPI-based input/output code.
  */
@@ -133,6 +203,187 @@ public:
         MPI_File_close(&file);
     }
 
+    /**
+     * Delta files complement the snapshots written by writeRegion():
+     * they only hold those cells which differ from a base snapshot
+     * (see IncrementalMPIIOWriter). Each node contributes a list of
+     * blocks, whose offsets refer to its local payload. The file
+     * starts with the same header fields as a snapshot (so
+     * readMetadata() works on both), followed by the base step, the
+     * global block table and finally the payloads of all nodes.
+     */
+    template<int DIM>
+    void writeDelta(
+        const Coord<DIM>& dimensions,
+        unsigned step,
+        unsigned maxSteps,
+        unsigned baseStep,
+        const std::string& filename,
+        std::vector<MPIIOHelpers::DeltaBlock<DIM> > blocks,
+        const std::vector<char>& payload,
+        const MPI_Comm& comm = MPI_COMM_WORLD)
+    {
+        typedef MPIIOHelpers::DeltaBlock<DIM> DeltaBlock;
+
+        unsigned long long localSizes[] = { blocks.size(), payload.size() };
+        unsigned long long offsets[] = { 0, 0 };
+        unsigned long long totalBlocks = 0;
+        MPI_Exscan(localSizes, offsets, 2, MPI_UNSIGNED_LONG_LONG, MPI_SUM, comm);
+        MPI_Allreduce(localSizes, &totalBlocks, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, comm);
+        int rank;
+        MPI_Comm_rank(comm, &rank);
+        if (rank == 0) {
+            // MPI_Exscan leaves the receive buffer on rank 0 undefined:
+            offsets[0] = 0;
+            offsets[1] = 0;
+        }
+
+        for (typename std::vector<DeltaBlock>::iterator i = blocks.begin(); i != blocks.end(); ++i) {
+            i->offset += offsets[1];
+        }
+
+        MPI_File file = openFileForWrite(filename, comm);
+        MPI_Offset tableStart = getDeltaHeaderLength<DIM>();
+        MPI_Offset payloadStart = tableStart + totalBlocks * DeltaBlock::SERIALIZED_SIZE;
+
+        if (rank == 0) {
+            MPI_File_write(file, const_cast<Coord<DIM>*>(&dimensions),
+                           1, Typemaps::lookup<Coord<DIM> >(), MPI_STATUS_IGNORE);
+            MPI_File_write(file, &step,        1, MPI_UNSIGNED,           MPI_STATUS_IGNORE);
+            MPI_File_write(file, &maxSteps,    1, MPI_UNSIGNED,           MPI_STATUS_IGNORE);
+            MPI_File_write(file, &baseStep,    1, MPI_UNSIGNED,           MPI_STATUS_IGNORE);
+            MPI_File_write(file, &totalBlocks, 1, MPI_UNSIGNED_LONG_LONG, MPI_STATUS_IGNORE);
+        }
+
+        if (!blocks.empty()) {
+            std::vector<char> table(blocks.size() * DeltaBlock::SERIALIZED_SIZE);
+            for (std::size_t i = 0; i < blocks.size(); ++i) {
+                blocks[i].save(&table[i * DeltaBlock::SERIALIZED_SIZE]);
+            }
+            writeBytes(
+                file,
+                tableStart + offsets[0] * DeltaBlock::SERIALIZED_SIZE,
+                &table[0],
+                table.size());
+        }
+        if (!payload.empty()) {
+            writeBytes(file, payloadStart + offsets[1], &payload[0], payload.size());
+        }
+
+        MPI_File_close(&file);
+    }
+
+    /**
+     * Returns the step of the snapshot to which the given delta file
+     * refers.
+     */
+    template<int DIM>
+    unsigned readDeltaBaseStep(
+        const std::string& filename,
+        const MPI_Comm& comm = MPI_COMM_WORLD)
+    {
+        MPI_File file = openFileForRead(filename, comm);
+        MPI_Offset offset =
+            getLength(Typemaps::lookup<Coord<DIM> >()) +
+            2 * getLength(MPI_UNSIGNED);
+        unsigned baseStep;
+        MPI_File_read_at(file, offset, &baseStep, 1, MPI_UNSIGNED, MPI_STATUS_IGNORE);
+        MPI_File_close(&file);
+        return baseStep;
+    }
+
+    /**
+     * Applies the differences stored in a delta file to all cells of
+     * grid within region. The grid needs to hold the contents of the
+     * base snapshot, see readDeltaBaseStep().
+     */
+    template<typename GRID_TYPE, int DIM>
+    void readDelta(
+        GRID_TYPE *grid,
+        const std::string& filename,
+        const Region<DIM>& region,
+        const MPI_Comm& comm = MPI_COMM_WORLD)
+    {
+        typedef MPIIOHelpers::DeltaBlock<DIM> DeltaBlock;
+        typedef std::multimap<Coord<DIM>, Streak<DIM> > StreakMap;
+
+        MPI_File file = openFileForRead(filename, comm);
+        Coord<DIM> dimensions = getDimensions<DIM>(file);
+        MPI_Offset tableStart = getDeltaHeaderLength<DIM>();
+        unsigned long long totalBlocks;
+        MPI_File_read_at(
+            file, tableStart - getLength(MPI_UNSIGNED_LONG_LONG),
+            &totalBlocks, 1, MPI_UNSIGNED_LONG_LONG, MPI_STATUS_IGNORE);
+        MPI_Offset payloadStart = tableStart + totalBlocks * DeltaBlock::SERIALIZED_SIZE;
+
+        std::vector<DeltaBlock> blocks(totalBlocks);
+        if (totalBlocks > 0) {
+            std::vector<char> table(totalBlocks * DeltaBlock::SERIALIZED_SIZE);
+            readBytes(file, tableStart, &table[0], table.size());
+            for (std::size_t i = 0; i < blocks.size(); ++i) {
+                blocks[i].load(&table[i * DeltaBlock::SERIALIZED_SIZE]);
+            }
+        }
+
+        // on torus topologies one cell in the file may be mapped to
+        // multiple locations in the grid, hence we look up target
+        // streaks by their normalized origin (with x set to 0):
+        StreakMap targets;
+        for (typename Region<DIM>::StreakIterator i = region.beginStreak();
+             i != region.endStreak();
+             ++i) {
+            Coord<DIM> key = TOPOLOGY::normalize(i->origin, dimensions);
+            key[0] = 0;
+            targets.insert(std::make_pair(key, *i));
+        }
+
+        std::vector<char> payload;
+        std::vector<char> diff;
+        std::vector<CELL_TYPE> cells;
+        DeltaCodec codec;
+
+        for (typename std::vector<DeltaBlock>::iterator block = blocks.begin();
+             block != blocks.end();
+             ++block) {
+            Coord<DIM> key = block->origin;
+            key[0] = 0;
+            std::pair<typename StreakMap::iterator, typename StreakMap::iterator> range =
+                targets.equal_range(key);
+            bool decoded = false;
+
+            for (typename StreakMap::iterator i = range.first; i != range.second; ++i) {
+                const Streak<DIM>& target = i->second;
+                int offsetX = target.origin.x() - TOPOLOGY::normalize(target.origin, dimensions).x();
+                int startX = (std::max)(block->origin.x(), target.origin.x() - offsetX);
+                int endX = (std::min)(block->origin.x() + block->length, target.endX - offsetX);
+                if (startX >= endX) {
+                    continue;
+                }
+
+                if (!decoded) {
+                    payload.resize(block->size);
+                    readBytes(file, payloadStart + block->offset, &payload[0], block->size);
+                    diff.resize(block->length * sizeof(CELL_TYPE));
+                    codec.decode(&payload[0], block->size, sizeof(CELL_TYPE), block->length, &diff[0]);
+                    decoded = true;
+                }
+
+                Coord<DIM> origin = target.origin;
+                origin.x() = startX + offsetX;
+                Streak<DIM> streak(origin, endX + offsetX);
+                cells.resize(endX - startX);
+                grid->get(streak, &cells[0]);
+                DeltaCodec::applyDiff(
+                    &diff[(startX - block->origin.x()) * sizeof(CELL_TYPE)],
+                    reinterpret_cast<char*>(&cells[0]),
+                    cells.size() * sizeof(CELL_TYPE));
+                grid->set(streak, &cells[0]);
+            }
+        }
+
+        MPI_File_close(&file);
+    }
+
     MPI_File openFileForRead(
         const std::string& filename,
         MPI_Comm comm)
@@ -194,6 +445,37 @@ private:
         *headerLength = coordLength + 2 * unsignedLength + *cellLength;
     }
 
+    template<int DIM>
+    MPI_Offset getDeltaHeaderLength()
+    {
+        return
+            getLength(Typemaps::lookup<Coord<DIM> >()) +
+            3 * getLength(MPI_UNSIGNED) +
+            getLength(MPI_UNSIGNED_LONG_LONG);
+    }
+
+    /**
+     * MPI-IO counts are ints, so we need to split large transfers.
+     */
+    void writeBytes(MPI_File file, MPI_Offset offset, const char *data, std::size_t length)
+    {
+        const std::size_t maxChunk = 1 << 30;
+        for (std::size_t i = 0; i < length; i += maxChunk) {
+            int chunk = (std::min)(maxChunk, length - i);
+            MPI_File_write_at(
+                file, offset + i, const_cast<char*>(data + i), chunk, MPI_BYTE, MPI_STATUS_IGNORE);
+        }
+    }
+
+    void readBytes(MPI_File file, MPI_Offset offset, char *data, std::size_t length)
+    {
+        const std::size_t maxChunk = 1 << 30;
+        for (std::size_t i = 0; i < length; i += maxChunk) {
+            int chunk = (std::min)(maxChunk, length - i);
+            MPI_File_read_at(file, offset + i, data + i, chunk, MPI_BYTE, MPI_STATUS_IGNORE);
+        }
+    }
+
     template<int DIM>
     Coord<DIM> getDimensions(MPI_File file)
     {
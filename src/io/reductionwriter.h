@@ -0,0 +1,258 @@
+#include <libgeodecomp/config.h>
+#ifdef LIBGEODECOMP_WITH_MPI
+#ifndef LIBGEODECOMP_IO_REDUCTIONWRITER_H
+#define LIBGEODECOMP_IO_REDUCTIONWRITER_H
+
+#include <libgeodecomp/communication/mpilayer.h>
+#include <libgeodecomp/io/parallelwriter.h>
+#include <libgeodecomp/misc/clonable.h>
+
+#include <algorithm>
+#include <limits>
+#include <list>
+#include <map>
+
+namespace LibGeoDecomp {
+
+namespace ReductionWriterHelpers {
+
+/**
+ * Reduction operators need to provide the MPI_Op for combining
+ * results of different nodes, a matching operator() for local
+ * aggregation and the operator's neutral element. Custom operators
+ * can be added by wrapping an MPI_Op obtained from MPI_Op_create().
+ */
+class Sum
+{
+public:
+    template<typename T>
+    T operator()(const T& a, const T& b) const
+    {
+        return a + b;
+    }
+
+    template<typename T>
+    T neutral() const
+    {
+        return T(0);
+    }
+
+    MPI_Op mpiOp() const
+    {
+        return MPI_SUM;
+    }
+};
+
+/**
+ * see above
+ */
+class Min
+{
+public:
+    template<typename T>
+    T operator()(const T& a, const T& b) const
+    {
+        return (std::min)(a, b);
+    }
+
+    template<typename T>
+    T neutral() const
+    {
+        return (std::numeric_limits<T>::max)();
+    }
+
+    MPI_Op mpiOp() const
+    {
+        return MPI_MIN;
+    }
+};
+
+/**
+ * see above
+ */
+class Max
+{
+public:
+    template<typename T>
+    T operator()(const T& a, const T& b) const
+    {
+        return (std::max)(a, b);
+    }
+
+    template<typename T>
+    T neutral() const
+    {
+        return std::numeric_limits<T>::is_integer ?
+            (std::numeric_limits<T>::min)() :
+            -(std::numeric_limits<T>::max)();
+    }
+
+    MPI_Op mpiOp() const
+    {
+        return MPI_MAX;
+    }
+};
+
+}
+
+/**
+ * The ReductionWriter computes global reductions (sum, min, max or
+ * custom operators) of a selected member of all cells. Each node
+ * aggregates its own region locally and then starts a non-blocking
+ * MPI_Iallreduce() which proceeds in the background while the
+ * simulator updates the next time steps. The reduction is completed
+ * once the writer is called for its next output step (or at the end
+ * of the simulation), which means that result() is always identical
+ * on all nodes and never blocks.
+ *
+ * A typical use case are Steerers which need a global quantity (e.g.
+ * a residual for a convergence check): they just keep a pointer to
+ * the ReductionWriter, see the globalreductions example.
+ */
+template<
+    typename CELL_TYPE,
+    typename MEMBER_TYPE,
+    typename OPERATOR = ReductionWriterHelpers::Sum>
+class ReductionWriter : public Clonable<ParallelWriter<CELL_TYPE>, ReductionWriter<CELL_TYPE, MEMBER_TYPE, OPERATOR> >
+{
+public:
+    typedef typename ParallelWriter<CELL_TYPE>::GridType GridType;
+    typedef typename ParallelWriter<CELL_TYPE>::Topology Topology;
+    typedef Clonable<ParallelWriter<CELL_TYPE>, ReductionWriter<CELL_TYPE, MEMBER_TYPE, OPERATOR> > ParentType;
+    using ParallelWriter<CELL_TYPE>::period;
+    static const int DIM = Topology::DIM;
+
+    explicit ReductionWriter(
+        MEMBER_TYPE CELL_TYPE:: *member,
+        const unsigned period = 1,
+        const OPERATOR& op = OPERATOR(),
+        MPI_Comm communicator = MPI_COMM_WORLD) :
+        ParentType("", period),
+        member(member),
+        op(op),
+        lastStep(0),
+        lastResult(op.template neutral<MEMBER_TYPE>()),
+        mpiLayer(communicator)
+    {}
+
+    ~ReductionWriter()
+    {
+        mpiLayer.wait(MPILayer::GLOBAL_REDUCTION);
+    }
+
+    virtual void stepFinished(
+        const GridType& grid,
+        const Region<DIM>& validRegion,
+        const Coord<DIM>& globalDimensions,
+        unsigned step,
+        WriterEvent event,
+        std::size_t rank,
+        bool lastCall)
+    {
+        if ((event == WRITER_STEP_FINISHED) && (step % period != 0)) {
+            return;
+        }
+
+        typename std::map<unsigned, MEMBER_TYPE>::iterator partial = partials.find(step);
+        if (partial == partials.end()) {
+            partial = partials.insert(std::make_pair(step, op.template neutral<MEMBER_TYPE>())).first;
+        }
+
+        for (typename Region<DIM>::StreakIterator i = validRegion.beginStreak();
+             i != validRegion.endStreak();
+             ++i) {
+            buffer.resize(i->length());
+            grid.get(*i, &buffer[0]);
+
+            for (typename std::vector<CELL_TYPE>::iterator j = buffer.begin(); j != buffer.end(); ++j) {
+                partial->second = op(partial->second, (*j).*member);
+            }
+        }
+
+        if (!lastCall) {
+            return;
+        }
+
+        // the previous reduction had a whole output period to
+        // complete, so waiting for it should be cheap by now:
+        complete();
+
+        pending.push_back(Reduction(step, partial->second));
+        partials.erase(partial);
+        mpiLayer.allReduce(
+            &pending.back().partial,
+            &pending.back().result,
+            1,
+            op.mpiOp(),
+            MPILayer::GLOBAL_REDUCTION,
+            Typemaps::lookup<MEMBER_TYPE>());
+
+        if (event == WRITER_ALL_DONE) {
+            complete();
+        }
+    }
+
+    /**
+     * Returns the latest completed reduction. Non-blocking.
+     */
+    MEMBER_TYPE result() const
+    {
+        return lastResult;
+    }
+
+    /**
+     * The time step to which result() belongs.
+     */
+    unsigned resultStep() const
+    {
+        return lastStep;
+    }
+
+    /**
+     * Blocks until all reductions in flight have completed.
+     */
+    void complete()
+    {
+        if (pending.empty()) {
+            return;
+        }
+
+        mpiLayer.wait(MPILayer::GLOBAL_REDUCTION);
+        lastStep = pending.back().step;
+        lastResult = pending.back().result;
+        pending.clear();
+    }
+
+private:
+    /**
+     * Buffers for a reduction in flight. Kept in a std::list as MPI
+     * will write to these addresses asynchronously.
+     */
+    class Reduction
+    {
+    public:
+        Reduction(unsigned step, const MEMBER_TYPE& partial) :
+            step(step),
+            partial(partial),
+            result(partial)
+        {}
+
+        unsigned step;
+        MEMBER_TYPE partial;
+        MEMBER_TYPE result;
+    };
+
+    MEMBER_TYPE CELL_TYPE:: *member;
+    OPERATOR op;
+    unsigned lastStep;
+    MEMBER_TYPE lastResult;
+    std::map<unsigned, MEMBER_TYPE> partials;
+    std::list<Reduction> pending;
+    std::vector<CELL_TYPE> buffer;
+    MPILayer mpiLayer;
+};
+
+}
+
+#endif
+#endif
@@ -0,0 +1,511 @@
+#ifndef LIBGEODECOMP_IO_STREAMINGCOLLECTINGWRITER_H
+#define LIBGEODECOMP_IO_STREAMINGCOLLECTINGWRITER_H
+
+#include <libgeodecomp/config.h>
+#ifdef LIBGEODECOMP_WITH_MPI
+
+#include <libgeodecomp/communication/mpilayer.h>
+#include <libgeodecomp/io/parallelwriter.h>
+#include <libgeodecomp/io/writer.h>
+#include <libgeodecomp/misc/clonable.h>
+#include <libgeodecomp/storage/displacedgrid.h>
+
+#include <boost/shared_ptr.hpp>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+namespace LibGeoDecomp {
+
+template<typename CELL_TYPE>
+class StreamingCollectingWriter;
+
+namespace StreamingCollectingWriterHelpers {
+
+/**
+ * Read-only view of the global grid which is handed to the serial
+ * writer on the root. Only one chunk of slices is held in memory at
+ * any time; the next one is pulled in from the gather tree as soon
+ * as the writer accesses it. This works for all writers which
+ * traverse the grid in row-major order (e.g. PPMWriter,
+ * SerialBOVWriter, ASCIIWriter). Going back to an earlier chunk is
+ * an error.
+ */
+template<typename CELL_TYPE>
+class StreamingGrid : public GridBase<CELL_TYPE, APITraits::SelectTopology<CELL_TYPE>::Value::DIM>
+{
+public:
+    typedef StreamingCollectingWriter<CELL_TYPE> WriterType;
+    static const int DIM = APITraits::SelectTopology<CELL_TYPE>::Value::DIM;
+
+    StreamingGrid(
+        WriterType *writer,
+        const CoordBox<DIM>& box,
+        const CELL_TYPE& edgeCell) :
+        writer(writer),
+        box(box),
+        edgeCell(edgeCell),
+        currentChunk(-1)
+    {}
+
+    virtual void set(const Coord<DIM>&, const CELL_TYPE&)
+    {
+        throw std::logic_error("StreamingGrid is read-only");
+    }
+
+    virtual void set(const Streak<DIM>&, const CELL_TYPE*)
+    {
+        throw std::logic_error("StreamingGrid is read-only");
+    }
+
+    virtual CELL_TYPE get(const Coord<DIM>& coord) const
+    {
+        if (!box.inBounds(coord)) {
+            return edgeCell;
+        }
+
+        seek(coord[DIM - 1]);
+        return chunk[coord];
+    }
+
+    virtual void get(const Streak<DIM>& streak, CELL_TYPE *cells) const
+    {
+        Coord<DIM> c = streak.origin;
+        for (; c.x() < streak.endX; ++c.x()) {
+            *cells++ = get(c);
+        }
+    }
+
+    virtual void setEdge(const CELL_TYPE& cell)
+    {
+        throw std::logic_error("StreamingGrid is read-only");
+    }
+
+    virtual const CELL_TYPE& getEdge() const
+    {
+        return edgeCell;
+    }
+
+    virtual CoordBox<DIM> boundingBox() const
+    {
+        return box;
+    }
+
+    /**
+     * Receives all chunks the writer didn't ask for so that the
+     * gather tree can complete.
+     */
+    void finish()
+    {
+        int numChunks = writer->numChunks(box.dimensions);
+        while (currentChunk < numChunks - 1) {
+            ++currentChunk;
+            writer->collectChunk(currentChunk, box.dimensions, &chunk, &chunkRegion);
+        }
+    }
+
+protected:
+    virtual void saveMemberImplementation(
+        char *target,
+        MemoryLocation::Location targetLocation,
+        const Selector<CELL_TYPE>& selector,
+        const Region<DIM>& region) const
+    {
+        for (typename Region<DIM>::StreakIterator i = region.beginStreak(); i != region.endStreak(); ++i) {
+            cells.resize(i->length());
+            get(*i, &cells[0]);
+            selector.copyMemberOut(&cells[0], MemoryLocation::HOST, target, targetLocation, i->length());
+            target += selector.sizeOfExternal() * selector.arity() * i->length();
+        }
+    }
+
+    virtual void loadMemberImplementation(
+        const char *source,
+        MemoryLocation::Location sourceLocation,
+        const Selector<CELL_TYPE>& selector,
+        const Region<DIM>& region)
+    {
+        throw std::logic_error("StreamingGrid is read-only");
+    }
+
+private:
+    WriterType *writer;
+    CoordBox<DIM> box;
+    CELL_TYPE edgeCell;
+    mutable int currentChunk;
+    mutable typename WriterType::ChunkGridType chunk;
+    mutable Region<DIM> chunkRegion;
+    mutable std::vector<CELL_TYPE> cells;
+
+    void seek(int slice) const
+    {
+        int index = writer->chunkIndex(slice);
+        if (index < currentChunk) {
+            throw std::logic_error(
+                "writer accessed the grid out of order, StreamingCollectingWriter "
+                "needs row-major access, consider CollectingWriter instead");
+        }
+
+        while (currentChunk < index) {
+            ++currentChunk;
+            writer->collectChunk(currentChunk, box.dimensions, &chunk, &chunkRegion);
+        }
+    }
+};
+
+}
+
+/**
+ * Scalable alternative to CollectingWriter which makes legacy Writer
+ * objects usable with a DistributedSimulator without ever holding
+ * the whole grid on one node. The grid is cut into chunks of
+ * slicesPerChunk slices along the last axis (rows in 2D, planes in
+ * 3D), which are gathered along a binomial tree: each rank merges its
+ * own cells of a chunk with those received from its children and
+ * forwards the result to its parent. The root hands a StreamingGrid
+ * to the wrapped writer, which pulls in one chunk after another as
+ * it traverses the grid, so the data is pipelined straight into the
+ * writer.
+ *
+ * Memory is bounded by a few chunks per rank (plus the rank's own
+ * cells). Leaves of the tree (half of all ranks) merely post
+ * non-blocking sends and return to the computation at once; inner
+ * ranks keep at most two chunks in flight and thus progress with the
+ * root. The wrapped writer needs to access the grid in row-major
+ * order, which all file-based writers do. Use CollectingWriter for
+ * writers with random access patterns (e.g. VisItWriter).
+ *
+ * Calls for different steps may be interleaved (HiParSimulator
+ * delivers the rims of several upcoming steps before the current
+ * inner set), so a rank's cells are buffered per step until that
+ * step's last call.
+ */
+template<typename CELL_TYPE>
+class StreamingCollectingWriter : public Clonable<ParallelWriter<CELL_TYPE>, StreamingCollectingWriter<CELL_TYPE> >
+{
+public:
+    friend class StreamingCollectingWriterHelpers::StreamingGrid<CELL_TYPE>;
+
+    typedef typename ParallelWriter<CELL_TYPE>::Topology Topology;
+    typedef typename ParallelWriter<CELL_TYPE>::GridType SimulatorGridType;
+    static const int DIM = Topology::DIM;
+    typedef DisplacedGrid<CELL_TYPE, typename Topologies::Cube<DIM>::Topology> ChunkGridType;
+    typedef StreamingCollectingWriterHelpers::StreamingGrid<CELL_TYPE> StreamingGridType;
+
+    using ParallelWriter<CELL_TYPE>::period;
+
+    /**
+     * writer is only required (and allowed) on the root.
+     */
+    explicit StreamingCollectingWriter(
+        Writer<CELL_TYPE> *writer,
+        int slicesPerChunk = 8,
+        int root = 0,
+        MPI_Comm communicator = MPI_COMM_WORLD,
+        MPI_Datatype mpiDatatype = APITraits::SelectMPIDataType<CELL_TYPE>::value()) :
+        Clonable<ParallelWriter<CELL_TYPE>, StreamingCollectingWriter<CELL_TYPE> >("", 1),
+        writer(writer),
+        slicesPerChunk(slicesPerChunk),
+        mpiLayer(communicator),
+        root(root),
+        datatype(mpiDatatype)
+    {
+        if (slicesPerChunk <= 0) {
+            throw std::invalid_argument("slicesPerChunk must be positive");
+        }
+        if ((mpiLayer.rank() != root) && (writer != 0)) {
+            throw std::invalid_argument("can't call back a writer on a node other than the root");
+        }
+
+        if (mpiLayer.rank() == root) {
+            if (writer == 0) {
+                throw std::invalid_argument("delegate writer on root must not be null");
+            }
+
+            period = writer->getPeriod();
+        }
+
+        period = mpiLayer.broadcast(period, root);
+        initTree();
+    }
+
+    virtual void stepFinished(
+        const SimulatorGridType& grid,
+        const Region<DIM>& validRegion,
+        const Coord<DIM>& globalDimensions,
+        unsigned step,
+        WriterEvent event,
+        std::size_t rank,
+        bool lastCall)
+    {
+        if ((event == WRITER_STEP_FINISHED) && (step % period != 0)) {
+            return;
+        }
+
+        typename std::map<unsigned, PendingStep>::iterator pending = pendingSteps.find(step);
+        if (pending == pendingSteps.end()) {
+            pending = pendingSteps.insert(std::make_pair(step, PendingStep())).first;
+            pending->second.grid = acquireGrid();
+        }
+
+        ChunkGridType& pendingGrid = *pending->second.grid;
+        CoordBox<DIM> box = grid.boundingBox();
+        if (pendingGrid.boundingBox() != box) {
+            pendingGrid.resize(box);
+        }
+        for (typename Region<DIM>::StreakIterator i = validRegion.beginStreak();
+             i != validRegion.endStreak();
+             ++i) {
+            grid.get(*i, &pendingGrid[i->origin]);
+        }
+        pending->second.region += validRegion;
+
+        if (!lastCall) {
+            return;
+        }
+
+        // collectChunk() reads from localGrid and localRegion:
+        localGrid = pending->second.grid;
+        localRegion = pending->second.region;
+        pendingSteps.erase(pending);
+
+        // sends of the previous step need to be complete before we
+        // can reuse the buffers:
+        mpiLayer.waitAll();
+
+        if (mpiLayer.rank() == root) {
+            StreamingGridType globalGrid(
+                this,
+                CoordBox<DIM>(Coord<DIM>(), globalDimensions),
+                grid.getEdge());
+
+            try {
+                writer->stepFinished(globalGrid, step, event);
+            } catch (...) {
+                globalGrid.finish();
+                releaseLocalGrid();
+                throw;
+            }
+            globalGrid.finish();
+        } else {
+            forwardChunks(globalDimensions);
+        }
+
+        releaseLocalGrid();
+    }
+
+    /**
+     * Returns the ranks which send their chunks to this rank.
+     */
+    const std::vector<int>& getChildren() const
+    {
+        return children;
+    }
+
+    int getParent() const
+    {
+        return parent;
+    }
+
+private:
+    /**
+     * Outgoing chunk, kept alive until its sends are complete.
+     */
+    class Message
+    {
+    public:
+        unsigned numStreaks;
+        std::vector<Streak<DIM> > streaks;
+        std::vector<CELL_TYPE> cells;
+    };
+
+    /**
+     * This rank's cells of a step whose last call is outstanding.
+     */
+    class PendingStep
+    {
+    public:
+        boost::shared_ptr<ChunkGridType> grid;
+        Region<DIM> region;
+    };
+
+    boost::shared_ptr<Writer<CELL_TYPE> > writer;
+    int slicesPerChunk;
+    MPILayer mpiLayer;
+    int root;
+    MPI_Datatype datatype;
+    int parent;
+    std::vector<int> children;
+    std::map<unsigned, PendingStep> pendingSteps;
+    boost::shared_ptr<ChunkGridType> localGrid;
+    Region<DIM> localRegion;
+    // grids of completed steps, reused to avoid reallocation:
+    std::vector<boost::shared_ptr<ChunkGridType> > spareGrids;
+    ChunkGridType chunkGrid;
+    Region<DIM> chunkRegion;
+    std::vector<Message> outbox;
+    std::vector<Streak<DIM> > streakBuffer;
+    std::vector<CELL_TYPE> cellBuffer;
+
+    /**
+     * Binomial tree rooted at root: with ranks relabeled relative to
+     * the root, rank r's parent is r with its lowest set bit
+     * cleared.
+     */
+    void initTree()
+    {
+        int size = mpiLayer.size();
+        int relativeRank = (mpiLayer.rank() - root + size) % size;
+        parent = -1;
+        children.clear();
+
+        for (int mask = 1; mask < size; mask <<= 1) {
+            if (relativeRank & mask) {
+                parent = (relativeRank - mask + root) % size;
+                break;
+            }
+            if (relativeRank + mask < size) {
+                children << (relativeRank + mask + root) % size;
+            }
+        }
+    }
+
+    boost::shared_ptr<ChunkGridType> acquireGrid()
+    {
+        if (spareGrids.empty()) {
+            return boost::shared_ptr<ChunkGridType>(new ChunkGridType);
+        }
+
+        boost::shared_ptr<ChunkGridType> ret = spareGrids.back();
+        spareGrids.pop_back();
+        return ret;
+    }
+
+    void releaseLocalGrid()
+    {
+        spareGrids << localGrid;
+        localGrid.reset();
+        localRegion.clear();
+    }
+
+    int numChunks(const Coord<DIM>& globalDimensions) const
+    {
+        return (globalDimensions[DIM - 1] + slicesPerChunk - 1) / slicesPerChunk;
+    }
+
+    int chunkIndex(int slice) const
+    {
+        return slice / slicesPerChunk;
+    }
+
+    CoordBox<DIM> chunkBox(int chunk, const Coord<DIM>& globalDimensions) const
+    {
+        Coord<DIM> origin;
+        origin[DIM - 1] = chunk * slicesPerChunk;
+        Coord<DIM> dimensions = globalDimensions;
+        dimensions[DIM - 1] = std::min(slicesPerChunk, globalDimensions[DIM - 1] - origin[DIM - 1]);
+
+        return CoordBox<DIM>(origin, dimensions);
+    }
+
+    /**
+     * Assembles the given chunk from this rank's cells and those of
+     * its subtree. Cells not covered by region retain arbitrary
+     * values.
+     */
+    void collectChunk(
+        int chunk,
+        const Coord<DIM>& globalDimensions,
+        ChunkGridType *target,
+        Region<DIM> *region)
+    {
+        CoordBox<DIM> box = chunkBox(chunk, globalDimensions);
+        if (target->boundingBox() != box) {
+            target->resize(box);
+        }
+
+        Region<DIM> boxRegion;
+        boxRegion << box;
+        *region = localRegion & boxRegion;
+        for (typename Region<DIM>::StreakIterator i = region->beginStreak(); i != region->endStreak(); ++i) {
+            const CELL_TYPE *source = &(*localGrid)[i->origin];
+            std::copy(source, source + i->length(), &(*target)[i->origin]);
+        }
+
+        for (std::vector<int>::iterator child = children.begin(); child != children.end(); ++child) {
+            MPI_Comm comm = mpiLayer.communicator();
+            int tag = MPILayer::COLLECTING_WRITER + chunk % 2;
+
+            unsigned numStreaks;
+            MPI_Recv(&numStreaks, 1, MPI_UNSIGNED, *child, tag, comm, MPI_STATUS_IGNORE);
+            if (numStreaks == 0) {
+                continue;
+            }
+
+            streakBuffer.resize(numStreaks);
+            MPI_Recv(
+                &streakBuffer[0], numStreaks, Typemaps::lookup<Streak<DIM> >(), *child, tag, comm, MPI_STATUS_IGNORE);
+            Region<DIM> childRegion;
+            childRegion.load(streakBuffer.begin(), streakBuffer.end());
+
+            cellBuffer.resize(childRegion.size());
+            MPI_Recv(&cellBuffer[0], cellBuffer.size(), datatype, *child, tag, comm, MPI_STATUS_IGNORE);
+
+            const CELL_TYPE *cursor = &cellBuffer[0];
+            for (typename std::vector<Streak<DIM> >::iterator i = streakBuffer.begin();
+                 i != streakBuffer.end();
+                 ++i) {
+                std::copy(cursor, cursor + i->length(), &(*target)[i->origin]);
+                cursor += i->length();
+            }
+
+            *region += childRegion;
+        }
+    }
+
+    /**
+     * Pushes all chunks of this rank's subtree to its parent. Leaves
+     * keep one message per chunk and return immediately, inner nodes
+     * reuse two messages and thus wait for the parent to catch up.
+     */
+    void forwardChunks(const Coord<DIM>& globalDimensions)
+    {
+        int chunks = numChunks(globalDimensions);
+        bool isLeaf = children.empty();
+        outbox.resize(isLeaf ? chunks : 2);
+
+        for (int chunk = 0; chunk < chunks; ++chunk) {
+            int tag = MPILayer::COLLECTING_WRITER + chunk % 2;
+            if (!isLeaf) {
+                mpiLayer.wait(tag);
+            }
+
+            collectChunk(chunk, globalDimensions, &chunkGrid, &chunkRegion);
+
+            Message& message = outbox[isLeaf ? chunk : (chunk % 2)];
+            message.streaks = chunkRegion.toVector();
+            message.numStreaks = message.streaks.size();
+            message.cells.resize(chunkRegion.size());
+            CELL_TYPE *cursor = message.cells.empty() ? 0 : &message.cells[0];
+            for (typename std::vector<Streak<DIM> >::iterator i = message.streaks.begin();
+                 i != message.streaks.end();
+                 ++i) {
+                const CELL_TYPE *source = &chunkGrid[i->origin];
+                cursor = std::copy(source, source + i->length(), cursor);
+            }
+
+            mpiLayer.send(&message.numStreaks, parent, 1, tag, MPI_UNSIGNED);
+            if (message.numStreaks > 0) {
+                mpiLayer.send(
+                    &message.streaks[0], parent, message.numStreaks, tag, Typemaps::lookup<Streak<DIM> >());
+                mpiLayer.send(&message.cells[0], parent, message.cells.size(), tag, datatype);
+            }
+        }
+    }
+};
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,272 @@
+#ifndef LIBGEODECOMP_IO_TELEMETRYWRITER_H
+#define LIBGEODECOMP_IO_TELEMETRYWRITER_H
+
+#include <libgeodecomp/io/ioexception.h>
+#include <libgeodecomp/io/parallelwriter.h>
+#include <libgeodecomp/io/writer.h>
+#include <libgeodecomp/misc/chronometer.h>
+#include <libgeodecomp/misc/clonable.h>
+#include <libgeodecomp/misc/scopedtimer.h>
+#include <libgeodecomp/parallelization/simulator.h>
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace LibGeoDecomp {
+
+/**
+ * TelemetryWriter records the performance counters of all ranks
+ * (i.e. the Chronometers returned by
+ * Simulator::gatherStatistics()) as a time series, so that load
+ * imbalance or the share of communication can be charted over the
+ * course of a run. Every period steps it collects the delta of each
+ * event since the last record, reduces it across ranks to min, max,
+ * mean and imbalance (max / mean - 1) and appends a record to a
+ * file, which is written by rank 0 only.
+ *
+ * Gathering the statistics is a collective operation, hence the
+ * writer needs to be added on all ranks. It needs access to the
+ * Simulator it's attached to:
+ *
+ *   sim.addWriter(new TelemetryWriter<Cell>(&sim, "telemetry.csv", 10));
+ *
+ * Two formats are available:
+ *
+ * - CSV: one line per record with columns step, wall_time and
+ *   EVENT_min, EVENT_max, EVENT_mean, EVENT_imbalance for each
+ *   event (see Chronometer for the event names).
+ *
+ * - BINARY: the magic string "LGDTELEM", followed by the uint32
+ *   values version, number of ranks and number of events, followed
+ *   by the zero-terminated event names. Each record consists of the
+ *   uint32 step, the double wall_time, min, max, mean and imbalance
+ *   for each event (as doubles, event-major) and finally the raw
+ *   per-rank deltas (rank-major). All values are stored in native
+ *   byte order.
+ *
+ * wall_time is the time which elapsed since the previous record, as
+ * measured on rank 0. Some Simulators reset their Chronometers (e.g.
+ * when balancing the load). A reset zeroes all events at once, so a
+ * rank counts as reset if any of its totals decreased. Its deltas are
+ * then the totals since the reset, time spent before the reset
+ * within the current period is lost.
+ *
+ * For a human-readable progress report see TracingWriter.
+ */
+template<typename CELL_TYPE>
+class TelemetryWriter :
+        public Clonable<Writer<CELL_TYPE>, TelemetryWriter<CELL_TYPE> >,
+        public Clonable<ParallelWriter<CELL_TYPE>, TelemetryWriter<CELL_TYPE> >
+{
+public:
+    typedef typename Writer<CELL_TYPE>::GridType WriterGridType;
+    typedef typename ParallelWriter<CELL_TYPE>::GridType ParallelWriterGridType;
+    typedef typename ParallelWriter<CELL_TYPE>::Topology Topology;
+
+    static const int DIM = Topology::DIM;
+    static const std::size_t NUM_EVENTS = Chronometer::NUM_INTERVALS;
+    static const boost::uint32_t VERSION = 1;
+
+    enum Format {
+        CSV,
+        BINARY
+    };
+
+    TelemetryWriter(
+        Simulator<CELL_TYPE> *simulator,
+        const std::string& filename,
+        const unsigned period = 1,
+        Format format = CSV) :
+        Clonable<Writer<CELL_TYPE>, TelemetryWriter<CELL_TYPE> >(filename, period),
+        Clonable<ParallelWriter<CELL_TYPE>, TelemetryWriter<CELL_TYPE> >(filename, period),
+        simulator(simulator),
+        filename(filename),
+        format(format),
+        lastTime(0)
+    {}
+
+    virtual void stepFinished(const WriterGridType& grid, unsigned step, WriterEvent event)
+    {
+        if ((event == WRITER_STEP_FINISHED) && (step % Writer<CELL_TYPE>::period != 0)) {
+            return;
+        }
+
+        record(step, event, 0);
+    }
+
+    virtual void stepFinished(
+        const ParallelWriterGridType& grid,
+        const Region<DIM>& validRegion,
+        const Coord<DIM>& globalDimensions,
+        unsigned step,
+        WriterEvent event,
+        std::size_t rank,
+        bool lastCall)
+    {
+        if (lastCall) {
+            record(step, event, rank);
+        }
+    }
+
+private:
+    Simulator<CELL_TYPE> *simulator;
+    std::string filename;
+    Format format;
+    boost::shared_ptr<std::ofstream> file;
+    std::vector<Chronometer> lastStatistics;
+    double lastTime;
+
+    void record(unsigned step, WriterEvent event, std::size_t rank)
+    {
+        // collective, so all ranks need to participate:
+        std::vector<Chronometer> statistics = simulator->gatherStatistics();
+        if (rank != 0) {
+            return;
+        }
+        double now = ScopedTimer::time();
+
+        if (event == WRITER_INITIALIZED) {
+            open(statistics.size());
+        } else {
+            writeRecord(step, now - lastTime, statistics);
+        }
+
+        lastStatistics = statistics;
+        lastTime = now;
+
+        if (event == WRITER_ALL_DONE) {
+            file->close();
+            file.reset();
+        }
+    }
+
+    void open(std::size_t numRanks)
+    {
+        std::ios_base::openmode mode = std::ios::out | std::ios::trunc;
+        if (format == BINARY) {
+            mode |= std::ios::binary;
+        }
+        file.reset(new std::ofstream(filename.c_str(), mode));
+        if (!*file) {
+            throw FileOpenException(filename);
+        }
+
+        ChronometerHelpers::EventToString toString;
+
+        if (format == CSV) {
+            *file << "step,wall_time";
+            for (std::size_t i = 0; i < NUM_EVENTS; ++i) {
+                std::string name = toString(i);
+                *file << "," << name << "_min"
+                      << "," << name << "_max"
+                      << "," << name << "_mean"
+                      << "," << name << "_imbalance";
+            }
+            *file << "\n";
+        } else {
+            *file << "LGDTELEM";
+            write<boost::uint32_t>(VERSION);
+            write<boost::uint32_t>(numRanks);
+            write<boost::uint32_t>(NUM_EVENTS);
+            for (std::size_t i = 0; i < NUM_EVENTS; ++i) {
+                std::string name = toString(i);
+                file->write(name.c_str(), name.size() + 1);
+            }
+        }
+
+        check();
+    }
+
+    void writeRecord(unsigned step, double wallTime, const std::vector<Chronometer>& statistics)
+    {
+        if (!file) {
+            throw std::logic_error("TelemetryWriter received step before initialization");
+        }
+        if (statistics.size() != lastStatistics.size()) {
+            throw std::logic_error("number of ranks must not change during a run");
+        }
+
+        std::vector<double> deltas;
+        for (std::size_t rank = 0; rank < statistics.size(); ++rank) {
+            const Chronometer& current = statistics[rank];
+            bool reset = wasReset(current, lastStatistics[rank]);
+
+            for (std::size_t i = 0; i < NUM_EVENTS; ++i) {
+                double base = reset ? 0 : lastStatistics[rank].interval(i);
+                deltas.push_back(current.interval(i) - base);
+            }
+        }
+
+        if (format == CSV) {
+            *file << step << "," << std::setprecision(9) << wallTime;
+        } else {
+            write<boost::uint32_t>(step);
+            write(wallTime);
+        }
+
+        for (std::size_t i = 0; i < NUM_EVENTS; ++i) {
+            double min = deltas[i];
+            double max = deltas[i];
+            double sum = 0;
+            for (std::size_t rank = 0; rank < statistics.size(); ++rank) {
+                double delta = deltas[rank * NUM_EVENTS + i];
+                min = (std::min)(min, delta);
+                max = (std::max)(max, delta);
+                sum += delta;
+            }
+            double mean = sum / statistics.size();
+            double imbalance = (mean == 0) ? 0 : (max / mean - 1);
+
+            if (format == CSV) {
+                *file << "," << min << "," << max << "," << mean << "," << imbalance;
+            } else {
+                write(min);
+                write(max);
+                write(mean);
+                write(imbalance);
+            }
+        }
+
+        if (format == CSV) {
+            *file << "\n";
+        } else {
+            file->write(reinterpret_cast<const char*>(&deltas[0]), deltas.size() * sizeof(double));
+        }
+
+        check();
+    }
+
+    static bool wasReset(const Chronometer& current, const Chronometer& last)
+    {
+        for (std::size_t i = 0; i < NUM_EVENTS; ++i) {
+            if (current.interval(i) < last.interval(i)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    template<typename T>
+    void write(T value)
+    {
+        file->write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void check()
+    {
+        if (!*file) {
+            throw FileWriteException(filename);
+        }
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,343 @@
+#include <libgeodecomp/config.h>
+#include <libgeodecomp/geometry/partitions/stripingpartition.h>
+#include <libgeodecomp/io/asyncparallelwriter.h>
+#include <libgeodecomp/io/paralleltestwriter.h>
+#include <libgeodecomp/io/testinitializer.h>
+#include <libgeodecomp/misc/clonable.h>
+#include <libgeodecomp/misc/testcell.h>
+#include <libgeodecomp/parallelization/hiparsimulator.h>
+
+#include <boost/assign/std/vector.hpp>
+#include <boost/shared_ptr.hpp>
+#include <cxxtest/TestSuite.h>
+
+using namespace boost::assign;
+using namespace LibGeoDecomp;
+
+#ifdef LIBGEODECOMP_WITH_THREADS
+
+namespace LibGeoDecomp {
+
+namespace AsyncParallelWriterTestHelpers {
+
+/**
+ * Records which data it has seen and takes its time doing so.
+ */
+class SlowWriter : public Clonable<ParallelWriter<TestCell<2> >, SlowWriter>
+{
+public:
+    typedef ParallelWriter<TestCell<2> >::GridType GridType;
+
+    class Record
+    {
+    public:
+        Record(unsigned step, WriterEvent event, bool lastCall, double sum) :
+            step(step),
+            event(event),
+            lastCall(lastCall),
+            sum(sum)
+        {}
+
+        bool operator==(const Record& other) const
+        {
+            return
+                (step == other.step) &&
+                (event == other.event) &&
+                (lastCall == other.lastCall) &&
+                (sum == other.sum);
+        }
+
+        unsigned step;
+        WriterEvent event;
+        bool lastCall;
+        double sum;
+        // not compared, snapshots may differ in size from the grid:
+        CoordBox<2> gridBox;
+    };
+
+    SlowWriter(
+        boost::shared_ptr<std::vector<Record> > records,
+        int delayMilliseconds,
+        unsigned failingStep = unsigned(-1)) :
+        Clonable<ParallelWriter<TestCell<2> >, SlowWriter>("", 1),
+        records(records),
+        delayMilliseconds(delayMilliseconds),
+        failingStep(failingStep)
+    {}
+
+    virtual void stepFinished(
+        const GridType& grid,
+        const Region<2>& validRegion,
+        const Coord<2>& globalDimensions,
+        unsigned step,
+        WriterEvent event,
+        std::size_t rank,
+        bool lastCall)
+    {
+        boost::this_thread::sleep(boost::posix_time::milliseconds(delayMilliseconds));
+        if (step == failingStep) {
+            throw std::runtime_error("SlowWriter failed as requested");
+        }
+
+        double sum = 0;
+        for (Region<2>::Iterator i = validRegion.begin(); i != validRegion.end(); ++i) {
+            sum += grid.get(*i).testValue;
+        }
+
+        *records << Record(step, event, lastCall, sum);
+        records->back().gridBox = grid.boundingBox();
+    }
+
+private:
+    boost::shared_ptr<std::vector<Record> > records;
+    int delayMilliseconds;
+    unsigned failingStep;
+};
+
+}
+
+class AsyncParallelWriterTest : public CxxTest::TestSuite
+{
+public:
+    typedef AsyncParallelWriterTestHelpers::SlowWriter SlowWriter;
+    typedef SlowWriter::Record Record;
+    typedef APITraits::SelectTopology<TestCell<2> >::Value Topology;
+    typedef DisplacedGrid<TestCell<2>, Topology> GridType;
+
+    void setUp()
+    {
+        dim = Coord<2>(20, 10);
+        box = CoordBox<2>(Coord<2>(), dim);
+        grid = GridType(box);
+        region.clear();
+        region << box;
+        ghost.clear();
+        ghost << CoordBox<2>(Coord<2>(0, 0), Coord<2>(dim.x(), 2));
+        inner = region - ghost;
+        records.reset(new std::vector<Record>);
+    }
+
+    void testSnapshotsAreDecoupledFromGrid()
+    {
+        if (!mpiIsThreadSafe()) {
+            return;
+        }
+
+        AsyncParallelWriter<TestCell<2> > writer(new SlowWriter(records, 20), 4);
+        writer.setRegion(region);
+
+        fill(1);
+        writer.stepFinished(grid, ghost, dim, 0, WRITER_INITIALIZED,   0, false);
+        writer.stepFinished(grid, inner, dim, 0, WRITER_INITIALIZED,   0, true);
+        fill(2);
+        writer.stepFinished(grid, ghost, dim, 1, WRITER_STEP_FINISHED, 0, false);
+        writer.stepFinished(grid, inner, dim, 1, WRITER_STEP_FINISHED, 0, true);
+        fill(3);
+        writer.stepFinished(grid, region, dim, 2, WRITER_ALL_DONE,     0, true);
+
+        // WRITER_ALL_DONE waits for the queue to drain. Partial
+        // calls get merged, one call per step remains:
+        std::vector<Record> expected;
+        expected << Record(0, WRITER_INITIALIZED,   true,  1.0 * region.size())
+                 << Record(1, WRITER_STEP_FINISHED, true,  2.0 * region.size())
+                 << Record(2, WRITER_ALL_DONE,      true,  3.0 * region.size());
+        TS_ASSERT_EQUALS(expected.size(), records->size());
+        TS_ASSERT(expected == *records);
+    }
+
+    void testSnapshotsCoverOwnRegionOnly()
+    {
+        if (!mpiIsThreadSafe()) {
+            return;
+        }
+
+        AsyncParallelWriter<TestCell<2> > writer(new SlowWriter(records, 0), 2);
+        Region<2> ownRegion;
+        ownRegion << CoordBox<2>(Coord<2>(5, 3), Coord<2>(10, 4));
+        writer.setRegion(ownRegion);
+
+        fill(1);
+        // the ghost zone lies partly outside of our own region:
+        writer.stepFinished(grid, ghost,  dim, 0, WRITER_INITIALIZED, 0, false);
+        writer.stepFinished(grid, region, dim, 0, WRITER_INITIALIZED, 0, true);
+        writer.drain();
+
+        TS_ASSERT_EQUALS(std::size_t(1), records->size());
+        TS_ASSERT_EQUALS(ownRegion.boundingBox(), (*records)[0].gridBox);
+        TS_ASSERT_EQUALS(1.0 * ownRegion.size(), (*records)[0].sum);
+    }
+
+    void testBackPressure()
+    {
+        if (!mpiIsThreadSafe()) {
+            return;
+        }
+
+        AsyncParallelWriter<TestCell<2> > writer(new SlowWriter(records, 50), 1);
+        writer.setRegion(region);
+
+        for (unsigned step = 0; step < 3; ++step) {
+            fill(step);
+            writer.stepFinished(grid, region, dim, step, WRITER_STEP_FINISHED, 0, true);
+        }
+        // the first step could be handed over immediately, the
+        // following ones needed to wait for the buffer:
+        TS_ASSERT(records->size() >= 1);
+        writer.drain();
+        TS_ASSERT_EQUALS(std::size_t(3), records->size());
+
+        Chronometer statistics = writer.statistics();
+        TS_ASSERT_LESS_THAN(0.05, statistics.interval<TimeOutput>());
+        TS_ASSERT_LESS_THAN(0.14, statistics.interval<TimeOutputDrain>());
+        TS_ASSERT_LESS_THAN(0.0,  statistics.interval<TimeOutputCopy>());
+
+        for (unsigned step = 0; step < 3; ++step) {
+            TS_ASSERT_EQUALS(1.0 * step * region.size(), (*records)[step].sum);
+        }
+    }
+
+    void testInterleavedSteps()
+    {
+        if (!mpiIsThreadSafe()) {
+            return;
+        }
+
+        AsyncParallelWriter<TestCell<2> > writer(new SlowWriter(records, 10), 1);
+        writer.setRegion(region);
+
+        fill(1);
+        writer.stepFinished(grid, ghost, dim, 1, WRITER_STEP_FINISHED, 0, false);
+        fill(2);
+        writer.stepFinished(grid, ghost, dim, 2, WRITER_STEP_FINISHED, 0, false);
+        fill(3);
+        writer.stepFinished(grid, ghost, dim, 3, WRITER_STEP_FINISHED, 0, false);
+        fill(10);
+        writer.stepFinished(grid, inner, dim, 1, WRITER_STEP_FINISHED, 0, true);
+        fill(20);
+        writer.stepFinished(grid, inner, dim, 2, WRITER_STEP_FINISHED, 0, true);
+        fill(30);
+        writer.stepFinished(grid, inner, dim, 3, WRITER_STEP_FINISHED, 0, true);
+        writer.drain();
+
+        std::vector<Record> expected;
+        for (unsigned step = 1; step < 4; ++step) {
+            double sum = 1.0 * step * ghost.size() + 10.0 * step * inner.size();
+            expected << Record(step, WRITER_STEP_FINISHED, true, sum);
+        }
+        TS_ASSERT_EQUALS(expected.size(), records->size());
+        TS_ASSERT(expected == *records);
+    }
+
+    void testErrorsArePropagated()
+    {
+        if (!mpiIsThreadSafe()) {
+            return;
+        }
+
+        AsyncParallelWriter<TestCell<2> > writer(new SlowWriter(records, 0, 1), 2);
+        writer.setRegion(region);
+
+        writer.stepFinished(grid, region, dim, 0, WRITER_STEP_FINISHED, 0, true);
+        writer.stepFinished(grid, region, dim, 1, WRITER_STEP_FINISHED, 0, true);
+        TS_ASSERT_THROWS(writer.drain(), std::runtime_error&);
+
+        // the error is reported only once:
+        writer.stepFinished(grid, region, dim, 2, WRITER_STEP_FINISHED, 0, true);
+        writer.drain();
+        TS_ASSERT_EQUALS(std::size_t(2), records->size());
+    }
+
+    void testWithHiParSimulator()
+    {
+        if (!mpiIsThreadSafe()) {
+            return;
+        }
+
+        unsigned maxSteps = 50;
+        TestInitializer<TestCell<2> > *init = new TestInitializer<TestCell<2> >(
+            Coord<2>(30, 20), maxSteps);
+        HiParSimulator<TestCell<2>, StripingPartition<2> > sim(init, 0, 1000, 3);
+
+        std::vector<unsigned> expectedSteps;
+        std::vector<WriterEvent> expectedEvents;
+        expectedSteps << 0
+                      << 10
+                      << 20
+                      << 30
+                      << 40
+                      << 50;
+        expectedEvents << WRITER_INITIALIZED
+                       << WRITER_STEP_FINISHED
+                       << WRITER_STEP_FINISHED
+                       << WRITER_STEP_FINISHED
+                       << WRITER_STEP_FINISHED
+                       << WRITER_ALL_DONE;
+
+        sim.addWriter(new AsyncParallelWriter<TestCell<2> >(
+                          new ParallelTestWriter<TestCell<2> >(10, expectedSteps, expectedEvents)));
+        sim.run();
+    }
+
+    void testWithHiParSimulatorAndPeriodBelowGhostZoneWidth()
+    {
+        if (!mpiIsThreadSafe()) {
+            return;
+        }
+
+        unsigned maxSteps = 20;
+        TestInitializer<TestCell<2> > *init = new TestInitializer<TestCell<2> >(
+            Coord<2>(30, 20), maxSteps);
+        HiParSimulator<TestCell<2>, StripingPartition<2> > sim(init, 0, 1000, 3);
+
+        std::vector<unsigned> expectedSteps;
+        std::vector<WriterEvent> expectedEvents;
+        for (unsigned step = 0; step <= maxSteps; ++step) {
+            expectedSteps << step;
+            expectedEvents << WRITER_STEP_FINISHED;
+        }
+        expectedEvents.front() = WRITER_INITIALIZED;
+        expectedEvents.back() = WRITER_ALL_DONE;
+
+        sim.addWriter(new AsyncParallelWriter<TestCell<2> >(
+                          new ParallelTestWriter<TestCell<2> >(1, expectedSteps, expectedEvents)));
+        sim.run();
+    }
+
+private:
+    Coord<2> dim;
+    CoordBox<2> box;
+    GridType grid;
+    Region<2> region;
+    Region<2> ghost;
+    Region<2> inner;
+    boost::shared_ptr<std::vector<Record> > records;
+
+    /**
+     * AsyncParallelWriter refuses to work if MPI wasn't initialized
+     * with MPI_THREAD_MULTIPLE (which some MPI builds can't provide).
+     */
+    bool mpiIsThreadSafe()
+    {
+        int provided = MPI_THREAD_SINGLE;
+        MPI_Query_thread(&provided);
+        if (provided < MPI_THREAD_MULTIPLE) {
+            TS_WARN("skipping test as MPI doesn't provide MPI_THREAD_MULTIPLE");
+            return false;
+        }
+
+        return true;
+    }
+
+    void fill(unsigned value)
+    {
+        for (CoordBox<2>::Iterator i = box.begin(); i != box.end(); ++i) {
+            TestCell<2> cell = grid.get(*i);
+            cell.testValue = value;
+            grid.set(*i, cell);
+        }
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,274 @@
+#include <libgeodecomp/geometry/partitions/stripingpartition.h>
+#include <libgeodecomp/io/downsamplingwriter.h>
+#include <libgeodecomp/io/parallelmemorywriter.h>
+#include <libgeodecomp/io/testinitializer.h>
+#include <libgeodecomp/misc/clonable.h>
+#include <libgeodecomp/misc/testcell.h>
+#include <libgeodecomp/parallelization/hiparsimulator.h>
+
+#include <boost/shared_ptr.hpp>
+#include <cxxtest/TestSuite.h>
+
+using namespace LibGeoDecomp;
+
+namespace LibGeoDecomp {
+
+namespace DownsamplingWriterTestHelpers {
+
+/**
+ * Keeps a copy of everything it receives.
+ */
+class RecordingWriter : public Clonable<ParallelWriter<TestCell<2> >, RecordingWriter>
+{
+public:
+    typedef ParallelWriter<TestCell<2> >::GridType GridType;
+    typedef DisplacedGrid<TestCell<2>, Topologies::Cube<2>::Topology> StorageGridType;
+
+    class Record
+    {
+    public:
+        StorageGridType grid;
+        Region<2> validRegion;
+        Coord<2> globalDimensions;
+        unsigned step;
+        bool lastCall;
+    };
+
+    explicit RecordingWriter(boost::shared_ptr<std::vector<Record> > records) :
+        Clonable<ParallelWriter<TestCell<2> >, RecordingWriter>("", 1),
+        records(records)
+    {}
+
+    virtual void stepFinished(
+        const GridType& grid,
+        const Region<2>& validRegion,
+        const Coord<2>& globalDimensions,
+        unsigned step,
+        WriterEvent event,
+        std::size_t rank,
+        bool lastCall)
+    {
+        Record record;
+        record.grid.resize(validRegion.boundingBox());
+        for (Region<2>::Iterator i = validRegion.begin(); i != validRegion.end(); ++i) {
+            record.grid[*i] = grid.get(*i);
+        }
+        record.validRegion = validRegion;
+        record.globalDimensions = globalDimensions;
+        record.step = step;
+        record.lastCall = lastCall;
+
+        *records << record;
+    }
+
+    const Region<2>& getRegion() const
+    {
+        return region;
+    }
+
+private:
+    boost::shared_ptr<std::vector<Record> > records;
+};
+
+}
+
+class DownsamplingWriterTest : public CxxTest::TestSuite
+{
+public:
+    typedef DownsamplingWriterTestHelpers::RecordingWriter RecordingWriter;
+    typedef RecordingWriter::Record Record;
+    typedef DisplacedGrid<TestCell<2>, Topologies::Cube<2>::Topology> GridType;
+
+    void setUp()
+    {
+        dim = Coord<2>(20, 10);
+        box = CoordBox<2>(Coord<2>(), dim);
+        grid = GridType(box);
+        for (CoordBox<2>::Iterator i = box.begin(); i != box.end(); ++i) {
+            grid[*i].pos = *i;
+            grid[*i].testValue = i->x() + 100 * i->y();
+        }
+
+        region.clear();
+        region << box;
+        ghost.clear();
+        ghost << CoordBox<2>(Coord<2>(0, 0), Coord<2>(dim.x(), 3));
+        inner = region - ghost;
+        records.reset(new std::vector<Record>);
+    }
+
+    void testStridedRegionOfInterest()
+    {
+        Region<2> roi;
+        roi << CoordBox<2>(Coord<2>(3, 2), Coord<2>(10, 7));
+        RecordingWriter *delegate = new RecordingWriter(records);
+        DownsamplingWriter<TestCell<2> > writer(delegate, Coord<2>(2, 3), roi);
+        writer.setRegion(region);
+
+        Region<2> expectedRegion;
+        expectedRegion << CoordBox<2>(Coord<2>(0, 0), Coord<2>(5, 3));
+        TS_ASSERT_EQUALS(expectedRegion, delegate->getRegion());
+
+        // partial calls are merged:
+        writer.stepFinished(grid, ghost, dim, 4, WRITER_STEP_FINISHED, 0, false);
+        TS_ASSERT_EQUALS(std::size_t(0), records->size());
+        writer.stepFinished(grid, inner, dim, 4, WRITER_STEP_FINISHED, 0, true);
+        TS_ASSERT_EQUALS(std::size_t(1), records->size());
+
+        Record& record = (*records)[0];
+        TS_ASSERT_EQUALS(4u, record.step);
+        TS_ASSERT(record.lastCall);
+        TS_ASSERT_EQUALS(Coord<2>(5, 3), record.globalDimensions);
+        TS_ASSERT_EQUALS(expectedRegion, record.validRegion);
+        for (Region<2>::Iterator i = expectedRegion.begin(); i != expectedRegion.end(); ++i) {
+            Coord<2> fine(3 + i->x() * 2, 2 + i->y() * 3);
+            TS_ASSERT_EQUALS(fine, record.grid[*i].pos);
+            TS_ASSERT_EQUALS(grid[fine].testValue, record.grid[*i].testValue);
+        }
+    }
+
+    void testAveraging()
+    {
+        RecordingWriter *delegate = new RecordingWriter(records);
+        DownsamplingWriter<TestCell<2> > writer(delegate, Coord<2>(2, 4));
+        writer.addAveragedMember(Selector<TestCell<2> >(&TestCell<2>::testValue, "testValue"));
+        TS_ASSERT_THROWS(
+            writer.addAveragedMember(Selector<TestCell<2> >(&TestCell<2>::cycleCounter, "cycleCounter")),
+            std::invalid_argument&);
+        writer.setRegion(region);
+
+        for (unsigned step = 0; step < 2; ++step) {
+            writer.stepFinished(grid, ghost, dim, step, WRITER_STEP_FINISHED, 0, false);
+            writer.stepFinished(grid, inner, dim, step, WRITER_STEP_FINISHED, 0, true);
+        }
+        TS_ASSERT_EQUALS(std::size_t(2), records->size());
+
+        // accumulators are reset between steps:
+        for (unsigned step = 0; step < 2; ++step) {
+            Record& record = (*records)[step];
+            TS_ASSERT_EQUALS(Coord<2>(10, 3), record.globalDimensions);
+            TS_ASSERT_EQUALS(std::size_t(30), record.validRegion.size());
+
+            for (Region<2>::Iterator i = record.validRegion.begin(); i != record.validRegion.end(); ++i) {
+                // the last row of blocks is only half full:
+                double meanY = (i->y() < 2) ? (i->y() * 4 + 1.5) : 8.5;
+                TS_ASSERT_EQUALS(i->x() * 2 + 0.5 + 100 * meanY, record.grid[*i].testValue);
+                TS_ASSERT_EQUALS(Coord<2>(i->x() * 2, i->y() * 4), record.grid[*i].pos);
+            }
+        }
+    }
+
+    void testInterleavedSteps()
+    {
+        RecordingWriter *delegate = new RecordingWriter(records);
+        DownsamplingWriter<TestCell<2> > writer(delegate, Coord<2>(2, 4));
+        writer.addAveragedMember(Selector<TestCell<2> >(&TestCell<2>::testValue, "testValue"));
+        writer.setRegion(region);
+
+        writer.stepFinished(grid, ghost, dim, 1, WRITER_STEP_FINISHED, 0, false);
+        writer.stepFinished(grid, ghost, dim, 2, WRITER_STEP_FINISHED, 0, false);
+        writer.stepFinished(grid, inner, dim, 1, WRITER_STEP_FINISHED, 0, true);
+        writer.stepFinished(grid, inner, dim, 2, WRITER_STEP_FINISHED, 0, true);
+        TS_ASSERT_EQUALS(std::size_t(2), records->size());
+
+        for (unsigned i = 0; i < 2; ++i) {
+            Record& record = (*records)[i];
+            TS_ASSERT_EQUALS(i + 1, record.step);
+            TS_ASSERT_EQUALS(std::size_t(30), record.validRegion.size());
+
+            for (Region<2>::Iterator c = record.validRegion.begin(); c != record.validRegion.end(); ++c) {
+                double meanY = (c->y() < 2) ? (c->y() * 4 + 1.5) : 8.5;
+                TS_ASSERT_EQUALS(c->x() * 2 + 0.5 + 100 * meanY, record.grid[*c].testValue);
+            }
+        }
+    }
+
+    void testClone()
+    {
+        RecordingWriter *delegate = new RecordingWriter(records);
+        DownsamplingWriter<TestCell<2> > writer(delegate, Coord<2>(2, 4));
+        writer.addAveragedMember(Selector<TestCell<2> >(&TestCell<2>::testValue, "testValue"));
+
+        boost::shared_ptr<ParallelWriter<TestCell<2> > > clone(writer.clone());
+        clone->setRegion(region);
+        clone->stepFinished(grid, region, dim, 0, WRITER_STEP_FINISHED, 0, true);
+
+        TS_ASSERT_EQUALS(std::size_t(1), records->size());
+        TS_ASSERT_EQUALS(0 * 2 + 0.5 + 100 * 1.5, (*records)[0].grid[Coord<2>(0, 0)].testValue);
+    }
+
+    void testRanksOutsideOfRegionOfInterest()
+    {
+        Region<2> roi;
+        roi << CoordBox<2>(Coord<2>(3, 5), Coord<2>(4, 4));
+
+        DownsamplingWriter<TestCell<2> > skipping(new RecordingWriter(records), Coord<2>(1, 1), roi, true);
+        skipping.setRegion(ghost);
+        skipping.stepFinished(grid, ghost, dim, 0, WRITER_STEP_FINISHED, 0, true);
+        TS_ASSERT_EQUALS(std::size_t(0), records->size());
+
+        DownsamplingWriter<TestCell<2> > participating(new RecordingWriter(records), Coord<2>(1, 1), roi);
+        participating.setRegion(ghost);
+        participating.stepFinished(grid, ghost, dim, 0, WRITER_STEP_FINISHED, 0, true);
+        TS_ASSERT_EQUALS(std::size_t(1), records->size());
+        TS_ASSERT((*records)[0].validRegion.empty());
+        TS_ASSERT_EQUALS(Coord<2>(4, 4), (*records)[0].globalDimensions);
+    }
+
+    void testWithHiParSimulator()
+    {
+        TestInitializer<TestCell<2> > *init = new TestInitializer<TestCell<2> >(Coord<2>(31, 20), 10);
+        HiParSimulator<TestCell<2>, StripingPartition<2> > sim(init, 0, 1000, 3);
+
+        ParallelMemoryWriter<TestCell<2> > *memoryWriter = new ParallelMemoryWriter<TestCell<2> >(5);
+        sim.addWriter(new DownsamplingWriter<TestCell<2> >(memoryWriter, Coord<2>(3, 2)));
+        sim.run();
+
+        TS_ASSERT_EQUALS(std::size_t(3), memoryWriter->getGrids().size());
+        ParallelMemoryWriter<TestCell<2> >::GridType& coarse = memoryWriter->getGrid(10);
+        TS_ASSERT_EQUALS(Coord<2>(11, 10), coarse.getDimensions());
+        for (int y = 0; y < 10; ++y) {
+            for (int x = 0; x < 11; ++x) {
+                TS_ASSERT_EQUALS(Coord<2>(x * 3, y * 2), coarse[Coord<2>(x, y)].pos);
+                TS_ASSERT(coarse[Coord<2>(x, y)].isValid);
+            }
+        }
+    }
+
+    void testWithHiParSimulatorAndPeriodBelowGhostZoneWidth()
+    {
+        TestInitializer<TestCell<2> > *init = new TestInitializer<TestCell<2> >(Coord<2>(31, 20), 10);
+        HiParSimulator<TestCell<2>, StripingPartition<2> > sim(init, 0, 1000, 3);
+
+        ParallelMemoryWriter<TestCell<2> > *memoryWriter = new ParallelMemoryWriter<TestCell<2> >(1);
+        DownsamplingWriter<TestCell<2> > *writer =
+            new DownsamplingWriter<TestCell<2> >(memoryWriter, Coord<2>(3, 2));
+        writer->addAveragedMember(Selector<TestCell<2> >(&TestCell<2>::testValue, "testValue"));
+        sim.addWriter(writer);
+        sim.run();
+
+        TS_ASSERT_EQUALS(std::size_t(11), memoryWriter->getGrids().size());
+        for (unsigned step = 0; step <= 10; ++step) {
+            ParallelMemoryWriter<TestCell<2> >::GridType& coarse = memoryWriter->getGrid(step);
+            TS_ASSERT_EQUALS(Coord<2>(11, 10), coarse.getDimensions());
+            for (int y = 0; y < 10; ++y) {
+                for (int x = 0; x < 11; ++x) {
+                    TS_ASSERT_EQUALS(Coord<2>(x * 3, y * 2), coarse[Coord<2>(x, y)].pos);
+                    TS_ASSERT(coarse[Coord<2>(x, y)].isValid);
+                    TS_ASSERT_EQUALS(step * TestCell<2>::NANO_STEPS, coarse[Coord<2>(x, y)].cycleCounter);
+                }
+            }
+        }
+    }
+
+private:
+    Coord<2> dim;
+    CoordBox<2> box;
+    GridType grid;
+    Region<2> region;
+    Region<2> ghost;
+    Region<2> inner;
+    boost::shared_ptr<std::vector<Record> > records;
+};
+
+}
@@ -2,15 +2,38 @@
 #include <libgeodecomp/geometry/partitions/zcurvepartition.h>
 #include <libgeodecomp/io/bovwriter.h>
 #include <libgeodecomp/io/testinitializer.h>
+#include <libgeodecomp/parallelization/hiparsimulator.h>
 #include <libgeodecomp/parallelization/stripingsimulator.h>
+#include <libgeodecomp/storage/simplefilter.h>
 
 #include <boost/filesystem.hpp>
 #include <cxxtest/TestSuite.h>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
 
 using namespace LibGeoDecomp;
 
 namespace LibGeoDecomp {
 
+/**
+ * Encodes a cell's position, so that the interleaving of components
+ * can be verified.
+ */
+class PositionFilter : public SimpleFilter<TestCell<3>, Coord<3>, double>
+{
+public:
+    void load(const double& source, Coord<3> *target)
+    {
+        // intentionally left blank
+    }
+
+    void save(const Coord<3>& source, double *target)
+    {
+        *target = source.x() + 100 * source.y() + 10000 * source.z();
+    }
+};
+
 class BOVWriterTest : public CxxTest::TestSuite
 {
 public:
@@ -79,15 +102,227 @@ public:
         }
     }
 
+    void testMultipleSelectors()
+    {
+        TestInitializer<TestCell<3> > *init = new TestInitializer<TestCell<3> >();
+        Coord<3> dimensions(init->gridDimensions());
+
+        std::vector<Selector<TestCell<3> > > selectors;
+        selectors << Selector<TestCell<3> >(&TestCell<3>::testValue, "val")
+                  << Selector<TestCell<3> >(
+                      &TestCell<3>::pos,
+                      "pos",
+                      boost::shared_ptr<FilterBase<TestCell<3> > >(new PositionFilter()));
+
+        LoadBalancer *balancer = MPILayer().rank()? 0 : new RandomBalancer;
+        StripingSimulator<TestCell<3> > sim(init, balancer);
+        sim.addWriter(new BOVWriter<TestCell<3> >(selectors, "testbovwritermulti", 10));
+        sim.run();
+
+        MPILayer().barrier();
+
+        if (MPILayer().rank() == 0) {
+            Grid<TestCell<3>, Topologies::Cube<3>::Topology> buffer(dimensions);
+            init->grid(&buffer);
+
+            files << "testbovwritermulti.00000.bov"
+                  << "testbovwritermulti.00010.bov"
+                  << "testbovwritermulti.00020.bov"
+                  << "testbovwritermulti.00021.bov"
+                  << "testbovwritermulti.00000.data"
+                  << "testbovwritermulti.00010.data"
+                  << "testbovwritermulti.00020.data"
+                  << "testbovwritermulti.00021.data";
+
+            std::ifstream headerFile(files[0].c_str());
+            std::string header((std::istreambuf_iterator<char>(headerFile)), std::istreambuf_iterator<char>());
+            TS_ASSERT(header.find("VARIABLE: val_pos\n") != std::string::npos);
+            TS_ASSERT(header.find("DATA_COMPONENTS: 2\n") != std::string::npos);
+
+            for (std::size_t i = 4; i < files.size(); ++i) {
+                std::vector<double> actual(dimensions.prod() * 2);
+                MPIIO<TestCell<3>, Topologies::Cube<3>::Topology> mpiio;
+                MPI_File file = mpiio.openFileForRead(files[i], MPI_COMM_SELF);
+                MPI_File_read(file, &actual[0], actual.size(), MPI_DOUBLE, MPI_STATUS_IGNORE);
+                MPI_File_close(&file);
+
+                CoordBox<3> box(Coord<3>(), dimensions);
+                for (CoordBox<3>::Iterator c = box.begin(); c != box.end(); ++c) {
+                    std::size_t index = c->toIndex(dimensions);
+                    TS_ASSERT_EQUALS(buffer[*c].testValue, actual[2 * index + 0]);
+                    TS_ASSERT_EQUALS(c->x() + 100 * c->y() + 10000 * c->z(), actual[2 * index + 1]);
+                }
+            }
+        }
+    }
+
+    void testSelectorsNeedToYieldSameType()
+    {
+        std::vector<Selector<TestCell<3> > > selectors;
+        selectors << Selector<TestCell<3> >(&TestCell<3>::testValue, "val")
+                  << Selector<TestCell<3> >(&TestCell<3>::cycleCounter, "counter");
+
+        TS_ASSERT_THROWS(
+            BOVWriter<TestCell<3> >(selectors, "testbovwritermixed", 1),
+            std::invalid_argument&);
+        TS_ASSERT_THROWS(
+            BOVWriter<TestCell<3> >(std::vector<Selector<TestCell<3> > >(), "testbovwriterempty", 1),
+            std::invalid_argument&);
+    }
+
+    void testSingleDataFileWithMultipleCallsPerStep()
+    {
+        TestInitializer<TestCell<3> > *init = new TestInitializer<TestCell<3> >();
+        Coord<3> dimensions(init->gridDimensions());
+
+        // HiParSimulator calls the writer twice per step (ghost zone
+        // and inner set), migration changes the regions:
+        HiParSimulator<TestCell<3>, ZCurvePartition<3> > sim(
+            init,
+            MPILayer().rank() ? 0 : new RandomBalancer,
+            5,
+            2);
+        sim.addWriter(new BOVWriter<TestCell<3> >(
+                          Selector<TestCell<3> >(&TestCell<3>::testValue, "val"),
+                          "testbovwritersingle",
+                          4,
+                          Coord<3>(),
+                          MPI_COMM_WORLD,
+                          true));
+        sim.run();
+
+        MPILayer().barrier();
+
+        if (MPILayer().rank() == 0) {
+            Grid<TestCell<3>, Topologies::Cube<3>::Topology> buffer(dimensions);
+            Grid<double, Topologies::Cube<3>::Topology> expected(dimensions);
+
+            init->grid(&buffer);
+            CoordBox<3> box(Coord<3>(), dimensions);
+            for (CoordBox<3>::Iterator i = box.begin(); i != box.end(); ++i) {
+                expected[*i] = buffer[*i].testValue;
+            }
+
+            files << "testbovwritersingle.data";
+            TS_ASSERT(!boost::filesystem::exists("testbovwritersingle.00000.data"));
+            unsigned steps[] = { 0, 4, 8, 12, 16, 20, 21 };
+            std::size_t snapshotSize = dimensions.prod() * sizeof(double);
+
+            for (int i = 0; i < 7; ++i) {
+                std::ostringstream headerName;
+                headerName << "testbovwritersingle." << std::setfill('0') << std::setw(5) << steps[i] << ".bov";
+                files << headerName.str();
+
+                std::ifstream headerFile(headerName.str().c_str());
+                std::string header((std::istreambuf_iterator<char>(headerFile)), std::istreambuf_iterator<char>());
+                TS_ASSERT(header.find("DATA_FILE: testbovwritersingle.data\n") != std::string::npos);
+                if (i > 0) {
+                    std::ostringstream byteOffset;
+                    byteOffset << "BYTE_OFFSET: " << i * snapshotSize << "\n";
+                    TS_ASSERT(header.find(byteOffset.str()) != std::string::npos);
+                }
+
+                TS_ASSERT_EQUALS(
+                    expected,
+                    readGrid("testbovwritersingle.data", dimensions, i * snapshotSize));
+            }
+        }
+    }
+
+    void testGhostZoneWiderThanPeriod()
+    {
+        // large enough to yield a non-empty inner set on each rank:
+        TestInitializer<TestCell<3> > *init = new TestInitializer<TestCell<3> >(Coord<3>(32, 32, 32), 10);
+        Coord<3> dimensions(init->gridDimensions());
+
+        // the rims of steps t+1...t+3 are delivered before the inner
+        // set of step t+1, so the writer sees interleaved steps:
+        HiParSimulator<TestCell<3>, ZCurvePartition<3> > sim(
+            init,
+            MPILayer().rank() ? 0 : new RandomBalancer,
+            1000,
+            3);
+        sim.addWriter(new BOVWriter<TestCell<3> >(
+                          Selector<TestCell<3> >(&TestCell<3>::testValue, "val"),
+                          "testbovwriterwide",
+                          1));
+        sim.run();
+
+        MPILayer().barrier();
+
+        if (MPILayer().rank() == 0) {
+            Grid<TestCell<3>, Topologies::Cube<3>::Topology> buffer(dimensions);
+            Grid<double, Topologies::Cube<3>::Topology> expected(dimensions);
+
+            init->grid(&buffer);
+            CoordBox<3> box(Coord<3>(), dimensions);
+            for (CoordBox<3>::Iterator i = box.begin(); i != box.end(); ++i) {
+                expected[*i] = buffer[*i].testValue;
+            }
+
+            for (unsigned step = init->startStep(); step <= init->maxSteps(); ++step) {
+                std::ostringstream prefix;
+                prefix << "testbovwriterwide." << std::setfill('0') << std::setw(5) << step;
+                files << prefix.str() + ".bov"
+                      << prefix.str() + ".data";
+
+                TS_ASSERT_EQUALS(expected, readGrid(prefix.str() + ".data", dimensions));
+            }
+        }
+    }
+
+    void testInterleavedSteps()
+    {
+        Coord<3> dimensions(10, 8, 6);
+        Grid<TestCell<3>, Topologies::Cube<3>::Topology> grid(dimensions);
+        CoordBox<3> box(Coord<3>(), dimensions);
+        for (CoordBox<3>::Iterator i = box.begin(); i != box.end(); ++i) {
+            grid[*i].testValue = i->x() + 100 * i->y() + 10000 * i->z();
+        }
+
+        // each rank owns three z-slices, the first one acts as its rim:
+        int rank = MPILayer().rank();
+        Region<3> rim;
+        Region<3> innerSet;
+        rim << CoordBox<3>(Coord<3>(0, 0, 3 * rank), Coord<3>(10, 8, 1));
+        innerSet << CoordBox<3>(Coord<3>(0, 0, 3 * rank + 1), Coord<3>(10, 8, 2));
+
+        BOVWriter<TestCell<3> > writer(
+            Selector<TestCell<3> >(&TestCell<3>::testValue, "val"),
+            "testbovwriterinterleaved",
+            1);
+        writer.stepFinished(grid, rim,      dimensions, 1, WRITER_STEP_FINISHED, rank, false);
+        writer.stepFinished(grid, rim,      dimensions, 2, WRITER_STEP_FINISHED, rank, false);
+        writer.stepFinished(grid, innerSet, dimensions, 1, WRITER_STEP_FINISHED, rank, true);
+        writer.stepFinished(grid, innerSet, dimensions, 2, WRITER_STEP_FINISHED, rank, true);
+
+        MPILayer().barrier();
+
+        if (rank == 0) {
+            Grid<double, Topologies::Cube<3>::Topology> expected(dimensions);
+            for (CoordBox<3>::Iterator i = box.begin(); i != box.end(); ++i) {
+                expected[*i] = grid[*i].testValue;
+            }
+
+            files << "testbovwriterinterleaved.00001.bov"
+                  << "testbovwriterinterleaved.00002.bov"
+                  << "testbovwriterinterleaved.00001.data"
+                  << "testbovwriterinterleaved.00002.data";
+            TS_ASSERT_EQUALS(expected, readGrid(files[2], dimensions));
+            TS_ASSERT_EQUALS(expected, readGrid(files[3], dimensions));
+        }
+    }
+
     Grid<double, Topologies::Cube<3>::Topology> readGrid(
         std::string filename,
-        Coord<3> dimensions)
+        Coord<3> dimensions,
+        MPI_Offset offset = 0)
     {
         Grid<double, Topologies::Cube<3>::Topology> ret(dimensions);
         MPIIO<TestCell<3>, Topologies::Cube<3>::Topology> mpiio;
         MPI_File file = mpiio.openFileForRead(
             filename, MPI_COMM_SELF);
-        MPI_File_read(file, &ret[Coord<3>()], dimensions.prod(), MPI_DOUBLE, MPI_STATUS_IGNORE);
+        MPI_File_read_at(file, offset, &ret[Coord<3>()], dimensions.prod(), MPI_DOUBLE, MPI_STATUS_IGNORE);
         MPI_File_close(&file);
         return ret;
     }
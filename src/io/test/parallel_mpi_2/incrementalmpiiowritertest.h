@@ -0,0 +1,127 @@
+#include <libgeodecomp/io/incrementalmpiioinitializer.h>
+#include <libgeodecomp/io/incrementalmpiiowriter.h>
+#include <libgeodecomp/io/memorywriter.h>
+#include <libgeodecomp/io/testinitializer.h>
+#include <libgeodecomp/loadbalancer/noopbalancer.h>
+#include <libgeodecomp/loadbalancer/randombalancer.h>
+#include <libgeodecomp/parallelization/serialsimulator.h>
+#include <libgeodecomp/parallelization/stripingsimulator.h>
+
+#include <boost/filesystem.hpp>
+#include <cxxtest/TestSuite.h>
+
+using namespace LibGeoDecomp;
+
+namespace LibGeoDecomp {
+
+class IncrementalMPIIOWriterTest : public CxxTest::TestSuite
+{
+public:
+    typedef APITraits::SelectTopology<TestCell<3> >::Value Topology;
+
+    std::vector<std::string> files;
+    int rank;
+
+    void setUp()
+    {
+        files.clear();
+        rank = MPILayer().rank();
+    }
+
+    void tearDown()
+    {
+        MPILayer().barrier();
+        if (rank == 0) {
+            for (std::size_t i = 0; i < files.size(); ++i) {
+                boost::filesystem::remove(files[i]);
+            }
+        }
+    }
+
+    void testReplayOfSnapshotsAndDeltas()
+    {
+        TestInitializer<TestCell<3> > *init = new TestInitializer<TestCell<3> >();
+        LoadBalancer *balancer = rank? 0 : new RandomBalancer;
+        // the balancer will shift cells between nodes, so some nodes
+        // will need to read their share of the snapshot back from disk:
+        StripingSimulator<TestCell<3> > simTest(init, balancer, 2);
+        IncrementalMPIIOWriter<TestCell<3> > *writer = new IncrementalMPIIOWriter<TestCell<3> >(
+            "testincrementalmpiiowriter",
+            4,
+            init->maxSteps(),
+            3,
+            7);
+        simTest.addWriter(writer);
+        simTest.run();
+
+        TS_ASSERT_EQUALS(
+            "testincrementalmpiiowriter01234.delta", writer->filename(1234, "delta"));
+
+        MPILayer().barrier();
+        if (rank != 0) {
+            return;
+        }
+
+        SerialSimulator<TestCell<3> > simReference(new TestInitializer<TestCell<3> >());
+        MemoryWriter<TestCell<3> > *memoryWriter = new MemoryWriter<TestCell<3> >(4);
+        simReference.addWriter(memoryWriter);
+        simReference.run();
+        std::vector<Grid<TestCell<3>, Topology> > expected = memoryWriter->getGrids();
+
+        // snapshots every 3rd checkpoint (i.e. every 12 steps):
+        files << "testincrementalmpiiowriter00000.mpiio"
+              << "testincrementalmpiiowriter00004.delta"
+              << "testincrementalmpiiowriter00008.delta"
+              << "testincrementalmpiiowriter00012.mpiio"
+              << "testincrementalmpiiowriter00016.delta"
+              << "testincrementalmpiiowriter00020.delta"
+              << "testincrementalmpiiowriter00021.delta";
+        TS_ASSERT_EQUALS(files.size(), expected.size());
+
+        for (std::size_t i = 0; i < files.size(); ++i) {
+            TS_ASSERT(boost::filesystem::exists(files[i]));
+
+            IncrementalMPIIOInitializer<TestCell<3> > restorer(files[i], MPI_COMM_SELF);
+            Grid<TestCell<3>, Topology> actual(restorer.gridDimensions());
+            restorer.grid(&actual);
+
+            TS_ASSERT_EQUALS(expected[i], actual);
+            TS_ASSERT_EQUALS(unsigned(21), restorer.maxSteps());
+        }
+
+        IncrementalMPIIOInitializer<TestCell<3> > restorer(files[5], MPI_COMM_SELF);
+        TS_ASSERT_EQUALS(unsigned(20), restorer.startStep());
+        TS_ASSERT_EQUALS(files[3], restorer.baseFilename());
+    }
+
+    void testDeltasOfSlowlyEvolvingFieldsAreSmall()
+    {
+        // TestCell<3>::testValue changes in every time step, but
+        // everything else (e.g. its position and dimensions) doesn't:
+        TestInitializer<TestCell<3> > *init = new TestInitializer<TestCell<3> >();
+        StripingSimulator<TestCell<3> > sim(init, rank? 0 : new NoOpBalancer);
+        sim.addWriter(new IncrementalMPIIOWriter<TestCell<3> >(
+                          "testincrementalmpiiowriter_size",
+                          4,
+                          init->maxSteps()));
+        sim.run();
+
+        MPILayer().barrier();
+        files << "testincrementalmpiiowriter_size00000.mpiio"
+              << "testincrementalmpiiowriter_size00004.delta"
+              << "testincrementalmpiiowriter_size00008.delta"
+              << "testincrementalmpiiowriter_size00012.delta"
+              << "testincrementalmpiiowriter_size00016.delta"
+              << "testincrementalmpiiowriter_size00020.delta"
+              << "testincrementalmpiiowriter_size00021.delta";
+
+        if (rank == 0) {
+            boost::uintmax_t snapshotSize = boost::filesystem::file_size(files[0]);
+            for (std::size_t i = 1; i < files.size(); ++i) {
+                TS_ASSERT_LESS_THAN(boost::filesystem::file_size(files[i]) * 2, snapshotSize);
+            }
+        }
+    }
+};
+
+}
@@ -0,0 +1,125 @@
+#include <libgeodecomp/io/reductionwriter.h>
+#include <libgeodecomp/misc/testcell.h>
+#include <libgeodecomp/storage/displacedgrid.h>
+
+#include <cxxtest/TestSuite.h>
+
+using namespace LibGeoDecomp;
+
+namespace LibGeoDecomp {
+
+class ReductionWriterTest :  public CxxTest::TestSuite
+{
+public:
+    typedef APITraits::SelectTopology<TestCell<2> >::Value Topology;
+    typedef DisplacedGrid<TestCell<2>, Topology> GridType;
+
+    void setUp()
+    {
+        dim = Coord<2>(10, 13);
+        grid = GridType(CoordBox<2>(Coord<2>(), dim));
+
+        for (int y = 0; y < dim.y(); ++y) {
+            for (int x = 0; x < dim.x(); ++x) {
+                Coord<2> c(x, y);
+                TestCell<2> cell(c, dim);
+                cell.testValue = y * dim.x() + x;
+                grid.set(c, cell);
+            }
+        }
+
+        // each rank gets two stripes which are handed over in two
+        // calls, just like ghost zone and inner set:
+        for (int i = 0; i < 4; ++i) {
+            int startY = dim.y() * i / 4;
+            int endY = dim.y() * (i + 1) / 4;
+
+            for (int y = startY; y < endY; ++y) {
+                stripes[i] << Streak<2>(Coord<2>(0, y), dim.x());
+            }
+        }
+    }
+
+    void testSum()
+    {
+        ReductionWriter<TestCell<2>, double> writer(&TestCell<2>::testValue, 10);
+        double expected = (dim.prod() - 1) * dim.prod() / 2;
+
+        feed(&writer, 0, WRITER_INITIALIZED);
+        TS_ASSERT_EQUALS(0.0, writer.result());
+
+        feed(&writer, 5, WRITER_STEP_FINISHED);
+        TS_ASSERT_EQUALS(0.0, writer.result());
+
+        // results arrive one output period late...
+        feed(&writer, 10, WRITER_STEP_FINISHED);
+        TS_ASSERT_EQUALS(expected, writer.result());
+        TS_ASSERT_EQUALS(unsigned(0), writer.resultStep());
+
+        // ...unless we force completion...
+        writer.complete();
+        TS_ASSERT_EQUALS(expected, writer.result());
+        TS_ASSERT_EQUALS(unsigned(10), writer.resultStep());
+
+        // ...or the simulation is done:
+        feed(&writer, 13, WRITER_ALL_DONE);
+        TS_ASSERT_EQUALS(expected, writer.result());
+        TS_ASSERT_EQUALS(unsigned(13), writer.resultStep());
+    }
+
+    void testMinMax()
+    {
+        ReductionWriter<TestCell<2>, double, ReductionWriterHelpers::Min> minWriter(
+            &TestCell<2>::testValue);
+        ReductionWriter<TestCell<2>, double, ReductionWriterHelpers::Max> maxWriter(
+            &TestCell<2>::testValue);
+
+        feed(&minWriter, 0, WRITER_ALL_DONE);
+        feed(&maxWriter, 0, WRITER_ALL_DONE);
+
+        TS_ASSERT_EQUALS(0.0, minWriter.result());
+        TS_ASSERT_EQUALS(dim.prod() - 1.0, maxWriter.result());
+    }
+
+    void testInterleavedSteps()
+    {
+        // with wide ghost zones the stepper will deliver the ghost
+        // zone of later steps before the inner set of earlier steps:
+        ReductionWriter<TestCell<2>, double> writer(&TestCell<2>::testValue);
+        int rank = MPILayer().rank();
+        Region<2> ghost = stripes[rank * 2];
+        Region<2> inner = stripes[rank * 2 + 1];
+
+        writer.stepFinished(grid, ghost, dim, 1, WRITER_STEP_FINISHED, rank, false);
+        writer.stepFinished(grid, ghost, dim, 2, WRITER_STEP_FINISHED, rank, false);
+        writer.stepFinished(grid, inner, dim, 1, WRITER_STEP_FINISHED, rank, true);
+        writer.stepFinished(grid, inner, dim, 2, WRITER_STEP_FINISHED, rank, true);
+        writer.complete();
+
+        TS_ASSERT_EQUALS((dim.prod() - 1) * dim.prod() / 2.0, writer.result());
+        TS_ASSERT_EQUALS(unsigned(2), writer.resultStep());
+    }
+
+private:
+    Coord<2> dim;
+    GridType grid;
+    Region<2> stripes[4];
+
+    template<typename WRITER>
+    void feed(WRITER *writer, unsigned step, WriterEvent event)
+    {
+        int rank = MPILayer().rank();
+        for (int i = 0; i < 2; ++i) {
+            writer->stepFinished(
+                grid,
+                stripes[rank * 2 + i],
+                dim,
+                step,
+                event,
+                rank,
+                i == 1);
+        }
+    }
+};
+
+}
@@ -0,0 +1,224 @@
+#include <libgeodecomp/geometry/partitions/zcurvepartition.h>
+#include <libgeodecomp/io/telemetrywriter.h>
+#include <libgeodecomp/io/testinitializer.h>
+#include <libgeodecomp/loadbalancer/noopbalancer.h>
+#include <libgeodecomp/misc/stringops.h>
+#include <libgeodecomp/misc/testcell.h>
+#include <libgeodecomp/parallelization/hiparsimulator.h>
+#include <libgeodecomp/parallelization/mocksimulator.h>
+#include <libgeodecomp/parallelization/stripingsimulator.h>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <cxxtest/TestSuite.h>
+#include <fstream>
+
+using namespace LibGeoDecomp;
+
+namespace LibGeoDecomp {
+
+/**
+ * Returns a predefined sequence of statistics, one per call.
+ */
+class ScriptedStatisticsSimulator : public MockSimulator
+{
+public:
+    ScriptedStatisticsSimulator() :
+        MockSimulator(new TestInitializer<TestCell<2> >())
+    {}
+
+    std::vector<Chronometer> gatherStatistics()
+    {
+        std::vector<Chronometer> ret(1, script.front());
+        script.erase(script.begin());
+        return ret;
+    }
+
+    std::vector<Chronometer> script;
+};
+
+class TelemetryWriterTest : public CxxTest::TestSuite
+{
+public:
+    typedef TelemetryWriter<TestCell<2> > TelemetryWriterType;
+
+    void setUp()
+    {
+        rank = MPILayer().rank();
+        filename = "testtelemetrywriter.out";
+    }
+
+    void tearDown()
+    {
+        MPILayer().barrier();
+        if (rank == 0) {
+            boost::filesystem::remove(filename);
+        }
+    }
+
+    void testCSV()
+    {
+        StripingSimulator<TestCell<2> > sim(
+            new TestInitializer<TestCell<2> >(Coord<2>(20, 30), 21),
+            rank ? 0 : new NoOpBalancer(),
+            1000);
+        sim.addWriter(new TelemetryWriterType(&sim, filename, 5));
+        sim.run();
+
+        MPILayer().barrier();
+        if (rank != 0) {
+            return;
+        }
+
+        std::ifstream file(filename.c_str());
+        std::vector<std::vector<std::string> > lines;
+        std::string line;
+        while (std::getline(file, line)) {
+            std::vector<std::string> fields;
+            boost::split(fields, line, boost::is_any_of(","));
+            lines.push_back(fields);
+        }
+
+        // header plus steps 5, 10, 15, 20 and 21:
+        TS_ASSERT_EQUALS(std::size_t(6), lines.size());
+        for (std::size_t i = 0; i < lines.size(); ++i) {
+            TS_ASSERT_EQUALS(2 + 4 * Chronometer::NUM_INTERVALS, lines[i].size());
+        }
+        TS_ASSERT_EQUALS("step", lines[0][0]);
+        TS_ASSERT_EQUALS("total_time_min", lines[0][2]);
+        TS_ASSERT_EQUALS("compute_time_imbalance", lines[0][9]);
+        TS_ASSERT_EQUALS("5",  lines[1][0]);
+        TS_ASSERT_EQUALS("21", lines[5][0]);
+
+        for (std::size_t i = 1; i < lines.size(); ++i) {
+            double min  = parse(lines[i][6]);
+            double max  = parse(lines[i][7]);
+            double mean = parse(lines[i][8]);
+            TS_ASSERT_LESS_THAN_EQUALS(min, mean);
+            TS_ASSERT_LESS_THAN_EQUALS(mean, max);
+            TS_ASSERT_LESS_THAN(0, max);
+            TS_ASSERT_DELTA(max / mean - 1, parse(lines[i][9]), 1e-6);
+        }
+    }
+
+    void testBinaryWithHiParSimulator()
+    {
+        HiParSimulator<TestCell<2>, ZCurvePartition<2> > sim(
+            new TestInitializer<TestCell<2> >(Coord<2>(20, 30), 12),
+            0,
+            1000,
+            1);
+        sim.addWriter(new TelemetryWriterType(&sim, filename, 4, TelemetryWriterType::BINARY));
+        sim.run();
+
+        MPILayer().barrier();
+        if (rank != 0) {
+            return;
+        }
+
+        std::ifstream file(filename.c_str(), std::ios::binary);
+        char magic[8];
+        file.read(magic, 8);
+        TS_ASSERT_EQUALS("LGDTELEM", std::string(magic, 8));
+        TS_ASSERT_EQUALS(boost::uint32_t(TelemetryWriterType::VERSION), read<boost::uint32_t>(file));
+        boost::uint32_t numRanks = read<boost::uint32_t>(file);
+        boost::uint32_t numEvents = read<boost::uint32_t>(file);
+        TS_ASSERT_EQUALS(boost::uint32_t(MPILayer().size()), numRanks);
+        TS_ASSERT_EQUALS(boost::uint32_t(Chronometer::NUM_INTERVALS), numEvents);
+
+        std::string name;
+        for (std::size_t i = 0; i < numEvents; ++i) {
+            std::getline(file, name, '\0');
+        }
+        TS_ASSERT_EQUALS("output_time_drain", name);
+
+        // steps 4, 8 and 12, the last of which is the final step:
+        for (unsigned step = 4; step <= 12; step += 4) {
+            TS_ASSERT_EQUALS(step, read<boost::uint32_t>(file));
+            TS_ASSERT_LESS_THAN(0, read<double>(file));
+
+            std::vector<double> aggregates(4 * numEvents);
+            std::vector<double> deltas(numRanks * numEvents);
+            file.read(reinterpret_cast<char*>(&aggregates[0]), aggregates.size() * sizeof(double));
+            file.read(reinterpret_cast<char*>(&deltas[0]), deltas.size() * sizeof(double));
+
+            int event = TimeComputeInner::ID;
+            double sum = 0;
+            for (std::size_t r = 0; r < numRanks; ++r) {
+                double delta = deltas[r * numEvents + event];
+                TS_ASSERT_LESS_THAN(0, delta);
+                TS_ASSERT_LESS_THAN_EQUALS(aggregates[4 * event + 0], delta);
+                TS_ASSERT_LESS_THAN_EQUALS(delta, aggregates[4 * event + 1]);
+                sum += delta;
+            }
+            TS_ASSERT_DELTA(sum / numRanks, aggregates[4 * event + 2], 1e-12);
+        }
+
+        file.peek();
+        TS_ASSERT(file.eof());
+    }
+
+    void testResetIsDetectedForAllEvents()
+    {
+        if (rank != 0) {
+            return;
+        }
+
+        ScriptedStatisticsSimulator sim;
+        Chronometer c;
+        c[TimeTotal::ID] = 5;
+        c[TimeCompute::ID] = 4;
+        sim.script.push_back(c);
+
+        // a reset, after which total time has outgrown its previous
+        // value while compute time hasn't:
+        c[TimeTotal::ID] = 7;
+        c[TimeCompute::ID] = 1;
+        sim.script.push_back(c);
+
+        c[TimeTotal::ID] = 10;
+        c[TimeCompute::ID] = 3;
+        sim.script.push_back(c);
+
+        TelemetryWriterType writer(&sim, filename, 1);
+        Grid<TestCell<2> > grid;
+        writer.stepFinished(grid, 0, WRITER_INITIALIZED);
+        writer.stepFinished(grid, 1, WRITER_STEP_FINISHED);
+        writer.stepFinished(grid, 2, WRITER_ALL_DONE);
+
+        std::ifstream file(filename.c_str());
+        std::vector<std::vector<std::string> > lines;
+        std::string line;
+        while (std::getline(file, line)) {
+            std::vector<std::string> fields;
+            boost::split(fields, line, boost::is_any_of(","));
+            lines.push_back(fields);
+        }
+
+        TS_ASSERT_EQUALS(std::size_t(3), lines.size());
+        // columns 2 and 6 hold the minimum of total and compute time:
+        TS_ASSERT_EQUALS(7, parse(lines[1][2]));
+        TS_ASSERT_EQUALS(1, parse(lines[1][6]));
+        TS_ASSERT_EQUALS(3, parse(lines[2][2]));
+        TS_ASSERT_EQUALS(2, parse(lines[2][6]));
+    }
+
+private:
+    int rank;
+    std::string filename;
+
+    double parse(const std::string& field)
+    {
+        return StringOps::atof(field);
+    }
+
+    template<typename T>
+    T read(std::ifstream& file)
+    {
+        T ret;
+        file.read(reinterpret_cast<char*>(&ret), sizeof(T));
+        return ret;
+    }
+};
+
+}
@@ -0,0 +1,194 @@
+#include <libgeodecomp/geometry/partitions/stripingpartition.h>
+#include <libgeodecomp/io/memorywriter.h>
+#include <libgeodecomp/io/streamingcollectingwriter.h>
+#include <libgeodecomp/io/testinitializer.h>
+#include <libgeodecomp/loadbalancer/randombalancer.h>
+#include <libgeodecomp/misc/clonable.h>
+#include <libgeodecomp/misc/testhelper.h>
+#include <libgeodecomp/parallelization/hiparsimulator.h>
+#include <libgeodecomp/parallelization/stripingsimulator.h>
+
+#include <boost/shared_ptr.hpp>
+#include <cxxtest/TestSuite.h>
+
+using namespace LibGeoDecomp;
+
+namespace LibGeoDecomp {
+
+namespace StreamingCollectingWriterTestHelpers {
+
+/**
+ * Reads the grid bottom up, which StreamingCollectingWriter can't
+ * support.
+ */
+class ReverseWriter : public Clonable<Writer<TestCell<2> >, ReverseWriter>
+{
+public:
+    ReverseWriter() :
+        Clonable<Writer<TestCell<2> >, ReverseWriter>("", 1)
+    {}
+
+    void stepFinished(const GridType& grid, unsigned step, WriterEvent event)
+    {
+        CoordBox<2> box = grid.boundingBox();
+        for (int y = box.dimensions.y() - 1; y >= 0; --y) {
+            grid.get(Coord<2>(0, y));
+        }
+    }
+};
+
+}
+
+class StreamingCollectingWriterTest : public CxxTest::TestSuite
+{
+public:
+    void testTree()
+    {
+        StreamingCollectingWriter<TestCell<2> > writer(
+            (MPILayer().rank() == 1) ? new MemoryWriter<TestCell<2> >() : 0, 8, 1);
+
+        // binomial tree, relative to root 1: 1 -> {2, 3}, 3 -> {0}
+        std::vector<int> expectedChildren;
+        int expectedParents[] = { 3, -1, 1, 1 };
+        if (MPILayer().rank() == 1) {
+            expectedChildren << 2
+                             << 3;
+        }
+        if (MPILayer().rank() == 3) {
+            expectedChildren << 0;
+        }
+
+        TS_ASSERT_EQUALS(expectedChildren, writer.getChildren());
+        TS_ASSERT_EQUALS(expectedParents[MPILayer().rank()], writer.getParent());
+    }
+
+    void testWithStripingSimulator()
+    {
+        TestInitializer<TestCell<3> > *init = new TestInitializer<TestCell<3> >();
+        LoadBalancer *balancer = MPILayer().rank() ? 0 : new RandomBalancer;
+        StripingSimulator<TestCell<3> > sim(init, balancer);
+
+        MemoryWriter<TestCell<3> > *writer = 0;
+        if (MPILayer().rank() == 0) {
+            writer = new MemoryWriter<TestCell<3> >(3);
+        }
+        // chunks of 5 planes don't align with the stripes:
+        sim.addWriter(new StreamingCollectingWriter<TestCell<3> >(writer, 5));
+        sim.run();
+
+        if (MPILayer().rank() == 0) {
+            int size = writer->getGrids().size();
+            TS_ASSERT_LESS_THAN(2, size);
+            unsigned cycle = 0;
+
+            for (int i = 0; i < (size - 1); ++i) {
+                cycle = APITraits::SelectNanoSteps<TestCell<3> >::VALUE * i * 3;
+                TS_ASSERT_TEST_GRID(MemoryWriter<TestCell<3> >::GridType, writer->getGrids()[i], cycle);
+            }
+
+            // WRITER_ALL_DONE repeats the last step:
+            TS_ASSERT_TEST_GRID(MemoryWriter<TestCell<3> >::GridType, writer->getGrids()[size - 1], cycle);
+        }
+    }
+
+    void testWithHiParSimulatorAndPeriodBelowGhostZoneWidth()
+    {
+        // the rims of steps t+1...t+3 arrive before the inner set of t+1:
+        TestInitializer<TestCell<2> > *init = new TestInitializer<TestCell<2> >(Coord<2>(20, 64), 10);
+        HiParSimulator<TestCell<2>, StripingPartition<2> > sim(init, 0, 1000, 3);
+
+        MemoryWriter<TestCell<2> > *writer = 0;
+        if (MPILayer().rank() == 0) {
+            writer = new MemoryWriter<TestCell<2> >(1);
+        }
+        sim.addWriter(new StreamingCollectingWriter<TestCell<2> >(writer, 5));
+        sim.run();
+
+        if (MPILayer().rank() == 0) {
+            TS_ASSERT_EQUALS(std::size_t(11), writer->getGrids().size());
+            for (unsigned step = 0; step <= 10; ++step) {
+                unsigned cycle = APITraits::SelectNanoSteps<TestCell<2> >::VALUE * step;
+                TS_ASSERT_TEST_GRID(MemoryWriter<TestCell<2> >::GridType, writer->getGrids()[step], cycle);
+            }
+        }
+    }
+
+    void testInterleavedSteps()
+    {
+        int rank = MPILayer().rank();
+        Coord<2> dim(10, 20);
+        CoordBox<2> box(Coord<2>(0, rank * 5), Coord<2>(10, 5));
+        DisplacedGrid<TestCell<2> > grid(box);
+        Region<2> ghost;
+        ghost << CoordBox<2>(box.origin, Coord<2>(10, 1));
+        Region<2> inner;
+        inner << box;
+        inner -= ghost;
+
+        MemoryWriter<TestCell<2> > *memoryWriter = 0;
+        if (rank == 0) {
+            memoryWriter = new MemoryWriter<TestCell<2> >(1);
+        }
+        StreamingCollectingWriter<TestCell<2> > writer(memoryWriter, 3);
+
+        fill(&grid, 1);
+        writer.stepFinished(grid, ghost, dim, 1, WRITER_STEP_FINISHED, rank, false);
+        fill(&grid, 2);
+        writer.stepFinished(grid, ghost, dim, 2, WRITER_STEP_FINISHED, rank, false);
+        fill(&grid, 10);
+        writer.stepFinished(grid, inner, dim, 1, WRITER_STEP_FINISHED, rank, true);
+        fill(&grid, 20);
+        writer.stepFinished(grid, inner, dim, 2, WRITER_STEP_FINISHED, rank, true);
+
+        if (rank == 0) {
+            TS_ASSERT_EQUALS(std::size_t(2), memoryWriter->getGrids().size());
+            for (int step = 1; step <= 2; ++step) {
+                const MemoryWriter<TestCell<2> >::StorageGrid& result = memoryWriter->getGrids()[step - 1];
+                for (int y = 0; y < dim.y(); ++y) {
+                    double expected = (y % 5 == 0) ? step : 10 * step;
+                    for (int x = 0; x < dim.x(); ++x) {
+                        TS_ASSERT_EQUALS(expected, result[Coord<2>(x, y)].testValue);
+                    }
+                }
+            }
+        }
+    }
+
+    void testOutOfOrderAccessIsRejected()
+    {
+        int rank = MPILayer().rank();
+        Coord<2> dim(10, 20);
+        CoordBox<2> box(Coord<2>(0, rank * 5), Coord<2>(10, 5));
+        DisplacedGrid<TestCell<2> > grid(box);
+        Region<2> region;
+        region << box;
+
+        Writer<TestCell<2> > *reverseWriter = 0;
+        if (rank == 0) {
+            reverseWriter = new StreamingCollectingWriterTestHelpers::ReverseWriter();
+        }
+        StreamingCollectingWriter<TestCell<2> > writer(reverseWriter, 2);
+        writer.setRegion(region);
+
+        for (unsigned step = 0; step < 2; ++step) {
+            if (rank == 0) {
+                TS_ASSERT_THROWS(
+                    writer.stepFinished(grid, region, dim, step, WRITER_STEP_FINISHED, rank, true),
+                    std::logic_error&);
+            } else {
+                writer.stepFinished(grid, region, dim, step, WRITER_STEP_FINISHED, rank, true);
+            }
+        }
+    }
+
+private:
+    void fill(DisplacedGrid<TestCell<2> > *grid, double value)
+    {
+        CoordBox<2> box = grid->boundingBox();
+        for (CoordBox<2>::Iterator i = box.begin(); i != box.end(); ++i) {
+            (*grid)[*i].testValue = value;
+        }
+    }
+};
+
+}
@@ -0,0 +1,84 @@
+#include <libgeodecomp/io/blockcompressor.h>
+#include <libgeodecomp/misc/random.h>
+#include <libgeodecomp/misc/stdcontaineroverloads.h>
+
+#include <cxxtest/TestSuite.h>
+
+using namespace LibGeoDecomp;
+
+namespace LibGeoDecomp {
+
+class BlockCompressorTest : public CxxTest::TestSuite
+{
+public:
+    void testRoundTrip()
+    {
+        // smooth data with a few blocks of zeros and noise:
+        std::vector<double> data(10000);
+        for (std::size_t i = 0; i < data.size(); ++i) {
+            data[i] = (i < 3000) ? 0 : float(1.0 + i * 1e-3);
+        }
+        Random::seed(47);
+        for (std::size_t i = 8000; i < 9000; ++i) {
+            data[i] = Random::gen_d(1.0);
+        }
+
+        BlockCompressor compressor(sizeof(double), 8192);
+        std::vector<char> stream;
+        compressor.compress(reinterpret_cast<char*>(&data[0]), data.size() * sizeof(double), &stream);
+        TS_ASSERT_LESS_THAN(stream.size(), data.size() * sizeof(double) / 2);
+
+        std::vector<char> restored;
+        TS_ASSERT_EQUALS(stream.size(), compressor.decompress(&stream[0], stream.size(), &restored));
+        TS_ASSERT_EQUALS(data.size() * sizeof(double), restored.size());
+        TS_ASSERT(std::equal(restored.begin(), restored.end(), reinterpret_cast<char*>(&data[0])));
+    }
+
+    void testIncompressibleDataAndConcatenation()
+    {
+        Random::seed(11);
+        std::vector<char> noise;
+        for (int i = 0; i < 1000; ++i) {
+            noise << char(1 + Random::gen_u(255));
+        }
+        std::vector<char> empty;
+
+        std::vector<char> stream;
+        BlockCompressor compressor(4, 256);
+        compressor.compress(&noise[0], noise.size(), &stream);
+        // raw blocks bound the overhead:
+        TS_ASSERT_LESS_THAN(stream.size(), noise.size() + 32);
+        std::size_t firstLength = stream.size();
+        compressor.compress(0, 0, &stream);
+        BlockCompressor().compress(&noise[0], 10, &stream);
+
+        // decompression doesn't depend on the compressor's parameters:
+        BlockCompressor decompressor;
+        std::vector<char> restored;
+        std::size_t offset = decompressor.decompress(&stream[0], stream.size(), &restored);
+        TS_ASSERT_EQUALS(firstLength, offset);
+        TS_ASSERT_EQUALS(noise, restored);
+
+        restored.clear();
+        offset += decompressor.decompress(&stream[offset], stream.size() - offset, &restored);
+        TS_ASSERT_EQUALS(empty, restored);
+
+        offset += decompressor.decompress(&stream[offset], stream.size() - offset, &restored);
+        TS_ASSERT_EQUALS(stream.size(), offset);
+        TS_ASSERT_EQUALS(std::vector<char>(noise.begin(), noise.begin() + 10), restored);
+    }
+
+    void testMalformedInput()
+    {
+        std::vector<char> data(100, 1);
+        std::vector<char> stream;
+        BlockCompressor compressor(4);
+        compressor.compress(&data[0], data.size(), &stream);
+        TS_ASSERT_THROWS(compressor.compress(&data[0], 99, &stream), std::invalid_argument&);
+
+        std::vector<char> restored;
+        TS_ASSERT_THROWS(compressor.decompress(&stream[0], stream.size() - 1, &restored), std::logic_error&);
+    }
+};
+
+}
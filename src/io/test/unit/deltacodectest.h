@@ -0,0 +1,112 @@
+#include <libgeodecomp/io/deltacodec.h>
+#include <libgeodecomp/misc/random.h>
+
+#include <cmath>
+#include <cxxtest/TestSuite.h>
+
+using namespace LibGeoDecomp;
+
+namespace LibGeoDecomp {
+
+class DeltaCodecTest : public CxxTest::TestSuite
+{
+public:
+    class Cell
+    {
+    public:
+        double temperature;
+        double pressure;
+        int flags;
+    };
+
+    void testIdenticalDataYieldsNoOutput()
+    {
+        std::vector<Cell> cells = makeCells(100, 0.0);
+        std::vector<char> encoded;
+
+        TS_ASSERT(!codec.encode(bytes(cells), bytes(cells), sizeof(Cell), cells.size(), &encoded));
+        TS_ASSERT(encoded.empty());
+    }
+
+    void testRoundTrip()
+    {
+        Random::seed(4711);
+        std::vector<char> base(1001 * 3);
+        std::vector<char> current(base.size());
+        for (std::size_t i = 0; i < base.size(); ++i) {
+            base[i] = Random::gen_u(256);
+            // some untouched runs, some random noise:
+            current[i] = ((i / 100) % 2)? base[i] : char(Random::gen_u(256));
+        }
+
+        // encode must append, so prepend some garbage:
+        std::vector<char> encoded(5, 'x');
+        TS_ASSERT(codec.encode(&base[0], &current[0], 3, 1001, &encoded));
+
+        std::vector<char> diff(base.size());
+        codec.decode(&encoded[5], encoded.size() - 5, 3, 1001, &diff[0]);
+        DeltaCodec::applyDiff(&diff[0], &base[0], base.size());
+        TS_ASSERT_EQUALS(base, current);
+    }
+
+    void testSlowlyChangingFieldsCompressWell()
+    {
+        std::size_t count = 4096;
+        std::vector<Cell> base = makeCells(count, 0.0);
+        std::vector<Cell> current = makeCells(count, 1e-9);
+        std::vector<char> encoded;
+
+        TS_ASSERT(codec.encode(bytes(base), bytes(current), sizeof(Cell), count, &encoded));
+        TS_ASSERT_LESS_THAN(encoded.size() * 10, count * sizeof(Cell));
+
+        std::vector<Cell> restored = base;
+        std::vector<char> diff(count * sizeof(Cell));
+        codec.decode(&encoded[0], encoded.size(), sizeof(Cell), count, &diff[0]);
+        DeltaCodec::applyDiff(&diff[0], reinterpret_cast<char*>(&restored[0]), diff.size());
+
+        for (std::size_t i = 0; i < count; ++i) {
+            TS_ASSERT_EQUALS(current[i].temperature, restored[i].temperature);
+            TS_ASSERT_EQUALS(current[i].pressure,    restored[i].pressure);
+            TS_ASSERT_EQUALS(current[i].flags,       restored[i].flags);
+        }
+    }
+
+    void testCorruptStreamIsDetected()
+    {
+        std::vector<Cell> base = makeCells(100, 0.0);
+        std::vector<Cell> current = makeCells(100, 1.0);
+        std::vector<char> encoded;
+        TS_ASSERT(codec.encode(bytes(base), bytes(current), sizeof(Cell), 100, &encoded));
+
+        std::vector<char> diff(100 * sizeof(Cell));
+        TS_ASSERT_THROWS(
+            codec.decode(&encoded[0], encoded.size() - 1, sizeof(Cell), 100, &diff[0]),
+            std::logic_error&);
+    }
+
+private:
+    DeltaCodec codec;
+
+    std::vector<Cell> makeCells(std::size_t count, double time)
+    {
+        std::vector<Cell> ret(count);
+        // zero padding, so that memcmp-style comparisons are valid:
+        std::fill(bytes(ret), bytes(ret) + count * sizeof(Cell), 0);
+
+        // only a small part of the domain evolves:
+        for (std::size_t i = 0; i < count; ++i) {
+            ret[i].temperature = 300 + std::sin(i * 0.01) + ((i < count / 20)? time * i : 0);
+            ret[i].pressure = 1e5;
+            ret[i].flags = i % 3;
+        }
+
+        return ret;
+    }
+
+    char *bytes(std::vector<Cell>& cells)
+    {
+        return reinterpret_cast<char*>(&cells[0]);
+    }
+};
+
+}
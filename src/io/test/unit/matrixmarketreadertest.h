@@ -0,0 +1,249 @@
+#include <libgeodecomp/io/ioexception.h>
+#include <libgeodecomp/io/matrixmarketreader.h>
+#include <libgeodecomp/misc/random.h>
+#include <libgeodecomp/misc/tempfile.h>
+
+#include <boost/filesystem.hpp>
+#include <cxxtest/TestSuite.h>
+#include <fstream>
+#include <iomanip>
+
+using namespace LibGeoDecomp;
+
+namespace LibGeoDecomp {
+
+class MatrixMarketReaderTest : public CxxTest::TestSuite
+{
+public:
+    typedef std::map<Coord<2>, double> Matrix;
+
+    void setUp()
+    {
+        fileName = TempFile::serial("matrixmarketreadertest") + ".mtx";
+    }
+
+    void tearDown()
+    {
+        boost::filesystem::remove(fileName);
+        boost::filesystem::remove(MatrixMarketReader::cacheFileName(fileName));
+    }
+
+    void testGeneral()
+    {
+        writeFile(
+            "%%MatrixMarket matrix coordinate real general\n"
+            "% a comment\n"
+            "%\n"
+            "4 5 6\n"
+            "1 1 1.5\n"
+            "3 2 -2e-3\n"
+            "\n"
+            "1 5 7\n"
+            "1 3 4.25\n"
+            "  4   4   1E2\r\n"
+            "3 1 3\n");
+
+        CSRMatrix<double> matrix = MatrixMarketReader::parse(fileName);
+        TS_ASSERT_EQUALS(4, matrix.rows());
+        TS_ASSERT_EQUALS(5, matrix.columns());
+        TS_ASSERT_EQUALS(6, matrix.nonZeros());
+
+        int expectedRowPointers[] = { 0, 3, 3, 5, 6 };
+        int expectedColumns[] = { 0, 2, 4, 0, 1, 3 };
+        double expectedValues[] = { 1.5, 4.25, 7, 3, -2e-3, 100 };
+        TS_ASSERT(std::equal(expectedRowPointers, expectedRowPointers + 5, matrix.rowPointers()));
+        TS_ASSERT(std::equal(expectedColumns, expectedColumns + 6, matrix.columnIndices()));
+        TS_ASSERT(std::equal(expectedValues, expectedValues + 6, matrix.values()));
+    }
+
+    void testSymmetricPattern()
+    {
+        writeFile(
+            "%%MatrixMarket matrix coordinate pattern symmetric\n"
+            "3 3 3\n"
+            "1 1\n"
+            "3 1\n"
+            "3 2\n");
+
+        Matrix expected;
+        expected[Coord<2>(0, 0)] = 1;
+        expected[Coord<2>(0, 2)] = 1;
+        expected[Coord<2>(1, 2)] = 1;
+        expected[Coord<2>(2, 0)] = 1;
+        expected[Coord<2>(2, 1)] = 1;
+
+        CSRMatrix<double> matrix = MatrixMarketReader::parse(fileName);
+        TS_ASSERT_EQUALS(5, matrix.nonZeros());
+        TS_ASSERT_EQUALS(expected, matrix.toMap());
+    }
+
+    void testSkewSymmetric()
+    {
+        writeFile(
+            "%%MatrixMarket matrix coordinate integer skew-symmetric\n"
+            "2 2 1\n"
+            "2 1 3\n");
+
+        Matrix expected;
+        expected[Coord<2>(0, 1)] = -3;
+        expected[Coord<2>(1, 0)] = 3;
+
+        TS_ASSERT_EQUALS(expected, MatrixMarketReader::parse(fileName).toMap());
+    }
+
+    void testLargeMatrixMatchesReference()
+    {
+        // large enough to be split among all threads:
+        Random::seed(1234);
+        int dimension = 5000;
+        Matrix expected;
+        for (int i = 0; i < 40000; ++i) {
+            expected[Coord<2>(Random::gen_u(dimension), Random::gen_u(dimension))] =
+                Random::gen_d(10.0) - 5.0;
+        }
+
+        std::stringstream buf;
+        buf << "%%MatrixMarket matrix coordinate real general\n"
+            << dimension << " " << dimension << " " << expected.size() << "\n"
+            << std::setprecision(17);
+        // column-major order, as is common for Matrix Market files:
+        std::map<Coord<2>, double> byColumn;
+        for (Matrix::iterator i = expected.begin(); i != expected.end(); ++i) {
+            byColumn[Coord<2>(i->first.y(), i->first.x())] = i->second;
+        }
+        for (Matrix::iterator i = byColumn.begin(); i != byColumn.end(); ++i) {
+            buf << (i->first.y() + 1) << " " << (i->first.x() + 1) << " " << i->second << "\n";
+        }
+        writeFile(buf.str());
+
+        CSRMatrix<double> matrix = MatrixMarketReader::parse(fileName);
+        TS_ASSERT_EQUALS(dimension, matrix.rows());
+        TS_ASSERT_EQUALS(int(expected.size()), matrix.nonZeros());
+        TS_ASSERT_EQUALS(expected, matrix.toMap());
+    }
+
+    void testCache()
+    {
+        writeFile(
+            "%%MatrixMarket matrix coordinate real general\n"
+            "3 3 4\n"
+            "1 1 1\n"
+            "2 3 2\n"
+            "3 3 3\n"
+            "2 1 4\n");
+        std::string cacheName = MatrixMarketReader::cacheFileName(fileName);
+        TS_ASSERT(!boost::filesystem::exists(cacheName));
+
+        CSRMatrix<double> parsed = MatrixMarketReader::read(fileName);
+        TS_ASSERT(!parsed.isView());
+        TS_ASSERT(boost::filesystem::exists(cacheName));
+
+        CSRMatrix<double> cached = MatrixMarketReader::read(fileName);
+        TS_ASSERT(cached.isView());
+        TS_ASSERT_EQUALS(parsed, cached);
+        TS_ASSERT_EQUALS(0u, reinterpret_cast<std::size_t>(cached.values()) % sizeof(double));
+
+        // changes to the input invalidate the cache:
+        writeFile(
+            "%%MatrixMarket matrix coordinate real general\n"
+            "3 3 2\n"
+            "1 1 5\n"
+            "3 2 6\n");
+        CSRMatrix<double> dummy;
+        TS_ASSERT(!MatrixMarketReader::loadCache(fileName, &dummy));
+
+        CSRMatrix<double> reparsed = MatrixMarketReader::read(fileName);
+        TS_ASSERT(!reparsed.isView());
+        TS_ASSERT_EQUALS(2, reparsed.nonZeros());
+        TS_ASSERT_EQUALS(reparsed, MatrixMarketReader::read(fileName));
+
+        // cached matrices outlive the cache file's removal:
+        cached = MatrixMarketReader::read(fileName);
+        boost::filesystem::remove(cacheName);
+        TS_ASSERT_EQUALS(reparsed, cached);
+    }
+
+    void testDuplicatesAreSummed()
+    {
+        writeFile(
+            "%%MatrixMarket matrix coordinate real symmetric\n"
+            "3 3 5\n"
+            "2 1 1\n"
+            "3 3 2\n"
+            "1 2 4\n"
+            "3 3 0.5\n"
+            "3 1 8\n");
+
+        CSRMatrix<double> matrix = MatrixMarketReader::parse(fileName);
+        TS_ASSERT_EQUALS(3, matrix.rows());
+        TS_ASSERT_EQUALS(5, matrix.nonZeros());
+
+        int expectedRowPointers[] = { 0, 2, 3, 5 };
+        int expectedColumns[] = { 1, 2, 0, 0, 2 };
+        double expectedValues[] = { 5, 8, 5, 8, 2.5 };
+        TS_ASSERT(std::equal(expectedRowPointers, expectedRowPointers + 4, matrix.rowPointers()));
+        TS_ASSERT(std::equal(expectedColumns, expectedColumns + 5, matrix.columnIndices()));
+        TS_ASSERT(std::equal(expectedValues, expectedValues + 5, matrix.values()));
+    }
+
+    void testMalformedInput()
+    {
+        writeFile(
+            "%%MatrixMarket matrix array real general\n"
+            "2 2\n"
+            "1\n2\n3\n4\n");
+        TS_ASSERT_THROWS(MatrixMarketReader::parse(fileName), IOException&);
+
+        writeFile(
+            "%%MatrixMarket matrix coordinate real general\n"
+            "2 2 3\n"
+            "1 1 1\n"
+            "2 2 2\n");
+        TS_ASSERT_THROWS(MatrixMarketReader::parse(fileName), IOException&);
+
+        writeFile(
+            "%%MatrixMarket matrix coordinate real general\n"
+            "2 2 1\n"
+            "3 1 1\n");
+        TS_ASSERT_THROWS(MatrixMarketReader::parse(fileName), IOException&);
+
+        writeFile(
+            "%%MatrixMarket matrix coordinate real general\n"
+            "2 2 1\n"
+            "1 1 abc\n");
+        TS_ASSERT_THROWS(MatrixMarketReader::parse(fileName), IOException&);
+
+        // too many entries for CSRMatrix's int indices:
+        writeFile(
+            "%%MatrixMarket matrix coordinate real general\n"
+            "2 2 3000000000\n"
+            "1 1 1\n");
+        TS_ASSERT_THROWS(MatrixMarketReader::parse(fileName), IOException&);
+
+        writeFile(
+            "%%MatrixMarket matrix coordinate real general\n"
+            "2 2 99999999999999999999999\n"
+            "1 1 1\n");
+        TS_ASSERT_THROWS(MatrixMarketReader::parse(fileName), IOException&);
+
+        TS_ASSERT_THROWS(MatrixMarketReader::parse(fileName + ".missing"), FileOpenException&);
+    }
+
+private:
+    std::string fileName;
+
+    void writeFile(const std::string& content)
+    {
+        std::ofstream file(fileName.c_str());
+        file << content;
+        file.close();
+
+        // modification times may have a resolution of a full second,
+        // so we make sure they change:
+        std::time_t now = boost::filesystem::last_write_time(fileName);
+        static std::time_t offset = 0;
+        boost::filesystem::last_write_time(fileName, now + (++offset));
+    }
+};
+
+}
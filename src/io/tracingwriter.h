@@ -17,7 +17,8 @@ namespace LibGeoDecomp {
  * The purpose of the TracingWriter is out output performance data
  * which allows the user to gauge execution time (current, remaining,
  * estimated time of arrival (ETA)) and performance (GLUPS, memory
- * bandwidth).
+ * bandwidth). For a machine-readable record of the performance
+ * counters of all ranks see TelemetryWriter.
  */
 template<typename CELL_TYPE>
 class TracingWriter :
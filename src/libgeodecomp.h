@@ -45,5 +45,7 @@
 #include <libgeodecomp/storage/multicontainercell.h>
 #include <libgeodecomp/storage/simplearrayfilter.h>
 #include <libgeodecomp/storage/simplefilter.h>
+#include <libgeodecomp/storage/soaboxcell.h>
+#include <libgeodecomp/storage/verletboxcell.h>
 
 #endif
@@ -0,0 +1,305 @@
+#ifndef LIBGEODECOMP_LOADBALANCER_COSTMAP_H
+#define LIBGEODECOMP_LOADBALANCER_COSTMAP_H
+
+#include <libgeodecomp/geometry/coordbox.h>
+#include <libgeodecomp/geometry/region.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace LibGeoDecomp {
+
+/**
+ * A CostMap stores the (relative) cost of updating a cell for each
+ * block of blockDim cells in the simulation space. Use a block size
+ * of 1 for a per-cell map, larger blocks to reduce memory and
+ * balancing overhead. Initially all cells are assumed to be equally
+ * expensive.
+ *
+ * The map can either be seeded by the user (e.g. from particle
+ * counts, see setDensity()) or learn from measured update times via
+ * refine(). Partitions which accept a CostMap (e.g.
+ * RecursiveBisectionPartition) will then cut the simulation space so
+ * that each node receives a share of the measured work rather than
+ * of the number of cells. For space-filling curves see
+ * curveWeights().
+ */
+template<int DIM>
+class CostMap
+{
+public:
+    explicit CostMap(
+        const CoordBox<DIM>& box = CoordBox<DIM>(),
+        const Coord<DIM>& blockDim = Coord<DIM>::diagonal(1)) :
+        box(box),
+        blockDim(blockDim)
+    {
+        for (int d = 0; d < DIM; ++d) {
+            if (blockDim[d] <= 0) {
+                throw std::invalid_argument("block dimensions must be positive");
+            }
+            numBlocks[d] = (box.dimensions[d] + blockDim[d] - 1) / blockDim[d];
+        }
+
+        densities.resize(numBlocks.prod(), 1.0);
+    }
+
+    inline const CoordBox<DIM>& boundingBox() const
+    {
+        return box;
+    }
+
+    inline const Coord<DIM>& blockDimensions() const
+    {
+        return blockDim;
+    }
+
+    /**
+     * Cost of the cell at coord.
+     */
+    inline double density(const Coord<DIM>& coord) const
+    {
+        return densities[blockIndex(coord)];
+    }
+
+    /**
+     * Sets the cost of all cells within the blocks which intersect
+     * with subBox.
+     */
+    void setDensity(const CoordBox<DIM>& subBox, double density)
+    {
+        CoordBox<DIM> blocks = blocksOf(subBox);
+        for (typename CoordBox<DIM>::Iterator i = blocks.begin(); i != blocks.end(); ++i) {
+            densities[i->toIndex(numBlocks)] = density;
+        }
+    }
+
+    /**
+     * Raw access to the per-block densities, e.g. for broadcasting
+     * the map to other nodes.
+     */
+    inline const std::vector<double>& getDensities() const
+    {
+        return densities;
+    }
+
+    inline void setDensities(const std::vector<double>& newDensities)
+    {
+        if (newDensities.size() != densities.size()) {
+            throw std::invalid_argument("number of blocks doesn't match");
+        }
+        densities = newDensities;
+    }
+
+    double cost(const CoordBox<DIM>& subBox) const
+    {
+        double ret = 0;
+        CoordBox<DIM> blocks = blocksOf(subBox);
+        for (typename CoordBox<DIM>::Iterator i = blocks.begin(); i != blocks.end(); ++i) {
+            ret += densities[i->toIndex(numBlocks)] * overlap(*i, subBox).prod();
+        }
+
+        return ret;
+    }
+
+    double cost(const Region<DIM>& region) const
+    {
+        double ret = 0;
+        for (typename Region<DIM>::StreakIterator i = region.beginStreak();
+             i != region.endStreak();
+             ++i) {
+            Coord<DIM> c = i->origin;
+            while (c.x() < i->endX) {
+                int blockEnd = blockEndX(c);
+                int end = (std::min)(blockEnd, i->endX);
+                ret += density(c) * (end - c.x());
+                c.x() = end;
+            }
+        }
+
+        return ret;
+    }
+
+    /**
+     * Returns the cost of each slice of subBox which is orthogonal
+     * to dimension dim, i.e. ret[i] is the cost of all cells within
+     * subBox with coord[dim] == subBox.origin[dim] + i. This is the
+     * basis for cost-aware bisections.
+     */
+    std::vector<double> sliceCosts(const CoordBox<DIM>& subBox, int dim) const
+    {
+        std::vector<double> ret(subBox.dimensions[dim], 0.0);
+        CoordBox<DIM> blocks = blocksOf(subBox);
+
+        for (typename CoordBox<DIM>::Iterator i = blocks.begin(); i != blocks.end(); ++i) {
+            Coord<DIM> extent = overlap(*i, subBox);
+            int sliceCells = extent.prod() / extent[dim];
+            double sliceCost = densities[i->toIndex(numBlocks)] * sliceCells;
+
+            int start = (std::max)(
+                box.origin[dim] + (*i)[dim] * blockDim[dim],
+                subBox.origin[dim]);
+            for (int s = 0; s < extent[dim]; ++s) {
+                ret[start - subBox.origin[dim] + s] += sliceCost;
+            }
+        }
+
+        return ret;
+    }
+
+    /**
+     * Updates the map given that updating the cells in regions[i]
+     * took measuredCosts[i] (e.g. seconds). The cost of each region
+     * is scaled to match the measurement while retaining the
+     * relative costs of blocks within that region, which were learned
+     * from previous measurements with different decompositions. Thus
+     * the map's resolution improves as partitions move. Blocks which
+     * overlap with multiple regions receive a weighted average of the
+     * corrections.
+     */
+    void refine(const std::vector<Region<DIM> >& regions, const std::vector<double>& measuredCosts)
+    {
+        if (regions.size() != measuredCosts.size()) {
+            throw std::invalid_argument("need exactly one measurement per region");
+        }
+
+        std::vector<double> weightedFactors(densities.size(), 0.0);
+        std::vector<double> overlaps(densities.size(), 0.0);
+
+        for (std::size_t r = 0; r < regions.size(); ++r) {
+            double predicted = cost(regions[r]);
+            // idle or empty nodes don't tell us anything:
+            if ((predicted <= 0) || (measuredCosts[r] <= 0)) {
+                continue;
+            }
+            double factor = measuredCosts[r] / predicted;
+
+            for (typename Region<DIM>::StreakIterator i = regions[r].beginStreak();
+                 i != regions[r].endStreak();
+                 ++i) {
+                Coord<DIM> c = i->origin;
+                while (c.x() < i->endX) {
+                    int end = (std::min)(blockEndX(c), i->endX);
+                    std::size_t index = blockIndex(c);
+                    weightedFactors[index] += factor * (end - c.x());
+                    overlaps[index] += end - c.x();
+                    c.x() = end;
+                }
+            }
+        }
+
+        for (std::size_t i = 0; i < densities.size(); ++i) {
+            if (overlaps[i] > 0) {
+                densities[i] *= weightedFactors[i] / overlaps[i];
+            }
+        }
+    }
+
+    /**
+     * Translates shares of the total work (e.g. weights returned by
+     * a LoadBalancer) into numbers of cells along a space-filling
+     * curve, given by the iterators begin and end (see
+     * SpaceFillingCurve). The result can be passed as weights to the
+     * curve's constructor. This traverses the whole curve, so it's
+     * O(number of cells).
+     */
+    template<typename ITERATOR>
+    std::vector<std::size_t> curveWeights(
+        ITERATOR begin,
+        const ITERATOR& end,
+        const std::vector<std::size_t>& shares) const
+    {
+        std::vector<std::size_t> ret(shares.size(), 0);
+        if (shares.empty()) {
+            return ret;
+        }
+
+        double totalShares = 0;
+        for (std::size_t i = 0; i < shares.size(); ++i) {
+            totalShares += shares[i];
+        }
+        double totalCost = cost(box);
+
+        std::size_t node = 0;
+        double accumulatedShares = shares[0];
+        double accumulatedCost = 0;
+
+        for (; begin != end; ++begin) {
+            double cellCost = density(*begin);
+            // cut at the cell whose center is closest to the target:
+            while ((node < shares.size() - 1) &&
+                   ((accumulatedCost + 0.5 * cellCost) >= (totalCost * accumulatedShares / totalShares))) {
+                ++node;
+                accumulatedShares += shares[node];
+            }
+
+            accumulatedCost += cellCost;
+            ++ret[node];
+        }
+
+        return ret;
+    }
+
+private:
+    CoordBox<DIM> box;
+    Coord<DIM> blockDim;
+    Coord<DIM> numBlocks;
+    std::vector<double> densities;
+
+    inline std::size_t blockIndex(const Coord<DIM>& coord) const
+    {
+        Coord<DIM> block;
+        for (int d = 0; d < DIM; ++d) {
+            block[d] = (coord[d] - box.origin[d]) / blockDim[d];
+        }
+
+        return block.toIndex(numBlocks);
+    }
+
+    inline int blockEndX(const Coord<DIM>& coord) const
+    {
+        int relative = coord.x() - box.origin.x();
+        return box.origin.x() + (relative / blockDim.x() + 1) * blockDim.x();
+    }
+
+    /**
+     * Returns the box of block indices which intersect with subBox.
+     */
+    CoordBox<DIM> blocksOf(const CoordBox<DIM>& subBox) const
+    {
+        CoordBox<DIM> ret;
+        for (int d = 0; d < DIM; ++d) {
+            if (subBox.dimensions[d] <= 0) {
+                return CoordBox<DIM>();
+            }
+
+            int first = (subBox.origin[d] - box.origin[d]) / blockDim[d];
+            int last = (subBox.origin[d] + subBox.dimensions[d] - 1 - box.origin[d]) / blockDim[d];
+            ret.origin[d] = first;
+            ret.dimensions[d] = last - first + 1;
+        }
+
+        return ret;
+    }
+
+    /**
+     * Extent of the intersection of a block with subBox.
+     */
+    Coord<DIM> overlap(const Coord<DIM>& block, const CoordBox<DIM>& subBox) const
+    {
+        Coord<DIM> ret;
+        for (int d = 0; d < DIM; ++d) {
+            int blockStart = box.origin[d] + block[d] * blockDim[d];
+            int start = (std::max)(blockStart, subBox.origin[d]);
+            int end = (std::min)(blockStart + blockDim[d], subBox.origin[d] + subBox.dimensions[d]);
+            ret[d] = end - start;
+        }
+
+        return ret;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,138 @@
+#include <libgeodecomp/geometry/partitions/hindexingpartition.h>
+#include <libgeodecomp/geometry/partitions/stripingpartition.h>
+#include <libgeodecomp/loadbalancer/costmap.h>
+
+#include <boost/assign/std/vector.hpp>
+#include <cxxtest/TestSuite.h>
+
+using namespace boost::assign;
+using namespace LibGeoDecomp;
+
+namespace LibGeoDecomp {
+
+class CostMapTest : public CxxTest::TestSuite
+{
+public:
+    void setUp()
+    {
+        box = CoordBox<2>(Coord<2>(10, 5), Coord<2>(20, 10));
+    }
+
+    void testUniformDefault()
+    {
+        CostMap<2> map(box, Coord<2>(4, 3));
+
+        TS_ASSERT_EQUALS(200.0, map.cost(box));
+        TS_ASSERT_EQUALS(1.0, map.density(Coord<2>(29, 14)));
+
+        Region<2> region;
+        region << Streak<2>(Coord<2>(11, 6), 27)
+               << Streak<2>(Coord<2>(15, 9), 16);
+        TS_ASSERT_EQUALS(17.0, map.cost(region));
+    }
+
+    void testPartialBlocks()
+    {
+        // 20x10 cells in blocks of 8x4 yield 3x3 blocks, the last row
+        // and column of which are only partially filled:
+        CostMap<2> map(box, Coord<2>(8, 4));
+        map.setDensity(CoordBox<2>(Coord<2>(26, 13), Coord<2>(1, 1)), 5.0);
+
+        TS_ASSERT_EQUALS(5.0, map.density(Coord<2>(29, 14)));
+        TS_ASSERT_EQUALS(5.0, map.density(Coord<2>(26, 13)));
+        TS_ASSERT_EQUALS(1.0, map.density(Coord<2>(25, 13)));
+        TS_ASSERT_EQUALS(200.0 - 8 + 8 * 5, map.cost(box));
+
+        Region<2> region;
+        region << box;
+        TS_ASSERT_EQUALS(map.cost(box), map.cost(region));
+
+        std::vector<double> slices = map.sliceCosts(box, 0);
+        TS_ASSERT_EQUALS(std::size_t(20), slices.size());
+        TS_ASSERT_EQUALS(10.0, slices[15]);
+        TS_ASSERT_EQUALS(18.0, slices[16]);
+        TS_ASSERT_EQUALS(18.0, slices[19]);
+
+        slices = map.sliceCosts(CoordBox<2>(Coord<2>(20, 12), Coord<2>(10, 3)), 1);
+        TS_ASSERT_EQUALS(std::size_t(3), slices.size());
+        TS_ASSERT_EQUALS(10.0, slices[0]);
+        TS_ASSERT_EQUALS(6.0 + 4 * 5, slices[1]);
+    }
+
+    void testRefineLearnsFromDifferentDecompositions()
+    {
+        // true cost: 4 per cell in the left quarter, 1 elsewhere
+        CostMap<2> map(box, Coord<2>(5, 10));
+
+        // first decomposition: left and right half
+        std::vector<Region<2> > regions(2);
+        regions[0] << CoordBox<2>(Coord<2>(10, 5), Coord<2>(10, 10));
+        regions[1] << CoordBox<2>(Coord<2>(20, 5), Coord<2>(10, 10));
+        std::vector<double> times;
+        times += 250, 100;
+        map.refine(regions, times);
+
+        TS_ASSERT_EQUALS(2.5, map.density(Coord<2>(10, 5)));
+        TS_ASSERT_EQUALS(2.5, map.density(Coord<2>(19, 5)));
+        TS_ASSERT_EQUALS(1.0, map.density(Coord<2>(20, 5)));
+
+        // second decomposition: left quarter and the rest
+        regions[0].clear();
+        regions[1].clear();
+        regions[0] << CoordBox<2>(Coord<2>(10, 5), Coord<2>( 5, 10));
+        regions[1] << CoordBox<2>(Coord<2>(15, 5), Coord<2>(15, 10));
+        times.clear();
+        times += 200, 150;
+        map.refine(regions, times);
+
+        // the left quarter is now known exactly, the estimate for the
+        // rest will improve with further measurements:
+        TS_ASSERT_EQUALS(4.0, map.density(Coord<2>(10, 5)));
+        TS_ASSERT_DELTA(5.0 / 3, map.density(Coord<2>(15, 5)), 1e-12);
+        TS_ASSERT_DELTA(2.0 / 3, map.density(Coord<2>(20, 5)), 1e-12);
+        TS_ASSERT_DELTA(350.0, map.cost(box), 1e-12);
+    }
+
+    void testRefineIgnoresIdleNodes()
+    {
+        CostMap<2> map(box);
+        std::vector<Region<2> > regions(2);
+        regions[1] << box;
+        std::vector<double> times;
+        times += 0, 0;
+        map.refine(regions, times);
+
+        TS_ASSERT_EQUALS(200.0, map.cost(box));
+    }
+
+    void testCurveWeights()
+    {
+        CostMap<2> map(box, Coord<2>(1, 1));
+        map.setDensity(CoordBox<2>(Coord<2>(10, 5), Coord<2>(20, 2)), 4.0);
+
+        std::vector<std::size_t> shares;
+        shares += 1, 1, 2;
+        StripingPartition<2> striping(box.origin, box.dimensions, 0, std::vector<std::size_t>(1, 200));
+        std::vector<std::size_t> weights = map.curveWeights(striping.begin(), striping.end(), shares);
+
+        // total cost 4 * 40 + 160 = 320, so the first two nodes should
+        // receive 80 each, i.e. one row of expensive cells each:
+        std::vector<std::size_t> expected;
+        expected += 20, 20, 160;
+        TS_ASSERT_EQUALS(expected, weights);
+
+        HIndexingPartition hindexing(Coord<2>(), Coord<2>(32, 32), 0, std::vector<std::size_t>(1, 1024));
+        CostMap<2> uniform(CoordBox<2>(Coord<2>(), Coord<2>(32, 32)));
+        shares.clear();
+        shares += 3, 1;
+        weights = uniform.curveWeights(hindexing.begin(), hindexing.end(), shares);
+        expected.clear();
+        expected += 768, 256;
+        TS_ASSERT_EQUALS(expected, weights);
+    }
+
+private:
+    CoordBox<2> box;
+};
+
+}
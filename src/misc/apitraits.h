@@ -1087,6 +1087,44 @@ public:
 
     // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 
+    template<typename CELL, typename HAS_BATCHED_UPDATE = void>
+    class SelectBatchedUpdate
+    {
+    public:
+        typedef FalseType Value;
+    };
+
+    template<typename CELL>
+    class SelectBatchedUpdate<CELL, typename CELL::API::SupportsBatchedUpdate>
+    {
+    public:
+        typedef TrueType Value;
+    };
+
+    /**
+     * Particles stored in a SoABoxCell may use this to update all
+     * particles of a box in one go, much like updateLineX() does for
+     * a streak of cells. The particle class then needs to provide a
+     * static function
+     *
+     *   template<typename ACCESSOR, typename NEIGHBORS>
+     *   static void updateBatch(
+     *       ACCESSOR& particles, long *i, long end,
+     *       const NEIGHBORS& neighbors, int nanoStep);
+     *
+     * which updates the particles i to end - 1, typically in chunks
+     * of short_vec lanes (see LIBFLATARRAY_LOOP_PEELER). particles is
+     * a LibFlatArray::soa_accessor, so &particles.foo() + *i points
+     * to member foo of particle *i.
+     */
+    class HasBatchedUpdate
+    {
+    public:
+        typedef void SupportsBatchedUpdate;
+    };
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+
     // Trait Template:
 
     // template<typename CELL, typename HAS_TEMPLATE_NAME = void>
@@ -135,6 +135,11 @@ DEFINE_EVENT(TimePatchProviders, ChronometerHelpers::BasicTimer,   "patch_provid
 DEFINE_EVENT(TimeCommunication,  ChronometerHelpers::BasicTimer,   "communication_time",   6)
 DEFINE_EVENT(TimeInput,          ChronometerHelpers::BasicTimer,   "input_time",           7)
 DEFINE_EVENT(TimeOutput,         ChronometerHelpers::BasicTimer,   "output_time",          8)
+DEFINE_EVENT(TimeIdle,           ChronometerHelpers::BasicTimer,   "idle_time",            9)
+DEFINE_EVENT(TimeMigration,      ChronometerHelpers::BasicTimer,   "migration_time",       10)
+DEFINE_EVENT(TimeOutputCopy,     TimeOutput,                       "output_time_copy",     11)
+// spent by background threads, so it may overlap with other events:
+DEFINE_EVENT(TimeOutputDrain,    ChronometerHelpers::BasicTimer,   "output_time_drain",    12)
 
 namespace ChronometerHelpers {
 
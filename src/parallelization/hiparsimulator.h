@@ -5,21 +5,199 @@
 #ifdef LIBGEODECOMP_WITH_MPI
 
 #include <libgeodecomp/communication/mpilayer.h>
+#include <libgeodecomp/geometry/partitions/hilbertpartition.h>
+#include <libgeodecomp/geometry/partitions/hindexingpartition.h>
+#include <libgeodecomp/geometry/partitions/recursivebisectionpartition.h>
 #include <libgeodecomp/geometry/partitions/stripingpartition.h>
+#include <libgeodecomp/geometry/partitions/zcurvepartition.h>
 #include <libgeodecomp/geometry/partitions/ptscotchunstructuredpartition.h>
 #include <libgeodecomp/geometry/partitions/unstructuredstripingpartition.h>
 #include <libgeodecomp/geometry/partitions/distributedptscotchunstructuredpartition.h>
+#include <libgeodecomp/io/logger.h>
+#include <libgeodecomp/loadbalancer/costmap.h>
 #include <libgeodecomp/loadbalancer/loadbalancer.h>
+#include <libgeodecomp/misc/scopedtimer.h>
 #include <libgeodecomp/parallelization/hierarchicalsimulator.h>
+#include <libgeodecomp/parallelization/nesting/ghostzonewidthmodel.h>
 #include <libgeodecomp/parallelization/nesting/parallelwriteradapter.h>
 #include <libgeodecomp/parallelization/nesting/steereradapter.h>
 #include <libgeodecomp/parallelization/nesting/mpiupdategroup.h>
+#include <libgeodecomp/storage/patchbufferfixed.h>
 #include <cmath>
+#include <limits>
 #include <stdexcept>
 #include <boost/make_shared.hpp>
 
 namespace LibGeoDecomp {
 
+namespace HiParSimulatorHelpers {
+
+/**
+ * Wraps the user's Initializer when an UpdateGroup needs to be
+ * rebuilt mid-run (e.g. after load balancing). The Stepper will then
+ * start at the current time step. grid() is still forwarded so that
+ * edge cells and other per-grid state (e.g. weights of unstructured
+ * grids) get set up; the cells themselves will be overwritten with
+ * the migrated state.
+ */
+template<typename CELL>
+class ResumingInitializer : public Initializer<CELL>
+{
+public:
+    typedef typename Initializer<CELL>::Topology Topology;
+    const static int DIM = Topology::DIM;
+
+    ResumingInitializer(
+        boost::shared_ptr<Initializer<CELL> > delegate,
+        unsigned resumeStep) :
+        delegate(delegate),
+        resumeStep(resumeStep)
+    {}
+
+    virtual void grid(GridBase<CELL, DIM> *target)
+    {
+        delegate->grid(target);
+    }
+
+    virtual Coord<DIM> gridDimensions() const
+    {
+        return delegate->gridDimensions();
+    }
+
+    virtual CoordBox<DIM> gridBox()
+    {
+        return delegate->gridBox();
+    }
+
+    virtual unsigned startStep() const
+    {
+        return resumeStep;
+    }
+
+    virtual unsigned maxSteps() const
+    {
+        return delegate->maxSteps();
+    }
+
+    virtual boost::shared_ptr<Adjacency> getAdjacency(const Region<DIM>& region) const
+    {
+        return delegate->getAdjacency(region);
+    }
+
+private:
+    boost::shared_ptr<Initializer<CELL> > delegate;
+    unsigned resumeStep;
+};
+
+/**
+ * Creates the Partitions for HiParSimulator. Partitions which can't
+ * make use of a CostMap simply ignore it.
+ */
+template<typename PARTITION>
+class PartitionFactory
+{
+public:
+    template<int DIM>
+    static PARTITION *make(
+        const CoordBox<DIM>& box,
+        const std::vector<std::size_t>& weights,
+        const boost::shared_ptr<Adjacency>& adjacency,
+        const boost::shared_ptr<const CostMap<DIM> >& /* unused: costMap */)
+    {
+        return new PARTITION(box.origin, box.dimensions, 0, weights, adjacency);
+    }
+};
+
+/**
+ * Space-filling curves are cut where the accumulated cost along the
+ * curve matches the nodes' shares.
+ */
+template<typename PARTITION>
+class CurvePartitionFactory
+{
+public:
+    template<int DIM>
+    static PARTITION *make(
+        const CoordBox<DIM>& box,
+        const std::vector<std::size_t>& weights,
+        const boost::shared_ptr<Adjacency>& adjacency,
+        const boost::shared_ptr<const CostMap<DIM> >& costMap)
+    {
+        if (!costMap) {
+            return new PARTITION(box.origin, box.dimensions, 0, weights, adjacency);
+        }
+
+        PARTITION curve(box.origin, box.dimensions, 0, weights, adjacency);
+        return new PARTITION(
+            box.origin,
+            box.dimensions,
+            0,
+            costMap->curveWeights(curve.begin(), curve.end(), weights),
+            adjacency);
+    }
+};
+
+/**
+ * see above
+ */
+template<int DIM>
+class PartitionFactory<StripingPartition<DIM> > : public CurvePartitionFactory<StripingPartition<DIM> >
+{};
+
+/**
+ * see above
+ */
+template<int DIM>
+class PartitionFactory<ZCurvePartition<DIM> > : public CurvePartitionFactory<ZCurvePartition<DIM> >
+{};
+
+/**
+ * see above
+ */
+template<>
+class PartitionFactory<HIndexingPartition> : public CurvePartitionFactory<HIndexingPartition>
+{};
+
+/**
+ * see above
+ */
+template<>
+class PartitionFactory<HilbertPartition> : public CurvePartitionFactory<HilbertPartition>
+{};
+
+/**
+ * RecursiveBisectionPartition evaluates the CostMap for each cut,
+ * even after construction. Hence it receives a snapshot of the map,
+ * so that refining the map doesn't move the cuts behind our back.
+ */
+template<int DIM>
+class PartitionFactory<RecursiveBisectionPartition<DIM> >
+{
+public:
+    static RecursiveBisectionPartition<DIM> *make(
+        const CoordBox<DIM>& box,
+        const std::vector<std::size_t>& weights,
+        const boost::shared_ptr<Adjacency>& adjacency,
+        const boost::shared_ptr<const CostMap<DIM> >& costMap)
+    {
+        boost::shared_ptr<const CostMap<DIM> > snapshot;
+        if (costMap) {
+            snapshot.reset(new CostMap<DIM>(*costMap));
+        }
+
+        return new RecursiveBisectionPartition<DIM>(
+            box.origin,
+            box.dimensions,
+            0,
+            weights,
+            adjacency,
+            Coord<DIM>::diagonal(1),
+            snapshot);
+    }
+};
+
+}
+
 /**
  * The HiParSimulator implements our hierarchical parallelization
  * algorithm which delivers best-of-breed latency hiding (wide ghost
@@ -29,6 +207,42 @@ namespace LibGeoDecomp {
  * inter-node or inter-NUMA-domain communication and OpenMP and/or
  * CUDA for local paralelism.
  *
+ * Load balancing is done by gathering the compute/wall clock time
+ * ratios of all ranks on rank 0, which will then ask its
+ * LoadBalancer for new weights. If these differ from the current
+ * ones, all ranks migrate their cells to match the new domain
+ * decomposition. Migration requires the whole grid to be in a
+ * consistent state, which is only the case when the ghost zones have
+ * just been synchronized and we're at the beginning of a time step.
+ * Hence migration may be deferred by a couple of nano steps.
+ *
+ * By default each rank's weight corresponds to a number of cells,
+ * which is only appropriate if all cells are equally expensive. With
+ * setCostMap() weights denote shares of the measured work instead:
+ * at each balancing step the CostMap is refined from the ranks'
+ * compute times and the domain is repartitioned if the map predicts
+ * an imbalance beyond the given tolerance. This requires a Partition
+ * which supports CostMaps, i.e. RecursiveBisectionPartition or one of
+ * the space-filling curves.
+ *
+ * If ghostZoneWidth is set to AUTO_GHOST_ZONE_WIDTH, the simulator
+ * picks the width itself: at startup neighboring ranks measure the
+ * latency and bandwidth of their links via a short ping-pong. The
+ * simulation then starts with a width of 1. At each load balancing
+ * step the ranks derive their per-cell compute cost from the
+ * Chronometer and evaluate a GhostZoneWidthModel for their
+ * subdomains. The width which minimizes the overhead of the slowest
+ * rank is applied by rebuilding the UpdateGroup (just like a
+ * migration, hence it may be deferred by a couple of nano steps).
+ * The width is re-evaluated whenever the domain is repartitioned, as
+ * this changes the subdomains' surfaces.
+ *
+ * With persistentRequests set, ghost zones of fixed size cells are
+ * exchanged via persistent MPI requests, for AoS cells straight from
+ * the grid via a derived datatype (see PatchLink). This saves the
+ * per-exchange setup and packing, which dominate when subdomains are
+ * small.
+ *
  * fixme: check if code runs with a communicator which is merely a subset of MPI_COMM_WORLD
  */
 template<
@@ -53,10 +267,15 @@ public:
     typedef HierarchicalSimulator<CELL_TYPE> ParentType;
     typedef MPIUpdateGroup<CELL_TYPE> UpdateGroupType;
     typedef typename ParentType::GridType GridType;
+    typedef typename UpdateGroupType::GridType UpdateGroupGridType;
+    typedef typename UpdateGroupType::PatchLinkAccepter PatchLinkAccepterType;
+    typedef typename UpdateGroupType::PatchLinkProvider PatchLinkProviderType;
+    typedef PatchBufferFixed<UpdateGroupGridType, UpdateGroupGridType, 1> PatchBufferType;
     typedef ParallelWriterAdapter<typename UpdateGroupType::GridType, CELL_TYPE> ParallelWriterAdapterType;
     typedef SteererAdapter<typename UpdateGroupType::GridType, CELL_TYPE> SteererAdapterType;
 
     static const int DIM = Topology::DIM;
+    static const unsigned AUTO_GHOST_ZONE_WIDTH = unsigned(-1);
 
     inline explicit HiParSimulator(
         Initializer<CELL_TYPE> *initializer,
@@ -64,15 +283,29 @@ public:
         unsigned loadBalancingPeriod = 1,
         unsigned ghostZoneWidth = 1,
         bool enableFineGrainedParallelism = false,
-        MPI_Comm communicator = MPI_COMM_WORLD) :
+        MPI_Comm communicator = MPI_COMM_WORLD,
+        bool persistentRequests = false) :
         ParentType(
             initializer,
             loadBalancingPeriod * NANO_STEPS,
             enableFineGrainedParallelism),
         balancer(balancer),
-        ghostZoneWidth(ghostZoneWidth),
-        mpiLayer(communicator)
-    {}
+        ghostZoneWidth((ghostZoneWidth == AUTO_GHOST_ZONE_WIDTH) ? 1 : ghostZoneWidth),
+        autoGhostZoneWidth(ghostZoneWidth == AUTO_GHOST_ZONE_WIDTH),
+        maxGhostZoneWidth(8),
+        linkLatency(0),
+        linkBandwidth(std::numeric_limits<double>::infinity()),
+        linkCalibrated(false),
+        cellCost(0),
+        mpiLayer(communicator),
+        persistentRequests(persistentRequests),
+        costMapTolerance(0.05),
+        cellsMigrated(0)
+    {
+        if (ghostZoneWidth == 0) {
+            throw std::invalid_argument("ghost zone width needs to be at least 1");
+        }
+    }
 
     inline void run()
     {
@@ -146,8 +379,83 @@ public:
 
     std::vector<Chronometer> gatherStatistics()
     {
-        Chronometer stats = chronometer + updateGroup->statistics();
-        return mpiLayer.gather(stats, 0);
+        return mpiLayer.gather(currentStatistics(), 0);
+    }
+
+    /**
+     * Enables cost-driven partitioning, see above. The map may have
+     * been seeded with expected costs. tolerance is the predicted
+     * relative imbalance above which the domain will be repartitioned.
+     * Needs to be called on all ranks before the simulation starts.
+     */
+    void setCostMap(const CostMap<DIM>& newCostMap, double tolerance = 0.05)
+    {
+        if (updateGroup) {
+            throw std::logic_error("CostMap needs to be set before the simulation starts");
+        }
+        if (newCostMap.boundingBox() != initializer->gridBox()) {
+            throw std::invalid_argument("CostMap needs to cover the simulation space");
+        }
+
+        costMap.reset(new CostMap<DIM>(newCostMap));
+        costMapTolerance = tolerance;
+    }
+
+    /**
+     * Returns the ghost zone width currently in use, which may change
+     * at run time with AUTO_GHOST_ZONE_WIDTH.
+     */
+    unsigned getGhostZoneWidth() const
+    {
+        return ghostZoneWidth;
+    }
+
+    /**
+     * Upper bound for automatically selected ghost zone widths.
+     */
+    void setMaxGhostZoneWidth(unsigned width)
+    {
+        if (width == 0) {
+            throw std::invalid_argument("ghost zone width needs to be at least 1");
+        }
+
+        maxGhostZoneWidth = width;
+        ghostCellsPartition.reset();
+    }
+
+    /**
+     * Sets link latency (in seconds) and bandwidth (in bytes per
+     * second) for the automatic selection of the ghost zone width,
+     * which skips the measurement at startup. Needs to be called on
+     * all ranks before the simulation starts.
+     */
+    void setLinkCharacteristics(double latency, double bandwidth)
+    {
+        linkLatency = latency;
+        linkBandwidth = bandwidth;
+        linkCalibrated = true;
+    }
+
+    /**
+     * Number of cells this rank has sent to other ranks during load
+     * balancing so far.
+     */
+    std::size_t getCellsMigrated() const
+    {
+        return cellsMigrated;
+    }
+
+    /**
+     * Predicted cost of each rank's region according to the CostMap.
+     */
+    std::vector<double> predictedCosts() const
+    {
+        std::vector<double> ret;
+        for (int i = 0; i < mpiLayer.size(); ++i) {
+            ret << (costMap ? costMap->cost(partition->getRegion(i)) : partition->getRegion(i).size());
+        }
+
+        return ret;
     }
 
 private:
@@ -157,8 +465,28 @@ private:
 
     boost::shared_ptr<LoadBalancer> balancer;
     unsigned ghostZoneWidth;
+    bool autoGhostZoneWidth;
+    unsigned maxGhostZoneWidth;
+    double linkLatency;
+    double linkBandwidth;
+    bool linkCalibrated;
+    double cellCost;
     MPILayer mpiLayer;
+    bool persistentRequests;
     boost::shared_ptr<UpdateGroupType> updateGroup;
+    boost::shared_ptr<Partition<DIM> > partition;
+    boost::shared_ptr<CostMap<DIM> > costMap;
+    double costMapTolerance;
+    LoadBalancer::WeightVec weights;
+    LoadBalancer::WeightVec pendingWeights;
+    Chronometer statisticsAtLastBalancing;
+    long nanoStepAtLastBalancing;
+    std::size_t cellsMigrated;
+    boost::shared_ptr<Partition<DIM> > ghostCellsPartition;
+    std::vector<std::size_t> ghostCellsPerWidth;
+    // ghost zones are synchronized every ghostZoneWidth nano steps,
+    // counting from here:
+    long syncBaseNanoStep;
 
     typename UpdateGroupType::PatchProviderVec steererAdaptersGhost;
     typename UpdateGroupType::PatchProviderVec steererAdaptersInner;
@@ -170,7 +498,17 @@ private:
         long remainingNanoSteps = s;
         while (remainingNanoSteps > 0) {
             long hop = std::min(remainingNanoSteps, timeToNextEvent());
+            if (!pendingWeights.empty()) {
+                hop = std::min(hop, timeToNextMigrationPoint());
+            }
+
             updateGroup->update(hop);
+
+            if (!pendingWeights.empty() && (timeToNextMigrationPoint() == 0)) {
+                migrate(pendingWeights);
+                pendingWeights.clear();
+            }
+
             handleEvents();
             remainingNanoSteps -= hop;
         }
@@ -193,43 +531,73 @@ private:
         }
 
         CoordBox<DIM> box = initializer->gridBox();
-        Region<DIM> globalRegion;
-        globalRegion << box;
 
         double mySpeed = APITraits::SelectSpeedGuide<CELL_TYPE>::value();
         std::vector<double> rankSpeeds = mpiLayer.allGather(mySpeed);
-        std::vector<std::size_t> weights = initialWeights(
+        weights = initialWeights(
             box.dimensions.prod(),
             rankSpeeds);
 
-        boost::shared_ptr<PARTITION> partition(
-            new PARTITION(
-                box.origin,
-                box.dimensions,
-                0,
+        partition = makePartition(weights);
+        if (autoGhostZoneWidth && !linkCalibrated) {
+            calibrateLinks();
+        }
+        syncBaseNanoStep = long(initializer->startStep()) * NANO_STEPS;
+        nanoStepAtLastBalancing = syncBaseNanoStep;
+        updateGroup = makeUpdateGroup(initializer);
+
+        initEvents();
+    }
+
+    inline boost::shared_ptr<Partition<DIM> > makePartition(const std::vector<std::size_t>& weights) const
+    {
+        CoordBox<DIM> box = initializer->gridBox();
+        Region<DIM> globalRegion;
+        globalRegion << box;
+
+        return boost::shared_ptr<Partition<DIM> >(
+            HiParSimulatorHelpers::PartitionFactory<PARTITION>::make(
+                box,
                 weights,
-                initializer->getAdjacency(globalRegion)));
+                initializer->getAdjacency(globalRegion),
+                boost::shared_ptr<const CostMap<DIM> >(costMap)));
+    }
 
-        updateGroup.reset(
+    /**
+     * The adapters for Writers and Steerers are retained so that
+     * they can be handed over to the next UpdateGroup after load
+     * balancing.
+     */
+    inline boost::shared_ptr<UpdateGroupType> makeUpdateGroup(
+        boost::shared_ptr<Initializer<CELL_TYPE> > stepperInitializer,
+        const typename UpdateGroupType::PatchProviderVec& migrationProviders =
+        typename UpdateGroupType::PatchProviderVec())
+    {
+        return boost::shared_ptr<UpdateGroupType>(
             new UpdateGroupType(
                 partition,
-                box,
+                initializer->gridBox(),
                 ghostZoneWidth,
-                initializer,
+                stepperInitializer,
                 static_cast<STEPPER*>(0),
                 writerAdaptersGhost,
                 writerAdaptersInner,
                 steererAdaptersGhost,
-                steererAdaptersInner,
+                steererAdaptersInner + migrationProviders,
                 enableFineGrainedParallelism,
-                mpiLayer.communicator()));
+                mpiLayer.communicator(),
+                persistentRequests));
+    }
 
-        writerAdaptersGhost.clear();
-        writerAdaptersInner.clear();
-        steererAdaptersGhost.clear();
-        steererAdaptersInner.clear();
+    inline Chronometer currentStatistics() const
+    {
+        // writers may ask for statistics while the UpdateGroup is
+        // still being set up:
+        if (!updateGroup) {
+            return chronometer;
+        }
 
-        initEvents();
+        return chronometer + updateGroup->statistics();
     }
 
     inline long currentNanoStep() const
@@ -238,18 +606,347 @@ private:
         return (long)now.first * NANO_STEPS + now.second;
     }
 
+    /**
+     * Collective operation: usually only rank 0 has a LoadBalancer,
+     * so all ranks need to learn about its decision.
+     */
     inline void balanceLoad()
     {
+        Chronometer stats = currentStatistics();
+        double computeTime =
+            stats.interval<TimeCompute>() - statisticsAtLastBalancing.interval<TimeCompute>();
+        double totalTime =
+            stats.interval<TimeTotal>()   - statisticsAtLastBalancing.interval<TimeTotal>();
+        statisticsAtLastBalancing = stats;
+
+        // same fallback as in Chronometer::ratio():
+        double myLoad = (totalTime == 0) ? 0.5 : (computeTime / totalTime);
+        bool ghostZoneWidthOutdated = false;
+        if (autoGhostZoneWidth) {
+            updateCellCost(computeTime);
+            ghostZoneWidthOutdated = (selectGhostZoneWidth(partition) != ghostZoneWidth);
+        }
+
+        LoadBalancer::LoadVec loads = mpiLayer.gather(myLoad, 0);
+        std::vector<double> computeTimes;
+        if (costMap) {
+            computeTimes = mpiLayer.gather(computeTime, 0);
+        }
+
+        LoadBalancer::WeightVec newWeights;
         if (mpiLayer.rank() == 0) {
-            if (!balancer) {
-                return;
+            if (balancer) {
+                newWeights = balancer->balance(weights, loads);
+            }
+            if (newWeights == weights) {
+                newWeights.clear();
             }
+            if (costMap) {
+                refineCostMap(computeTimes);
+                // even if the shares remain the same, the cuts may
+                // need to move as the map has changed:
+                if (newWeights.empty() && (predictedImbalance() > costMapTolerance)) {
+                    newWeights = weights;
+                }
+            }
+        }
+        newWeights = mpiLayer.broadcastVector(newWeights, 0);
+        // ghostZoneWidthOutdated is consistent among all ranks as the
+        // selection is based on a global reduction:
+        if (newWeights.empty() && ghostZoneWidthOutdated) {
+            newWeights = weights;
+        }
 
-            LoadBalancer::LoadVec loads(mpiLayer.size(), 1.0);
-            LoadBalancer::WeightVec newWeights =
-                balancer->balance(updateGroup->getWeights(), loads);
-            // fixme: actually balance the load!
+        if (newWeights.empty()) {
+            return;
+        }
+        if (sum(newWeights) != sum(weights)) {
+            throw std::logic_error("LoadBalancer must not alter the total number of work items");
+        }
+        if (costMap) {
+            costMap->setDensities(mpiLayer.broadcastVector(costMap->getDensities(), 0));
         }
+
+        if (timeToNextMigrationPoint() == 0) {
+            migrate(newWeights);
+        } else {
+            pendingWeights = newWeights;
+        }
+    }
+
+    /**
+     * Only called on rank 0, which then broadcasts the map.
+     */
+    inline void refineCostMap(const std::vector<double>& computeTimes)
+    {
+        std::vector<Region<DIM> > regions;
+        for (int i = 0; i < mpiLayer.size(); ++i) {
+            regions << partition->getRegion(i);
+        }
+
+        costMap->refine(regions, computeTimes);
+    }
+
+    /**
+     * Relative deviation of the most expensive rank from its share
+     * of the total cost, according to the CostMap.
+     */
+    inline double predictedImbalance() const
+    {
+        std::vector<double> costs = predictedCosts();
+        double totalCost = sum(costs);
+        double totalWeight = sum(weights);
+        if ((totalCost <= 0) || (totalWeight <= 0)) {
+            return 0;
+        }
+
+        double ret = 0;
+        for (std::size_t i = 0; i < costs.size(); ++i) {
+            double expected = totalCost * weights[i] / totalWeight;
+            if (expected > 0) {
+                ret = (std::max)(ret, costs[i] / expected - 1);
+            }
+        }
+
+        return ret;
+    }
+
+    /**
+     * Migration is only possible at the beginning of a time step
+     * which coincides with a ghost zone synchronization as only then
+     * the whole region of a node is valid.
+     */
+    inline long timeToNextMigrationPoint() const
+    {
+        long period = NANO_STEPS;
+        while (period % ghostZoneWidth) {
+            period += NANO_STEPS;
+        }
+
+        long offset = (currentNanoStep() - syncBaseNanoStep) % period;
+        return (offset == 0) ? 0 : (period - offset);
+    }
+
+    /**
+     * Estimates the time this rank needs per cell update from the
+     * compute time since the last balancing step. Redundant updates
+     * in the ghost zone are neglected, which slightly overestimates
+     * the cost.
+     */
+    inline void updateCellCost(double computeTime)
+    {
+        long nanoSteps = currentNanoStep() - nanoStepAtLastBalancing;
+        nanoStepAtLastBalancing = currentNanoStep();
+        std::size_t cells = partition->getRegion(mpiLayer.rank()).size();
+
+        if ((nanoSteps > 0) && (cells > 0)) {
+            cellCost = computeTime / (double(nanoSteps) * cells);
+        }
+    }
+
+    /**
+     * Collective operation: returns the ghost zone width which
+     * minimizes the predicted overhead of the slowest rank for the
+     * given Partition. The number of PatchLinks of the current
+     * UpdateGroup serves as an estimate for the number of messages
+     * per synchronization.
+     */
+    inline unsigned selectGhostZoneWidth(const boost::shared_ptr<Partition<DIM> >& candidate)
+    {
+        GhostZoneWidthModel model(linkLatency, linkBandwidth, cellCost, sizeof(CELL_TYPE));
+        std::vector<double> overheads = model.overheads(
+            ghostCells(candidate), updateGroup->numPatchLinks());
+        std::vector<double> maxOverheads(overheads.size());
+        mpiLayer.allReduce(&overheads[0], &maxOverheads[0], overheads.size(), MPI_MAX);
+        mpiLayer.wait(MPILayer::GLOBAL_REDUCTION);
+
+        return GhostZoneWidthModel::bestWidth(maxOverheads);
+    }
+
+    /**
+     * Returns the number of ghost cells of this rank's region in the
+     * given Partition for all widths up to maxGhostZoneWidth. Computing
+     * these requires expanding the region, so the result is cached
+     * for the last Partition queried (which is also the one in use
+     * between repartitionings).
+     */
+    inline const std::vector<std::size_t>& ghostCells(const boost::shared_ptr<Partition<DIM> >& candidate)
+    {
+        if (candidate == ghostCellsPartition) {
+            return ghostCellsPerWidth;
+        }
+
+        PartitionManager<Topology> manager;
+        manager.resetRegions(initializer, initializer->gridBox(), candidate, mpiLayer.rank(), maxGhostZoneWidth);
+
+        ghostCellsPerWidth.clear();
+        std::size_t ownCells = manager.ownRegion().size();
+        for (unsigned i = 0; i <= maxGhostZoneWidth; ++i) {
+            ghostCellsPerWidth << (manager.ownRegion(i).size() - ownCells);
+        }
+        ghostCellsPartition = candidate;
+
+        return ghostCellsPerWidth;
+    }
+
+    /**
+     * Collective operation: ranks 2i and 2i+1 measure latency and
+     * bandwidth of their link via a ping-pong. The slowest link
+     * determines the result on all ranks.
+     */
+    inline void calibrateLinks()
+    {
+        int partner = mpiLayer.rank() ^ 1;
+        double latency = 0;
+        double secondsPerByte = 0;
+
+        if (partner < mpiLayer.size()) {
+            int largeMessage = 1 << 20;
+            latency = 0.5 * pingPong(partner, 1, 20);
+            double transferTime = 0.5 * pingPong(partner, largeMessage, 4) - latency;
+            secondsPerByte = (std::max)(0.0, transferTime) / largeMessage;
+        }
+
+        linkLatency = mpiLayer.allReduce(latency, MPI_MAX);
+        secondsPerByte = mpiLayer.allReduce(secondsPerByte, MPI_MAX);
+        linkBandwidth = (secondsPerByte > 0) ?
+            (1.0 / secondsPerByte) :
+            std::numeric_limits<double>::infinity();
+        linkCalibrated = true;
+
+        LOG(Logger::INFO, "HiParSimulator measured link latency " << linkLatency
+            << "s, bandwidth " << linkBandwidth << " B/s");
+    }
+
+    /**
+     * Returns the average round trip time for messages of the given
+     * size. The first round trip is excluded as it includes
+     * connection setup.
+     */
+    inline double pingPong(int partner, int bytes, int repeats)
+    {
+        std::vector<char> buffer(bytes);
+        bool initiator = mpiLayer.rank() < partner;
+        double start = 0;
+
+        for (int i = -1; i < repeats; ++i) {
+            if (i == 0) {
+                start = ScopedTimer::time();
+            }
+
+            for (int j = 0; j < 2; ++j) {
+                if ((j == 0) == initiator) {
+                    mpiLayer.send(&buffer[0], partner, bytes, MPILayer::GHOST_ZONE_CALIBRATION);
+                } else {
+                    mpiLayer.recv(&buffer[0], partner, bytes, MPILayer::GHOST_ZONE_CALIBRATION);
+                }
+                mpiLayer.wait(MPILayer::GHOST_ZONE_CALIBRATION);
+            }
+        }
+
+        return (ScopedTimer::time() - start) / repeats;
+    }
+
+    /**
+     * Rebuilds the UpdateGroup for the Partition described by
+     * newWeights. Each node will send the part of its current region
+     * which overlaps with another node's new region (including its
+     * ghost zone) via a PatchLink. The incoming PatchLinks are handed
+     * to the new UpdateGroup as PatchProviders so that the Stepper
+     * picks up the migrated cells right after initialization. With
+     * AUTO_GHOST_ZONE_WIDTH the new UpdateGroup's ghost zone width is
+     * selected for the new Partition.
+     */
+    inline void migrate(const LoadBalancer::WeightVec& newWeights)
+    {
+        TimeMigration t(&chronometer);
+
+        CoordBox<DIM> box = initializer->gridBox();
+        std::size_t nanoStep = currentNanoStep();
+        unsigned rank = mpiLayer.rank();
+        boost::shared_ptr<Partition<DIM> > newPartition = makePartition(newWeights);
+        unsigned newGhostZoneWidth = ghostZoneWidth;
+        if (autoGhostZoneWidth) {
+            newGhostZoneWidth = selectGhostZoneWidth(newPartition);
+            if (newGhostZoneWidth != ghostZoneWidth) {
+                LOG(Logger::INFO, "HiParSimulator switching ghost zone width from "
+                    << ghostZoneWidth << " to " << newGhostZoneWidth);
+            }
+        }
+
+        PartitionManager<Topology> oldPartitionManager;
+        oldPartitionManager.resetRegions(initializer, box, partition, rank, ghostZoneWidth);
+        PartitionManager<Topology> newPartitionManager;
+        newPartitionManager.resetRegions(initializer, box, newPartition, rank, newGhostZoneWidth);
+
+        const Region<DIM>& oldRegion = oldPartitionManager.ownRegion();
+        const Region<DIM>& newRegion = newPartitionManager.ownRegion(newGhostZoneWidth);
+
+        typename UpdateGroupType::PatchProviderVec migrationProviders;
+        std::vector<boost::shared_ptr<PatchLinkAccepterType> > migrationAccepters;
+
+        for (int i = 0; i < mpiLayer.size(); ++i) {
+            if (i == int(rank)) {
+                continue;
+            }
+
+            Region<DIM> incoming = oldPartitionManager.getRegion(i, 0) & newRegion;
+            if (!incoming.empty()) {
+                boost::shared_ptr<PatchLinkProviderType> provider(
+                    new PatchLinkProviderType(
+                        incoming,
+                        i,
+                        MPILayer::GRID_MIGRATION,
+                        SerializationBuffer<CELL_TYPE>::cellMPIDataType(),
+                        mpiLayer.communicator()));
+                provider->charge(nanoStep, nanoStep + 1, 1);
+                migrationProviders << provider;
+            }
+
+            Region<DIM> outgoing = oldRegion & newPartitionManager.getRegion(i, newGhostZoneWidth);
+            if (!outgoing.empty()) {
+                boost::shared_ptr<PatchLinkAccepterType> accepter(
+                    new PatchLinkAccepterType(
+                        outgoing,
+                        i,
+                        MPILayer::GRID_MIGRATION,
+                        SerializationBuffer<CELL_TYPE>::cellMPIDataType(),
+                        mpiLayer.communicator()));
+                accepter->charge(nanoStep, nanoStep + 1, 1);
+                accepter->put(updateGroup->grid(), oldRegion, box.dimensions, nanoStep, rank);
+                migrationAccepters << accepter;
+                cellsMigrated += outgoing.size();
+            }
+        }
+
+        boost::shared_ptr<PatchBufferType> localCells(new PatchBufferType(oldRegion & newRegion));
+        localCells->pushRequest(nanoStep);
+        localCells->put(updateGroup->grid(), oldRegion, box.dimensions, nanoStep, rank);
+        migrationProviders << localCells;
+
+        // the old Stepper has already delivered the ghost zone for
+        // the upcoming ghostZoneWidth nano steps. These need to be
+        // repeated as the new Stepper's ghost zone differs.
+        for (std::size_t i = 0; i < writerAdaptersGhost.size(); ++i) {
+            boost::static_pointer_cast<ParallelWriterAdapterType>(writerAdaptersGhost[i])->rewind(nanoStep);
+        }
+        for (std::size_t i = 0; i < steererAdaptersGhost.size(); ++i) {
+            boost::static_pointer_cast<SteererAdapterType>(steererAdaptersGhost[i])->rewind(nanoStep);
+        }
+
+        chronometer += updateGroup->statistics();
+        partition = newPartition;
+        weights = newWeights;
+        ghostZoneWidth = newGhostZoneWidth;
+        syncBaseNanoStep = nanoStep;
+        // the old UpdateGroup needs to be torn down first so its
+        // PatchLinks can complete all pending transmissions:
+        updateGroup.reset();
+        updateGroup = makeUpdateGroup(
+            boost::make_shared<HiParSimulatorHelpers::ResumingInitializer<CELL_TYPE> >(
+                initializer,
+                nanoStep / NANO_STEPS),
+            migrationProviders);
     }
 };
 
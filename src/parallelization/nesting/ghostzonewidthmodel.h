@@ -0,0 +1,117 @@
+#ifndef LIBGEODECOMP_PARALLELIZATION_NESTING_GHOSTZONEWIDTHMODEL_H
+#define LIBGEODECOMP_PARALLELIZATION_NESTING_GHOSTZONEWIDTHMODEL_H
+
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace LibGeoDecomp {
+
+/**
+ * Predicts the cost of ghost zone handling for different ghost zone
+ * widths. Wider ghost zones need fewer synchronizations (each of
+ * which pays the link latency once per neighbor), but the halo has
+ * to be updated redundantly: after a synchronization with width w
+ * the halo shrinks by one cell per nano step, so (w - 1) shells of
+ * the halo are computed by both neighbors.
+ *
+ * The per nano step overhead for width w is thus estimated as
+ *
+ *   (links * latency + ghostCells[w] * cellSize / bandwidth +
+ *    cellCost * (ghostCells[1] + ... + ghostCells[w - 1])) / w
+ *
+ * where ghostCells[i] is the number of cells in a halo of width i.
+ * Using the actual halo sizes (rather than a surface times width)
+ * accounts for the faster than linear growth of halos around small
+ * or irregularly shaped subdomains.
+ */
+class GhostZoneWidthModel
+{
+public:
+    /**
+     * latency is given in seconds per message, bandwidth in bytes
+     * per second, cellCost in seconds per cell update and cellSize
+     * in bytes.
+     */
+    explicit GhostZoneWidthModel(
+        double latency = 0,
+        double bandwidth = std::numeric_limits<double>::infinity(),
+        double cellCost = 0,
+        std::size_t cellSize = 0) :
+        latency(latency),
+        bandwidth(bandwidth),
+        cellCost(cellCost),
+        cellSize(cellSize)
+    {}
+
+    /**
+     * Expected time per nano step spent on synchronization and
+     * redundant computation when using the given width. links is
+     * the number of messages per synchronization.
+     */
+    double overhead(
+        unsigned width,
+        const std::vector<std::size_t>& ghostCells,
+        std::size_t links) const
+    {
+        if ((width == 0) || (width >= ghostCells.size())) {
+            throw std::invalid_argument("no halo size given for requested ghost zone width");
+        }
+
+        double synchronization = links * latency + ghostCells[width] * cellSize / bandwidth;
+        std::size_t redundantCells = 0;
+        for (unsigned i = 1; i < width; ++i) {
+            redundantCells += ghostCells[i];
+        }
+
+        return (synchronization + redundantCells * cellCost) / width;
+    }
+
+    /**
+     * Returns the overhead for all widths in [1, ghostCells.size()),
+     * the overhead for width w is stored at index w - 1.
+     */
+    std::vector<double> overheads(
+        const std::vector<std::size_t>& ghostCells,
+        std::size_t links) const
+    {
+        std::vector<double> ret;
+        for (unsigned width = 1; width < ghostCells.size(); ++width) {
+            ret.push_back(overhead(width, ghostCells, links));
+        }
+
+        return ret;
+    }
+
+    /**
+     * Picks the width with the lowest overhead from a vector as
+     * returned by overheads(). Ties are resolved in favor of
+     * narrower ghost zones as these need less memory.
+     */
+    static unsigned bestWidth(const std::vector<double>& overheads)
+    {
+        if (overheads.empty()) {
+            throw std::invalid_argument("need at least one candidate width");
+        }
+
+        std::size_t best = 0;
+        for (std::size_t i = 1; i < overheads.size(); ++i) {
+            if (overheads[i] < overheads[best]) {
+                best = i;
+            }
+        }
+
+        return best + 1;
+    }
+
+private:
+    double latency;
+    double bandwidth;
+    double cellCost;
+    std::size_t cellSize;
+};
+
+}
+
+#endif
@@ -14,7 +14,10 @@ class HiParSimulatorTest;
 
 /**
  * This is an implementation of the UpdateGroup for MPI-based
- * hiearchical Simulators, e.g. the HiParSimulator.
+ * hiearchical Simulators, e.g. the HiParSimulator. If
+ * persistentRequests is set, the PatchLinks exchange ghost zones of
+ * fixed size cells via persistent MPI requests (see
+ * PatchLink::Accepter).
  */
 template<class CELL_TYPE>
 class MPIUpdateGroup : public UpdateGroup<CELL_TYPE, PatchLink>
@@ -46,9 +49,11 @@ public:
         PatchProviderVec patchProvidersGhost = PatchProviderVec(),
         PatchProviderVec patchProvidersInner = PatchProviderVec(),
         bool enableFineGrainedParallelism = false,
-        MPI_Comm communicator = MPI_COMM_WORLD) :
+        MPI_Comm communicator = MPI_COMM_WORLD,
+        bool persistentRequests = false) :
         UpdateGroup<CELL_TYPE, PatchLink>(ghostZoneWidth, initializer, MPILayer(communicator).rank()),
-        mpiLayer(communicator)
+        mpiLayer(communicator),
+        persistentRequests(persistentRequests)
     {
         init(
             partition,
@@ -65,6 +70,7 @@ public:
 
 private:
     MPILayer mpiLayer;
+    bool persistentRequests;
 
     std::vector<CoordBox<DIM> > gatherBoundingBoxes(
         const CoordBox<DIM>& ownBoundingBox,
@@ -83,7 +89,8 @@ private:
                 target,
                 MPILayer::PATCH_LINK,
                 SerializationBuffer<CELL_TYPE>::cellMPIDataType(),
-                mpiLayer.communicator()));
+                mpiLayer.communicator(),
+                persistentRequests));
 
     }
 
@@ -95,7 +102,8 @@ private:
                 source,
                 MPILayer::PATCH_LINK,
                 SerializationBuffer<CELL_TYPE>::cellMPIDataType(),
-                mpiLayer.communicator()));
+                mpiLayer.communicator(),
+                persistentRequests));
     }
 };
 
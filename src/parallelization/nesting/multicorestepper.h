@@ -4,48 +4,409 @@
 #include <libgeodecomp/config.h>
 #ifdef LIBGEODECOMP_WITH_THREADS
 
+#include <omp.h>
+#include <libgeodecomp/misc/stdcontaineroverloads.h>
 #include <libgeodecomp/parallelization/nesting/commonstepper.h>
 #include <libgeodecomp/storage/patchbufferfixed.h>
+#include <libgeodecomp/storage/updatefunctor.h>
 
 namespace LibGeoDecomp {
 
+namespace MultiCoreStepperHelpers {
+
+/**
+ * A double-ended range of chunk IDs, guarded by an OpenMP lock. The
+ * owning thread pops chunks from the front while idle threads steal
+ * from the back. This keeps the owner working on adjacent planes
+ * (good for caches) for as long as possible.
+ */
+class ChunkQueue
+{
+public:
+    inline ChunkQueue() :
+        first(0),
+        last(0)
+    {
+        omp_init_lock(&lock);
+    }
+
+    inline ChunkQueue(const ChunkQueue& other) :
+        first(other.first),
+        last(other.last)
+    {
+        omp_init_lock(&lock);
+    }
+
+    inline ~ChunkQueue()
+    {
+        omp_destroy_lock(&lock);
+    }
+
+    inline ChunkQueue& operator=(const ChunkQueue& other)
+    {
+        first = other.first;
+        last = other.last;
+        return *this;
+    }
+
+    inline void reset(std::size_t newFirst, std::size_t newLast)
+    {
+        first = newFirst;
+        last = newLast;
+    }
+
+    inline bool popFront(std::size_t *chunk)
+    {
+        omp_set_lock(&lock);
+        bool ret = (first < last);
+        if (ret) {
+            *chunk = first++;
+        }
+        omp_unset_lock(&lock);
+
+        return ret;
+    }
+
+    inline bool popBack(std::size_t *chunk)
+    {
+        omp_set_lock(&lock);
+        bool ret = (first < last);
+        if (ret) {
+            *chunk = --last;
+        }
+        omp_unset_lock(&lock);
+
+        return ret;
+    }
+
+private:
+    std::size_t first;
+    std::size_t last;
+    omp_lock_t lock;
+};
+
+}
+
 /**
  * MultiCoreStepper is an OpenMP-enabled implementation of the Stepper
- * concept.
+ * concept. Its update scheme mirrors the VanillaStepper (wide halos,
+ * overlapping communication and calculation), but each Region is
+ * split into chunks of planes which are processed by a pool of
+ * threads with work stealing: every thread starts on a contiguous
+ * range of chunks and, once done, steals from the tail of other
+ * threads' ranges. This balances load if cells have non-uniform
+ * costs or if threads get delayed (e.g. by the MPI progress engine).
+ *
+ * The rim is updated ahead of the kernel (see updateGhost()), so the
+ * ghost zone PatchLinks are in flight while the threads work on the
+ * inner set.
+ *
+ * Per-thread busy and idle times are recorded in separate
+ * Chronometers, see threadStatistics(). Idle time is the time a
+ * thread spent waiting at the barrier after it ran out of chunks.
  *
  * fixme: how to handle threading if user code has a multithreaded
  *        update() itself? (e.g. n-body codes)
  *
  * fixme: cache blocking?
- *
- * fixme: mpi pacing?
  */
 template<typename CELL_TYPE>
 class MultiCoreStepper : public CommonStepper<CELL_TYPE>
 {
 public:
+    friend class MultiCoreStepperTest;
+
     typedef typename Stepper<CELL_TYPE>::Topology Topology;
     const static int DIM = Topology::DIM;
     const static unsigned NANO_STEPS = APITraits::SelectNanoSteps<CELL_TYPE>::VALUE;
 
-    typedef class Stepper<CELL_TYPE> ParentType;
+    /**
+     * Number of chunks each Region gets split into per thread. More
+     * chunks allow for better load balancing, less chunks yield
+     * lower overhead.
+     */
+    const static std::size_t CHUNKS_PER_THREAD = 4;
+
+    typedef class CommonStepper<CELL_TYPE> ParentType;
     typedef typename ParentType::GridType GridType;
     typedef PartitionManager<Topology> PartitionManagerType;
     typedef PatchBufferFixed<GridType, GridType, 1> PatchBufferType1;
     typedef PatchBufferFixed<GridType, GridType, 2> PatchBufferType2;
     typedef typename ParentType::PatchAccepterVec PatchAccepterVec;
+    typedef typename ParentType::PatchProviderVec PatchProviderVec;
+    typedef std::vector<Region<DIM> > RegionVec;
+
+    using ParentType::initializer;
+    using ParentType::patchAccepters;
+    using ParentType::patchProviders;
+    using ParentType::partitionManager;
+    using ParentType::chronometer;
+
+    using ParentType::innerSet;
+    using ParentType::saveKernel;
+    using ParentType::restoreRim;
+    using ParentType::globalNanoStep;
+    using ParentType::rim;
+    using ParentType::resetValidGhostZoneWidth;
+    using ParentType::initGridsCommon;
+    using ParentType::getVolatileKernel;
+    using ParentType::saveRim;
+    using ParentType::getInnerRim;
+    using ParentType::restoreKernel;
+
+    using ParentType::curStep;
+    using ParentType::curNanoStep;
+    using ParentType::validGhostZoneWidth;
+    using ParentType::ghostZoneWidth;
+    using ParentType::oldGrid;
+    using ParentType::newGrid;
+    using ParentType::rimBuffer;
+    using ParentType::kernelBuffer;
+    using ParentType::kernelFraction;
 
     inline MultiCoreStepper(
         boost::shared_ptr<PartitionManagerType> partitionManager,
         boost::shared_ptr<Initializer<CELL_TYPE> > initializer,
         const PatchAccepterVec& ghostZonePatchAccepters = PatchAccepterVec(),
-        const PatchAccepterVec& innerSetPatchAccepters = PatchAccepterVec()) :
-        CommonStepper<CELL_TYPE>(
+        const PatchAccepterVec& innerSetPatchAccepters = PatchAccepterVec(),
+        const PatchProviderVec& ghostZonePatchProviders = PatchProviderVec(),
+        const PatchProviderVec& innerSetPatchProviders = PatchProviderVec(),
+        bool enableFineGrainedParallelism = false) :
+        ParentType(
             partitionManager,
             initializer,
             ghostZonePatchAccepters,
-            innerSetPatchAccepters)
+            innerSetPatchAccepters,
+            ghostZonePatchProviders,
+            innerSetPatchProviders,
+            enableFineGrainedParallelism),
+        threadChronometers(omp_get_max_threads()),
+        queues(omp_get_max_threads())
+    {
+        initGrids();
+    }
+
+    /**
+     * Returns one Chronometer per thread. TimeComputeInner and
+     * TimeComputeGhost hold the time each thread spent updating
+     * cells, TimeIdle the time it spent waiting for the others.
+     */
+    inline const std::vector<Chronometer>& threadStatistics() const
+    {
+        return threadChronometers;
+    }
+
+private:
+    std::vector<RegionVec> innerSetChunks;
+    std::vector<RegionVec> rimChunks;
+    std::vector<Chronometer> threadChronometers;
+    std::vector<MultiCoreStepperHelpers::ChunkQueue> queues;
+
+    inline void update1()
     {
+        using std::swap;
+        TimeTotal t(&chronometer);
+        unsigned index = ghostZoneWidth() - --validGhostZoneWidth;
+        {
+            TimeComputeInner t(&chronometer);
+
+            updateChunks<TimeComputeInner>(innerSetChunks[index]);
+            swap(oldGrid, newGrid);
+
+            ++curNanoStep;
+            if (curNanoStep == NANO_STEPS) {
+                curNanoStep = 0;
+                ++curStep;
+            }
+        }
+
+        this->notifyPatchAccepters(innerSet(ghostZoneWidth()), ParentType::INNER_SET, globalNanoStep());
+
+        if (validGhostZoneWidth == 0) {
+            updateGhost();
+            resetValidGhostZoneWidth();
+        }
+
+        index = ghostZoneWidth() - validGhostZoneWidth;
+        const Region<DIM>& nextRegion = innerSet(index);
+        this->notifyPatchProviders(nextRegion, ParentType::INNER_SET, globalNanoStep());
+    }
+
+    inline void initGrids()
+    {
+        initGridsCommon();
+        initChunks();
+
+        this->notifyPatchAccepters(
+            rim(),
+            ParentType::GHOST,
+            globalNanoStep());
+        this->notifyPatchAccepters(
+            innerSet(ghostZoneWidth()),
+            ParentType::INNER_SET,
+            globalNanoStep());
+
+        saveRim(globalNanoStep());
+        updateGhost();
+    }
+
+    /**
+     * Regions from the PartitionManager are fixed between
+     * repartitionings, so we split them only once.
+     */
+    inline void initChunks()
+    {
+        innerSetChunks.clear();
+        rimChunks.clear();
+
+        for (unsigned i = 0; i <= ghostZoneWidth(); ++i) {
+            innerSetChunks << splitRegion(innerSet(i));
+            rimChunks << splitRegion(rim(i));
+        }
+    }
+
+    inline RegionVec splitRegion(const Region<DIM>& region) const
+    {
+        std::size_t numPlanes = region.numPlanes();
+        std::size_t numChunks = (std::min)(numPlanes, queues.size() * CHUNKS_PER_THREAD);
+        RegionVec ret(numChunks);
+
+        for (std::size_t i = 0; i < numChunks; ++i) {
+            typename Region<DIM>::StreakIterator end =
+                region.planeStreakIterator((i + 1) * numPlanes / numChunks);
+
+            for (typename Region<DIM>::StreakIterator j =
+                     region.planeStreakIterator(i * numPlanes / numChunks);
+                 j != end;
+                 ++j) {
+                ret[i] << *j;
+            }
+        }
+
+        return ret;
+    }
+
+    /**
+     * Updates all chunks from oldGrid to newGrid. EVENT is the
+     * Chronometer event to which the threads' busy times are
+     * attributed.
+     */
+    template<typename EVENT>
+    inline void updateChunks(const RegionVec& chunks)
+    {
+        const std::size_t numThreads = queues.size();
+        for (std::size_t i = 0; i < numThreads; ++i) {
+            queues[i].reset(
+                i * chunks.size() / numThreads,
+                (i + 1) * chunks.size() / numThreads);
+        }
+
+#pragma omp parallel num_threads(numThreads)
+        {
+            std::size_t threadID = omp_get_thread_num();
+            Chronometer& threadChronometer = threadChronometers[threadID];
+            std::size_t chunk;
+
+            while (nextChunk(threadID, &chunk)) {
+                EVENT t(&threadChronometer);
+
+                UpdateFunctor<CELL_TYPE>()(
+                    chunks[chunk],
+                    Coord<DIM>(),
+                    Coord<DIM>(),
+                    *oldGrid,
+                    &*newGrid,
+                    curNanoStep);
+            }
+
+            double finishTime = ScopedTimer::time();
+#pragma omp barrier
+            threadChronometer.tock<TimeIdle>(finishTime);
+        }
+    }
+
+    /**
+     * Fetches the next chunk from the thread's own queue or steals
+     * one from another thread. Returns false once all queues are
+     * drained. Queues of threads which OpenMP didn't spawn (e.g. with
+     * dynamic team sizes) will get emptied by stealing, too.
+     */
+    inline bool nextChunk(std::size_t threadID, std::size_t *chunk)
+    {
+        if (queues[threadID].popFront(chunk)) {
+            return true;
+        }
+
+        for (std::size_t i = 1; i < queues.size(); ++i) {
+            std::size_t victim = (threadID + i) % queues.size();
+            if (queues[victim].popBack(chunk)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * Like VanillaStepper::updateGhost(), but the rim is updated by
+     * the thread pool.
+     */
+    inline void updateGhost()
+    {
+        using std::swap;
+        {
+            TimeComputeGhost t(&chronometer);
+
+            // 1: Prepare grid. The following update of the ghostzone will
+            // destroy parts of the kernel, which is why we'll
+            // save/restore those.
+            saveKernel();
+            // We need to restore the rim since it got destroyed while the
+            // kernel was updated.
+            restoreRim(false);
+        }
+
+        // 2: actual ghostzone update
+        std::size_t oldNanoStep = curNanoStep;
+        std::size_t oldStep = curStep;
+        std::size_t curGlobalNanoStep = globalNanoStep();
+
+        for (std::size_t t = 0; t < ghostZoneWidth(); ++t) {
+            this->notifyPatchProviders(rim(t), ParentType::GHOST, globalNanoStep());
+
+            {
+                TimeComputeGhost timer(&chronometer);
+
+                updateChunks<TimeComputeGhost>(rimChunks[t + 1]);
+
+                ++curNanoStep;
+                if (curNanoStep == NANO_STEPS) {
+                    curNanoStep = 0;
+                    curStep++;
+                }
+
+                swap(oldGrid, newGrid);
+
+                ++curGlobalNanoStep;
+            }
+
+            this->notifyPatchAccepters(rim(ghostZoneWidth()), ParentType::GHOST, curGlobalNanoStep);
+        }
+
+        {
+            TimeComputeGhost t(&chronometer);
+
+            saveRim(curGlobalNanoStep);
+            if (ghostZoneWidth() % 2) {
+                swap(oldGrid, newGrid);
+            }
+
+            // 3: restore grid for kernel update
+            curNanoStep = oldNanoStep;
+            curStep = oldStep;
+            restoreRim(true);
+            restoreKernel();
+        }
     }
 };
 
@@ -46,6 +46,27 @@ public:
         writer->setRegion(region);
     }
 
+    /**
+     * Discards all pending requests and re-requests all output steps
+     * after nanoStep. Required if the Stepper gets replaced (e.g.
+     * during load balancing) as the old one might already have
+     * delivered the ghost zone for some future steps.
+     */
+    void rewind(const std::size_t nanoStep)
+    {
+        requestedNanoSteps.clear();
+
+        if (nanoStep < firstNanoStep) {
+            pushRequest(firstNanoStep);
+        } else {
+            pushRequest(firstNanoStep + ((nanoStep - firstNanoStep) / stride + 1) * stride);
+        }
+
+        if (nanoStep < lastNanoStep) {
+            pushRequest(lastNanoStep);
+        }
+    }
+
     virtual void put(
         const GRID_TYPE& grid,
         const Region<GRID_TYPE::DIM>& validRegion,
@@ -49,6 +49,27 @@ public:
         steerer->setRegion(region);
     }
 
+    /**
+     * Counterpart to ParallelWriterAdapter::rewind(): makes all
+     * events after nanoStep available again.
+     */
+    void rewind(const std::size_t nanoStep)
+    {
+        storedNanoSteps.clear();
+
+        if (nanoStep < firstNanoStep) {
+            storedNanoSteps << firstNanoStep;
+        }
+
+        std::size_t period = steerer->getPeriod();
+        std::size_t step = (std::max)(nanoStep, firstNanoStep) / NANO_STEPS;
+        storedNanoSteps << (step / period + 1) * period * NANO_STEPS;
+
+        if (nanoStep < lastNanoStep) {
+            storedNanoSteps << lastNanoStep;
+        }
+    }
+
     virtual void get(
         GRID_TYPE *destinationGrid,
         const Region<DIM>& patchableRegion,
@@ -10,17 +10,19 @@ using namespace LibGeoDecomp;
 
 namespace LibGeoDecomp {
 
-class MulticoreStepperTest : public CxxTest::TestSuite
+class MultiCoreStepperTest : public CxxTest::TestSuite
 {
 public:
     typedef APITraits::SelectTopology<TestCell<2> >::Value Topology;
     typedef DisplacedGrid<TestCell<2>, Topology, true> GridType;
 #ifdef LIBGEODECOMP_WITH_THREADS
     typedef MultiCoreStepper<TestCell<2> > StepperType;
+    typedef MultiCoreStepper<TestCell<3> > StepperType3D;
 #endif
 
     void setUp()
     {
+#ifdef LIBGEODECOMP_WITH_THREADS
         init.reset(new TestInitializer<TestCell<2> >(Coord<2>(17, 12)));
         CoordBox<2> rect = init->gridBox();
 
@@ -30,26 +32,126 @@ public:
         patchAccepter->pushRequest(13);
 
         partitionManager.reset(new PartitionManager<Topology>(rect));
-        // stepper.reset(
-        //     new StepperType(partitionManager, init));
+        stepper.reset(
+            new StepperType(partitionManager, init));
+
+        stepper->addPatchAccepter(patchAccepter, StepperType::GHOST);
+#endif
+    }
+
+    void testUpdate1()
+    {
+#ifdef LIBGEODECOMP_WITH_THREADS
+        TS_ASSERT_TEST_GRID(GridType, stepper->grid(), 0);
+        stepper->update1();
+        TS_ASSERT_TEST_GRID(GridType, stepper->grid(), 1);
+#endif
+    }
+
+    void testUpdateMultiple()
+    {
+#ifdef LIBGEODECOMP_WITH_THREADS
+        stepper->update(8);
+        TS_ASSERT_TEST_GRID(GridType, stepper->grid(), 8);
+        stepper->update(30);
+        TS_ASSERT_TEST_GRID(GridType, stepper->grid(), 38);
+#endif
+    }
+
+    void testPutPatch()
+    {
+#ifdef LIBGEODECOMP_WITH_THREADS
+        stepper->update(9);
+        TS_ASSERT_EQUALS(std::size_t(2), patchAccepter->getOfferedNanoSteps().size());
+
+        stepper->update(4);
+        TS_ASSERT_EQUALS(std::size_t(3), patchAccepter->getOfferedNanoSteps().size());
+#endif
+    }
 
-        // stepper->addPatchAccepter(patchAccepter, StepperType::GHOST);
+    void testSplitRegion()
+    {
+#ifdef LIBGEODECOMP_WITH_THREADS
+        Region<2> region;
+        region << CoordBox<2>(Coord<2>(3, 5), Coord<2>(20, 30));
+        region >> CoordBox<2>(Coord<2>(5, 10), Coord<2>(4, 4));
+
+        StepperType::RegionVec chunks = stepper->splitRegion(region);
+        TS_ASSERT_EQUALS(
+            (std::min)(std::size_t(30), stepper->queues.size() * StepperType::CHUNKS_PER_THREAD),
+            chunks.size());
+
+        Region<2> sum;
+        for (std::size_t i = 0; i < chunks.size(); ++i) {
+            TS_ASSERT(!chunks[i].empty());
+            TS_ASSERT((sum & chunks[i]).empty());
+            sum += chunks[i];
+        }
+        TS_ASSERT_EQUALS(region, sum);
+#endif
+    }
+
+    void testWideGhostZone3D()
+    {
+#ifdef LIBGEODECOMP_WITH_THREADS
+        typedef APITraits::SelectTopology<TestCell<3> >::Value Topology3D;
+        typedef StepperType3D::GridType GridType3D;
+        unsigned ghostZoneWidth = 3;
+
+        boost::shared_ptr<TestInitializer<TestCell<3> > > init3D(
+            new TestInitializer<TestCell<3> >(Coord<3>(20, 18, 14)));
+        CoordBox<3> box = init3D->gridBox();
+
+        std::vector<std::size_t> weights(1, box.dimensions.prod());
+        boost::shared_ptr<Partition<3> > partition(
+            new StripingPartition<3>(Coord<3>(), box.dimensions, 0, weights));
+
+        boost::shared_ptr<PartitionManager<Topology3D> > partitionManager3D(
+            new PartitionManager<Topology3D>());
+        partitionManager3D->resetRegions(
+            init3D,
+            box,
+            partition,
+            0,
+            ghostZoneWidth);
+        std::vector<CoordBox<3> > boundingBoxes;
+        boundingBoxes << box;
+        partitionManager3D->resetGhostZones(boundingBoxes);
+
+        StepperType3D stepper3D(partitionManager3D, init3D);
+        TS_ASSERT_TEST_GRID(GridType3D, stepper3D.grid(), 0);
+        stepper3D.update(7);
+        TS_ASSERT_TEST_GRID(GridType3D, stepper3D.grid(), 7);
+        stepper3D.update(11);
+        TS_ASSERT_TEST_GRID(GridType3D, stepper3D.grid(), 18);
+#endif
     }
 
-    void testFoo()
+    void testThreadStatistics()
     {
 #ifdef LIBGEODECOMP_WITH_THREADS
-        std::cout << "fixme\n";
+        stepper->update(10);
+
+        const std::vector<Chronometer>& statistics = stepper->threadStatistics();
+        TS_ASSERT_EQUALS(std::size_t(omp_get_max_threads()), statistics.size());
+
+        double computeTime = 0;
+        for (std::size_t i = 0; i < statistics.size(); ++i) {
+            computeTime += statistics[i].interval<TimeComputeInner>();
+            computeTime += statistics[i].interval<TimeComputeGhost>();
+            TS_ASSERT_LESS_THAN_EQUALS(0, statistics[i].interval<TimeIdle>());
+        }
+        TS_ASSERT_LESS_THAN(0, computeTime);
 #endif
     }
 
 private:
+#ifdef LIBGEODECOMP_WITH_THREADS
     boost::shared_ptr<TestInitializer<TestCell<2> > > init;
     boost::shared_ptr<PartitionManager<Topology> > partitionManager;
-#ifdef LIBGEODECOMP_WITH_THREADS
     boost::shared_ptr<StepperType> stepper;
-#endif
     boost::shared_ptr<MockPatchAccepter<GridType> > patchAccepter;
+#endif
 };
 
 }
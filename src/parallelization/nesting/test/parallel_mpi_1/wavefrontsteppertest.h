@@ -0,0 +1,220 @@
+#include <cxxtest/TestSuite.h>
+
+#include <libgeodecomp.h>
+#include <libgeodecomp/io/testinitializer.h>
+#include <libgeodecomp/misc/testhelper.h>
+#include <libgeodecomp/parallelization/nesting/vanillastepper.h>
+#include <libgeodecomp/parallelization/nesting/wavefrontstepper.h>
+#include <libgeodecomp/storage/mockpatchaccepter.h>
+
+using namespace LibGeoDecomp;
+
+namespace LibGeoDecomp {
+
+namespace WavefrontStepperTestHelpers {
+
+/**
+ * Splits a 3D grid into two slabs along the z-axis. Slab 0 is
+ * centered at z = 0, so on a torus its planes wrap around the
+ * boundary.
+ */
+class WrappedSlabPartition : public Partition<3>
+{
+public:
+    WrappedSlabPartition(const Coord<3>& dimensions, const std::vector<std::size_t>& weights) :
+        Partition<3>(0, weights),
+        dimensions(dimensions)
+    {}
+
+    Region<3> getRegion(const std::size_t node) const
+    {
+        int quarter = dimensions.z() / 4;
+        Coord<3> sliceDim(dimensions.x(), dimensions.y(), quarter);
+        Region<3> ret;
+
+        if (node == 0) {
+            ret << CoordBox<3>(Coord<3>(), sliceDim);
+            ret << CoordBox<3>(Coord<3>(0, 0, dimensions.z() - quarter), sliceDim);
+        } else {
+            ret << CoordBox<3>(
+                Coord<3>(0, 0, quarter),
+                Coord<3>(dimensions.x(), dimensions.y(), dimensions.z() - 2 * quarter));
+        }
+
+        return ret;
+    }
+
+private:
+    Coord<3> dimensions;
+};
+
+}
+
+class WavefrontStepperTest : public CxxTest::TestSuite
+{
+public:
+    typedef TestCell<2> TestCell2D;
+    // the torus test leaves the other slab's ghost zones stale,
+    // which is why we silence the cells' error messages:
+    typedef TestCell<
+        3,
+        Stencils::Moore<3, 1>,
+        Topologies::Torus<3>::Topology,
+        TestCellHelpers::EmptyAPI,
+        TestCellHelpers::NoOutput> TestCell3D;
+    typedef APITraits::SelectTopology<TestCell2D>::Value Topology2D;
+    typedef APITraits::SelectTopology<TestCell3D>::Value Topology3D;
+    typedef UpdateFunctorHelpers::ConcurrencyNoP ConcurrencySpec;
+    typedef WavefrontStepper<TestCell2D, ConcurrencySpec> StepperType2D;
+    typedef WavefrontStepper<TestCell3D, ConcurrencySpec> StepperType3D;
+    typedef VanillaStepper<TestCell3D, ConcurrencySpec> ReferenceStepperType3D;
+    typedef StepperType2D::GridType GridType2D;
+    typedef StepperType3D::GridType GridType3D;
+
+    void testCube2D()
+    {
+        boost::shared_ptr<TestInitializer<TestCell2D> > init(
+            new TestInitializer<TestCell2D>(Coord<2>(17, 32)));
+        CoordBox<2> box = init->gridBox();
+
+        for (unsigned ghostZoneWidth = 1; ghostZoneWidth <= 4; ++ghostZoneWidth) {
+            boost::shared_ptr<PartitionManager<Topology2D> > partitionManager(
+                new PartitionManager<Topology2D>());
+            std::vector<std::size_t> weights(1, box.dimensions.prod());
+            boost::shared_ptr<Partition<2> > partition(
+                new StripingPartition<2>(Coord<2>(), box.dimensions, 0, weights));
+            partitionManager->resetRegions(init, box, partition, 0, ghostZoneWidth);
+            std::vector<CoordBox<2> > boundingBoxes;
+            boundingBoxes << box;
+            partitionManager->resetGhostZones(boundingBoxes);
+
+            StepperType2D stepper(partitionManager, init);
+            TS_ASSERT_EQUALS(ghostZoneWidth > 1, stepper.blockingEnabled());
+
+            TS_ASSERT_TEST_GRID(GridType2D, stepper.grid(), 0);
+            stepper.update(7);
+            TS_ASSERT_TEST_GRID(GridType2D, stepper.grid(), 7);
+            stepper.update(12);
+            TS_ASSERT_TEST_GRID(GridType2D, stepper.grid(), 19);
+        }
+    }
+
+    void testPatchAccepterSeesIntermediateSteps()
+    {
+        boost::shared_ptr<TestInitializer<TestCell2D> > init(
+            new TestInitializer<TestCell2D>(Coord<2>(17, 32)));
+        CoordBox<2> box = init->gridBox();
+        unsigned ghostZoneWidth = 4;
+
+        boost::shared_ptr<PartitionManager<Topology2D> > partitionManager(
+            new PartitionManager<Topology2D>());
+        std::vector<std::size_t> weights(1, box.dimensions.prod());
+        boost::shared_ptr<Partition<2> > partition(
+            new StripingPartition<2>(Coord<2>(), box.dimensions, 0, weights));
+        partitionManager->resetRegions(init, box, partition, 0, ghostZoneWidth);
+        std::vector<CoordBox<2> > boundingBoxes;
+        boundingBoxes << box;
+        partitionManager->resetGhostZones(boundingBoxes);
+
+        boost::shared_ptr<MockPatchAccepter<GridType2D> > patchAccepter(
+            new MockPatchAccepter<GridType2D>());
+        patchAccepter->pushRequest(3);
+        patchAccepter->pushRequest(8);
+        patchAccepter->pushRequest(10);
+
+        StepperType2D stepper(partitionManager, init);
+        stepper.addPatchAccepter(patchAccepter, StepperType2D::INNER_SET);
+
+        stepper.update(13);
+        TS_ASSERT_TEST_GRID(GridType2D, stepper.grid(), 13);
+
+        std::deque<std::size_t> expected;
+        expected << 3 << 8 << 10;
+        TS_ASSERT_EQUALS(expected, patchAccepter->getOfferedNanoSteps());
+    }
+
+    void testTorusMatchesVanillaStepper()
+    {
+        // we simulate only the first of two slabs, so the inner set
+        // is wrapped around the torus' z-axis, but the other slab's
+        // planes provide a gap where the wavefront may start:
+        boost::shared_ptr<TestInitializer<TestCell3D> > init(
+            new TestInitializer<TestCell3D>(Coord<3>(13, 12, 32)));
+        CoordBox<3> box = init->gridBox();
+        std::vector<std::size_t> weights;
+        weights << box.dimensions.prod() / 2
+                << box.dimensions.prod() / 2;
+
+        for (unsigned ghostZoneWidth = 2; ghostZoneWidth <= 3; ++ghostZoneWidth) {
+            boost::shared_ptr<Partition<3> > partition(
+                new WavefrontStepperTestHelpers::WrappedSlabPartition(box.dimensions, weights));
+            boost::shared_ptr<PartitionManager<Topology3D> > partitionManager =
+                createPartitionManager3D(init, partition, weights.size(), ghostZoneWidth);
+
+            StepperType3D stepper(partitionManager, init);
+            ReferenceStepperType3D reference(partitionManager, init);
+            TS_ASSERT(stepper.blockingEnabled());
+
+            // as nobody feeds the ghost zones, only the first cycle
+            // yields valid cells:
+            stepper.update(ghostZoneWidth);
+            reference.update(ghostZoneWidth);
+            TS_ASSERT_TEST_GRID_REGION(
+                GridType3D, stepper.grid(), stepper.innerSet(ghostZoneWidth), ghostZoneWidth);
+            checkEquality(partitionManager->ownRegion(), reference.grid(), stepper.grid());
+        }
+    }
+
+    void testTorusWithoutGapFallsBack()
+    {
+        boost::shared_ptr<TestInitializer<TestCell3D> > init(
+            new TestInitializer<TestCell3D>(Coord<3>(13, 12, 20)));
+        CoordBox<3> box = init->gridBox();
+        std::vector<std::size_t> weights(1, box.dimensions.prod());
+
+        boost::shared_ptr<Partition<3> > partition(
+            new StripingPartition<3>(Coord<3>(), box.dimensions, 0, weights));
+        boost::shared_ptr<PartitionManager<Topology3D> > partitionManager =
+            createPartitionManager3D(init, partition, weights.size(), 3);
+
+        StepperType3D stepper(partitionManager, init);
+        TS_ASSERT(!stepper.blockingEnabled());
+
+        stepper.update(8);
+        TS_ASSERT_TEST_GRID(GridType3D, stepper.grid(), 8);
+    }
+
+private:
+    boost::shared_ptr<PartitionManager<Topology3D> > createPartitionManager3D(
+        boost::shared_ptr<TestInitializer<TestCell3D> > init,
+        boost::shared_ptr<Partition<3> > partition,
+        std::size_t numNodes,
+        unsigned ghostZoneWidth)
+    {
+        CoordBox<3> box = init->gridBox();
+
+        boost::shared_ptr<PartitionManager<Topology3D> > partitionManager(
+            new PartitionManager<Topology3D>());
+        partitionManager->resetRegions(init, box, partition, 0, ghostZoneWidth);
+
+        std::vector<CoordBox<3> > boundingBoxes;
+        for (std::size_t i = 0; i < numNodes; ++i) {
+            boundingBoxes << partition->getRegion(i).boundingBox();
+        }
+        partitionManager->resetGhostZones(boundingBoxes);
+
+        return partitionManager;
+    }
+
+    void checkEquality(
+        const Region<3>& region,
+        const GridType3D& expected,
+        const GridType3D& actual)
+    {
+        for (Region<3>::Iterator i = region.begin(); i != region.end(); ++i) {
+            TS_ASSERT_EQUALS(expected.get(*i), actual.get(*i));
+        }
+    }
+};
+
+}
@@ -0,0 +1,81 @@
+#include <cxxtest/TestSuite.h>
+#include <libgeodecomp/geometry/region.h>
+#include <libgeodecomp/parallelization/nesting/ghostzonewidthmodel.h>
+
+using namespace LibGeoDecomp;
+
+namespace LibGeoDecomp {
+
+class GhostZoneWidthModelTest : public CxxTest::TestSuite
+{
+public:
+    void setUp()
+    {
+        // halo sizes of a 100x100 subdomain:
+        ghostCells.clear();
+        Region<2> ownRegion;
+        ownRegion << CoordBox<2>(Coord<2>(), Coord<2>(100, 100));
+        for (int i = 0; i <= 10; ++i) {
+            ghostCells.push_back(ownRegion.expand(i).size() - ownRegion.size());
+        }
+    }
+
+    void testOverhead()
+    {
+        GhostZoneWidthModel model(1e-5, 1e9, 1e-8, 8);
+
+        // width 1: no redundant computation
+        TS_ASSERT_DELTA(4 * 1e-5 + 404 * 8 / 1e9, model.overhead(1, ghostCells, 4), 1e-15);
+        // width 3: halo of width 2 and 1 computed redundantly
+        TS_ASSERT_DELTA(
+            (4 * 1e-5 + 1236 * 8 / 1e9 + (404 + 816) * 1e-8) / 3,
+            model.overhead(3, ghostCells, 4),
+            1e-15);
+
+        TS_ASSERT_THROWS(model.overhead(0,  ghostCells, 4), std::invalid_argument&);
+        TS_ASSERT_THROWS(model.overhead(11, ghostCells, 4), std::invalid_argument&);
+    }
+
+    void testWidthGrowsWithLatency()
+    {
+        // optimum approximately at sqrt(2 * links * latency / (cellCost * surface)):
+        GhostZoneWidthModel lowLatency(1e-6, 1e9, 1e-8, 8);
+        TS_ASSERT_EQUALS(1, GhostZoneWidthModel::bestWidth(lowLatency.overheads(ghostCells, 4)));
+
+        GhostZoneWidthModel highLatency(2.5e-5, 1e9, 1e-8, 8);
+        TS_ASSERT_EQUALS(7, GhostZoneWidthModel::bestWidth(highLatency.overheads(ghostCells, 4)));
+
+        GhostZoneWidthModel extremeLatency(1, 1e9, 1e-8, 8);
+        TS_ASSERT_EQUALS(10, GhostZoneWidthModel::bestWidth(extremeLatency.overheads(ghostCells, 4)));
+
+        // without neighbors there is nothing to synchronize:
+        TS_ASSERT_EQUALS(1, GhostZoneWidthModel::bestWidth(extremeLatency.overheads(ghostCells, 0)));
+    }
+
+    void testWidthShrinksWithCellCost()
+    {
+        GhostZoneWidthModel cheapCells(1e-5, 1e9, 1e-9, 8);
+        GhostZoneWidthModel expensiveCells(1e-5, 1e9, 1e-6, 8);
+
+        unsigned wide = GhostZoneWidthModel::bestWidth(cheapCells.overheads(ghostCells, 4));
+        unsigned narrow = GhostZoneWidthModel::bestWidth(expensiveCells.overheads(ghostCells, 4));
+        TS_ASSERT_LESS_THAN(narrow, wide);
+        TS_ASSERT_EQUALS(1, narrow);
+    }
+
+    void testBestWidthPrefersNarrowGhostZones()
+    {
+        std::vector<double> overheads;
+        overheads.push_back(3);
+        overheads.push_back(2);
+        overheads.push_back(2);
+        TS_ASSERT_EQUALS(2, GhostZoneWidthModel::bestWidth(overheads));
+
+        TS_ASSERT_THROWS(GhostZoneWidthModel::bestWidth(std::vector<double>()), std::invalid_argument&);
+    }
+
+private:
+    std::vector<std::size_t> ghostCells;
+};
+
+}
@@ -109,6 +109,15 @@ public:
         return partitionManager->getWeights();
     }
 
+    /**
+     * Number of PatchLinks used for ghost zone synchronization, i.e.
+     * the number of messages sent and received per synchronization.
+     */
+    inline std::size_t numPatchLinks() const
+    {
+        return patchLinks.size();
+    }
+
     inline double computeTimeInner() const
     {
         return stepper->computeTimeInner;
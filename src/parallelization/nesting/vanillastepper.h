@@ -83,7 +83,7 @@ public:
         initGrids();
     }
 
-private:
+protected:
     inline void update1()
     {
         using std::swap;
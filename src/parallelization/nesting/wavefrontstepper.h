@@ -0,0 +1,278 @@
+#ifndef LIBGEODECOMP_PARALLELIZATION_NESTING_WAVEFRONTSTEPPER_H
+#define LIBGEODECOMP_PARALLELIZATION_NESTING_WAVEFRONTSTEPPER_H
+
+#include <libgeodecomp/parallelization/nesting/vanillastepper.h>
+
+namespace LibGeoDecomp {
+
+/**
+ * The WavefrontStepper adds temporal blocking to the VanillaStepper:
+ * with a ghost zone width of k it will advance the inner set by k
+ * (nano) steps in a single sweep over the grid instead of k full
+ * sweeps. For this it splits the inner sets into planes along the
+ * slowest axis (DIM - 1) and runs a skewed wavefront across these
+ * planes: while step s updates plane j, step s + 1 updates plane j -
+ * r (r being the stencil's radius). This way each plane is touched k
+ * times while it's still in cache. As the wavefront works on the same
+ * two grids as the VanillaStepper, no additional memory is required.
+ *
+ * Ghost zone handling is inherited from the VanillaStepper. Blocking
+ * is only used where it's safe: it falls back to single step updates
+ * if a patch accepter or provider on the inner set needs to see an
+ * intermediate time step or if the inner set spans the whole slowest
+ * axis of a torus without a gap of at least r planes (in which case
+ * there is no plane the wavefront could start at).
+ */
+template<typename CELL_TYPE, typename CONCURRENCY_SPEC>
+class WavefrontStepper : public VanillaStepper<CELL_TYPE, CONCURRENCY_SPEC>
+{
+public:
+    friend class WavefrontStepperTest;
+
+    typedef typename Stepper<CELL_TYPE>::Topology Topology;
+    const static int DIM = Topology::DIM;
+    const static unsigned NANO_STEPS = APITraits::SelectNanoSteps<CELL_TYPE>::VALUE;
+
+    typedef class VanillaStepper<CELL_TYPE, CONCURRENCY_SPEC> ParentType;
+    typedef typename ParentType::GridType GridType;
+    typedef typename ParentType::PartitionManagerType PartitionManagerType;
+    typedef typename ParentType::PatchAccepterVec PatchAccepterVec;
+    typedef typename ParentType::PatchProviderVec PatchProviderVec;
+    typedef typename ParentType::PatchAccepterList PatchAccepterList;
+    typedef typename ParentType::PatchProviderList PatchProviderList;
+    typedef std::vector<Region<DIM> > RegionVec;
+    const static int RADIUS = APITraits::SelectStencil<CELL_TYPE>::Value::RADIUS;
+
+    using ParentType::patchAccepters;
+    using ParentType::patchProviders;
+    using ParentType::partitionManager;
+    using ParentType::chronometer;
+
+    using ParentType::innerSet;
+    using ParentType::globalNanoStep;
+    using ParentType::resetValidGhostZoneWidth;
+    using ParentType::updateGhost;
+    using ParentType::update1;
+
+    using ParentType::curStep;
+    using ParentType::curNanoStep;
+    using ParentType::validGhostZoneWidth;
+    using ParentType::ghostZoneWidth;
+    using ParentType::oldGrid;
+    using ParentType::newGrid;
+    using ParentType::enableFineGrainedParallelism;
+
+    inline WavefrontStepper(
+        boost::shared_ptr<PartitionManagerType> partitionManager,
+        boost::shared_ptr<Initializer<CELL_TYPE> > initializer,
+        const PatchAccepterVec& ghostZonePatchAccepters = PatchAccepterVec(),
+        const PatchAccepterVec& innerSetPatchAccepters = PatchAccepterVec(),
+        const PatchProviderVec& ghostZonePatchProviders = PatchProviderVec(),
+        const PatchProviderVec& innerSetPatchProviders = PatchProviderVec(),
+        bool enableFineGrainedParallelism = false) :
+        ParentType(
+            partitionManager,
+            initializer,
+            ghostZonePatchAccepters,
+            innerSetPatchAccepters,
+            ghostZonePatchProviders,
+            innerSetPatchProviders,
+            enableFineGrainedParallelism)
+    {
+        initSlices();
+    }
+
+    inline void update(std::size_t nanoSteps)
+    {
+        for (std::size_t i = 0; i < nanoSteps; ) {
+            if (blockingPossible(nanoSteps - i)) {
+                updateBlock();
+                i += ghostZoneWidth();
+            } else {
+                update1();
+                ++i;
+            }
+        }
+    }
+
+    /**
+     * Returns true if the stepper will use temporal blocking at all,
+     * i.e. if the ghost zone is wider than 1 and a plane ordering for
+     * the wavefront could be found.
+     */
+    inline bool blockingEnabled() const
+    {
+        return !slices.empty();
+    }
+
+private:
+    /**
+     * slices[s][j] holds the part of innerSet(s + 1) which lies in the
+     * j-th plane of the wavefront.
+     */
+    std::vector<RegionVec> slices;
+
+    /**
+     * Blocking is only permissible if we're at the beginning of a
+     * ghost zone cycle, enough steps are left to be computed and no
+     * patch accepter/provider expects to see an intermediate step.
+     */
+    inline bool blockingPossible(std::size_t remainingNanoSteps)
+    {
+        if (!blockingEnabled() ||
+            (validGhostZoneWidth != ghostZoneWidth()) ||
+            (remainingNanoSteps < ghostZoneWidth())) {
+            return false;
+        }
+
+        std::size_t begin = globalNanoStep();
+        std::size_t end = begin + ghostZoneWidth();
+
+        PatchAccepterList& accepters = patchAccepters[ParentType::INNER_SET];
+        for (typename PatchAccepterList::iterator i = accepters.begin(); i != accepters.end(); ++i) {
+            std::size_t nanoStep = (*i)->nextRequiredNanoStep();
+            if ((nanoStep > begin) && (nanoStep < end)) {
+                return false;
+            }
+        }
+
+        PatchProviderList& providers = patchProviders[ParentType::INNER_SET];
+        for (typename PatchProviderList::iterator i = providers.begin(); i != providers.end(); ++i) {
+            std::size_t nanoStep = (*i)->nextAvailableNanoStep();
+            if ((nanoStep > begin) && (nanoStep < end)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * Equivalent to ghostZoneWidth() calls to update1(), but the
+     * inner sets are traversed plane-wise in a skewed wavefront.
+     * Step s reads from grid (s - 1) % 2 and writes to grid s % 2.
+     * Running the steps in ascending order per wavefront position
+     * ensures that step s reads plane j - r of step s - 1 before step
+     * s + 1 overwrites it.
+     */
+    inline void updateBlock()
+    {
+        using std::swap;
+        TimeTotal t(&chronometer);
+        unsigned width = ghostZoneWidth();
+
+        {
+            TimeComputeInner t(&chronometer);
+
+            GridType *grids[] = { &*oldGrid, &*newGrid };
+            int numPlanes = slices[0].size();
+
+            int skew = RADIUS;
+            for (int i = 0; i < (numPlanes + (int(width) - 1) * skew); ++i) {
+                for (unsigned s = 1; s <= width; ++s) {
+                    int plane = i - (int(s) - 1) * skew;
+                    if ((plane < 0) || (plane >= numPlanes)) {
+                        continue;
+                    }
+
+                    const Region<DIM>& region = slices[s - 1][plane];
+                    if (region.empty()) {
+                        continue;
+                    }
+
+                    UpdateFunctor<CELL_TYPE, CONCURRENCY_SPEC>()(
+                        region,
+                        Coord<DIM>(),
+                        Coord<DIM>(),
+                        *grids[(s - 1) % 2],
+                        grids[s % 2],
+                        (curNanoStep + s - 1) % NANO_STEPS,
+                        CONCURRENCY_SPEC(false, enableFineGrainedParallelism));
+                }
+            }
+
+            if (width % 2) {
+                swap(oldGrid, newGrid);
+            }
+
+            curNanoStep += width;
+            curStep += curNanoStep / NANO_STEPS;
+            curNanoStep %= NANO_STEPS;
+            validGhostZoneWidth = 0;
+        }
+
+        this->notifyPatchAccepters(innerSet(width), ParentType::INNER_SET, globalNanoStep());
+
+        updateGhost();
+        resetValidGhostZoneWidth();
+
+        this->notifyPatchProviders(innerSet(0), ParentType::INNER_SET, globalNanoStep());
+    }
+
+    /**
+     * Buckets the streaks of the inner sets by their coordinate along
+     * the slowest axis. On a torus the planes are ordered cyclically,
+     * starting right after a sufficiently wide gap in the inner set, so that the
+     * wavefront never needs values from a plane it hasn't reached yet.
+     */
+    inline void initSlices()
+    {
+        slices.clear();
+        unsigned width = ghostZoneWidth();
+        const Region<DIM>& outermost = innerSet(1);
+        if ((DIM < 2) || (width < 2) || outermost.empty()) {
+            return;
+        }
+
+        const int axis = DIM - 1;
+        const CoordBox<DIM>& box = outermost.boundingBox();
+        int dimension = partitionManager->getSimulationArea()[axis];
+        int offset = box.origin[axis];
+        int numPlanes = box.dimensions[axis];
+
+        if (Topology::wrapsAxis(axis)) {
+            std::vector<bool> occupied(dimension, false);
+            for (typename Region<DIM>::StreakIterator i = outermost.beginStreak();
+                 i != outermost.endStreak();
+                 ++i) {
+                occupied[i->origin[axis]] = true;
+            }
+
+            // the wavefront may only start behind at least RADIUS
+            // empty planes, otherwise the last planes would read
+            // values which the first planes have already overwritten:
+            int gapEnd = -1;
+            for (int z = 0, gapLength = 0; z < (2 * dimension); ++z) {
+                gapLength = occupied[z % dimension] ? 0 : gapLength + 1;
+                if (gapLength >= RADIUS) {
+                    gapEnd = (z + 1) % dimension;
+                    break;
+                }
+            }
+            if (gapEnd == -1) {
+                return;
+            }
+
+            offset = gapEnd;
+            numPlanes = dimension;
+        }
+
+        slices.resize(width, RegionVec(numPlanes));
+        for (unsigned s = 1; s <= width; ++s) {
+            const Region<DIM>& region = innerSet(s);
+            for (typename Region<DIM>::StreakIterator i = region.beginStreak();
+                 i != region.endStreak();
+                 ++i) {
+                int plane = i->origin[axis] - offset;
+                if (plane < 0) {
+                    plane += dimension;
+                }
+                slices[s - 1][plane] << *i;
+            }
+        }
+    }
+};
+
+}
+
+#endif
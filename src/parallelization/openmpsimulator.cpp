@@ -0,0 +1,95 @@
+#include <libgeodecomp/config.h>
+#include <libgeodecomp/parallelization/openmpsimulator.h>
+
+#ifdef LIBGEODECOMP_WITH_THREADS
+#include <omp.h>
+#endif
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace LibGeoDecomp {
+namespace OpenMPSimulatorHelpers {
+
+#ifdef __linux__
+
+namespace {
+
+/**
+ * Once the master thread has been pinned, sched_getaffinity() would
+ * only report a single CPU, hence we need to remember the original
+ * set.
+ */
+const std::vector<int>& allowedCPUs()
+{
+    static std::vector<int> cpus;
+    static bool initialized = false;
+
+    if (!initialized) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (int i = 0; i < CPU_SETSIZE; ++i) {
+                if (CPU_ISSET(i, &set)) {
+                    cpus.push_back(i);
+                }
+            }
+        }
+
+        initialized = true;
+    }
+
+    return cpus;
+}
+
+}
+
+void pinThreads()
+{
+#ifdef LIBGEODECOMP_WITH_THREADS
+    const std::vector<int>& cpus = allowedCPUs();
+    if (cpus.empty()) {
+        return;
+    }
+
+#pragma omp parallel
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpus[omp_get_thread_num() % cpus.size()], &set);
+        // this is merely an optimization, so failure is not an error:
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+#endif
+}
+
+void discardPages(void *begin, std::size_t bytes)
+{
+    std::size_t pageSize = sysconf(_SC_PAGESIZE);
+    std::size_t first = reinterpret_cast<std::size_t>(begin);
+    std::size_t last = first + bytes;
+    // partial pages at either end may be shared with other objects:
+    first = (first + pageSize - 1) / pageSize * pageSize;
+    last = last / pageSize * pageSize;
+
+    if (first < last) {
+        madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED);
+    }
+}
+
+#else
+
+void pinThreads()
+{}
+
+void discardPages(void * /* begin */, std::size_t /* bytes */)
+{}
+
+#endif
+
+}
+}
@@ -7,14 +7,105 @@
 #include <libgeodecomp/communication/hpxserializationwrapper.h>
 #include <libgeodecomp/io/writer.h>
 #include <libgeodecomp/parallelization/serialsimulator.h>
+#include <libgeodecomp/storage/displacedgrid.h>
 #include <libgeodecomp/storage/gridtypeselector.h>
+#include <libgeodecomp/storage/soagrid.h>
 #include <libgeodecomp/storage/updatefunctor.h>
 
+#include <boost/type_traits/has_trivial_copy.hpp>
+#include <boost/type_traits/has_trivial_destructor.hpp>
+#include <vector>
+
 namespace LibGeoDecomp {
 
+namespace OpenMPSimulatorHelpers {
+
+/**
+ * Pins OpenMP thread i to the i-th CPU the process may run on
+ * (compact placement), so threads won't migrate away from the NUMA
+ * domain holding their share of the grid. The set of allowed CPUs is
+ * captured on the first call, so repeated calls yield the same
+ * mapping. Does nothing on systems other than Linux.
+ */
+void pinThreads();
+
+/**
+ * Returns all whole pages within the given range to the OS. The next
+ * write to each page will then place it in the NUMA domain of the
+ * writing thread (first-touch policy). Their contents are lost.
+ */
+void discardPages(void *begin, std::size_t bytes);
+
+/**
+ * Discards the pages backing the grid's cells, but only if the cells
+ * don't manage any resources themselves (e.g. via a std::vector
+ * member), as these would otherwise leak. Returns true if the pages
+ * were discarded.
+ */
+template<typename CELL, typename TOPOLOGY, bool TOPOLOGICALLY_CORRECT>
+bool discardStorage(DisplacedGrid<CELL, TOPOLOGY, TOPOLOGICALLY_CORRECT> *grid)
+{
+    if (!boost::has_trivial_copy<CELL>::value || !boost::has_trivial_destructor<CELL>::value) {
+        return false;
+    }
+
+    discardPages(grid->baseAddress(), grid->boundingBox().dimensions.prod() * sizeof(CELL));
+    return true;
+}
+
+/**
+ * SoA cells are always copied bytewise, so their storage may be
+ * discarded unconditionally.
+ */
+template<typename CELL, typename TOPOLOGY, bool TOPOLOGICALLY_CORRECT>
+bool discardStorage(SoAGrid<CELL, TOPOLOGY, TOPOLOGICALLY_CORRECT> *grid)
+{
+    discardPages(grid->data(), grid->byteSize());
+    return true;
+}
+
+/**
+ * Copies the given region from source to target, plane by plane and
+ * using the same static plane-to-thread mapping as UpdateFunctor
+ * does with static scheduling. This way each page of target is first
+ * touched by the thread which is going to update it. Works for both,
+ * AoS and SoA grids, as both store planes contiguously (per member
+ * in the latter case).
+ */
+template<typename CELL, typename GRID, int DIM>
+void parallelCopy(const GRID& source, GRID *target, const Region<DIM>& region)
+{
+#pragma omp parallel for schedule(static)
+    for (std::size_t c = 0; c < region.numPlanes(); ++c) {
+        std::vector<CELL> buffer;
+        typename Region<DIM>::StreakIterator e = region.planeStreakIterator(c + 1);
+        typedef typename Region<DIM>::StreakIterator Iter;
+
+        for (Iter i = region.planeStreakIterator(c + 0); i != e; ++i) {
+            buffer.resize(i->length());
+            source.get(*i, &buffer[0]);
+            target->set(*i, &buffer[0]);
+        }
+    }
+
+    target->setEdge(source.getEdge());
+}
+
+}
+
 /**
  * OpenMPSimulator is based on SerialSimulator, but is capable of
  * threading via OpenMP.
+ *
+ * On multi-socket systems the achievable memory bandwidth depends on
+ * the grids' pages being spread across all NUMA domains, matching
+ * the threads which access them. Initializer::grid() runs serially
+ * though, so by default all pages end up in one domain. With
+ * enableNUMAFirstTouch the simulator will instead place each plane
+ * of the grids in the domain of the thread which updates it and
+ * switch the update to static scheduling so that this mapping stays
+ * fixed. pinThreads additionally prevents threads from migrating
+ * (alternatively set OMP_PROC_BIND/OMP_PLACES).
  */
 template<typename CELL_TYPE>
 class OpenMPSimulator : public SerialSimulator<CELL_TYPE>
@@ -47,13 +138,41 @@ public:
      */
     explicit OpenMPSimulator(
         Initializer<CELL_TYPE> *initializer,
-        bool enableFineGrainedParallelism = false) :
+        bool enableFineGrainedParallelism = false,
+        bool enableNUMAFirstTouch = false,
+        bool pinThreads = false) :
         SerialSimulator<CELL_TYPE>(initializer),
-        enableFineGrainedParallelism(enableFineGrainedParallelism)
-    {}
+        enableFineGrainedParallelism(enableFineGrainedParallelism),
+        enableNUMAFirstTouch(enableNUMAFirstTouch)
+    {
+        if (pinThreads) {
+            OpenMPSimulatorHelpers::pinThreads();
+        }
+
+        if (enableNUMAFirstTouch) {
+            placeGrids();
+        }
+    }
 
 protected:
     bool enableFineGrainedParallelism;
+    bool enableNUMAFirstTouch;
+
+    /**
+     * Both grids have been initialized identically by
+     * SerialSimulator, so we can restore either from the other after
+     * discarding its pages.
+     */
+    void placeGrids()
+    {
+        if (OpenMPSimulatorHelpers::discardStorage(curGrid)) {
+            OpenMPSimulatorHelpers::parallelCopy<CELL_TYPE>(*newGrid, curGrid, simArea);
+        }
+
+        if (OpenMPSimulatorHelpers::discardStorage(newGrid)) {
+            OpenMPSimulatorHelpers::parallelCopy<CELL_TYPE>(*curGrid, newGrid, simArea);
+        }
+    }
 
     void nanoStep(unsigned nanoStep)
     {
@@ -67,7 +186,10 @@ protected:
             *curGrid,
             newGrid,
             nanoStep,
-            UpdateFunctorHelpers::ConcurrencyEnableOpenMP(true, enableFineGrainedParallelism));
+            // static scheduling keeps the plane-to-thread mapping
+            // established by placeGrids():
+            UpdateFunctorHelpers::ConcurrencyEnableOpenMP(
+                true, enableFineGrainedParallelism, enableNUMAFirstTouch));
         swap(curGrid, newGrid);
     }
 
@@ -213,6 +213,27 @@ public:
         TS_ASSERT_TEST_GRID(GridBaseType, *sim.getGrid(), 21 * NANO_STEPS_3D);
     }
 
+    void testNUMAFirstTouch()
+    {
+        OpenMPSimulator<TestCell<3> > sim(new TestInitializer<TestCell<3> >(), false, true);
+        TS_ASSERT_TEST_GRID(GridBase3D, *sim.getGrid(), 0);
+        TS_ASSERT_TEST_GRID(GridBase3D, *sim.newGrid, 0);
+
+        sim.run();
+        TS_ASSERT_TEST_GRID(GridBase3D, *sim.getGrid(), 21 * NANO_STEPS_3D);
+    }
+
+    void testNUMAFirstTouchSoA()
+    {
+        typedef GridBase<TestCellSoA, 3> GridBaseType;
+        OpenMPSimulator<TestCellSoA> sim(new TestInitializer<TestCellSoA>(), false, true, true);
+        TS_ASSERT_TEST_GRID(GridBaseType, *sim.getGrid(), 0);
+        TS_ASSERT_TEST_GRID(GridBaseType, *sim.newGrid, 0);
+
+        sim.run();
+        TS_ASSERT_TEST_GRID(GridBaseType, *sim.getGrid(), 21 * NANO_STEPS_3D);
+    }
+
 private:
     boost::shared_ptr<MockWriter<>::EventsStore> events;
     boost::shared_ptr<OpenMPSimulator<TestCell<2> > > simulator;
@@ -0,0 +1,184 @@
+#ifndef LIBGEODECOMP_STORAGE_CSRMATRIX_H
+#define LIBGEODECOMP_STORAGE_CSRMATRIX_H
+
+#include <libgeodecomp/geometry/coord.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <map>
+#include <vector>
+
+namespace LibGeoDecomp {
+
+/**
+ * A sparse matrix in compressed sparse row (CSR) format: the entries
+ * of row i are stored in columnIndices()/values() at positions
+ * [rowPointers()[i], rowPointers()[i + 1]), sorted by column.
+ *
+ * The arrays are either owned by the matrix or live in an external
+ * buffer (e.g. a memory-mapped file), which is kept alive by the
+ * owner handle for as long as any copy of the matrix exists. The
+ * latter allows matrices to be handed to
+ * SellCSigmaSparseMatrixContainer (and thus unstructured grids via
+ * GridBase::setWeights()) without an intermediate copy.
+ */
+template<typename VALUE_TYPE>
+class CSRMatrix
+{
+public:
+    /**
+     * Creates a matrix without any non-zero entries.
+     */
+    explicit CSRMatrix(int rows = 0, int columns = 0) :
+        myRows(rows),
+        myColumns(columns),
+        myNonZeros(0),
+        ownedRowPointers(rows + 1, 0),
+        externalRowPointers(0),
+        externalColumnIndices(0),
+        externalValues(0)
+    {}
+
+    /**
+     * Takes over the contents of the given vectors, leaving them
+     * empty. rowPointers needs to hold rows + 1 elements.
+     */
+    CSRMatrix(
+        int rows,
+        int columns,
+        std::vector<int> *rowPointers,
+        std::vector<int> *columnIndices,
+        std::vector<VALUE_TYPE> *values) :
+        myRows(rows),
+        myColumns(columns),
+        myNonZeros(columnIndices->size()),
+        externalRowPointers(0),
+        externalColumnIndices(0),
+        externalValues(0)
+    {
+        assert(rowPointers->size() == std::size_t(rows + 1));
+        assert(columnIndices->size() == values->size());
+        ownedRowPointers.swap(*rowPointers);
+        ownedColumnIndices.swap(*columnIndices);
+        ownedValues.swap(*values);
+    }
+
+    /**
+     * Wraps external arrays, which need to remain valid for as long
+     * as owner is alive.
+     */
+    CSRMatrix(
+        int rows,
+        int columns,
+        int nonZeros,
+        const int *rowPointers,
+        const int *columnIndices,
+        const VALUE_TYPE *values,
+        boost::shared_ptr<void> owner) :
+        myRows(rows),
+        myColumns(columns),
+        myNonZeros(nonZeros),
+        externalRowPointers(rowPointers),
+        externalColumnIndices(columnIndices),
+        externalValues(values),
+        owner(owner)
+    {}
+
+    inline int rows() const
+    {
+        return myRows;
+    }
+
+    inline int columns() const
+    {
+        return myColumns;
+    }
+
+    inline int nonZeros() const
+    {
+        return myNonZeros;
+    }
+
+    /**
+     * true if the arrays live in an external buffer.
+     */
+    inline bool isView() const
+    {
+        return externalRowPointers != 0;
+    }
+
+    inline const int *rowPointers() const
+    {
+        return isView() ? externalRowPointers : &ownedRowPointers[0];
+    }
+
+    inline const int *columnIndices() const
+    {
+        return isView() ? externalColumnIndices : data(ownedColumnIndices);
+    }
+
+    inline const VALUE_TYPE *values() const
+    {
+        return isView() ? externalValues : data(ownedValues);
+    }
+
+    /**
+     * Converts the matrix to the representation expected by
+     * GridBase::setWeights(). Mainly useful for testing as the map
+     * is much larger than the CSR arrays.
+     */
+    std::map<Coord<2>, VALUE_TYPE> toMap() const
+    {
+        std::map<Coord<2>, VALUE_TYPE> ret;
+        for (int row = 0; row < myRows; ++row) {
+            for (int i = rowPointers()[row]; i < rowPointers()[row + 1]; ++i) {
+                ret[Coord<2>(row, columnIndices()[i])] = values()[i];
+            }
+        }
+
+        return ret;
+    }
+
+    bool operator==(const CSRMatrix& other) const
+    {
+        if ((myRows != other.myRows) ||
+            (myColumns != other.myColumns) ||
+            (myNonZeros != other.myNonZeros)) {
+            return false;
+        }
+
+        return
+            std::equal(rowPointers(), rowPointers() + myRows + 1, other.rowPointers()) &&
+            std::equal(columnIndices(), columnIndices() + myNonZeros, other.columnIndices()) &&
+            std::equal(values(), values() + myNonZeros, other.values());
+    }
+
+    inline bool operator!=(const CSRMatrix& other) const
+    {
+        return !(*this == other);
+    }
+
+private:
+    int myRows;
+    int myColumns;
+    int myNonZeros;
+    std::vector<int> ownedRowPointers;
+    std::vector<int> ownedColumnIndices;
+    std::vector<VALUE_TYPE> ownedValues;
+    const int *externalRowPointers;
+    const int *externalColumnIndices;
+    const VALUE_TYPE *externalValues;
+    boost::shared_ptr<void> owner;
+
+    template<typename T>
+    static const T *data(const std::vector<T>& vec)
+    {
+        return vec.empty() ? 0 : &vec[0];
+    }
+};
+
+}
+
+#endif
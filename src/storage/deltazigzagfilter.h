@@ -0,0 +1,122 @@
+#ifndef LIBGEODECOMP_STORAGE_DELTAZIGZAGFILTER_H
+#define LIBGEODECOMP_STORAGE_DELTAZIGZAGFILTER_H
+
+#include <libgeodecomp/storage/filter.h>
+
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/is_integral.hpp>
+#include <boost/type_traits/make_unsigned.hpp>
+
+namespace LibGeoDecomp {
+
+/**
+ * Lossless filter for integer members (e.g. state flags, material
+ * IDs or counters): each value is replaced by the difference to its
+ * predecessor in the same streak, and the difference is zigzag
+ * encoded (0, -1, 1, -2, ... become 0, 1, 2, 3, ...). Slowly varying
+ * or piecewise constant fields thus turn into long runs of small
+ * numbers with zero high order bytes, which BlockCompressor then
+ * stores in a fraction of the original size. EXTERNAL receives the
+ * bit pattern of the code and defaults to MEMBER so that writers
+ * which only know signed types can handle the output.
+ *
+ * Each streak is encoded independently, starting from zero. Hence
+ * data has to be loaded with the same streaks (i.e. the same Region
+ * and grid type) it was saved with, which is what writer/reader
+ * pairs do anyway.
+ */
+template<typename CELL, typename MEMBER, typename EXTERNAL = MEMBER>
+class DeltaZigZagFilter : public Filter<CELL, MEMBER, EXTERNAL>
+{
+public:
+    BOOST_STATIC_ASSERT(boost::is_integral<MEMBER>::value);
+
+    typedef typename boost::make_unsigned<MEMBER>::type Unsigned;
+
+    void copyStreakInImpl(
+        const EXTERNAL *source,
+        MemoryLocation::Location sourceLocation,
+        MEMBER *target,
+        MemoryLocation::Location targetLocation,
+        const std::size_t num,
+        const std::size_t stride)
+    {
+        Unsigned previous = 0;
+        for (std::size_t i = 0; i < num; ++i) {
+            previous += decode(source[i]);
+            target[i] = static_cast<MEMBER>(previous);
+        }
+    }
+
+    void copyStreakOutImpl(
+        const MEMBER *source,
+        MemoryLocation::Location sourceLocation,
+        EXTERNAL *target,
+        MemoryLocation::Location targetLocation,
+        const std::size_t num,
+        const std::size_t stride)
+    {
+        Unsigned previous = 0;
+        for (std::size_t i = 0; i < num; ++i) {
+            Unsigned value = static_cast<Unsigned>(source[i]);
+            target[i] = encode(value - previous);
+            previous = value;
+        }
+    }
+
+    void copyMemberInImpl(
+        const EXTERNAL *source,
+        MemoryLocation::Location sourceLocation,
+        CELL *target,
+        MemoryLocation::Location targetLocation,
+        std::size_t num,
+        MEMBER CELL:: *memberPointer)
+    {
+        Unsigned previous = 0;
+        for (std::size_t i = 0; i < num; ++i) {
+            previous += decode(source[i]);
+            target[i].*memberPointer = static_cast<MEMBER>(previous);
+        }
+    }
+
+    void copyMemberOutImpl(
+        const CELL *source,
+        MemoryLocation::Location sourceLocation,
+        EXTERNAL *target,
+        MemoryLocation::Location targetLocation,
+        std::size_t num,
+        MEMBER CELL:: *memberPointer)
+    {
+        Unsigned previous = 0;
+        for (std::size_t i = 0; i < num; ++i) {
+            Unsigned value = static_cast<Unsigned>(source[i].*memberPointer);
+            target[i] = encode(value - previous);
+            previous = value;
+        }
+    }
+
+private:
+    /**
+     * Zigzag encoding of the two's complement difference, using
+     * only unsigned arithmetic to avoid implementation defined
+     * shifts of negative numbers.
+     */
+    static inline EXTERNAL encode(Unsigned delta)
+    {
+        const Unsigned signBit = Unsigned(1) << (sizeof(Unsigned) * 8 - 1);
+        Unsigned code = (delta & signBit) ?
+            Unsigned((Unsigned(~delta) << 1) | 1) :
+            Unsigned(delta << 1);
+        return static_cast<EXTERNAL>(code);
+    }
+
+    static inline Unsigned decode(EXTERNAL value)
+    {
+        Unsigned code = static_cast<Unsigned>(value);
+        return (code & 1) ? Unsigned(~(code >> 1)) : Unsigned(code >> 1);
+    }
+};
+
+}
+
+#endif
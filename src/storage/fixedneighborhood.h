@@ -12,6 +12,13 @@ namespace LibGeoDecomp {
  * CoordMap and LinePointerNeighborhood, class requires grid
  * dimensions to be known at compile time. The benefit is that we can
  * significantly reduce runtime overhead.
+ *
+ * The offsets are added to the index of neighbors beyond the
+ * respective boundary of a periodic grid. For stencils with a radius
+ * > 1 a neighbor with an offset of, say, X < 0 only lies beyond the
+ * western boundary if -X exceeds the number of cells between the
+ * current cell and that boundary (reachWest). The default reach of 0
+ * means that all neighbors in that direction wrap around.
  */
 template<
     typename CELL,
@@ -51,7 +58,14 @@ public:
         const long& offsetBottom = 0,
         // Z axis
         const long& offsetSouth = 0,
-        const long& offsetNorth = 0) :
+        const long& offsetNorth = 0,
+        // distance to boundaries
+        const long reachWest = 0,
+        const long reachEast = 0,
+        const long reachTop = 0,
+        const long reachBottom = 0,
+        const long reachSouth = 0,
+        const long reachNorth = 0) :
         accessor(accessor),
         tempIndex(tempIndex),
         offsetWest(offsetWest),
@@ -59,7 +73,13 @@ public:
         offsetTop(offsetTop),
         offsetBottom(offsetBottom),
         offsetSouth(offsetSouth),
-        offsetNorth(offsetNorth)
+        offsetNorth(offsetNorth),
+        reachWest(reachWest),
+        reachEast(reachEast),
+        reachTop(reachTop),
+        reachBottom(reachBottom),
+        reachSouth(reachSouth),
+        reachNorth(reachNorth)
     {}
 
     template<int X, int Y, int Z>
@@ -72,12 +92,12 @@ public:
         tempIndex =
             *tempAccessor.get_index() +
             ACCESSOR::gen_index(
-                ((X < 0) ? offsetWest   : 0) +
-                ((X > 0) ? offsetEast   : 0),
-                ((Y < 0) ? offsetTop    : 0) +
-                ((Y > 0) ? offsetBottom : 0),
-                ((Z < 0) ? offsetSouth  : 0) +
-                ((Z > 0) ? offsetNorth  : 0));
+                (((X < 0) && (-X > reachWest))   ? offsetWest   : 0) +
+                (((X > 0) && ( X > reachEast))   ? offsetEast   : 0),
+                (((Y < 0) && (-Y > reachTop))    ? offsetTop    : 0) +
+                (((Y > 0) && ( Y > reachBottom)) ? offsetBottom : 0),
+                (((Z < 0) && (-Z > reachSouth))  ? offsetSouth  : 0) +
+                (((Z > 0) && ( Z > reachNorth))  ? offsetNorth  : 0));
 
         return ACCESSOR(tempAccessor.get_data(), tempIndex);
     }
@@ -117,6 +137,12 @@ private:
     const long& offsetBottom;
     const long& offsetSouth;
     const long& offsetNorth;
+    long reachWest;
+    long reachEast;
+    long reachTop;
+    long reachBottom;
+    long reachSouth;
+    long reachNorth;
 };
 
 }
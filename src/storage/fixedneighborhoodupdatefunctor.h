@@ -14,6 +14,8 @@
 #include <libgeodecomp/storage/updatefunctormacros.h>
 #include <libgeodecomp/misc/apitraits.h>
 
+#include <algorithm>
+
 namespace LibGeoDecomp {
 
 namespace FixedNeighborhoodUpdateFunctorHelpers {
@@ -34,6 +36,7 @@ class Invoke
 {
 public:
     static const int DIM = TOPOLOGY::DIM;
+    static const int RADIUS = APITraits::SelectStencil<CELL>::Value::RADIUS;
 
     template<typename ACCESSOR1, typename ACCESSOR2, typename CONCURRENCY_FUNCTOR, typename ANY_THREADED_UPDATE>
     void operator()(
@@ -69,7 +72,7 @@ public:
 
         if ((CUR_DIM == 2) && (HIGH == true)) {
             if (TOPOLOGY::template WrapsAxis<CUR_DIM>::VALUE &&
-                (normalizedOriginOld[CUR_DIM] == ((*dimensionsOld)[CUR_DIM] - 1))) {
+                (normalizedOriginOld[CUR_DIM] >= ((*dimensionsOld)[CUR_DIM] - RADIUS))) {
                 Invoke<CELL, CUR_DIM, false, TOPOLOGY, BOUNDARY_TOP, BOUNDARY_BOTTOM, BOUNDARY_SOUTH, true>()(
                     LGD_FIXEDNEIGHBORHOODUPDATEFUNCTORHELPERS_INVOKE_PARAMS);
             } else {
@@ -80,7 +83,7 @@ public:
 
         if ((CUR_DIM == 2) && (HIGH == false)) {
             if (TOPOLOGY::template WrapsAxis<CUR_DIM>::VALUE &&
-                (normalizedOriginOld[CUR_DIM] == 0)) {
+                (normalizedOriginOld[CUR_DIM] < RADIUS)) {
                 Invoke<CELL, CUR_DIM - 1, true, TOPOLOGY, BOUNDARY_TOP, BOUNDARY_BOTTOM, true,  BOUNDARY_NORTH>()(
                     LGD_FIXEDNEIGHBORHOODUPDATEFUNCTORHELPERS_INVOKE_PARAMS);
             } else {
@@ -91,7 +94,7 @@ public:
 
         if ((CUR_DIM == 1) && (HIGH == true)) {
             if (TOPOLOGY::template WrapsAxis<CUR_DIM>::VALUE &&
-                (normalizedOriginOld[CUR_DIM] == ((*dimensionsOld)[CUR_DIM] - 1))) {
+                (normalizedOriginOld[CUR_DIM] >= ((*dimensionsOld)[CUR_DIM] - RADIUS))) {
                 Invoke<CELL, CUR_DIM, false, TOPOLOGY, BOUNDARY_TOP, true,  BOUNDARY_SOUTH, BOUNDARY_NORTH>()(
                     LGD_FIXEDNEIGHBORHOODUPDATEFUNCTORHELPERS_INVOKE_PARAMS);
             } else {
@@ -102,7 +105,7 @@ public:
 
         if ((CUR_DIM == 1) && (HIGH == false)) {
             if (TOPOLOGY::template WrapsAxis<CUR_DIM>::VALUE &&
-                (normalizedOriginOld[CUR_DIM] == 0)) {
+                (normalizedOriginOld[CUR_DIM] < RADIUS)) {
                 Invoke<CELL, CUR_DIM - 1, true, TOPOLOGY, true,  BOUNDARY_BOTTOM, BOUNDARY_SOUTH, BOUNDARY_NORTH>()(
                     LGD_FIXEDNEIGHBORHOODUPDATEFUNCTORHELPERS_INVOKE_PARAMS);
             } else {
@@ -128,6 +131,7 @@ class Invoke<CELL, 0, HIGH, TOPOLOGY, BOUNDARY_TOP, BOUNDARY_BOTTOM, BOUNDARY_SO
 {
 public:
     static const int DIM = TOPOLOGY::DIM;
+    static const int RADIUS = APITraits::SelectStencil<CELL>::Value::RADIUS;
 
     template<typename ACCESSOR1, typename ACCESSOR2, typename CONCURRENCY_FUNCTOR, typename ANY_THREADED_UPDATE>
     void operator()(
@@ -164,33 +168,48 @@ public:
 
         hoodOld.index = indexOld;
         hoodNew.index = indexNew;
-        long indexEnd = hoodOld.index + streak.length();
         long tempIndex;
 
-        long boundaryWest;
-        long boundaryEast;
-        long boundaryTop;
-        long boundaryBottom;
-        long boundarySouth;
-        long boundaryNorth;
-
-        boundaryTop    = BOUNDARY_TOP    ?  (*dimensionsNew)[1] : 0;
-        boundaryBottom = BOUNDARY_BOTTOM ? -(*dimensionsNew)[1] : 0;
-        boundarySouth  = BOUNDARY_SOUTH  ?  (*dimensionsNew)[2] : 0;
-        boundaryNorth  = BOUNDARY_NORTH  ? -(*dimensionsNew)[2] : 0;
-
-        // special case: on left boundary
-        if (TOPOLOGY::template WrapsAxis<0>::VALUE && (originOld.x() == 0)) {
-            boundaryWest   = (*dimensionsNew)[0];
-            boundaryEast   = 0;
-            if (TOPOLOGY::template WrapsAxis<0>::VALUE &&
-                ((originOld.x() + 1) == (*dimensionsNew).x())) {
-                boundaryEast   = -(*dimensionsNew)[0];
-            }
+        long boundaryTop    = BOUNDARY_TOP    ?  (*dimensionsNew)[1] : 0;
+        long boundaryBottom = BOUNDARY_BOTTOM ? -(*dimensionsNew)[1] : 0;
+        long boundarySouth  = BOUNDARY_SOUTH  ?  (*dimensionsNew)[2] : 0;
+        long boundaryNorth  = BOUNDARY_NORTH  ? -(*dimensionsNew)[2] : 0;
+
+        // for stencils with a radius > 1 not all neighbors in the
+        // direction of a nearby boundary will wrap around:
+        long reachTop    = BOUNDARY_TOP    ? originOld.y() : 0;
+        long reachBottom = BOUNDARY_BOTTOM ? (*dimensionsOld)[1] - 1 - originOld.y() : 0;
+        long reachSouth  = BOUNDARY_SOUTH  ? originOld.z() : 0;
+        long reachNorth  = BOUNDARY_NORTH  ? (*dimensionsOld)[2] - 1 - originOld.z() : 0;
+
+        const long dimX = (*dimensionsNew)[0];
+        long x = originOld.x();
+        const long xEnd = x + streak.length();
+
+        // cells in [x, westEnd) and [eastBegin, xEnd) are closer to
+        // the western/eastern boundary than the stencil's radius and
+        // are hence updated individually:
+        long westEnd = x;
+        long eastBegin = xEnd;
+        if (TOPOLOGY::template WrapsAxis<0>::VALUE) {
+            westEnd   = (std::min)(xEnd, (std::max)(x, long(RADIUS)));
+            eastBegin = (std::max)(westEnd, (std::min)(xEnd, dimX - RADIUS));
+        }
+
+        for (; x < westEnd; ++x) {
+            updateBoundaryCell(
+                x, dimX, hoodOld, hoodNew, tempIndex,
+                boundaryTop, boundaryBottom, boundarySouth, boundaryNorth,
+                reachTop, reachBottom, reachSouth, reachNorth, nanoStep);
+        }
+
+        if (x < eastBegin) {
+            long boundaryWest = 0;
+            long boundaryEast = 0;
 
             FixedNeighborhood<
                 CELL,
-                ACCESSOR1::DIM_X, ACCESSOR1::DIM_Y, ACCESSOR1::DIM_Z, 0> hoodLeft(
+                ACCESSOR1::DIM_X, ACCESSOR1::DIM_Y, ACCESSOR1::DIM_Z, 0> hood(
                     hoodOld,
                     tempIndex,
                     boundaryWest,
@@ -198,14 +217,47 @@ public:
                     boundaryTop,
                     boundaryBottom,
                     boundarySouth,
-                    boundaryNorth);
+                    boundaryNorth,
+                    0,
+                    0,
+                    reachTop,
+                    reachBottom,
+                    reachSouth,
+                    reachNorth);
+
+            long indexEnd = hoodOld.index + (eastBegin - x);
+            CELL::updateLineX(hood, indexEnd, hoodNew, nanoStep);
+            x = eastBegin;
+        }
 
-            long indexEnd = hoodOld.index + 1;
-            CELL::updateLineX(hoodLeft, indexEnd, hoodNew, nanoStep);
+        for (; x < xEnd; ++x) {
+            updateBoundaryCell(
+                x, dimX, hoodOld, hoodNew, tempIndex,
+                boundaryTop, boundaryBottom, boundarySouth, boundaryNorth,
+                reachTop, reachBottom, reachSouth, reachNorth, nanoStep);
         }
+    }
 
-        boundaryWest   = 0;
-        boundaryEast   = 0;
+private:
+    template<typename ACCESSOR1, typename ACCESSOR2>
+    void updateBoundaryCell(
+        long x,
+        long dimX,
+        ACCESSOR1& hoodOld,
+        ACCESSOR2& hoodNew,
+        long& tempIndex,
+        const long& boundaryTop,
+        const long& boundaryBottom,
+        const long& boundarySouth,
+        const long& boundaryNorth,
+        long reachTop,
+        long reachBottom,
+        long reachSouth,
+        long reachNorth,
+        int nanoStep) const
+    {
+        long boundaryWest = (x < RADIUS)           ?  dimX : 0;
+        long boundaryEast = (x >= (dimX - RADIUS)) ? -dimX : 0;
 
         FixedNeighborhood<
             CELL,
@@ -217,33 +269,16 @@ public:
                 boundaryTop,
                 boundaryBottom,
                 boundarySouth,
-                boundaryNorth);
-
-        // other special case: right boundary
-        if (TOPOLOGY::template WrapsAxis<0>::VALUE &&
-            ((originOld.x() + streak.length()) == (*dimensionsNew).x())) {
-            long indexEndRight = indexEnd - 1;
-            CELL::updateLineX(hood, indexEndRight, hoodNew, nanoStep);
-
-            boundaryWest   = 0;
-            boundaryEast   = -(*dimensionsNew)[0];
-
-            FixedNeighborhood<
-                CELL,
-                ACCESSOR1::DIM_X, ACCESSOR1::DIM_Y, ACCESSOR1::DIM_Z, 0> hoodRight(
-                    hoodOld,
-                    tempIndex,
-                    boundaryWest,
-                    boundaryEast,
-                    boundaryTop,
-                    boundaryBottom,
-                    boundarySouth,
-                    boundaryNorth);
-
-            CELL::updateLineX(hoodRight, indexEnd, hoodNew, nanoStep);
-        } else {
-            CELL::updateLineX(hood, indexEnd, hoodNew, nanoStep);
-        }
+                boundaryNorth,
+                x,
+                dimX - 1 - x,
+                reachTop,
+                reachBottom,
+                reachSouth,
+                reachNorth);
+
+        long indexEnd = hoodOld.index + 1;
+        CELL::updateLineX(hood, indexEnd, hoodNew, nanoStep);
     }
 };
 
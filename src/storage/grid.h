@@ -1,13 +1,13 @@
 #ifndef LIBGEODECOMP_STORAGE_GRID_H
 #define LIBGEODECOMP_STORAGE_GRID_H
 
-#include <libflatarray/aligned_allocator.hpp>
 #include <libgeodecomp/geometry/coord.h>
 #include <libgeodecomp/geometry/coordbox.h>
 #include <libgeodecomp/geometry/region.h>
 #include <libgeodecomp/geometry/topologies.h>
 #include <libgeodecomp/storage/coordmap.h>
 #include <libgeodecomp/storage/gridbase.h>
+#include <libgeodecomp/storage/pooledallocator.h>
 #include <libgeodecomp/storage/selector.h>
 
 namespace LibGeoDecomp {
@@ -95,8 +95,9 @@ public:
     friend class ParallelStripingSimulatorTest;
     const static int DIM = TOPOLOGY::DIM;
 
-    // always align on cache line boundaries
-    typedef typename std::vector<CELL_TYPE, LibFlatArray::aligned_allocator<CELL_TYPE, 64> > CellVector;
+    // always align on cache line boundaries, large grids obtain
+    // their memory via GridMemoryPool:
+    typedef typename std::vector<CELL_TYPE, PooledAllocator<CELL_TYPE, 64> > CellVector;
 
     typedef TOPOLOGY Topology;
     typedef CELL_TYPE Cell;
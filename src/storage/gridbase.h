@@ -5,6 +5,7 @@
 #include <libgeodecomp/geometry/coordbox.h>
 #include <libgeodecomp/geometry/region.h>
 #include <libgeodecomp/geometry/streak.h>
+#include <libgeodecomp/storage/csrmatrix.h>
 #include <libgeodecomp/storage/memorylocation.h>
 #include <libgeodecomp/storage/selector.h>
 
@@ -146,6 +147,15 @@ public:
         throw std::logic_error("edge weights cannot be set on this grid type");
     }
 
+    /**
+     * Same as above, but avoids the detour via std::map, which is
+     * prohibitively expensive for large matrices.
+     */
+    virtual void setWeights(std::size_t matrixID, const CSRMatrix<WEIGHT_TYPE>& matrix)
+    {
+        throw std::logic_error("edge weights cannot be set on this grid type");
+    }
+
 protected:
     Coord<DIM> topoDimensions;
 
@@ -0,0 +1,239 @@
+#include <libgeodecomp/storage/gridmemorypool.h>
+
+#include <libflatarray/aligned_allocator.hpp>
+
+#include <algorithm>
+#include <new>
+
+#ifndef __WIN32__
+#include <sys/mman.h>
+#endif
+
+namespace LibGeoDecomp {
+
+#ifdef LIBGEODECOMP_WITH_THREADS
+#define LIBGEODECOMP_GRIDMEMORYPOOL_LOCK boost::lock_guard<boost::mutex> lock(mutex)
+#else
+#define LIBGEODECOMP_GRIDMEMORYPOOL_LOCK
+#endif
+
+const std::size_t GridMemoryPool::PAGE_SIZE;
+const std::size_t GridMemoryPool::HUGE_PAGE_SIZE;
+const std::size_t GridMemoryPool::MIN_POOLED_BYTES;
+
+GridMemoryPool& GridMemoryPool::instance()
+{
+    // deliberately leaked: a function-static pool might be destroyed
+    // before grids held by other static objects release their memory.
+    static GridMemoryPool *pool = new GridMemoryPool();
+    return *pool;
+}
+
+GridMemoryPool::GridMemoryPool() :
+    myCachedBytes(0),
+    cacheLimit(0),
+    myHits(0),
+    myMisses(0)
+{}
+
+GridMemoryPool::~GridMemoryPool()
+{
+    release();
+}
+
+void *GridMemoryPool::allocate(std::size_t bytes)
+{
+    std::size_t capacity = roundUp(bytes);
+
+    {
+        LIBGEODECOMP_GRIDMEMORYPOOL_LOCK;
+
+        FreeBlockMap::iterator i = freeBlocks.lower_bound(capacity);
+        if ((i != freeBlocks.end()) && (i->first <= (capacity + capacity / 4))) {
+            void *block = i->second;
+            myCachedBytes -= i->first;
+            freeBlocks.erase(i);
+            ++myHits;
+
+            return block;
+        }
+    }
+
+    // mapping and touching fresh memory is expensive, so we don't
+    // hold the lock meanwhile:
+    void *block = map(capacity);
+    firstTouch(block, capacity);
+
+    LIBGEODECOMP_GRIDMEMORYPOOL_LOCK;
+    blockSizes[block] = capacity;
+    ++myMisses;
+
+    return block;
+}
+
+void GridMemoryPool::deallocate(void *block)
+{
+    if (block == 0) {
+        return;
+    }
+
+    FreeBlockMap evicted;
+
+    {
+        LIBGEODECOMP_GRIDMEMORYPOOL_LOCK;
+
+        std::size_t capacity = blockSizes[block];
+        freeBlocks.insert(std::make_pair(capacity, block));
+        myCachedBytes += capacity;
+        trim(&evicted);
+    }
+
+    unmap(evicted);
+}
+
+void GridMemoryPool::release()
+{
+    FreeBlockMap blocks;
+
+    {
+        LIBGEODECOMP_GRIDMEMORYPOOL_LOCK;
+
+        std::swap(blocks, freeBlocks);
+        for (FreeBlockMap::iterator i = blocks.begin(); i != blocks.end(); ++i) {
+            blockSizes.erase(i->second);
+        }
+        myCachedBytes = 0;
+    }
+
+    unmap(blocks);
+}
+
+void GridMemoryPool::setMaxCachedBytes(std::size_t bytes)
+{
+    FreeBlockMap evicted;
+
+    {
+        LIBGEODECOMP_GRIDMEMORYPOOL_LOCK;
+        cacheLimit = bytes;
+        trim(&evicted);
+    }
+
+    unmap(evicted);
+}
+
+std::size_t GridMemoryPool::maxCachedBytes() const
+{
+    LIBGEODECOMP_GRIDMEMORYPOOL_LOCK;
+    return cacheLimit;
+}
+
+std::size_t GridMemoryPool::cachedBytes() const
+{
+    LIBGEODECOMP_GRIDMEMORYPOOL_LOCK;
+    return myCachedBytes;
+}
+
+std::size_t GridMemoryPool::hits() const
+{
+    LIBGEODECOMP_GRIDMEMORYPOOL_LOCK;
+    return myHits;
+}
+
+std::size_t GridMemoryPool::misses() const
+{
+    LIBGEODECOMP_GRIDMEMORYPOOL_LOCK;
+    return myMisses;
+}
+
+std::size_t GridMemoryPool::roundUp(std::size_t bytes)
+{
+    std::size_t granularity = (bytes >= HUGE_PAGE_SIZE) ? HUGE_PAGE_SIZE : PAGE_SIZE;
+    return (bytes + granularity - 1) / granularity * granularity;
+}
+
+void *GridMemoryPool::map(std::size_t bytes)
+{
+#ifndef __WIN32__
+    if (bytes < HUGE_PAGE_SIZE) {
+        void *block = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (block == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+
+        return block;
+    }
+
+    // huge pages can only be used for properly aligned address
+    // ranges, so we over-allocate and trim the excess on both ends:
+    std::size_t size = bytes + HUGE_PAGE_SIZE;
+    char *chunk = static_cast<char*>(
+        mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (chunk == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+
+    std::size_t offset = reinterpret_cast<std::size_t>(chunk) % HUGE_PAGE_SIZE;
+    std::size_t head = offset ? (HUGE_PAGE_SIZE - offset) : 0;
+    std::size_t tail = size - head - bytes;
+    char *block = chunk + head;
+
+    if (head) {
+        munmap(chunk, head);
+    }
+    if (tail) {
+        munmap(block + bytes, tail);
+    }
+
+#ifdef MADV_HUGEPAGE
+    // this is only a hint, so failure is not an error:
+    madvise(block, bytes, MADV_HUGEPAGE);
+#endif
+
+    return block;
+#else
+    return LibFlatArray::aligned_allocator<char, PAGE_SIZE>().allocate(bytes);
+#endif
+}
+
+void GridMemoryPool::unmap(void *block, std::size_t bytes)
+{
+#ifndef __WIN32__
+    munmap(block, bytes);
+#else
+    LibFlatArray::aligned_allocator<char, PAGE_SIZE>().deallocate(static_cast<char*>(block), bytes);
+#endif
+}
+
+void GridMemoryPool::firstTouch(void *block, std::size_t bytes)
+{
+    char *data = static_cast<char*>(block);
+    long pages = bytes / PAGE_SIZE;
+
+#ifdef LIBGEODECOMP_WITH_THREADS
+#pragma omp parallel for schedule(static)
+#endif
+    for (long i = 0; i < pages; ++i) {
+        data[i * PAGE_SIZE] = 0;
+    }
+}
+
+void GridMemoryPool::trim(FreeBlockMap *evicted)
+{
+    // small blocks are cheaper to recreate, so we evict those first:
+    while (myCachedBytes > cacheLimit) {
+        FreeBlockMap::iterator i = freeBlocks.begin();
+        evicted->insert(*i);
+        blockSizes.erase(i->second);
+        myCachedBytes -= i->first;
+        freeBlocks.erase(i);
+    }
+}
+
+void GridMemoryPool::unmap(const FreeBlockMap& blocks)
+{
+    for (FreeBlockMap::const_iterator i = blocks.begin(); i != blocks.end(); ++i) {
+        unmap(i->second, i->first);
+    }
+}
+
+}
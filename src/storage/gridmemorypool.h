@@ -0,0 +1,131 @@
+#ifndef LIBGEODECOMP_STORAGE_GRIDMEMORYPOOL_H
+#define LIBGEODECOMP_STORAGE_GRIDMEMORYPOOL_H
+
+#include <libgeodecomp/config.h>
+
+#ifdef LIBGEODECOMP_WITH_THREADS
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#endif
+
+#include <cstddef>
+#include <map>
+
+namespace LibGeoDecomp {
+
+/**
+ * GridMemoryPool manages the large memory blocks which back grids.
+ * Simulators reallocate their grids wholesale whenever the domain is
+ * repartitioned, which would otherwise send multi-GB requests to the
+ * system allocator, followed by a page fault (and the kernel zeroing
+ * the page) for each page touched. The pool mitigates this by:
+ *
+ * - keeping freed blocks around so they can be handed out again if a
+ *   request of compatible size (same size or at most 25% smaller)
+ *   comes along, e.g. when a grid is recreated after load balancing,
+ *
+ * - requesting memory via mmap() in multiples of the huge page size
+ *   (aligned accordingly and with transparent huge pages requested
+ *   via madvise(), where available) for blocks of at least that
+ *   size,
+ *
+ * - touching fresh blocks page by page in an OpenMP parallel loop
+ *   with static scheduling, so that pages get distributed across
+ *   NUMA domains in the same way an OpenMP-parallel sweep over the
+ *   grid accesses them (first-touch policy).
+ *
+ * Caching is opt-in: by default freed blocks are returned to the OS
+ * right away, so the pool never holds on to memory the application
+ * isn't using. Call setMaxCachedBytes() to enable it; the pool then
+ * evicts the smallest blocks first once the limit is exceeded. Use
+ * PooledAllocator to attach containers to the pool.
+ */
+class GridMemoryPool
+{
+public:
+    friend class GridMemoryPoolTest;
+
+    static const std::size_t PAGE_SIZE = 4096;
+    static const std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+    /**
+     * Smaller requests aren't worth pooling and should be served by
+     * the regular allocator (PooledAllocator takes care of this).
+     */
+    static const std::size_t MIN_POOLED_BYTES = 1024 * 1024;
+
+    /**
+     * The process-wide pool used by PooledAllocator. It's never
+     * destroyed, so that grids released by other static destructors
+     * can still return their memory.
+     */
+    static GridMemoryPool& instance();
+
+    GridMemoryPool();
+
+    ~GridMemoryPool();
+
+    /**
+     * Returns a block of at least the given size, aligned to at
+     * least PAGE_SIZE.
+     */
+    void *allocate(std::size_t bytes);
+
+    /**
+     * Returns block to the pool (or to the OS, if the cache is
+     * full). block must have been obtained from allocate() of the
+     * same pool.
+     */
+    void deallocate(void *block);
+
+    /**
+     * Returns all cached blocks to the OS.
+     */
+    void release();
+
+    /**
+     * Sets the maximum number of bytes kept cached for reuse (0 by
+     * default, i.e. caching is disabled). Cached blocks exceeding the
+     * new limit are returned to the OS, smallest first.
+     */
+    void setMaxCachedBytes(std::size_t bytes);
+
+    std::size_t maxCachedBytes() const;
+
+    std::size_t cachedBytes() const;
+
+    /**
+     * Number of requests served from the cache.
+     */
+    std::size_t hits() const;
+
+    /**
+     * Number of requests which required fresh memory.
+     */
+    std::size_t misses() const;
+
+private:
+    typedef std::multimap<std::size_t, void*> FreeBlockMap;
+    typedef std::map<void*, std::size_t> BlockSizeMap;
+
+#ifdef LIBGEODECOMP_WITH_THREADS
+    mutable boost::mutex mutex;
+#endif
+    FreeBlockMap freeBlocks;
+    BlockSizeMap blockSizes;
+    std::size_t myCachedBytes;
+    std::size_t cacheLimit;
+    std::size_t myHits;
+    std::size_t myMisses;
+
+    static std::size_t roundUp(std::size_t bytes);
+    static void *map(std::size_t bytes);
+    static void unmap(void *block, std::size_t bytes);
+    static void firstTouch(void *block, std::size_t bytes);
+
+    void trim(FreeBlockMap *evicted);
+    static void unmap(const FreeBlockMap& blocks);
+};
+
+}
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef LIBGEODECOMP_STORAGE_POOLEDALLOCATOR_H
+#define LIBGEODECOMP_STORAGE_POOLEDALLOCATOR_H
+
+#include <libflatarray/aligned_allocator.hpp>
+#include <libgeodecomp/storage/gridmemorypool.h>
+
+#include <cstddef>
+#include <memory>
+
+namespace LibGeoDecomp {
+
+/**
+ * A drop-in replacement for LibFlatArray::aligned_allocator which
+ * obtains large blocks (at least GridMemoryPool::MIN_POOLED_BYTES)
+ * from GridMemoryPool::instance(), so that grid storage can be
+ * reused across repartitionings (once caching has been enabled via
+ * GridMemoryPool::setMaxCachedBytes()). Smaller blocks are delegated to
+ * aligned_allocator. Large blocks are page-aligned, so ALIGNMENT
+ * must not exceed GridMemoryPool::PAGE_SIZE.
+ */
+template<class T, std::size_t ALIGNMENT>
+class PooledAllocator
+{
+public:
+    typedef ptrdiff_t difference_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef T value_type;
+    typedef std::size_t size_type;
+    typedef LibFlatArray::aligned_allocator<T, ALIGNMENT> FallbackAllocator;
+
+    template<typename OTHER>
+    struct rebind
+    {
+        typedef PooledAllocator<OTHER, ALIGNMENT> other;
+    };
+
+    inline pointer address(reference x) const
+    {
+        return &x;
+    }
+
+    inline const_pointer address(const_reference x) const
+    {
+        return &x;
+    }
+
+    pointer allocate(std::size_t n, const void* = 0)
+    {
+        if (!pooled(n)) {
+            return FallbackAllocator().allocate(n);
+        }
+
+        return static_cast<pointer>(GridMemoryPool::instance().allocate(n * sizeof(T)));
+    }
+
+    void deallocate(pointer p, std::size_t n)
+    {
+        if (!pooled(n)) {
+            FallbackAllocator().deallocate(p, n);
+            return;
+        }
+
+        GridMemoryPool::instance().deallocate(p);
+    }
+
+    std::size_t max_size() const throw()
+    {
+        return std::allocator<T>().max_size();
+    }
+
+    void construct(pointer p, const_reference val)
+    {
+        std::allocator<T>().construct(p, val);
+    }
+
+    void construct(pointer p)
+    {
+        std::allocator<T>().construct(p, value_type());
+    }
+
+    void destroy(pointer p)
+    {
+        std::allocator<T>().destroy(p);
+    }
+
+    bool operator!=(const PooledAllocator& other) const
+    {
+        return !(*this == other);
+    }
+
+    bool operator==(const PooledAllocator& other) const
+    {
+        return true;
+    }
+
+private:
+    inline static bool pooled(std::size_t n)
+    {
+        return (n * sizeof(T)) >= GridMemoryPool::MIN_POOLED_BYTES;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef LIBGEODECOMP_STORAGE_QUANTIZINGFILTER_H
+#define LIBGEODECOMP_STORAGE_QUANTIZINGFILTER_H
+
+#include <libgeodecomp/storage/filter.h>
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace LibGeoDecomp {
+
+/**
+ * Lossy filter which maps floating point members to integers with a
+ * guaranteed absolute error bound: values are rounded to the nearest
+ * multiple of 2 * errorBound (relative to offset), so that
+ *
+ *   |x - load(save(x))| <= errorBound
+ *
+ * holds for all x whose quantized value fits into EXTERNAL. Others,
+ * including infinities, are clamped to EXTERNAL's range. NaNs have
+ * no integer representation and yield a std::invalid_argument.
+ *
+ * The resulting integers are small and highly repetitive for smooth
+ * fields, which makes them a good input for BlockCompressor or
+ * DeltaZigZagFilter-style encodings. Loading via a Selector with
+ * this filter reconstructs the quantized values.
+ */
+template<typename CELL, typename MEMBER, typename EXTERNAL = int>
+class QuantizingFilter : public Filter<CELL, MEMBER, EXTERNAL>
+{
+public:
+    explicit QuantizingFilter(double errorBound, double offset = 0) :
+        errorBound(errorBound),
+        offset(offset),
+        stepSize(2 * errorBound)
+    {
+        if (!(errorBound > 0)) {
+            throw std::invalid_argument("QuantizingFilter needs a positive error bound");
+        }
+    }
+
+    double getErrorBound() const
+    {
+        return errorBound;
+    }
+
+    void copyStreakInImpl(
+        const EXTERNAL *source,
+        MemoryLocation::Location sourceLocation,
+        MEMBER *target,
+        MemoryLocation::Location targetLocation,
+        const std::size_t num,
+        const std::size_t stride)
+    {
+        for (std::size_t i = 0; i < num; ++i) {
+            target[i] = dequantize(source[i]);
+        }
+    }
+
+    void copyStreakOutImpl(
+        const MEMBER *source,
+        MemoryLocation::Location sourceLocation,
+        EXTERNAL *target,
+        MemoryLocation::Location targetLocation,
+        const std::size_t num,
+        const std::size_t stride)
+    {
+        for (std::size_t i = 0; i < num; ++i) {
+            target[i] = quantize(source[i]);
+        }
+    }
+
+    void copyMemberInImpl(
+        const EXTERNAL *source,
+        MemoryLocation::Location sourceLocation,
+        CELL *target,
+        MemoryLocation::Location targetLocation,
+        std::size_t num,
+        MEMBER CELL:: *memberPointer)
+    {
+        for (std::size_t i = 0; i < num; ++i) {
+            target[i].*memberPointer = dequantize(source[i]);
+        }
+    }
+
+    void copyMemberOutImpl(
+        const CELL *source,
+        MemoryLocation::Location sourceLocation,
+        EXTERNAL *target,
+        MemoryLocation::Location targetLocation,
+        std::size_t num,
+        MEMBER CELL:: *memberPointer)
+    {
+        for (std::size_t i = 0; i < num; ++i) {
+            target[i] = quantize(source[i].*memberPointer);
+        }
+    }
+
+private:
+    double errorBound;
+    double offset;
+    double stepSize;
+
+    inline EXTERNAL quantize(const MEMBER& value) const
+    {
+        double q = std::floor((value - offset) / stepSize + 0.5);
+
+        // NaNs fail both range checks below, and converting them is
+        // undefined:
+        if (q != q) {
+            throw std::invalid_argument("QuantizingFilter can't quantize NaN");
+        }
+        if (q < double(std::numeric_limits<EXTERNAL>::min())) {
+            return std::numeric_limits<EXTERNAL>::min();
+        }
+        if (q > double(std::numeric_limits<EXTERNAL>::max())) {
+            return std::numeric_limits<EXTERNAL>::max();
+        }
+        return static_cast<EXTERNAL>(q);
+    }
+
+    inline MEMBER dequantize(const EXTERNAL& value) const
+    {
+        return static_cast<MEMBER>(offset + value * stepSize);
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,304 @@
+#ifndef LIBGEODECOMP_STORAGE_SELLCSIGMAENGINE_H
+#define LIBGEODECOMP_STORAGE_SELLCSIGMAENGINE_H
+
+#include <libgeodecomp/config.h>
+
+#ifdef LIBGEODECOMP_WITH_CPP14
+
+#include <libflatarray/short_vec.hpp>
+#include <libgeodecomp/io/logger.h>
+#include <libgeodecomp/misc/scopedtimer.h>
+#include <libgeodecomp/storage/sellcsigmasparsematrixcontainer.h>
+
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace LibGeoDecomp {
+
+namespace SellCSigmaEngineHelpers {
+
+/**
+ * Type-erased interface of a SpMVM kernel for one particular (C,
+ * SIGMA) combination.
+ */
+template<typename VALUETYPE>
+class Kernel
+{
+public:
+    virtual ~Kernel()
+    {}
+
+    /**
+     * lhs += A * rhs
+     */
+    virtual void multiply(const VALUETYPE *rhs, VALUETYPE *lhs) const = 0;
+
+    virtual int c() const = 0;
+
+    virtual int sigma() const = 0;
+
+    /**
+     * Number of matrix entries stored, including padding.
+     */
+    virtual std::size_t storedValues() const = 0;
+};
+
+/**
+ * Processes one chunk of C rows per iteration, with the rows mapped
+ * to the lanes of a short_vec. As C is fixed at compile time, the
+ * inner loop compiles down to a gather, a load and a multiply-add
+ * of the native vector width (or multiples thereof).
+ */
+template<typename VALUETYPE, int C, int SIGMA>
+class KernelImplementation : public Kernel<VALUETYPE>
+{
+public:
+    using ShortVec = LibFlatArray::short_vec<VALUETYPE, C>;
+    using Matrix = std::map<Coord<2>, VALUETYPE>;
+
+    KernelImplementation(const Matrix& matrix, int dimension) :
+        container(dimension)
+    {
+        container.initFromMatrix(matrix);
+    }
+
+    void multiply(const VALUETYPE *rhs, VALUETYPE *lhs) const
+    {
+        const VALUETYPE *values = container.valuesVec().data();
+        const int *columns = container.columnVec().data();
+        const int *chunkLength = container.chunkLengthVec().data();
+        const int *chunkOffset = container.chunkOffsetVec().data();
+        const int numChunks = container.chunkLengthVec().size();
+        const int dimension = container.dim();
+        VALUETYPE buffer[C];
+
+        for (int chunk = 0; chunk < numChunks; ++chunk) {
+            ShortVec sum = VALUETYPE(0);
+            ShortVec rhsVec;
+            int offset = chunkOffset[chunk];
+
+            for (int j = 0; j < chunkLength[chunk]; ++j, offset += C) {
+                // padding refers to column 0 with a weight of 0, so
+                // no need to treat it separately:
+                rhsVec.gather(rhs, columns + offset);
+                sum += ShortVec(values + offset) * rhsVec;
+            }
+
+            int firstRow = chunk * C;
+            if ((SIGMA == 1) && ((firstRow + C) <= dimension)) {
+                ShortVec result = ShortVec(lhs + firstRow) + sum;
+                result.store(lhs + firstRow);
+                continue;
+            }
+
+            // either the rows have been permuted or this is the last,
+            // partial chunk:
+            sum.store(buffer);
+            for (int i = 0; i < C; ++i) {
+                int row = (SIGMA == 1) ? (firstRow + i) : container.chunkRowToRealVec()[firstRow + i];
+                if (row < dimension) {
+                    lhs[row] += buffer[i];
+                }
+            }
+        }
+    }
+
+    int c() const
+    {
+        return C;
+    }
+
+    int sigma() const
+    {
+        return SIGMA;
+    }
+
+    std::size_t storedValues() const
+    {
+        return container.valuesVec().size();
+    }
+
+private:
+    SellCSigmaSparseMatrixContainer<VALUETYPE, C, SIGMA> container;
+};
+
+/**
+ * Outcome of benchmarking one (C, SIGMA) combination.
+ */
+class Calibration
+{
+public:
+    Calibration(int c = 0, int sigma = 0, double seconds = 0, double paddingOverhead = 0) :
+        c(c),
+        sigma(sigma),
+        seconds(seconds),
+        paddingOverhead(paddingOverhead)
+    {}
+
+    int c;
+    int sigma;
+    double seconds;
+    double paddingOverhead;
+};
+
+}
+
+/**
+ * SellCSigmaSparseMatrixContainer requires the chunk height C and the
+ * sorting scope SIGMA to be fixed at compile time, yet the best
+ * choice depends on both, the matrix' row length distribution
+ * (padding overhead) and the machine's vector width (SSE: 2 doubles,
+ * AVX: 4, AVX-512: 8). SellCSigmaEngine instantiates kernels for a
+ * range of combinations, times each of them on the actual matrix and
+ * keeps the fastest one for subsequent multiplications. The choice is
+ * logged and may be queried via format() and calibrations().
+ *
+ * VALUETYPE needs to be supported by LibFlatArray::short_vec, i.e.
+ * float or double. Only a single variant is held in memory at any
+ * time (besides the one being calibrated).
+ */
+template<typename VALUETYPE>
+class SellCSigmaEngine
+{
+public:
+    friend class SellCSigmaEngineTest;
+
+    using Matrix = std::map<Coord<2>, VALUETYPE>;
+    using Calibration = SellCSigmaEngineHelpers::Calibration;
+
+    /**
+     * matrix holds all non-zero entries of a dimension x dimension
+     * matrix, keyed by (row, column). Each variant will be timed over
+     * calibrationRuns multiplications, with the fastest run counting.
+     */
+    SellCSigmaEngine(const Matrix& matrix, int dimension, int calibrationRuns = 3) :
+        nonZeros(matrix.size()),
+        dimension(dimension),
+        bestSeconds(std::numeric_limits<double>::max())
+    {
+        calibrate<2,  1  >(matrix, calibrationRuns);
+        calibrate<2,  32 >(matrix, calibrationRuns);
+        calibrate<2,  256>(matrix, calibrationRuns);
+        calibrate<4,  1  >(matrix, calibrationRuns);
+        calibrate<4,  32 >(matrix, calibrationRuns);
+        calibrate<4,  256>(matrix, calibrationRuns);
+        calibrate<8,  1  >(matrix, calibrationRuns);
+        calibrate<8,  32 >(matrix, calibrationRuns);
+        calibrate<8,  256>(matrix, calibrationRuns);
+        calibrate<16, 1  >(matrix, calibrationRuns);
+        calibrate<16, 32 >(matrix, calibrationRuns);
+        calibrate<16, 256>(matrix, calibrationRuns);
+
+        LOG(Logger::INFO, "SellCSigmaEngine selected " << format()
+            << " with a padding overhead of " << paddingOverhead()
+            << " for a matrix of dimension " << dimension
+            << " and " << nonZeros << " non-zero entries");
+    }
+
+    /**
+     * lhs += A * rhs, both need to hold dimension elements.
+     */
+    inline void multiply(const VALUETYPE *rhs, VALUETYPE *lhs) const
+    {
+        kernel->multiply(rhs, lhs);
+    }
+
+    inline void multiply(const std::vector<VALUETYPE>& rhs, std::vector<VALUETYPE> *lhs) const
+    {
+        if ((rhs.size() != std::size_t(dimension)) || (lhs->size() != std::size_t(dimension))) {
+            throw std::invalid_argument("lhs and rhs must match the matrix' dimension");
+        }
+
+        multiply(rhs.data(), lhs->data());
+    }
+
+    inline int c() const
+    {
+        return kernel->c();
+    }
+
+    inline int sigma() const
+    {
+        return kernel->sigma();
+    }
+
+    /**
+     * Name of the selected storage format, e.g. "SELL-4-32".
+     */
+    std::string format() const
+    {
+        std::stringstream buf;
+        buf << "SELL-" << c() << "-" << sigma();
+        return buf.str();
+    }
+
+    /**
+     * Fraction of stored entries which are padding, relative to the
+     * number of non-zero entries.
+     */
+    inline double paddingOverhead() const
+    {
+        return paddingOverhead(*kernel);
+    }
+
+    inline const std::vector<Calibration>& calibrations() const
+    {
+        return myCalibrations;
+    }
+
+private:
+    boost::shared_ptr<SellCSigmaEngineHelpers::Kernel<VALUETYPE> > kernel;
+    std::vector<Calibration> myCalibrations;
+    std::size_t nonZeros;
+    int dimension;
+    double bestSeconds;
+
+    template<int C, int SIGMA>
+    void calibrate(const Matrix& matrix, int calibrationRuns)
+    {
+        boost::shared_ptr<SellCSigmaEngineHelpers::Kernel<VALUETYPE> > candidate =
+            boost::make_shared<SellCSigmaEngineHelpers::KernelImplementation<VALUETYPE, C, SIGMA> >(
+                matrix, dimension);
+
+        std::vector<VALUETYPE> rhs(dimension, 1);
+        std::vector<VALUETYPE> lhs(dimension, 0);
+        // warm-up, so all variants start with the same cache state:
+        candidate->multiply(rhs.data(), lhs.data());
+
+        double seconds = std::numeric_limits<double>::max();
+        for (int i = 0; i < calibrationRuns; ++i) {
+            double elapsed = 0;
+            {
+                ScopedTimer timer(&elapsed);
+                candidate->multiply(rhs.data(), lhs.data());
+            }
+            seconds = (std::min)(seconds, elapsed);
+        }
+
+        myCalibrations.push_back(Calibration(C, SIGMA, seconds, paddingOverhead(*candidate)));
+        if (!kernel || (seconds < bestSeconds)) {
+            bestSeconds = seconds;
+            kernel = candidate;
+        }
+    }
+
+    inline double paddingOverhead(const SellCSigmaEngineHelpers::Kernel<VALUETYPE>& candidate) const
+    {
+        if (nonZeros == 0) {
+            return 0;
+        }
+
+        return double(candidate.storedValues()) / nonZeros - 1;
+    }
+};
+
+}
+
+#endif
+#endif
@@ -7,6 +7,7 @@
 
 #include <libflatarray/aligned_allocator.hpp>
 #include <libgeodecomp/geometry/coord.h>
+#include <libgeodecomp/storage/csrmatrix.h>
 
 #include <map>
 #include <vector>
@@ -40,6 +41,43 @@ public:
     int rowIndex;
 };
 
+/**
+ * Converts a matrix given as map (keyed by (row, column)) to CSR.
+ */
+template<typename VALUETYPE>
+CSRMatrix<VALUETYPE> toCSR(std::size_t dimension, const std::map<Coord<2>, VALUETYPE>& matrix)
+{
+    std::vector<int> rowPointers(dimension + 1, 0);
+    std::vector<int> columns;
+    std::vector<VALUETYPE> values;
+    columns.reserve(matrix.size());
+    values.reserve(matrix.size());
+
+    for (const auto& pair: matrix) {
+        if ((pair.first.x() < 0) || (std::size_t(pair.first.x()) >= dimension)) {
+            throw std::invalid_argument("matrix row exceeds container dimension");
+        }
+
+        ++rowPointers[pair.first.x() + 1];
+        columns.push_back(pair.first.y());
+        values.push_back(pair.second);
+    }
+
+    for (std::size_t row = 0; row < dimension; ++row) {
+        rowPointers[row + 1] += rowPointers[row];
+    }
+
+    return CSRMatrix<VALUETYPE>(dimension, dimension, &rowPointers, &columns, &values);
+}
+
+template<typename VALUETYPE>
+void checkCSR(std::size_t dimension, const CSRMatrix<VALUETYPE>& matrix)
+{
+    if (std::size_t(matrix.rows()) > dimension) {
+        throw std::invalid_argument("matrix rows exceed container dimension");
+    }
+}
+
 /**
  * Helper class to initialize the sell container from an adjacency matrix.
  * This is a class and not a method, because there are two different implementations,
@@ -54,6 +92,13 @@ public:
 
     void operator()(SellContainer *container, const Matrix& matrix) const
     {
+        CSRMatrix<VALUETYPE> csr = toCSR(container->dimension, matrix);
+        (*this)(container, csr);
+    }
+
+    void operator()(SellContainer *container, const CSRMatrix<VALUETYPE>& matrix) const
+    {
+        checkCSR(container->dimension, matrix);
         std::vector<int> rowLengthCopy;
 
         // calculate size for arrays
@@ -82,8 +127,8 @@ public:
 
         // get row lengths
         std::fill(begin(rowLength), end(rowLength), 0);
-        for (const auto& pair: matrix) {
-            ++rowLength[pair.first.x()];
+        for (int row = 0; row < matrix.rows(); ++row) {
+            rowLength[row] = matrix.rowPointers()[row + 1] - matrix.rowPointers()[row];
         }
 
         // map sorting scope
@@ -126,20 +171,15 @@ public:
         column.resize(numberOfValues);
         std::fill(begin(values), end(values), 0);
         std::fill(begin(column), end(column), 0);
-        int currentRow = 0;
-        int index = 0;
-        for (const auto& pair: matrix) {
-            if (pair.first.x() != currentRow) {
-                currentRow = pair.first.x();
-                index = 0;
+        for (int realRow = 0; realRow < matrix.rows(); ++realRow) {
+            const int chunk = realRowToSorted[realRow] / C;
+            const int row   = realRowToSorted[realRow] % C;
+            int idx = chunkOffset[chunk] + row;
+            for (int i = matrix.rowPointers()[realRow]; i < matrix.rowPointers()[realRow + 1]; ++i) {
+                values[idx] = matrix.values()[i];
+                column[idx] = matrix.columnIndices()[i];
+                idx += C;
             }
-            const int chunk = realRowToSorted[pair.first.x()] / C;
-            const int row   = realRowToSorted[pair.first.x()] % C;
-            const int start = chunkOffset[chunk];
-            const int idx   = start + index * C + row;
-            values[idx]     = pair.second;
-            column[idx]     = pair.first.y();
-            ++index;
         }
     }
 };
@@ -156,6 +196,14 @@ public:
 
     void operator()(SellContainer *container, const Matrix& matrix) const
     {
+        CSRMatrix<VALUETYPE> csr = toCSR(container->dimension, matrix);
+        (*this)(container, csr);
+    }
+
+    void operator()(SellContainer *container, const CSRMatrix<VALUETYPE>& matrix) const
+    {
+        checkCSR(container->dimension, matrix);
+
         // calculate size for arrays
         const int matrixRows = container->dimension;
         const int numberOfChunks = (matrixRows - 1) / C + 1;
@@ -176,8 +224,8 @@ public:
 
         // get row lengths
         std::fill(begin(rowLength), end(rowLength), 0);
-        for (const auto& pair: matrix) {
-            ++rowLength[pair.first.x()];
+        for (int row = 0; row < matrix.rows(); ++row) {
+            rowLength[row] = matrix.rowPointers()[row + 1] - matrix.rowPointers()[row];
         }
 
         // save chunk lengths and offsets
@@ -198,20 +246,13 @@ public:
         column.resize(numberOfValues);
         std::fill(begin(values), end(values), 0);
         std::fill(begin(column), end(column), 0);
-        int currentRow = 0;
-        int index = 0;
-        for (const auto& pair: matrix) {
-            if (pair.first.x() != currentRow) {
-                currentRow = pair.first.x();
-                index = 0;
+        for (int realRow = 0; realRow < matrix.rows(); ++realRow) {
+            int idx = chunkOffset[realRow / C] + realRow % C;
+            for (int i = matrix.rowPointers()[realRow]; i < matrix.rowPointers()[realRow + 1]; ++i) {
+                values[idx] = matrix.values()[i];
+                column[idx] = matrix.columnIndices()[i];
+                idx += C;
             }
-            const int chunk = pair.first.x() / C;
-            const int row   = pair.first.x() % C;
-            const int start = chunkOffset[chunk];
-            const int idx   = start + index * C + row;
-            values[idx]     = pair.second;
-            column[idx]     = pair.first.y();
-            ++index;
         }
     }
 };
@@ -313,6 +354,16 @@ public:
         SellHelpers::InitFromMatrix<VALUETYPE, C, SIGMA>()(this, matrix);
     }
 
+    /**
+     * Same as above, but reads the matrix from CSR arrays. This
+     * avoids building a map for large matrices, e.g. ones read via
+     * MatrixMarketReader.
+     */
+    void initFromCSR(const CSRMatrix<VALUETYPE>& matrix)
+    {
+        SellHelpers::InitFromMatrix<VALUETYPE, C, SIGMA>()(this, matrix);
+    }
+
     inline bool operator==(const SellCSigmaSparseMatrixContainer& other) const
     {
         return ((dimension   == other.dimension)  &&
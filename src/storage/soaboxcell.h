@@ -0,0 +1,291 @@
+#ifndef LIBGEODECOMP_STORAGE_SOABOXCELL_H
+#define LIBGEODECOMP_STORAGE_SOABOXCELL_H
+
+#include <libflatarray/flat_array.hpp>
+#include <libflatarray/short_vec.hpp>
+
+#include <libgeodecomp/misc/apitraits.h>
+#include <libgeodecomp/geometry/coord.h>
+#include <libgeodecomp/geometry/coordbox.h>
+#include <libgeodecomp/geometry/floatcoord.h>
+
+namespace LibGeoDecomp {
+
+namespace SoABoxCellHelpers {
+
+/**
+ * Iterates over all particles in the surrounding boxes. As particles
+ * are stored in SoA layout, each one is converted to a Cargo object
+ * on the fly.
+ */
+template<typename CELL>
+class NeighborIterator
+{
+public:
+    typedef typename CELL::Cargo Particle;
+
+    inline NeighborIterator(const CELL *const *cells, const int box) :
+        cells(cells),
+        box(box),
+        index(0)
+    {
+        skipEmptyBoxes();
+    }
+
+    inline const Particle& operator*() const
+    {
+        return particle;
+    }
+
+    inline const Particle *operator->() const
+    {
+        return &particle;
+    }
+
+    inline void operator++()
+    {
+        ++index;
+        skipEmptyBoxes();
+    }
+
+    inline bool operator==(const NeighborIterator& other) const
+    {
+        return (box == other.box) && (index == other.index);
+    }
+
+    inline bool operator!=(const NeighborIterator& other) const
+    {
+        return !(*this == other);
+    }
+
+private:
+    const CELL *const *cells;
+    int box;
+    std::size_t index;
+    Particle particle;
+
+    inline void skipEmptyBoxes()
+    {
+        while ((box < CELL::NUM_BOXES) && (index >= cells[box]->size())) {
+            ++box;
+            index = 0;
+        }
+
+        if (box < CELL::NUM_BOXES) {
+            particle = (*cells[box])[index];
+        }
+    }
+};
+
+/**
+ * This is what particles get to see during their update: all
+ * particles of the surrounding boxes (including their own box). For
+ * scalar updates the interface matches
+ * NeighborhoodIteratorHelpers::Adapter, so particle code written for
+ * BoxCell can be reused. Batched updates (see
+ * APITraits::HasBatchedUpdate) should instead walk the SoA
+ * containers directly via box(), which yields the SoA layout required
+ * for loading short_vec lanes.
+ */
+template<typename CELL>
+class Neighbors
+{
+public:
+    typedef NeighborIterator<CELL> Iterator;
+    typedef typename CELL::Container Container;
+
+    inline Neighbors(CELL *writeContainer, const CELL *const *cells) :
+        writeContainer(writeContainer),
+        cells(cells),
+        myBegin(cells, 0),
+        myEnd(cells, CELL::NUM_BOXES)
+    {}
+
+    inline const Iterator& begin() const
+    {
+        return myBegin;
+    }
+
+    inline const Iterator& end() const
+    {
+        return myEnd;
+    }
+
+    inline int numBoxes() const
+    {
+        return CELL::NUM_BOXES;
+    }
+
+    inline const Container& box(const int i) const
+    {
+        return cells[i]->particles;
+    }
+
+    template<typename PARTICLE>
+    void operator<<(const PARTICLE& particle)
+    {
+        (*writeContainer) << particle;
+    }
+
+private:
+    CELL *writeContainer;
+    const CELL *const *cells;
+    Iterator myBegin;
+    Iterator myEnd;
+};
+
+}
+
+/**
+ * SoABoxCell is a variant of BoxCell which stores its particles in a
+ * LibFlatArray::soa_array, i.e. in "Struct of Arrays" layout with a
+ * capacity of SIZE particles. The Cargo type therefore needs to be
+ * registered via LIBFLATARRAY_REGISTER_SOA() and provide getPos().
+ *
+ * If Cargo's API derives from APITraits::HasBatchedUpdate, all
+ * particles of a box are updated by a single call to
+ * Cargo::updateBatch(), which can then process pair interactions at
+ * SIMD width -- just like updateLineX() does for regular grids.
+ * Otherwise each particle is updated by its own update(), which
+ * doesn't require any changes to particle code written for BoxCell.
+ *
+ * Unlike BoxCell, particles always observe the state of the previous
+ * time step, even in their own box. That's what makes the batched
+ * update free of dependencies between particles.
+ */
+template<typename CARGO, int SIZE>
+class SoABoxCell
+{
+public:
+    friend class SoABoxCellTest;
+    friend class SoABoxCellHelpers::Neighbors<SoABoxCell>;
+
+    typedef CARGO Cargo;
+    typedef CARGO value_type;
+    typedef LibFlatArray::soa_array<Cargo, SIZE> Container;
+    typedef LibFlatArray::soa_accessor<Cargo, SIZE, 1, 1, 0> Accessor;
+    typedef SoABoxCellHelpers::Neighbors<SoABoxCell> NeighborsType;
+    typedef typename APITraits::SelectTopology<Cargo>::Value Topology;
+
+    class API :
+        public APITraits::SelectAPI<Cargo>::Value,
+        public APITraits::HasStencil<Stencils::Moore<Topology::DIM, 1> >
+    {};
+
+    const static int DIM = Topology::DIM;
+    const static int NUM_BOXES = (DIM == 1) ? 3 : ((DIM == 2) ? 9 : 27);
+    const static int CENTER = NUM_BOXES / 2;
+
+    inline explicit SoABoxCell(
+        const FloatCoord<DIM>& origin = Coord<DIM>(),
+        const FloatCoord<DIM>& dimension = Coord<DIM>()) :
+        origin(origin),
+        dimension(dimension)
+    {}
+
+    inline void insert(const Cargo& particle)
+    {
+        particles << particle;
+    }
+
+    inline std::size_t size() const
+    {
+        return particles.size();
+    }
+
+    inline
+    Cargo operator[](const std::size_t i) const
+    {
+        return particles[i];
+    }
+
+    inline
+    SoABoxCell& operator<<(const Cargo& cargo)
+    {
+        particles << cargo;
+        return *this;
+    }
+
+    inline const Container& getParticles() const
+    {
+        return particles;
+    }
+
+    template<class HOOD>
+    inline void update(HOOD& hood, const int nanoStep)
+    {
+        const SoABoxCell *cells[NUM_BOXES];
+        CoordBox<DIM> box(Coord<DIM>::diagonal(-1), Coord<DIM>::diagonal(3));
+        int index = 0;
+        for (typename CoordBox<DIM>::Iterator i = box.begin(); i != box.end(); ++i) {
+            cells[index++] = &hood[*i];
+        }
+
+        copyOver(cells, nanoStep);
+        updateCargo(cells, nanoStep, typename APITraits::SelectBatchedUpdate<Cargo>::Value());
+    }
+
+private:
+    FloatCoord<DIM> origin;
+    FloatCoord<DIM> dimension;
+    Container particles;
+
+    inline void copyOver(const SoABoxCell *const *cells, const int nanoStep)
+    {
+        origin    = cells[CENTER]->origin;
+        dimension = cells[CENTER]->dimension;
+
+        if (nanoStep != 0) {
+            particles = cells[CENTER]->particles;
+            return;
+        }
+
+        particles = Container();
+        FloatCoord<DIM> oppositeCorner = origin + dimension;
+
+        for (int i = 0; i < NUM_BOXES; ++i) {
+            const Container& other = cells[i]->particles;
+
+            for (std::size_t j = 0; j < other.size(); ++j) {
+                Cargo particle = other[j];
+                if (APITraits::SelectPositionChecker<Cargo>::value(particle, origin, oppositeCorner)) {
+                    particles << particle;
+                }
+            }
+        }
+    }
+
+    inline void updateCargo(
+        const SoABoxCell *const *cells,
+        const int nanoStep,
+        APITraits::TrueType /* hasBatchedUpdate */)
+    {
+        NeighborsType neighbors(this, cells);
+        Accessor accessor = particles[0];
+        long i = 0;
+        // we need to fix end here so particles inserted by
+        // updateBatch() won't be immediately updated, too:
+        long end = particles.size();
+
+        Cargo::updateBatch(accessor, &i, end, neighbors, nanoStep);
+    }
+
+    inline void updateCargo(
+        const SoABoxCell *const *cells,
+        const int nanoStep,
+        APITraits::FalseType /* hasBatchedUpdate */)
+    {
+        NeighborsType neighbors(this, cells);
+        std::size_t end = particles.size();
+
+        for (std::size_t i = 0; i < end; ++i) {
+            Cargo particle = particles[i];
+            particle.update(neighbors, nanoStep);
+            particles[i] = particle;
+        }
+    }
+};
+
+}
+
+#endif
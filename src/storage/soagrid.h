@@ -381,6 +381,20 @@ public:
         return box;
     }
 
+    /**
+     * Raw access to the underlying storage (including padding), e.g.
+     * for controlling page placement on NUMA systems.
+     */
+    char *data()
+    {
+        return delegate.get_data();
+    }
+
+    std::size_t byteSize() const
+    {
+        return delegate.byte_size();
+    }
+
     template<typename FUNCTOR>
     void callback(FUNCTOR functor) const
     {
@@ -0,0 +1,103 @@
+#include <cxxtest/TestSuite.h>
+#include <libgeodecomp/geometry/region.h>
+#include <libgeodecomp/storage/deltazigzagfilter.h>
+#include <libgeodecomp/storage/grid.h>
+#include <libgeodecomp/storage/selector.h>
+
+#include <limits>
+
+using namespace LibGeoDecomp;
+
+namespace LibGeoDecomp {
+
+/**
+ * Test model with an integer state field
+ */
+class DeltaZigZagFilterTestCell
+{
+public:
+    explicit DeltaZigZagFilterTestCell(int state = 0) :
+        state(state)
+    {}
+
+    int state;
+};
+
+class DeltaZigZagFilterTest : public CxxTest::TestSuite
+{
+public:
+    void testEncoding()
+    {
+        DeltaZigZagFilter<DeltaZigZagFilterTestCell, int> filter;
+        std::vector<int> source;
+        source << 5
+               << 5
+               << 4
+               << 6
+               << std::numeric_limits<int>::min()
+               << std::numeric_limits<int>::max();
+        std::vector<int> buffer(source.size());
+
+        filter.copyStreakOut(
+            reinterpret_cast<char*>(&source[0]),
+            MemoryLocation::HOST,
+            reinterpret_cast<char*>(&buffer[0]),
+            MemoryLocation::HOST,
+            source.size(),
+            source.size());
+
+        TS_ASSERT_EQUALS(10, buffer[0]);
+        TS_ASSERT_EQUALS(0,  buffer[1]);
+        TS_ASSERT_EQUALS(1,  buffer[2]);
+        TS_ASSERT_EQUALS(4,  buffer[3]);
+
+        std::vector<int> restored(source.size());
+        filter.copyStreakIn(
+            reinterpret_cast<char*>(&buffer[0]),
+            MemoryLocation::HOST,
+            reinterpret_cast<char*>(&restored[0]),
+            MemoryLocation::HOST,
+            source.size(),
+            source.size());
+        TS_ASSERT_EQUALS(source, restored);
+    }
+
+    void testGridRoundTrip()
+    {
+        typedef DeltaZigZagFilterTestCell Cell;
+        Selector<Cell> selector(
+            &Cell::state,
+            "state",
+            boost::shared_ptr<FilterBase<Cell> >(new DeltaZigZagFilter<Cell, int, unsigned>()));
+
+        Coord<2> dim(30, 20);
+        Grid<Cell> grid(dim);
+        for (int y = 0; y < dim.y(); ++y) {
+            for (int x = 0; x < dim.x(); ++x) {
+                grid[Coord<2>(x, y)] = Cell(1000 + x / 7 - y);
+            }
+        }
+
+        Region<2> region;
+        region << CoordBox<2>(Coord<2>(2, 3), Coord<2>(25, 10))
+               << CoordBox<2>(Coord<2>(0, 15), Coord<2>(30, 5));
+
+        std::vector<unsigned> buffer(region.size());
+        grid.saveMember(&buffer[0], MemoryLocation::HOST, selector, region);
+
+        // piecewise constant streaks yield mostly zeros:
+        std::size_t zeros = 0;
+        for (std::size_t i = 0; i < buffer.size(); ++i) {
+            zeros += (buffer[i] == 0);
+        }
+        TS_ASSERT_LESS_THAN(buffer.size() * 3 / 4, zeros);
+
+        Grid<Cell> restored(dim);
+        restored.loadMember(&buffer[0], MemoryLocation::HOST, selector, region);
+        for (Region<2>::Iterator i = region.begin(); i != region.end(); ++i) {
+            TS_ASSERT_EQUALS(grid[*i].state, restored[*i].state);
+        }
+    }
+};
+
+}
@@ -89,6 +89,64 @@ public:
     double valB;
 };
 
+/**
+ * Star-shaped stencil of radius 3, neighbors are weighted by their
+ * distance so that mix-ups become visible.
+ */
+class MySoATestCellWithTwoDoublesTorusRadius3
+{
+public:
+    class API :
+          public LibGeoDecomp::APITraits::HasFixedCoordsOnlyUpdate,
+          public LibGeoDecomp::APITraits::HasUpdateLineX,
+          public LibGeoDecomp::APITraits::HasStencil<LibGeoDecomp::Stencils::VonNeumann<3, 3> >,
+          public LibGeoDecomp::APITraits::HasTorusTopology<3>,
+          public LibGeoDecomp::APITraits::HasSoA
+    {};
+
+    inline
+    explicit MySoATestCellWithTwoDoublesTorusRadius3(const double valA = 0, const double valB = 0) :
+        valA(valA),
+        valB(valB)
+    {}
+
+    template<typename NEIGHBORHOOD>
+    void update(const NEIGHBORHOOD& hood, const int nanoStep)
+    {}
+
+    template<typename HOOD_OLD, typename HOOD_NEW>
+    static void updateLineX(HOOD_OLD& hoodOld, long indexEnd,
+                            HOOD_NEW& hoodNew, long /* nanoStep */)
+    {
+        for (; hoodOld.index() < indexEnd; hoodOld += 1, hoodNew += 1) {
+            double akku =
+                3 * hoodOld[FixedCoord< 0,  0, -3>()].valA() +
+                2 * hoodOld[FixedCoord< 0,  0, -2>()].valA() +
+                1 * hoodOld[FixedCoord< 0,  0, -1>()].valA() +
+                3 * hoodOld[FixedCoord< 0, -3,  0>()].valA() +
+                2 * hoodOld[FixedCoord< 0, -2,  0>()].valA() +
+                1 * hoodOld[FixedCoord< 0, -1,  0>()].valA() +
+                3 * hoodOld[FixedCoord<-3,  0,  0>()].valA() +
+                2 * hoodOld[FixedCoord<-2,  0,  0>()].valA() +
+                1 * hoodOld[FixedCoord<-1,  0,  0>()].valA() +
+                1 * hoodOld[FixedCoord< 1,  0,  0>()].valA() +
+                2 * hoodOld[FixedCoord< 2,  0,  0>()].valA() +
+                3 * hoodOld[FixedCoord< 3,  0,  0>()].valA() +
+                1 * hoodOld[FixedCoord< 0,  1,  0>()].valA() +
+                2 * hoodOld[FixedCoord< 0,  2,  0>()].valA() +
+                3 * hoodOld[FixedCoord< 0,  3,  0>()].valA() +
+                1 * hoodOld[FixedCoord< 0,  0,  1>()].valA() +
+                2 * hoodOld[FixedCoord< 0,  0,  2>()].valA() +
+                3 * hoodOld[FixedCoord< 0,  0,  3>()].valA();
+
+            hoodNew.valB() = akku;
+        }
+    }
+
+    double valA;
+    double valB;
+};
+
 LIBFLATARRAY_REGISTER_SOA(
     MySoATestCellWithTwoDoublesTorus,
     ((double)(valA))
@@ -99,6 +157,11 @@ LIBFLATARRAY_REGISTER_SOA(
     ((double)(valA))
     ((double)(valB)))
 
+LIBFLATARRAY_REGISTER_SOA(
+    MySoATestCellWithTwoDoublesTorusRadius3,
+    ((double)(valA))
+    ((double)(valB)))
+
 
 namespace LibGeoDecomp {
 
@@ -301,6 +364,71 @@ public:
         }
     }
 
+    void testTorusWithRadius3()
+    {
+        typedef MySoATestCellWithTwoDoublesTorusRadius3 Cell;
+        CoordBox<3> box(Coord<3>(10, 20, 30), Coord<3>(40, 30, 20));
+
+        Cell defaultCell(666, 777);
+        Cell edgeCell(-1, -1);
+        SoAGrid<Cell, Topologies::Torus<3>::Topology> gridOld(box, defaultCell, edgeCell);
+        SoAGrid<Cell, Topologies::Torus<3>::Topology> gridNew(box, defaultCell, edgeCell);
+
+        for (CoordBox<3>::Iterator i = box.begin(); i != box.end(); ++i) {
+            gridOld.set(*i, Cell(i->x() + i->y() * 1000.0 + i->z() * 1000 * 1000.0));
+        }
+
+        // streaks touch all boundaries, start or end within the
+        // stencil's radius of a boundary, or do both:
+        Region<3> region;
+        region
+            << Streak<3>(Coord<3>(10, 20, 30), 50)
+            << Streak<3>(Coord<3>(11, 21, 31), 49)
+            << Streak<3>(Coord<3>(12, 22, 32), 15)
+            << Streak<3>(Coord<3>(13, 35, 40), 36)
+            << Streak<3>(Coord<3>(30, 47, 47), 18)
+            << Streak<3>(Coord<3>(47, 48, 48),  2)
+            << Streak<3>(Coord<3>(10, 49, 49), 40)
+            << Streak<3>(Coord<3>(11, 30, 40),  1);
+
+        CoordBox<3> boxNew = gridNew.boundingBox();
+        CoordBox<3> boxOld = gridOld.boundingBox();
+        Coord<3> offsetOld = -boxOld.origin;
+        Coord<3> offsetNew = -boxNew.origin;
+        Coord<3> topoDim = boxNew.dimensions;
+
+        gridOld.callback(&gridNew, FixedNeighborhoodUpdateFunctor<
+                         Cell,
+                         UpdateFunctorHelpers::ConcurrencyNoP,
+                         APITraits::SelectThreadedUpdate<void>::Value>(
+                             &region,
+                             &offsetOld,
+                             &offsetNew,
+                             &boxNew.dimensions,
+                             &boxNew.dimensions,
+                             &topoDim,
+                             0,
+                             0,
+                             0));
+
+        for (Region<3>::Iterator i = region.begin(); i != region.end(); ++i) {
+            Cell cell = gridNew.get(*i);
+
+            Coord<3> sum;
+            for (int d = 1; d <= 3; ++d) {
+                sum += normalizeTorus(*i + Coord<3>(-d,  0,  0), box) * d;
+                sum += normalizeTorus(*i + Coord<3>( d,  0,  0), box) * d;
+                sum += normalizeTorus(*i + Coord<3>( 0, -d,  0), box) * d;
+                sum += normalizeTorus(*i + Coord<3>( 0,  d,  0), box) * d;
+                sum += normalizeTorus(*i + Coord<3>( 0,  0, -d), box) * d;
+                sum += normalizeTorus(*i + Coord<3>( 0,  0,  d), box) * d;
+            }
+
+            double expected = sum.x() + sum.y() * 1000.0 + sum.z() * 1000 * 1000.0;
+            TS_ASSERT_EQUALS(cell.valB, expected);
+        }
+    }
+
     void testCube()
     {
         CoordBox<3> box(Coord<3>(10, 20, 30), Coord<3>(200, 100, 50));
@@ -0,0 +1,166 @@
+#include <libgeodecomp/storage/grid.h>
+#include <libgeodecomp/storage/gridmemorypool.h>
+#include <libgeodecomp/storage/pooledallocator.h>
+
+#include <cxxtest/TestSuite.h>
+
+using namespace LibGeoDecomp;
+
+namespace LibGeoDecomp {
+
+class GridMemoryPoolTest : public CxxTest::TestSuite
+{
+public:
+    void testReuseOfCompatibleBlocks()
+    {
+        GridMemoryPool pool;
+        pool.setMaxCachedBytes(16 * MB);
+        std::size_t size = 3 * MB + 1234;
+
+        void *block1 = pool.allocate(size);
+        pool.deallocate(block1);
+        TS_ASSERT_EQUALS(std::size_t(4 * MB), pool.cachedBytes());
+
+        // slightly smaller requests may reuse the block, too:
+        void *block2 = pool.allocate(size - 1 * MB);
+        TS_ASSERT_EQUALS(block1, block2);
+        TS_ASSERT_EQUALS(std::size_t(1), pool.hits());
+        TS_ASSERT_EQUALS(std::size_t(1), pool.misses());
+        TS_ASSERT_EQUALS(std::size_t(0), pool.cachedBytes());
+
+        pool.deallocate(block2);
+    }
+
+    void testIncompatibleBlocksAreNotReused()
+    {
+        GridMemoryPool pool;
+        pool.setMaxCachedBytes(16 * MB);
+
+        void *block1 = pool.allocate(4 * MB);
+        void *block2 = pool.allocate(8 * MB);
+        pool.deallocate(block1);
+        pool.deallocate(block2);
+
+        // too large for block1 and too small for block2:
+        void *block3 = pool.allocate(5 * MB);
+        // too small for both:
+        void *block4 = pool.allocate(1 * MB);
+        TS_ASSERT_DIFFERS(block1, block3);
+        TS_ASSERT_DIFFERS(block2, block3);
+        TS_ASSERT_DIFFERS(block1, block4);
+        TS_ASSERT_DIFFERS(block2, block4);
+        TS_ASSERT_EQUALS(std::size_t(0), pool.hits());
+        TS_ASSERT_EQUALS(std::size_t(4), pool.misses());
+
+        pool.deallocate(block3);
+        pool.deallocate(block4);
+    }
+
+    void testAlignment()
+    {
+        GridMemoryPool pool;
+
+        void *block1 = pool.allocate(1 * MB + 1);
+        void *block2 = pool.allocate(6 * MB + 1);
+        TS_ASSERT_EQUALS(std::size_t(0), reinterpret_cast<std::size_t>(block1) % GridMemoryPool::PAGE_SIZE);
+        TS_ASSERT_EQUALS(std::size_t(0), reinterpret_cast<std::size_t>(block2) % GridMemoryPool::HUGE_PAGE_SIZE);
+
+        // memory needs to be usable, of course:
+        char *data = static_cast<char*>(block2);
+        for (std::size_t i = 0; i < (6 * MB + 1); i += 1000) {
+            data[i] = i % 127;
+        }
+        TS_ASSERT_EQUALS(char(1000 % 127), data[1000]);
+
+        pool.deallocate(block1);
+        pool.deallocate(block2);
+    }
+
+    void testCacheLimit()
+    {
+        GridMemoryPool pool;
+
+        pool.setMaxCachedBytes(8 * MB);
+        void *block1 = pool.allocate(4 * MB);
+        void *block2 = pool.allocate(4 * MB);
+        pool.deallocate(block1);
+        pool.deallocate(block2);
+        TS_ASSERT_EQUALS(std::size_t(8 * MB), pool.cachedBytes());
+
+        // trimming keeps as many blocks as fit:
+        pool.setMaxCachedBytes(6 * MB);
+        TS_ASSERT_EQUALS(std::size_t(6 * MB), pool.maxCachedBytes());
+        TS_ASSERT_EQUALS(std::size_t(4 * MB), pool.cachedBytes());
+        pool.release();
+
+        block1 = pool.allocate(4 * MB);
+        block2 = pool.allocate(4 * MB);
+        pool.deallocate(block1);
+        pool.deallocate(block2);
+        TS_ASSERT_EQUALS(std::size_t(4 * MB), pool.cachedBytes());
+
+        pool.release();
+        TS_ASSERT_EQUALS(std::size_t(0), pool.cachedBytes());
+    }
+
+    void testCachingIsOptIn()
+    {
+        GridMemoryPool pool;
+        TS_ASSERT_EQUALS(std::size_t(0), pool.maxCachedBytes());
+
+        void *block = pool.allocate(4 * MB);
+        pool.deallocate(block);
+        TS_ASSERT_EQUALS(std::size_t(0), pool.cachedBytes());
+
+        block = pool.allocate(4 * MB);
+        pool.deallocate(block);
+        TS_ASSERT_EQUALS(std::size_t(0), pool.hits());
+        TS_ASSERT_EQUALS(std::size_t(2), pool.misses());
+    }
+
+    void testPooledAllocatorDelegatesSmallBlocks()
+    {
+        GridMemoryPool& pool = GridMemoryPool::instance();
+        std::size_t misses = pool.misses();
+        std::size_t hits = pool.hits();
+
+        PooledAllocator<double, 64> allocator;
+        double *data = allocator.allocate(100);
+        TS_ASSERT_EQUALS(std::size_t(0), reinterpret_cast<std::size_t>(data) % 64);
+        allocator.deallocate(data, 100);
+
+        TS_ASSERT_EQUALS(misses, pool.misses());
+        TS_ASSERT_EQUALS(hits, pool.hits());
+    }
+
+    void testGridsRecycleMemory()
+    {
+        GridMemoryPool& pool = GridMemoryPool::instance();
+        Coord<2> dim(1024, 768);
+        const double *data1;
+        const double *data2;
+        // other tests may have left blocks of similar size behind:
+        pool.release();
+        pool.setMaxCachedBytes(16 * MB);
+        std::size_t hits = pool.hits();
+
+        {
+            Grid<double> grid(dim, 1.5);
+            data1 = &grid[Coord<2>()];
+        }
+        {
+            Grid<double> grid(dim, 2.5);
+            data2 = &grid[Coord<2>()];
+            TS_ASSERT_EQUALS(2.5, grid[Coord<2>(1023, 767)]);
+        }
+
+        TS_ASSERT_EQUALS(data1, data2);
+        TS_ASSERT_EQUALS(hits + 1, pool.hits());
+        pool.setMaxCachedBytes(0);
+    }
+
+private:
+    static const std::size_t MB = 1024 * 1024;
+};
+
+}
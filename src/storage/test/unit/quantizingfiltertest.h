@@ -0,0 +1,114 @@
+#include <cxxtest/TestSuite.h>
+#include <libgeodecomp/misc/testcell.h>
+#include <libgeodecomp/storage/quantizingfilter.h>
+#include <libgeodecomp/storage/selector.h>
+
+using namespace LibGeoDecomp;
+
+namespace LibGeoDecomp {
+
+class QuantizingFilterTest : public CxxTest::TestSuite
+{
+public:
+    void testErrorBound()
+    {
+        double errorBound = 0.001;
+        Selector<TestCell<2> > selector(
+            &TestCell<2>::testValue,
+            "testValue",
+            boost::shared_ptr<FilterBase<TestCell<2> > >(
+                new QuantizingFilter<TestCell<2>, double>(errorBound, 100)));
+        TS_ASSERT_EQUALS("INT", selector.typeName());
+        TS_ASSERT_EQUALS(sizeof(int), selector.sizeOfExternal());
+
+        std::vector<TestCell<2> > cells(1000);
+        for (std::size_t i = 0; i < cells.size(); ++i) {
+            cells[i].testValue = 100 + std::sin(i * 0.01) * 3;
+        }
+
+        std::vector<int> buffer(cells.size());
+        selector.copyMemberOut(
+            &cells[0], MemoryLocation::HOST, reinterpret_cast<char*>(&buffer[0]), MemoryLocation::HOST, cells.size());
+        TS_ASSERT_EQUALS(0,     buffer[0]);
+        TS_ASSERT_EQUALS(1500,  buffer[157]);
+        TS_ASSERT_EQUALS(-1500, buffer[471]);
+
+        std::vector<TestCell<2> > restored(cells.size());
+        selector.copyMemberIn(
+            reinterpret_cast<char*>(&buffer[0]), MemoryLocation::HOST, &restored[0], MemoryLocation::HOST, cells.size());
+        for (std::size_t i = 0; i < cells.size(); ++i) {
+            TS_ASSERT_LESS_THAN_EQUALS(std::abs(cells[i].testValue - restored[i].testValue), errorBound * 1.000001);
+        }
+    }
+
+    void testStreaksAndClamping()
+    {
+        QuantizingFilter<TestCell<2>, double, short> filter(0.5);
+        std::vector<double> source;
+        source << -1.2
+               << 0.49
+               << 0.51
+               << 1e9
+               << -1e9;
+        std::vector<short> buffer(source.size());
+
+        filter.copyStreakOut(
+            reinterpret_cast<char*>(&source[0]),
+            MemoryLocation::HOST,
+            reinterpret_cast<char*>(&buffer[0]),
+            MemoryLocation::HOST,
+            source.size(),
+            source.size());
+        TS_ASSERT_EQUALS(-1,    buffer[0]);
+        TS_ASSERT_EQUALS(0,     buffer[1]);
+        TS_ASSERT_EQUALS(1,     buffer[2]);
+        TS_ASSERT_EQUALS(32767,  buffer[3]);
+        TS_ASSERT_EQUALS(-32768, buffer[4]);
+
+        std::vector<double> restored(source.size());
+        filter.copyStreakIn(
+            reinterpret_cast<char*>(&buffer[0]),
+            MemoryLocation::HOST,
+            reinterpret_cast<char*>(&restored[0]),
+            MemoryLocation::HOST,
+            source.size(),
+            source.size());
+        TS_ASSERT_EQUALS(-1.0, restored[0]);
+        TS_ASSERT_EQUALS( 0.0, restored[1]);
+        TS_ASSERT_EQUALS( 1.0, restored[2]);
+
+        TS_ASSERT_THROWS((QuantizingFilter<TestCell<2>, double>(0)), std::invalid_argument&);
+    }
+
+    void testNonFiniteValues()
+    {
+        QuantizingFilter<TestCell<2>, double, short> filter(0.5);
+        std::vector<double> source;
+        source << std::numeric_limits<double>::infinity()
+               << -std::numeric_limits<double>::infinity();
+        std::vector<short> buffer(source.size());
+
+        filter.copyStreakOut(
+            reinterpret_cast<char*>(&source[0]),
+            MemoryLocation::HOST,
+            reinterpret_cast<char*>(&buffer[0]),
+            MemoryLocation::HOST,
+            source.size(),
+            source.size());
+        TS_ASSERT_EQUALS(32767,  buffer[0]);
+        TS_ASSERT_EQUALS(-32768, buffer[1]);
+
+        source[1] = std::numeric_limits<double>::quiet_NaN();
+        TS_ASSERT_THROWS(
+            filter.copyStreakOut(
+                reinterpret_cast<char*>(&source[0]),
+                MemoryLocation::HOST,
+                reinterpret_cast<char*>(&buffer[0]),
+                MemoryLocation::HOST,
+                source.size(),
+                source.size()),
+            std::invalid_argument&);
+    }
+};
+
+}
@@ -0,0 +1,150 @@
+#include <libgeodecomp/config.h>
+#include <libgeodecomp/misc/random.h>
+#include <libgeodecomp/storage/sellcsigmaengine.h>
+
+#include <cxxtest/TestSuite.h>
+
+using namespace LibGeoDecomp;
+
+namespace LibGeoDecomp {
+
+class SellCSigmaEngineTest : public CxxTest::TestSuite
+{
+public:
+#ifdef LIBGEODECOMP_WITH_CPP14
+    using Matrix = std::map<Coord<2>, double>;
+#endif
+
+    void testAllVariantsMatchReference()
+    {
+#ifdef LIBGEODECOMP_WITH_CPP14
+        // 37 isn't a multiple of any C, so the last chunk is partial:
+        const int dimension = 37;
+        Matrix matrix = createMatrix(dimension);
+        std::vector<double> expected = reference(matrix, dimension);
+
+        checkVariant<2,  1  >(matrix, dimension, expected);
+        checkVariant<2,  32 >(matrix, dimension, expected);
+        checkVariant<4,  1  >(matrix, dimension, expected);
+        checkVariant<4,  32 >(matrix, dimension, expected);
+        checkVariant<8,  1  >(matrix, dimension, expected);
+        checkVariant<8,  256>(matrix, dimension, expected);
+        checkVariant<16, 1  >(matrix, dimension, expected);
+        checkVariant<16, 32 >(matrix, dimension, expected);
+#endif
+    }
+
+    void testEngineSelectsFastestVariant()
+    {
+#ifdef LIBGEODECOMP_WITH_CPP14
+        const int dimension = 1000;
+        Matrix matrix = createMatrix(dimension);
+        SellCSigmaEngine<double> engine(matrix, dimension, 2);
+
+        TS_ASSERT_EQUALS(std::size_t(12), engine.calibrations().size());
+        double fastest = engine.calibrations()[0].seconds;
+        for (std::size_t i = 0; i < engine.calibrations().size(); ++i) {
+            fastest = (std::min)(fastest, engine.calibrations()[i].seconds);
+        }
+
+        bool found = false;
+        for (std::size_t i = 0; i < engine.calibrations().size(); ++i) {
+            const SellCSigmaEngine<double>::Calibration& calibration = engine.calibrations()[i];
+            if ((calibration.c == engine.c()) && (calibration.sigma == engine.sigma())) {
+                TS_ASSERT_EQUALS(fastest, calibration.seconds);
+                TS_ASSERT_EQUALS(calibration.paddingOverhead, engine.paddingOverhead());
+                found = true;
+            }
+        }
+        TS_ASSERT(found);
+
+        std::stringstream buf;
+        buf << "SELL-" << engine.c() << "-" << engine.sigma();
+        TS_ASSERT_EQUALS(buf.str(), engine.format());
+
+        std::vector<double> rhs(dimension);
+        for (int i = 0; i < dimension; ++i) {
+            rhs[i] = i % 7;
+        }
+        std::vector<double> lhs(dimension, 0);
+        engine.multiply(rhs, &lhs);
+        std::vector<double> expected = reference(matrix, dimension);
+        for (int i = 0; i < dimension; ++i) {
+            TS_ASSERT_DELTA(expected[i], lhs[i], 1e-9);
+        }
+
+        std::vector<double> tooShort(dimension - 1);
+        TS_ASSERT_THROWS(engine.multiply(rhs, &tooShort), std::invalid_argument&);
+#endif
+    }
+
+    void testSortingReducesPadding()
+    {
+#ifdef LIBGEODECOMP_WITH_CPP14
+        // one long row per chunk of 8 rows, but rows of similar
+        // length are neighbors within a sorting scope of 32:
+        const int dimension = 64;
+        Matrix matrix;
+        for (int row = 0; row < dimension; ++row) {
+            int length = (row % 8 == 0) ? 20 : 1;
+            for (int i = 0; i < length; ++i) {
+                matrix[Coord<2>(row, (row + i) % dimension)] = 1;
+            }
+        }
+
+        SellCSigmaEngineHelpers::KernelImplementation<double, 8, 1> unsorted(matrix, dimension);
+        SellCSigmaEngineHelpers::KernelImplementation<double, 8, 32> sorted(matrix, dimension);
+        TS_ASSERT_EQUALS(std::size_t(64 * 20), unsorted.storedValues());
+        TS_ASSERT_EQUALS(std::size_t(16 * 20 + 48), sorted.storedValues());
+#endif
+    }
+
+private:
+#ifdef LIBGEODECOMP_WITH_CPP14
+    Matrix createMatrix(int dimension)
+    {
+        Random::seed(4711);
+        Matrix matrix;
+
+        for (int row = 0; row < dimension; ++row) {
+            // row lengths vary widely so that padding matters:
+            int length = 1 + Random::gen_u(row % 5 == 0 ? 40 : 5);
+            for (int i = 0; i < length; ++i) {
+                matrix[Coord<2>(row, Random::gen_u(dimension))] = Random::gen_d(2.0) - 1.0;
+            }
+        }
+
+        return matrix;
+    }
+
+    std::vector<double> reference(const Matrix& matrix, int dimension)
+    {
+        std::vector<double> ret(dimension, 0);
+        for (Matrix::const_iterator i = matrix.begin(); i != matrix.end(); ++i) {
+            ret[i->first.x()] += i->second * (i->first.y() % 7);
+        }
+
+        return ret;
+    }
+
+    template<int C, int SIGMA>
+    void checkVariant(const Matrix& matrix, int dimension, const std::vector<double>& expected)
+    {
+        SellCSigmaEngineHelpers::KernelImplementation<double, C, SIGMA> kernel(matrix, dimension);
+        std::vector<double> rhs(dimension);
+        for (int i = 0; i < dimension; ++i) {
+            rhs[i] = i % 7;
+        }
+
+        // the kernel accumulates, so we start with an offset:
+        std::vector<double> lhs(dimension, 1.0);
+        kernel.multiply(rhs.data(), lhs.data());
+
+        for (int i = 0; i < dimension; ++i) {
+            TS_ASSERT_DELTA(expected[i] + 1.0, lhs[i], 1e-9);
+        }
+    }
+#endif
+};
+
+}
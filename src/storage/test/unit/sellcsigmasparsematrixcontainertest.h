@@ -1022,6 +1022,40 @@ public:
         TS_ASSERT(col[11] == 0);
         TS_ASSERT(col[12] == 2);
         TS_ASSERT(col[13] == 0);
+#endif
+    }
+
+    void testInitFromCSRMatchesInitFromMatrix()
+    {
+#ifdef LIBGEODECOMP_WITH_CPP14
+        std::map<Coord<2>, double> matrix;
+        for (int row = 0; row < 13; ++row) {
+            for (int i = 0; i < (row * 7 % 5); ++i) {
+                matrix[Coord<2>(row, (row * 3 + i * 5) % 13)] = row + 0.5 * i;
+            }
+        }
+
+        CSRMatrix<double> csr = SellHelpers::toCSR(13, matrix);
+        TS_ASSERT_EQUALS(matrix, csr.toMap());
+
+        SellCSigmaSparseMatrixContainer<double, 4, 8> a(13);
+        SellCSigmaSparseMatrixContainer<double, 4, 8> b(13);
+        a.initFromMatrix(matrix);
+        b.initFromCSR(csr);
+        TS_ASSERT_EQUALS(a, b);
+        TS_ASSERT_EQUALS(a.realRowToSortedVec(), b.realRowToSortedVec());
+        TS_ASSERT_EQUALS(a.chunkRowToRealVec(),  b.chunkRowToRealVec());
+        TS_ASSERT_EQUALS(a.rowLengthVec(),       b.rowLengthVec());
+
+        SellCSigmaSparseMatrixContainer<double, 2, 1> c(13);
+        SellCSigmaSparseMatrixContainer<double, 2, 1> d(13);
+        c.initFromMatrix(matrix);
+        d.initFromCSR(csr);
+        TS_ASSERT_EQUALS(c, d);
+        TS_ASSERT_EQUALS(c.rowLengthVec(), d.rowLengthVec());
+
+        SellCSigmaSparseMatrixContainer<double, 2, 1> tooSmall(12);
+        TS_ASSERT_THROWS(tooSmall.initFromCSR(csr), std::invalid_argument&);
 #endif
     }
 };
@@ -0,0 +1,318 @@
+#include <libgeodecomp/geometry/region.h>
+#include <libgeodecomp/storage/grid.h>
+#include <libgeodecomp/storage/soaboxcell.h>
+#include <libgeodecomp/storage/updatefunctor.h>
+
+#include <cmath>
+#include <cxxtest/TestSuite.h>
+#include <map>
+
+using namespace LibGeoDecomp;
+
+namespace LibGeoDecomp {
+
+/**
+ * Moves according to a softened gravitational pull of all particles
+ * in the surrounding boxes. API_BASE selects whether the particles
+ * are updated one by one or in batches.
+ */
+template<typename API_BASE>
+class GravityParticle
+{
+public:
+    class API :
+        public API_BASE,
+        public APITraits::HasCubeTopology<2>
+    {};
+
+    explicit GravityParticle(
+        const int id = 0,
+        const FloatCoord<2>& pos = FloatCoord<2>(),
+        const FloatCoord<2>& vel = FloatCoord<2>()) :
+        posX(pos[0]),
+        posY(pos[1]),
+        velX(vel[0]),
+        velY(vel[1]),
+        id(id)
+    {}
+
+    template<typename HOOD>
+    inline void update(const HOOD& hood, const int nanoStep)
+    {
+        double forceX = 0;
+        double forceY = 0;
+
+        for (typename HOOD::Iterator i = hood.begin(); i != hood.end(); ++i) {
+            double deltaX = i->posX - posX;
+            double deltaY = i->posY - posY;
+            double r2 = deltaX * deltaX + deltaY * deltaY + softening();
+            double scale = gravity() / (r2 * std::sqrt(r2));
+            forceX += deltaX * scale;
+            forceY += deltaY * scale;
+        }
+
+        velX += forceX;
+        velY += forceY;
+        posX += velX;
+        posY += velY;
+    }
+
+    template<typename ACCESSOR, typename NEIGHBORS>
+    static void updateBatch(ACCESSOR& particles, long *i, long end, const NEIGHBORS& neighbors, const int nanoStep)
+    {
+        LIBFLATARRAY_LOOP_PEELER(double, 4, long, i, end, updateBatchImplementation, particles, neighbors, nanoStep);
+    }
+
+    template<typename DOUBLE, typename ACCESSOR, typename NEIGHBORS>
+    static void updateBatchImplementation(
+        long *i,
+        long end,
+        ACCESSOR& particles,
+        const NEIGHBORS& neighbors,
+        const int /* nanoStep */)
+    {
+        for (; *i < (end - DOUBLE::ARITY + 1); *i += DOUBLE::ARITY) {
+            DOUBLE posX = &particles.posX() + *i;
+            DOUBLE posY = &particles.posY() + *i;
+            DOUBLE forceX = 0.0;
+            DOUBLE forceY = 0.0;
+
+            for (int b = 0; b < neighbors.numBoxes(); ++b) {
+                const typename NEIGHBORS::Container& box = neighbors.box(b);
+
+                for (std::size_t j = 0; j < box.size(); ++j) {
+                    DOUBLE deltaX = DOUBLE(box[j].posX()) - posX;
+                    DOUBLE deltaY = DOUBLE(box[j].posY()) - posY;
+                    DOUBLE r2 = deltaX * deltaX + deltaY * deltaY + DOUBLE(softening());
+                    DOUBLE scale = DOUBLE(gravity()) / (r2 * sqrt(r2));
+                    forceX += deltaX * scale;
+                    forceY += deltaY * scale;
+                }
+            }
+
+            DOUBLE velX = &particles.velX() + *i;
+            DOUBLE velY = &particles.velY() + *i;
+            velX += forceX;
+            velY += forceY;
+            posX += velX;
+            posY += velY;
+
+            &particles.posX() + *i << posX;
+            &particles.posY() + *i << posY;
+            &particles.velX() + *i << velX;
+            &particles.velY() + *i << velY;
+        }
+    }
+
+    inline FloatCoord<2> getPos() const
+    {
+        return FloatCoord<2>(posX, posY);
+    }
+
+    double posX;
+    double posY;
+    double velX;
+    double velY;
+    int id;
+
+private:
+    static double softening()
+    {
+        return 0.1;
+    }
+
+    static double gravity()
+    {
+        return 0.001;
+    }
+};
+
+class ScalarAPI
+{};
+
+typedef GravityParticle<ScalarAPI> ScalarParticle;
+typedef GravityParticle<APITraits::HasBatchedUpdate> BatchedParticle;
+
+}
+
+LIBFLATARRAY_REGISTER_SOA(
+    LibGeoDecomp::ScalarParticle,
+    ((double)(posX))((double)(posY))((double)(velX))((double)(velY))((int)(id)))
+
+LIBFLATARRAY_REGISTER_SOA(
+    LibGeoDecomp::BatchedParticle,
+    ((double)(posX))((double)(posY))((double)(velX))((double)(velY))((int)(id)))
+
+namespace LibGeoDecomp {
+
+class SoABoxCellTest : public CxxTest::TestSuite
+{
+public:
+    typedef SoABoxCell<ScalarParticle, 40> ScalarCellType;
+    typedef SoABoxCell<BatchedParticle, 40> BatchedCellType;
+
+    void setUp()
+    {
+        gridDim = Coord<2>(7, 6);
+        boxDim = FloatCoord<2>(1.0, 1.0);
+    }
+
+    void testInsertAndAccess()
+    {
+        BatchedCellType cell(FloatCoord<2>(1, 2), boxDim);
+        TS_ASSERT_EQUALS(std::size_t(0), cell.size());
+
+        cell << BatchedParticle(5, FloatCoord<2>(1.5, 2.5), FloatCoord<2>(0.1, 0.2));
+        cell.insert(BatchedParticle(6, FloatCoord<2>(1.25, 2.75)));
+        TS_ASSERT_EQUALS(std::size_t(2), cell.size());
+        TS_ASSERT_EQUALS(5, cell[0].id);
+        TS_ASSERT_EQUALS(FloatCoord<2>(1.5, 2.5), cell[0].getPos());
+        TS_ASSERT_EQUALS(0.2, cell[0].velY);
+        TS_ASSERT_EQUALS(6, cell[1].id);
+        TS_ASSERT_EQUALS(1.25, cell.getParticles()[1].posX());
+    }
+
+    void testBatchedUpdateMatchesScalarUpdate()
+    {
+        Grid<ScalarCellType> scalarGrid1 = makeGrid<ScalarCellType>();
+        Grid<ScalarCellType> scalarGrid2 = scalarGrid1;
+        Grid<BatchedCellType> batchedGrid1 = makeGrid<BatchedCellType>();
+        Grid<BatchedCellType> batchedGrid2 = batchedGrid1;
+        std::map<int, Coord<2> > initialBoxes = locate(batchedGrid1);
+        int numParticles = initialBoxes.size();
+
+        for (int t = 0; t < 10; ++t) {
+            step(&scalarGrid1, &scalarGrid2);
+            step(&batchedGrid1, &batchedGrid2);
+
+            std::map<int, ScalarParticle> expected = collect(scalarGrid1);
+            std::map<int, BatchedParticle> actual = collect(batchedGrid1);
+            TS_ASSERT_EQUALS(std::size_t(numParticles), expected.size());
+            TS_ASSERT_EQUALS(std::size_t(numParticles), actual.size());
+
+            for (std::map<int, ScalarParticle>::iterator i = expected.begin(); i != expected.end(); ++i) {
+                const BatchedParticle& particle = actual[i->first];
+                TS_ASSERT_DELTA(i->second.posX, particle.posX, 1e-12);
+                TS_ASSERT_DELTA(i->second.posY, particle.posY, 1e-12);
+                TS_ASSERT_DELTA(i->second.velX, particle.velX, 1e-12);
+                TS_ASSERT_DELTA(i->second.velY, particle.velY, 1e-12);
+            }
+        }
+
+        // particles should have been handed over to neighboring
+        // boxes while moving:
+        std::map<int, Coord<2> > finalBoxes = locate(batchedGrid1);
+        int migrated = 0;
+        for (std::map<int, Coord<2> >::iterator i = initialBoxes.begin(); i != initialBoxes.end(); ++i) {
+            if (finalBoxes[i->first] != i->second) {
+                ++migrated;
+            }
+        }
+        TS_ASSERT_LESS_THAN(0, migrated);
+    }
+
+    void testPairInteraction()
+    {
+        Grid<BatchedCellType> grid1(gridDim);
+        initCells(&grid1);
+        grid1[Coord<2>(2, 2)] << BatchedParticle(1, FloatCoord<2>(2.5, 2.5));
+        grid1[Coord<2>(3, 2)] << BatchedParticle(2, FloatCoord<2>(3.5, 2.5));
+        Grid<BatchedCellType> grid2 = grid1;
+
+        step(&grid1, &grid2);
+
+        // softening = 0.1, gravity = 0.001:
+        double velocity = 0.001 / (1.1 * std::sqrt(1.1));
+        std::map<int, BatchedParticle> particles = collect(grid1);
+        TS_ASSERT_DELTA( velocity,      particles[1].velX, 1e-15);
+        TS_ASSERT_DELTA(-velocity,      particles[2].velX, 1e-15);
+        TS_ASSERT_DELTA(2.5 + velocity, particles[1].posX, 1e-15);
+        TS_ASSERT_DELTA(3.5 - velocity, particles[2].posX, 1e-15);
+        TS_ASSERT_EQUALS(0.0, particles[1].velY);
+    }
+
+private:
+    Coord<2> gridDim;
+    FloatCoord<2> boxDim;
+
+    template<typename CELL>
+    void initCells(Grid<CELL> *grid)
+    {
+        CoordBox<2> box(Coord<2>(), gridDim);
+        for (CoordBox<2>::Iterator i = box.begin(); i != box.end(); ++i) {
+            (*grid)[*i] = CELL(boxDim.scale(*i), boxDim);
+        }
+    }
+
+    /**
+     * Places 7 particles in each inner box, so batched updates
+     * exercise both, the vectorized loop and the scalar remainder.
+     * The outermost boxes remain empty, so no particle leaves the
+     * grid.
+     */
+    template<typename CELL>
+    Grid<CELL> makeGrid()
+    {
+        typedef typename CELL::Cargo Particle;
+
+        Grid<CELL> grid(gridDim);
+        initCells(&grid);
+        CoordBox<2> box(Coord<2>::diagonal(1), gridDim - Coord<2>::diagonal(2));
+        int id = 0;
+
+        for (CoordBox<2>::Iterator i = box.begin(); i != box.end(); ++i) {
+            FloatCoord<2> origin = boxDim.scale(*i);
+
+            for (int j = 0; j < 7; ++j) {
+                FloatCoord<2> pos = origin + FloatCoord<2>(0.1 + 0.13 * j, 0.9 - 0.11 * j);
+                FloatCoord<2> vel(0.03 * ((j % 3) - 1), 0.045 * ((j % 2) - 0.5));
+                grid[*i] << Particle(++id, pos, vel);
+            }
+        }
+
+        return grid;
+    }
+
+    template<typename CELL>
+    void step(Grid<CELL> *grid1, Grid<CELL> *grid2)
+    {
+        Region<2> region;
+        region << CoordBox<2>(Coord<2>(), gridDim);
+
+        UpdateFunctor<CELL>()(region, Coord<2>(), Coord<2>(), *grid1, grid2, 0);
+        std::swap(*grid1, *grid2);
+    }
+
+    template<typename CELL>
+    std::map<int, typename CELL::Cargo> collect(const Grid<CELL>& grid)
+    {
+        std::map<int, typename CELL::Cargo> ret;
+        CoordBox<2> box(Coord<2>(), gridDim);
+
+        for (CoordBox<2>::Iterator i = box.begin(); i != box.end(); ++i) {
+            for (std::size_t j = 0; j < grid[*i].size(); ++j) {
+                typename CELL::Cargo particle = grid[*i][j];
+                ret[particle.id] = particle;
+            }
+        }
+
+        return ret;
+    }
+
+    template<typename CELL>
+    std::map<int, Coord<2> > locate(const Grid<CELL>& grid)
+    {
+        std::map<int, Coord<2> > ret;
+        CoordBox<2> box(Coord<2>(), gridDim);
+
+        for (CoordBox<2>::Iterator i = box.begin(); i != box.end(); ++i) {
+            for (std::size_t j = 0; j < grid[*i].size(); ++j) {
+                ret[grid[*i][j].id] = *i;
+            }
+        }
+
+        return ret;
+    }
+};
+
+}
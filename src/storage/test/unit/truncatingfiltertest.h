@@ -0,0 +1,81 @@
+#include <cxxtest/TestSuite.h>
+#include <libgeodecomp/misc/testcell.h>
+#include <libgeodecomp/storage/selector.h>
+#include <libgeodecomp/storage/truncatingfilter.h>
+
+#include <limits>
+
+using namespace LibGeoDecomp;
+
+namespace LibGeoDecomp {
+
+class TruncatingFilterTest : public CxxTest::TestSuite
+{
+public:
+    void testRelativeError()
+    {
+        TruncatingFilter<TestCell<2>, double> *filter = new TruncatingFilter<TestCell<2>, double>(10);
+        TS_ASSERT_EQUALS(std::ldexp(1.0, -11), filter->relativeErrorBound());
+        Selector<TestCell<2> > selector(
+            &TestCell<2>::testValue,
+            "testValue",
+            boost::shared_ptr<FilterBase<TestCell<2> > >(filter));
+        TS_ASSERT_EQUALS("DOUBLE", selector.typeName());
+
+        std::vector<TestCell<2> > cells(500);
+        for (std::size_t i = 0; i < cells.size(); ++i) {
+            cells[i].testValue = (i * 1.2345e-3 - 0.3) * std::pow(10.0, int(i % 7) - 3);
+        }
+
+        std::vector<double> buffer(cells.size());
+        selector.copyMemberOut(
+            &cells[0], MemoryLocation::HOST, reinterpret_cast<char*>(&buffer[0]), MemoryLocation::HOST, cells.size());
+
+        for (std::size_t i = 0; i < cells.size(); ++i) {
+            double expected = cells[i].testValue;
+            TS_ASSERT_LESS_THAN_EQUALS(std::abs(buffer[i] - expected), std::abs(expected) * std::ldexp(1.0, -11));
+
+            // only the 10 upper mantissa bits may be set:
+            boost::uint64_t bits;
+            std::memcpy(&bits, &buffer[i], sizeof(double));
+            TS_ASSERT_EQUALS(0u, bits & ((boost::uint64_t(1) << 42) - 1));
+        }
+    }
+
+    void testSpecialValues()
+    {
+        TruncatingFilter<TestCell<2>, float> filter(3);
+        std::vector<float> source;
+        source << 1.0f
+               << 1.0624f
+               << 1.0626f
+               << 1.9999f
+               << -0.0f
+               << std::numeric_limits<float>::infinity()
+               << std::numeric_limits<float>::max();
+        std::vector<float> buffer(source.size());
+
+        filter.copyStreakOut(
+            reinterpret_cast<char*>(&source[0]),
+            MemoryLocation::HOST,
+            reinterpret_cast<char*>(&buffer[0]),
+            MemoryLocation::HOST,
+            source.size(),
+            source.size());
+
+        TS_ASSERT_EQUALS(1.0f,   buffer[0]);
+        TS_ASSERT_EQUALS(1.0f,   buffer[1]);
+        TS_ASSERT_EQUALS(1.125f, buffer[2]);
+        // rounding carries into the exponent:
+        TS_ASSERT_EQUALS(2.0f,   buffer[3]);
+        TS_ASSERT_EQUALS(-0.0f,  buffer[4]);
+        TS_ASSERT_EQUALS(std::numeric_limits<float>::infinity(), buffer[5]);
+        // ...but never overflows:
+        TS_ASSERT_LESS_THAN(buffer[6], std::numeric_limits<float>::infinity());
+        TS_ASSERT_LESS_THAN_EQUALS(std::numeric_limits<float>::max() * 0.9f, buffer[6]);
+
+        TS_ASSERT_THROWS((TruncatingFilter<TestCell<2>, float>(24)), std::invalid_argument&);
+    }
+};
+
+}
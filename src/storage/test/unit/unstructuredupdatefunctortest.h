@@ -400,6 +400,99 @@ public:
 #endif
     }
 
+    void testSoAWithOpenMP()
+    {
+#ifdef LIBGEODECOMP_WITH_CPP14
+        const int DIM = 150;
+        CoordBox<1> dim(Coord<1>(0), Coord<1>(DIM));
+
+        SimpleUnstructuredSoATestCell<1> defaultCell(200);
+        SimpleUnstructuredSoATestCell<1> edgeCell(-1);
+
+        UnstructuredSoAGrid<SimpleUnstructuredSoATestCell<1>, 1, double, 4, 1> gridOld(dim, defaultCell, edgeCell);
+
+        Region<1> region;
+        // streak within a single chunk
+        region << Streak<1>(Coord<1>(5),     7);
+        // loop peeling in first chunk
+        region << Streak<1>(Coord<1>(37),   60);
+        // loop peeling in first and last chunk
+        region << Streak<1>(Coord<1>(61),  147);
+
+        std::map<Coord<2>, double> matrix;
+        for (int row = 0; row < DIM; ++row) {
+            for (int col = 0; col < row; ++col) {
+                matrix[Coord<2>(row, col)] = 1;
+            }
+        }
+        gridOld.setWeights(0, matrix);
+
+        UnstructuredUpdateFunctor<SimpleUnstructuredSoATestCell<1> > functor;
+        APITraits::SelectThreadedUpdate<SimpleUnstructuredSoATestCell<1> >::Value modelThreadingSpec;
+
+        for (int fineGrained = 0; fineGrained < 2; ++fineGrained) {
+            for (int updatingGhost = 0; updatingGhost < 2; ++updatingGhost) {
+                // cells accumulate into sum, hence a fresh grid for each run:
+                UnstructuredSoAGrid<SimpleUnstructuredSoATestCell<1>, 1, double, 4, 1> gridNew(dim, defaultCell, edgeCell);
+                UpdateFunctorHelpers::ConcurrencyEnableOpenMP concurrencySpec(updatingGhost, fineGrained);
+                functor(region, gridOld, &gridNew, 0, concurrencySpec, modelThreadingSpec);
+
+                for (Coord<1> coord(0); coord < Coord<1>(150); ++coord.x()) {
+                    if (region.count(coord)) {
+                        const double sum = coord.x() * 200.0;
+                        TS_ASSERT_EQUALS(sum, gridNew.get(coord).sum);
+                    } else {
+                        TS_ASSERT_EQUALS(0.0, gridNew.get(coord).sum);
+                    }
+                }
+            }
+        }
+#endif
+    }
+
+    void testWorkItemSplitting()
+    {
+#ifdef LIBGEODECOMP_WITH_CPP14
+        typedef SimpleUnstructuredSoATestCell<1> TestCellType;
+        typedef UnstructuredUpdateFunctorHelpers::UnstructuredGridSoAUpdateHelper<TestCellType> HelperType;
+        typedef UnstructuredSoAGrid<TestCellType, 1, double, 4, 1> GridType;
+
+        CoordBox<1> dim(Coord<1>(0), Coord<1>(512));
+        GridType gridOld(dim);
+        GridType gridNew(dim);
+
+        Region<1> region;
+        region << Streak<1>(Coord<1>(5),     7);
+        region << Streak<1>(Coord<1>(37),   60);
+        region << Streak<1>(Coord<1>(64),  200);
+
+        std::vector<Streak<1> > expected;
+        expected << Streak<1>(Coord<1>(5),     7)
+                 << Streak<1>(Coord<1>(37),   40)
+                 << Streak<1>(Coord<1>(40),   60)
+                 << Streak<1>(Coord<1>(64),  128)
+                 << Streak<1>(Coord<1>(128), 192)
+                 << Streak<1>(Coord<1>(192), 200);
+
+        HelperType helper(gridOld, &gridNew, region, 0);
+        TS_ASSERT_EQUALS(expected, helper.splitIntoWorkItems());
+
+        // fine-grained parallelism yields one work item per chunk:
+        HelperType fineGrainedHelper(
+            gridOld,
+            &gridNew,
+            region,
+            0,
+            UpdateFunctorHelpers::ConcurrencyEnableOpenMP(false, true),
+            APITraits::SelectThreadedUpdate<TestCellType>::Value());
+        std::vector<Streak<1> > workItems = fineGrainedHelper.splitIntoWorkItems();
+        TS_ASSERT_EQUALS(std::size_t(1 + 6 + 34), workItems.size());
+        for (std::size_t i = 0; i < workItems.size(); ++i) {
+            TS_ASSERT_LESS_THAN_EQUALS(workItems[i].length(), 4);
+        }
+#endif
+    }
+
     void testSoAWithSIGMA()
     {
 #ifdef LIBGEODECOMP_WITH_CPP14
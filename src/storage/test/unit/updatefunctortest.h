@@ -162,6 +162,15 @@ public:
             "FixedLineUpdateCell::updateLine(x = 0, endX = 1, nanoStep = 0)\nFixedLineUpdateCell::updateLine(x = 1, endX = 7, nanoStep = 0)\nFixedLineUpdateCell::updateLine(x = 7, endX = 8, nanoStep = 0)\n", 1);
     }
 
+    void testOpenMPScheduling()
+    {
+        typedef UpdateFunctorHelpers::ConcurrencyEnableOpenMP Spec;
+        TS_ASSERT( Spec(false, false).preferStaticScheduling());
+        TS_ASSERT(!Spec(true,  false).preferStaticScheduling());
+        TS_ASSERT( Spec(true,  false, true).preferStaticScheduling());
+        TS_ASSERT( Spec(true,  true,  true).preferFineGrainedParallelism());
+    }
+
     void testMoore2D()
     {
         UpdateFunctorTestHelper<Stencils::Moore<2, 1> >().testSimple(3);
@@ -0,0 +1,233 @@
+#include <libgeodecomp/geometry/region.h>
+#include <libgeodecomp/storage/boxcell.h>
+#include <libgeodecomp/storage/grid.h>
+#include <libgeodecomp/storage/updatefunctor.h>
+#include <libgeodecomp/storage/verletboxcell.h>
+
+#include <cmath>
+#include <cxxtest/TestSuite.h>
+#include <map>
+
+using namespace LibGeoDecomp;
+
+namespace LibGeoDecomp {
+
+/**
+ * Drifts with constant velocity and records which particles were
+ * within the cutoff radius.
+ */
+class DriftingParticle
+{
+public:
+    class API : public APITraits::HasCubeTopology<2>
+    {};
+
+    explicit DriftingParticle(
+        const int id = 0,
+        const FloatCoord<2>& pos = FloatCoord<2>(),
+        const FloatCoord<2>& velocity = FloatCoord<2>(),
+        const double cutoff = 0) :
+        id(id),
+        pos(pos),
+        velocity(velocity),
+        cutoff2(cutoff * cutoff),
+        neighbors(0),
+        neighborIDs(0)
+    {}
+
+    template<typename HOOD>
+    inline void update(const HOOD& hood, const int nanoStep)
+    {
+        neighbors = 0;
+        neighborIDs = 0;
+
+        for (typename HOOD::Iterator i = hood.begin(); i != hood.end(); ++i) {
+            FloatCoord<2> delta = i->pos - pos;
+            if ((delta * delta) < cutoff2) {
+                ++neighbors;
+                neighborIDs += i->id;
+            }
+        }
+
+        pos += velocity;
+    }
+
+    inline const FloatCoord<2>& getPos() const
+    {
+        return pos;
+    }
+
+    int id;
+    FloatCoord<2> pos;
+    FloatCoord<2> velocity;
+    double cutoff2;
+    int neighbors;
+    int neighborIDs;
+};
+
+class VerletBoxCellTest : public CxxTest::TestSuite
+{
+public:
+    typedef FixedArray<DriftingParticle, 30> ContainerType;
+    typedef BoxCell<ContainerType> BoxCellType;
+    typedef VerletBoxCell<ContainerType, 2000> VerletBoxCellType;
+
+    void setUp()
+    {
+        gridDim = Coord<2>(8, 6);
+        boxDim = FloatCoord<2>(3.0, 3.0);
+        cutoff = 1.6;
+        skin = 0.6;
+    }
+
+    void testMatchesBoxCell()
+    {
+        checkAgainstBoxCell<VerletBoxCellType>(0.05, 40);
+    }
+
+    void testFallbackToFullSearchOnOverflow()
+    {
+        typedef VerletBoxCell<ContainerType, 8> SmallCellType;
+        Grid<SmallCellType> grid = checkAgainstBoxCell<SmallCellType>(0.05, 5);
+
+        TS_ASSERT(!grid[Coord<2>(3, 3)].listValid);
+    }
+
+    void testListsAreReusedWhileParticlesMoveSlowly()
+    {
+        double speed = 0.01;
+        Grid<VerletBoxCellType> grid1 = makeGrid<VerletBoxCellType>(speed);
+        Grid<VerletBoxCellType> grid2 = grid1;
+        Coord<2> center(3, 3);
+
+        step(&grid1, &grid2);
+        unsigned generation = grid1[center].generation;
+        TS_ASSERT(grid1[center].listValid);
+        TS_ASSERT_EQUALS(0.0, grid1[center].drift);
+
+        // drift grows by the maximum displacement in the neighborhood
+        // (the fastest particles travel diagonally at 1.2 * speed),
+        // the lists remain untouched until it exceeds skin / 2:
+        double maxSpeed = std::sqrt(2.0) * 1.2 * speed;
+        for (int t = 1; t < 17; ++t) {
+            step(&grid1, &grid2);
+            TS_ASSERT_DELTA(t * maxSpeed, grid1[center].drift, 1e-9);
+        }
+        TS_ASSERT_EQUALS(generation, grid1[center].generation);
+
+        for (int t = 17; t < 30; ++t) {
+            step(&grid1, &grid2);
+        }
+        TS_ASSERT_LESS_THAN(grid1[center].drift, 0.5 * skin);
+    }
+
+private:
+    Coord<2> gridDim;
+    FloatCoord<2> boxDim;
+    double cutoff;
+    double skin;
+
+    template<typename CELL>
+    Grid<CELL> makeGrid(double speed)
+    {
+        Grid<CELL> grid(gridDim);
+        CoordBox<2> box(Coord<2>(), gridDim);
+        int id = 0;
+
+        for (CoordBox<2>::Iterator i = box.begin(); i != box.end(); ++i) {
+            FloatCoord<2> origin = boxDim.scale(*i);
+            initCell(&grid[*i], origin);
+
+            // particles drift away from the center of the simulation
+            // space, so no particle ever leaves it:
+            for (int y = 0; y < 3; ++y) {
+                for (int x = 0; x < 3; ++x) {
+                    FloatCoord<2> pos = origin + FloatCoord<2>(0.4 + x * 1.0 + 0.1 * y, 0.5 + y * 0.9);
+                    FloatCoord<2> direction(
+                        (i->x() < gridDim.x() / 2) ? -1 : 1,
+                        (i->y() < gridDim.y() / 2) ? -1 : 1);
+                    FloatCoord<2> velocity = direction * speed * (1 + 0.1 * ((x + y) % 3));
+                    if ((i->x() == 0) || (i->y() == 0) ||
+                        (i->x() == (gridDim.x() - 1)) || (i->y() == (gridDim.y() - 1))) {
+                        velocity = FloatCoord<2>();
+                    }
+
+                    grid[*i] << DriftingParticle(++id, pos, velocity, cutoff);
+                }
+            }
+        }
+
+        return grid;
+    }
+
+    void initCell(BoxCellType *cell, const FloatCoord<2>& origin)
+    {
+        *cell = BoxCellType(origin, boxDim);
+    }
+
+    template<typename CELL>
+    void initCell(CELL *cell, const FloatCoord<2>& origin)
+    {
+        *cell = CELL(origin, boxDim, cutoff, skin);
+    }
+
+    template<typename CELL>
+    void step(Grid<CELL> *grid1, Grid<CELL> *grid2)
+    {
+        Region<2> region;
+        region << CoordBox<2>(Coord<2>(), gridDim);
+
+        UpdateFunctor<CELL>()(region, Coord<2>(), Coord<2>(), *grid1, grid2, 0);
+        std::swap(*grid1, *grid2);
+    }
+
+    /**
+     * BoxCell doesn't allow particles to stray from their boxes, so
+     * particles may be stored in different boxes, but all particles
+     * should observe the same surroundings.
+     */
+    template<typename CELL>
+    Grid<CELL> checkAgainstBoxCell(double speed, int steps)
+    {
+        Grid<BoxCellType> referenceGrid1 = makeGrid<BoxCellType>(speed);
+        Grid<BoxCellType> referenceGrid2 = referenceGrid1;
+        Grid<CELL> grid1 = makeGrid<CELL>(speed);
+        Grid<CELL> grid2 = grid1;
+
+        for (int t = 0; t < steps; ++t) {
+            step(&referenceGrid1, &referenceGrid2);
+            step(&grid1, &grid2);
+
+            std::map<int, DriftingParticle> expected = collect(referenceGrid1);
+            std::map<int, DriftingParticle> actual = collect(grid1);
+            TS_ASSERT_EQUALS(std::size_t(gridDim.prod() * 9), actual.size());
+            TS_ASSERT_EQUALS(expected.size(), actual.size());
+
+            for (std::map<int, DriftingParticle>::iterator i = expected.begin(); i != expected.end(); ++i) {
+                const DriftingParticle& particle = actual[i->first];
+                TS_ASSERT_EQUALS(i->second.pos, particle.pos);
+                TS_ASSERT_EQUALS(i->second.neighbors, particle.neighbors);
+                TS_ASSERT_EQUALS(i->second.neighborIDs, particle.neighborIDs);
+            }
+        }
+
+        return grid1;
+    }
+
+    template<typename CELL>
+    std::map<int, DriftingParticle> collect(const Grid<CELL>& grid)
+    {
+        std::map<int, DriftingParticle> ret;
+        CoordBox<2> box(Coord<2>(), gridDim);
+
+        for (CoordBox<2>::Iterator i = box.begin(); i != box.end(); ++i) {
+            for (typename CELL::const_iterator j = grid[*i].begin(); j != grid[*i].end(); ++j) {
+                ret[j->id] = *j;
+            }
+        }
+
+        return ret;
+    }
+};
+
+}
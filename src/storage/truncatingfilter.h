@@ -0,0 +1,162 @@
+#ifndef LIBGEODECOMP_STORAGE_TRUNCATINGFILTER_H
+#define LIBGEODECOMP_STORAGE_TRUNCATINGFILTER_H
+
+#include <libgeodecomp/storage/filter.h>
+
+#include <boost/cstdint.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace LibGeoDecomp {
+
+namespace TruncatingFilterHelpers {
+
+/**
+ * Bit layout of the IEEE 754 types we can truncate.
+ */
+template<typename MEMBER>
+class FloatTraits;
+
+/**
+ * see above
+ */
+template<>
+class FloatTraits<float>
+{
+public:
+    typedef boost::uint32_t Bits;
+    static const int MANTISSA_BITS = 23;
+    static const int EXPONENT_BITS = 8;
+};
+
+/**
+ * see above
+ */
+template<>
+class FloatTraits<double>
+{
+public:
+    typedef boost::uint64_t Bits;
+    static const int MANTISSA_BITS = 52;
+    static const int EXPONENT_BITS = 11;
+};
+
+}
+
+/**
+ * Lossy filter which rounds floating point members to the given
+ * number of mantissa bits and zeroes the remaining ones. The type
+ * stays the same (so the output can be read by any tool), but the
+ * low order bytes become zero, which lets byte-oriented compressors
+ * such as BlockCompressor shrink the data considerably. The relative
+ * error is bounded by relativeErrorBound() = 2^-(mantissaBits + 1).
+ * Infinity and NaN are passed through unmodified.
+ *
+ * Loading is a plain copy, as the truncated values are already the
+ * best reconstruction.
+ */
+template<typename CELL, typename MEMBER>
+class TruncatingFilter : public Filter<CELL, MEMBER, MEMBER>
+{
+public:
+    typedef TruncatingFilterHelpers::FloatTraits<MEMBER> Traits;
+    typedef typename Traits::Bits Bits;
+
+    explicit TruncatingFilter(int mantissaBits) :
+        mantissaBits(mantissaBits)
+    {
+        if ((mantissaBits < 0) || (mantissaBits > Traits::MANTISSA_BITS)) {
+            throw std::invalid_argument("TruncatingFilter: invalid number of mantissa bits");
+        }
+
+        int droppedBits = Traits::MANTISSA_BITS - mantissaBits;
+        mask = ~((Bits(1) << droppedBits) - 1);
+        roundingBias = droppedBits ? (Bits(1) << (droppedBits - 1)) : 0;
+        exponentMask = ((Bits(1) << Traits::EXPONENT_BITS) - 1) << Traits::MANTISSA_BITS;
+    }
+
+    double relativeErrorBound() const
+    {
+        return std::ldexp(1.0, -(mantissaBits + 1));
+    }
+
+    void copyStreakInImpl(
+        const MEMBER *source,
+        MemoryLocation::Location sourceLocation,
+        MEMBER *target,
+        MemoryLocation::Location targetLocation,
+        const std::size_t num,
+        const std::size_t stride)
+    {
+        std::copy(source, source + num, target);
+    }
+
+    void copyStreakOutImpl(
+        const MEMBER *source,
+        MemoryLocation::Location sourceLocation,
+        MEMBER *target,
+        MemoryLocation::Location targetLocation,
+        const std::size_t num,
+        const std::size_t stride)
+    {
+        for (std::size_t i = 0; i < num; ++i) {
+            target[i] = truncate(source[i]);
+        }
+    }
+
+    void copyMemberInImpl(
+        const MEMBER *source,
+        MemoryLocation::Location sourceLocation,
+        CELL *target,
+        MemoryLocation::Location targetLocation,
+        std::size_t num,
+        MEMBER CELL:: *memberPointer)
+    {
+        for (std::size_t i = 0; i < num; ++i) {
+            target[i].*memberPointer = source[i];
+        }
+    }
+
+    void copyMemberOutImpl(
+        const CELL *source,
+        MemoryLocation::Location sourceLocation,
+        MEMBER *target,
+        MemoryLocation::Location targetLocation,
+        std::size_t num,
+        MEMBER CELL:: *memberPointer)
+    {
+        for (std::size_t i = 0; i < num; ++i) {
+            target[i] = truncate(source[i].*memberPointer);
+        }
+    }
+
+private:
+    int mantissaBits;
+    Bits mask;
+    Bits roundingBias;
+    Bits exponentMask;
+
+    inline MEMBER truncate(const MEMBER& value) const
+    {
+        Bits bits;
+        std::memcpy(&bits, &value, sizeof(MEMBER));
+        if ((bits & exponentMask) == exponentMask) {
+            return value;
+        }
+
+        // a carry into the exponent correctly rounds up to the next
+        // power of two, but we mustn't overflow to infinity:
+        Bits rounded = (bits + roundingBias) & mask;
+        bits = ((rounded & exponentMask) == exponentMask) ? (bits & mask) : rounded;
+
+        MEMBER ret;
+        std::memcpy(&ret, &bits, sizeof(MEMBER));
+        return ret;
+    }
+};
+
+}
+
+#endif
@@ -164,6 +164,13 @@ public:
         matrices[matrixID].initFromMatrix(matrix);
     }
 
+    inline
+    void setWeights(std::size_t matrixID, const CSRMatrix<VALUE_TYPE>& matrix)
+    {
+        assert(matrixID < MATRICES);
+        matrices[matrixID].initFromCSR(matrix);
+    }
+
     inline
     const SellCSigmaSparseMatrixContainer<VALUE_TYPE, C, SIGMA>& getWeights(std::size_t const matrixID) const
     {
@@ -12,11 +12,12 @@
 #endif
 
 #include <boost/iterator/counting_iterator.hpp>
+#include <vector>
 
 #include <libgeodecomp/misc/apitraits.h>
 #include <libgeodecomp/geometry/streak.h>
 #include <libgeodecomp/geometry/coord.h>
-#include <libgeodecomp/storage/fixedarray.h>
+#include <libgeodecomp/misc/stdcontaineroverloads.h>
 #include <libgeodecomp/storage/unstructuredsoagrid.h>
 #include <libgeodecomp/storage/unstructuredneighborhood.h>
 #include <libgeodecomp/storage/unstructuredneighborhoodnew.h>
@@ -32,6 +33,19 @@ namespace UnstructuredUpdateFunctorHelpers {
 /**
  * Functor to be used from with LibFlatArray from within
  * UnstructuredUpdateFunctor. Hides much of the boilerplate code.
+ *
+ * The Region is cut into work items along the SELL-C-sigma chunk
+ * boundaries: streak heads and tails which only partially cover a
+ * chunk are peeled off and updated via update() (scalar, masked to
+ * the streak), while aligned runs of chunks are handed to
+ * updateLineX(). Work items can then be processed in parallel (via
+ * OpenMP or HPX) as chunks are independent of each other.
+ *
+ * updateLineX() sees the same hoodNew as before: it wraps the
+ * accessor handed in by the grid's callback. Without threading all
+ * calls share that accessor (one call per Streak), with threading
+ * each work item receives a private copy of it, taken before any
+ * update ran. Peeled cells never move the accessor.
  */
 template<typename CELL>
 class UnstructuredGridSoAUpdateHelper
@@ -45,6 +59,13 @@ public:
     static const auto DIM = Topology::DIM;
     using Grid = UnstructuredSoAGrid<CELL, MATRICES, ValueType, C, SIGMA>;
 
+    /**
+     * Number of SELL chunks bundled into one work item, unless
+     * fine-grained parallelism was requested (then it's one chunk
+     * per work item).
+     */
+    static const int CHUNKS_PER_WORK_ITEM = 16;
+
     UnstructuredGridSoAUpdateHelper(
         const Grid& gridOld,
         Grid *gridNew,
@@ -53,7 +74,29 @@ public:
         gridOld(gridOld),
         gridNew(gridNew),
         region(region),
-        nanoStep(nanoStep)
+        nanoStep(nanoStep),
+        enableOpenMP(false),
+        enableHPX(false),
+        preferStaticScheduling(false),
+        chunksPerWorkItem(CHUNKS_PER_WORK_ITEM)
+    {}
+
+    template<typename CONCURRENCY_FUNCTOR, typename ANY_THREADED_UPDATE>
+    UnstructuredGridSoAUpdateHelper(
+        const Grid& gridOld,
+        Grid *gridNew,
+        const Region<DIM>& region,
+        unsigned nanoStep,
+        const CONCURRENCY_FUNCTOR& concurrencySpec,
+        const ANY_THREADED_UPDATE& modelThreadingSpec) :
+        gridOld(gridOld),
+        gridNew(gridNew),
+        region(region),
+        nanoStep(nanoStep),
+        enableOpenMP(concurrencySpec.enableOpenMP() && !modelThreadingSpec.hasOpenMP()),
+        enableHPX(concurrencySpec.enableHPX() && !modelThreadingSpec.hasHPX()),
+        preferStaticScheduling(concurrencySpec.preferStaticScheduling()),
+        chunksPerWorkItem(concurrencySpec.preferFineGrainedParallelism() ? 1 : CHUNKS_PER_WORK_ITEM)
     {}
 
     template<
@@ -63,66 +106,157 @@ public:
         LibFlatArray::soa_accessor<CELL1, MY_DIM_X1, MY_DIM_Y1, MY_DIM_Z1, INDEX1>& oldAccessor,
         LibFlatArray::soa_accessor<CELL2, MY_DIM_X2, MY_DIM_Y2, MY_DIM_Z2, INDEX2>& newAccessor) const
     {
-        // fixme: threading!
-        for (typename Region<DIM>::StreakIterator i = region.beginStreak(); i != region.endStreak(); ++i) {
-            // Assumption: Cell has both (updateLineX and update())
-
-            // loop peeling: streak's start might point to middle of chunks
-            // if so: vectorization cannot be done -> solution: additionally
-            // update the first and last chunk of complete streak scalar by
-            // calling update() instead
-            int startX = i->origin.x();
-            if ((startX % C) != 0) {
-                UnstructuredSoAScalarNeighborhood<CELL, MATRICES, ValueType, C, SIGMA>
-                    hoodOld(gridOld, startX);
-                const int cellsToUpdate = C - (startX % C);
-                FixedArray<CELL, C> cells;
-                Streak<1> cellStreak(Coord<1>(startX), startX + cellsToUpdate);
-
-                // update SoA grid: copy cells to local buffer, update, copy data back to grid
-                gridNew->get(cellStreak, cells.begin());
-                // call update
-                for (int i = 0; i < cellsToUpdate; ++i, ++hoodOld) {
-                    cells[i].update(hoodOld, nanoStep);
+#ifdef LIBGEODECOMP_WITH_THREADS
+        if (enableOpenMP) {
+            std::vector<Streak<DIM> > workItems = splitIntoWorkItems();
+
+            if (preferStaticScheduling) {
+#pragma omp parallel for schedule(static)
+                for (std::size_t i = 0; i < workItems.size(); ++i) {
+                    LibFlatArray::soa_accessor<CELL2, MY_DIM_X2, MY_DIM_Y2, MY_DIM_Z2, INDEX2> accessor = newAccessor;
+                    updateWorkItem(workItems[i], oldAccessor, accessor);
+                }
+            } else {
+#pragma omp parallel for schedule(dynamic)
+                for (std::size_t i = 0; i < workItems.size(); ++i) {
+                    LibFlatArray::soa_accessor<CELL2, MY_DIM_X2, MY_DIM_Y2, MY_DIM_Z2, INDEX2> accessor = newAccessor;
+                    updateWorkItem(workItems[i], oldAccessor, accessor);
                 }
-                // fixme: woah, avoid these copies!
-                gridNew->set(cellStreak, cells.begin());
-
-                startX += cellsToUpdate;
             }
 
-            // call updateLineX with adjusted indices
-            UnstructuredSoANeighborhood<CELL, MY_DIM_X1, MY_DIM_Y1, MY_DIM_Z1, INDEX1,
-                                        MATRICES, ValueType, C, SIGMA>
-                hoodOld(oldAccessor, gridOld, startX);
-
-            UnstructuredSoANeighborhoodNew<CELL, MY_DIM_X2, MY_DIM_Y2, MY_DIM_Z2, INDEX2> hoodNew(&newAccessor);
-            CELL::updateLineX(hoodNew, i->endX, hoodOld, nanoStep);
-
-            // call scalar updates for last chunk
-            if ((i->endX % C) != 0) {
-                const int cellsToUpdate = i->endX % C;
-                UnstructuredSoAScalarNeighborhood<CELL, MATRICES, ValueType, C, SIGMA>
-                    hoodOld(gridOld, i->endX - cellsToUpdate);
-                std::array<CELL, C> cells;
-                Streak<1> cellStreak(Coord<1>(i->endX - cellsToUpdate), i->endX);
-
-                // update SoA grid: copy cells to local buffer, update, copy data back to grid
-                gridNew->get(cellStreak, cells.begin());
-                // call update
-                for (int i = 0; i < cellsToUpdate; ++i, ++hoodOld) {
-                    cells[i].update(hoodOld, nanoStep);
-                }
-                gridNew->set(cellStreak, cells.begin());
+            return;
+        }
+#endif
+
+#ifdef LIBGEODECOMP_WITH_HPX
+        if (enableHPX) {
+            std::vector<Streak<DIM> > workItems = splitIntoWorkItems();
+            std::vector<hpx::future<void> > updateFutures;
+            updateFutures.reserve(workItems.size());
+
+            for (std::size_t i = 0; i < workItems.size(); ++i) {
+                updateFutures << hpx::async(
+                    [&, i]() {
+                        LibFlatArray::soa_accessor<CELL2, MY_DIM_X2, MY_DIM_Y2, MY_DIM_Z2, INDEX2> accessor = newAccessor;
+                        updateWorkItem(workItems[i], oldAccessor, accessor);
+                    });
             }
+
+            hpx::lcos::wait_all(std::move(updateFutures));
+            return;
+        }
+#endif
+
+        // without threading each Streak's aligned chunks are handed
+        // to a single updateLineX() call on the shared accessor, just
+        // as before:
+        std::vector<Streak<DIM> > workItems = splitIntoWorkItems(0);
+        for (std::size_t i = 0; i < workItems.size(); ++i) {
+            updateWorkItem(workItems[i], oldAccessor, newAccessor);
         }
     }
 
+    /**
+     * Cuts the Region's Streaks so that each resulting Streak is
+     * either a run of complete chunks or lies within a single chunk.
+     */
+    std::vector<Streak<DIM> > splitIntoWorkItems() const
+    {
+        return splitIntoWorkItems(chunksPerWorkItem * C);
+    }
+
 private:
     const Grid& gridOld;
     Grid *gridNew;
     const Region<DIM>& region;
     unsigned nanoStep;
+    bool enableOpenMP;
+    bool enableHPX;
+    bool preferStaticScheduling;
+    int chunksPerWorkItem;
+
+    /**
+     * A maxItemLength of 0 means that runs of complete chunks are
+     * not cut any further.
+     */
+    std::vector<Streak<DIM> > splitIntoWorkItems(int maxItemLength) const
+    {
+        std::vector<Streak<DIM> > ret;
+
+        for (typename Region<DIM>::StreakIterator i = region.beginStreak(); i != region.endStreak(); ++i) {
+            int startX = i->origin.x();
+            int endX = i->endX;
+
+            // loop peeling: streak's start might point to middle of
+            // chunks. If so, vectorization can't be done for the
+            // first chunk.
+            if ((startX % C) != 0) {
+                int headEndX = (std::min)(endX, startX - (startX % C) + C);
+                ret << Streak<DIM>(Coord<DIM>(startX), headEndX);
+                startX = headEndX;
+            }
+
+            int alignedEndX = endX - (endX % C);
+            while (startX < alignedEndX) {
+                int itemEndX = (maxItemLength == 0) ?
+                    alignedEndX : (std::min)(alignedEndX, startX + maxItemLength);
+                ret << Streak<DIM>(Coord<DIM>(startX), itemEndX);
+                startX = itemEndX;
+            }
+
+            // same for the streak's last chunk:
+            if (startX < endX) {
+                ret << Streak<DIM>(Coord<DIM>(startX), endX);
+            }
+        }
+
+        return ret;
+    }
+
+    template<
+        typename CELL1, long MY_DIM_X1, long MY_DIM_Y1, long MY_DIM_Z1, long INDEX1,
+        typename CELL2, long MY_DIM_X2, long MY_DIM_Y2, long MY_DIM_Z2, long INDEX2>
+    void updateWorkItem(
+        const Streak<DIM>& item,
+        const LibFlatArray::soa_accessor<CELL1, MY_DIM_X1, MY_DIM_Y1, MY_DIM_Z1, INDEX1>& oldAccessor,
+        LibFlatArray::soa_accessor<CELL2, MY_DIM_X2, MY_DIM_Y2, MY_DIM_Z2, INDEX2>& newAccessor) const
+    {
+        if (((item.origin.x() % C) != 0) || ((item.endX % C) != 0)) {
+            updateScalar(item, newAccessor);
+            return;
+        }
+
+        UnstructuredSoANeighborhood<CELL, MY_DIM_X1, MY_DIM_Y1, MY_DIM_Z1, INDEX1,
+                                    MATRICES, ValueType, C, SIGMA>
+            hoodOld(oldAccessor, gridOld, item.origin.x());
+
+        UnstructuredSoANeighborhoodNew<CELL, MY_DIM_X2, MY_DIM_Y2, MY_DIM_Z2, INDEX2> hoodNew(&newAccessor);
+        CELL::updateLineX(hoodNew, item.endX, hoodOld, nanoStep);
+    }
+
+    /**
+     * Updates the cells of a partial chunk via update(). As that
+     * needs a CELL instance, each cell is loaded from the new grid,
+     * updated and stored back, just like the old get()/set() did,
+     * but without going through a temporary chunk buffer. Only the
+     * cells covered by the Streak are touched and the caller's
+     * accessor isn't moved.
+     */
+    template<typename NEW_ACCESSOR>
+    void updateScalar(const Streak<DIM>& item, NEW_ACCESSOR newAccessor) const
+    {
+        UnstructuredSoAScalarNeighborhood<CELL, MATRICES, ValueType, C, SIGMA>
+            hoodOld(gridOld, item.origin.x());
+        const long baseIndex = newAccessor.index;
+        CELL cell;
+
+        for (int x = item.origin.x(); x != item.endX; ++x, ++hoodOld) {
+            newAccessor.index = baseIndex + x;
+            newAccessor >> cell;
+            cell.update(hoodOld, nanoStep);
+            newAccessor << cell;
+        }
+    }
 };
 
 }
@@ -286,12 +420,13 @@ public:
     {
         gridOld.callback(
             gridNew,
-            // fixme: is missing concurrencySpec, modelThreadingSpec
             UnstructuredUpdateFunctorHelpers::UnstructuredGridSoAUpdateHelper<CELL>(
                 gridOld,
                 gridNew,
                 region,
-                nanoStep));
+                nanoStep,
+                concurrencySpec,
+                modelThreadingSpec));
     }
 };
 
@@ -324,14 +324,21 @@ public:
  * Unsurprisingly, this class requests the UpdateFunctor to use OpenMP
  * for parallelization. Flags can optionally steer the granularity and
  * dynamics of load distribution among the threads.
+ * forceStaticScheduling yields a fixed mapping of work items to
+ * threads even when updating the ghost zone (e.g. to match the NUMA
+ * placement of the grids).
  */
 class ConcurrencyEnableOpenMP
 {
 public:
     inline
-    ConcurrencyEnableOpenMP(bool updatingGhost, bool enableFineGrainedParallelism) :
+    ConcurrencyEnableOpenMP(
+        bool updatingGhost,
+        bool enableFineGrainedParallelism,
+        bool forceStaticScheduling = false) :
         updatingGhost(updatingGhost),
-        enableFineGrainedParallelism(enableFineGrainedParallelism)
+        enableFineGrainedParallelism(enableFineGrainedParallelism),
+        forceStaticScheduling(forceStaticScheduling)
     {}
 
     bool enableOpenMP() const
@@ -346,7 +353,7 @@ public:
 
     bool preferStaticScheduling() const
     {
-        return !updatingGhost;
+        return forceStaticScheduling || !updatingGhost;
     }
 
     bool preferFineGrainedParallelism() const
@@ -357,6 +364,7 @@ public:
 private:
     bool updatingGhost;
     bool enableFineGrainedParallelism;
+    bool forceStaticScheduling;
 };
 
 /**
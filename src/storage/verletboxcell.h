@@ -0,0 +1,478 @@
+#ifndef LIBGEODECOMP_STORAGE_VERLETBOXCELL_H
+#define LIBGEODECOMP_STORAGE_VERLETBOXCELL_H
+
+#include <libgeodecomp/misc/apitraits.h>
+#include <libgeodecomp/geometry/coord.h>
+#include <libgeodecomp/geometry/coordbox.h>
+#include <libgeodecomp/geometry/floatcoord.h>
+#include <libgeodecomp/misc/stdcontaineroverloads.h>
+#include <libgeodecomp/storage/neighborhooditerator.h>
+#include <libgeodecomp/storage/fixedarray.h>
+
+#include <algorithm>
+
+namespace LibGeoDecomp {
+
+namespace VerletBoxCellHelpers {
+
+/**
+ * An entry of a Verlet list: the particle with index neighbor in box
+ * number box is a potential interaction partner of the particle with
+ * index particle. Boxes are numbered in the order in which
+ * CoordBox<DIM>(Coord<DIM>::diagonal(-1), Coord<DIM>::diagonal(3))
+ * enumerates them.
+ */
+class Pair
+{
+public:
+    inline explicit Pair(
+        const std::size_t particle = 0,
+        const int box = 0,
+        const std::size_t neighbor = 0) :
+        particle(particle),
+        neighbor(neighbor),
+        box(box)
+    {}
+
+    unsigned short particle;
+    unsigned short neighbor;
+    unsigned char box;
+};
+
+/**
+ * Iterates over the particles referenced by a section of a Verlet
+ * list.
+ */
+template<typename CELL>
+class NeighborIterator
+{
+public:
+    typedef typename CELL::Cargo Particle;
+
+    inline NeighborIterator(const CELL *const *cells, const Pair *pair) :
+        cells(cells),
+        pair(pair)
+    {}
+
+    inline const Particle& operator*() const
+    {
+        return (*cells[pair->box])[pair->neighbor];
+    }
+
+    inline const Particle *operator->() const
+    {
+        return &**this;
+    }
+
+    inline void operator++()
+    {
+        ++pair;
+    }
+
+    inline bool operator==(const NeighborIterator& other) const
+    {
+        return pair == other.pair;
+    }
+
+    inline bool operator!=(const NeighborIterator& other) const
+    {
+        return pair != other.pair;
+    }
+
+private:
+    const CELL *const *cells;
+    const Pair *pair;
+};
+
+/**
+ * This is what a particle gets to see during update() if its Verlet
+ * list is valid: all particles within cutoff + skin. The interface
+ * matches NeighborhoodIteratorHelpers::Adapter, so particle code
+ * doesn't need to know whether it's being used with a BoxCell or a
+ * VerletBoxCell.
+ */
+template<typename CELL>
+class Neighbors
+{
+public:
+    typedef NeighborIterator<CELL> Iterator;
+
+    inline Neighbors(
+        CELL *writeContainer,
+        const CELL *const *cells,
+        const Pair *begin,
+        const Pair *end) :
+        writeContainer(writeContainer),
+        myBegin(cells, begin),
+        myEnd(cells, end)
+    {}
+
+    inline const Iterator& begin() const
+    {
+        return myBegin;
+    }
+
+    inline const Iterator& end() const
+    {
+        return myEnd;
+    }
+
+    template<typename PARTICLE>
+    void operator<<(const PARTICLE& particle)
+    {
+        (*writeContainer) << particle;
+    }
+
+private:
+    CELL *writeContainer;
+    Iterator myBegin;
+    Iterator myEnd;
+};
+
+}
+
+/**
+ * VerletBoxCell is a drop-in replacement for BoxCell (when used
+ * directly as a simulation model, not within a MultiContainerCell)
+ * which avoids most of the distance checks in short-range particle
+ * codes. For each particle it caches a list of all particles within
+ * cutoff + skin (a Verlet list). Particles are then only handed this
+ * list during update(). The lists are reused until any particle in
+ * the surrounding boxes may have moved by more than skin / 2 or
+ * until a neighboring box changed its set of particles.
+ *
+ * To make the latter rare, particles are allowed to stray up to
+ * skin / 2 beyond their box before they're handed over to the
+ * neighboring box. Hence the box dimensions need to be at least
+ * cutoff + 2 * skin (instead of cutoff for BoxCell) and neighboring
+ * boxes only need to be scanned for incoming particles if they
+ * reported any emigrants.
+ *
+ * Decisions are based on the state of the surrounding boxes only, so
+ * no global communication is required. Particles need to provide
+ * getPos(). Up to MAX_PAIRS pairs can be stored per box; if that's
+ * exceeded, the box falls back to a full search (just like BoxCell)
+ * until the next rebuild.
+ */
+template<typename CONTAINER, int MAX_PAIRS>
+class VerletBoxCell
+{
+public:
+    friend class VerletBoxCellTest;
+
+    typedef CONTAINER Container;
+    typedef typename Container::value_type Cargo;
+    typedef typename Container::value_type value_type;
+    typedef typename Container::const_iterator const_iterator;
+    typedef typename Container::iterator iterator;
+    typedef typename APITraits::SelectTopology<Cargo>::Value Topology;
+    typedef VerletBoxCellHelpers::Pair Pair;
+    typedef FixedArray<Pair, MAX_PAIRS> PairList;
+
+    class API :
+        public APITraits::SelectAPI<Cargo>::Value,
+        public APITraits::HasStencil<Stencils::Moore<Topology::DIM, 1> >
+    {};
+
+    const static int DIM = Topology::DIM;
+    const static int NUM_BOXES = (DIM == 1) ? 3 : ((DIM == 2) ? 9 : 27);
+    const static int CENTER = NUM_BOXES / 2;
+
+    template<
+        typename WRITE_CONTAINER,
+        typename NEIGHBORHOOD,
+        typename COLLECTION_INTERFACE>
+    class NeighborhoodAdapter
+    {
+    public:
+        typedef NeighborhoodIterator<WRITE_CONTAINER, NEIGHBORHOOD, DIM, COLLECTION_INTERFACE> IteratorType;
+        typedef typename NeighborhoodIteratorHelpers::Adapter<WRITE_CONTAINER, IteratorType>::Adapter Value;
+    };
+
+    inline explicit VerletBoxCell(
+        const FloatCoord<DIM>& origin = Coord<DIM>(),
+        const FloatCoord<DIM>& dimension = Coord<DIM>(),
+        const double cutoff = 0,
+        const double skin = 0) :
+        origin(origin),
+        dimension(dimension),
+        cutoff(cutoff),
+        skin(skin),
+        generation(0),
+        listValid(false),
+        // initial particles may have been placed anywhere:
+        hasEmigrants(true),
+        drift(0),
+        maxDisplacement(0)
+    {}
+
+    inline const_iterator begin() const
+    {
+        return particles.begin();
+    }
+
+    inline iterator begin()
+    {
+        return particles.begin();
+    }
+
+    inline const_iterator end() const
+    {
+        return particles.end();
+    }
+
+    inline iterator end()
+    {
+        return particles.end();
+    }
+
+    inline void insert(const Cargo& particle)
+    {
+        particles << particle;
+        ++generation;
+    }
+
+    inline std::size_t size() const
+    {
+        return particles.size();
+    }
+
+    inline
+    const Cargo& operator[](const std::size_t i) const
+    {
+        return particles[i];
+    }
+
+    inline
+    Cargo& operator[](const std::size_t i)
+    {
+        return particles[i];
+    }
+
+    inline
+    VerletBoxCell& operator<<(const Cargo& cargo)
+    {
+        insert(cargo);
+        return *this;
+    }
+
+    template<class HOOD>
+    inline void update(HOOD& hood, const int nanoStep)
+    {
+        const VerletBoxCell *cells[NUM_BOXES];
+        CoordBox<DIM> box(Coord<DIM>::diagonal(-1), Coord<DIM>::diagonal(3));
+        int index = 0;
+        for (typename CoordBox<DIM>::Iterator i = box.begin(); i != box.end(); ++i) {
+            cells[index++] = &hood[*i];
+        }
+
+        copyOver(cells, nanoStep);
+        if (listOutdated(cells)) {
+            rebuildList(cells);
+        }
+
+        if (listValid) {
+            updateWithVerletList(cells, nanoStep);
+        } else {
+            typedef CollectionInterface::PassThrough<typename HOOD::Cell> PassThroughType;
+            typedef typename NeighborhoodAdapter<VerletBoxCell, HOOD, PassThroughType>::Value NeighborhoodAdapterType;
+            NeighborhoodAdapterType adapter(this, &hood);
+            updateCargo(adapter, nanoStep);
+        }
+    }
+
+private:
+    FloatCoord<DIM> origin;
+    FloatCoord<DIM> dimension;
+    double cutoff;
+    double skin;
+    Container particles;
+    // incremented whenever the set of particles or their order
+    // changes, as that invalidates indices into particles:
+    unsigned generation;
+    bool listValid;
+    bool hasEmigrants;
+    // upper bound for the distance any particle in the surrounding
+    // boxes has moved since the Verlet list was built:
+    double drift;
+    // maximum distance an own particle traveled during the last
+    // update:
+    double maxDisplacement;
+    PairList pairs;
+    FixedArray<unsigned, NUM_BOXES> neighborGenerations;
+
+    inline void copyOver(const VerletBoxCell *const *cells, const int nanoStep)
+    {
+        *this = *cells[CENTER];
+
+        if (nanoStep == 0) {
+            exchangeParticles(cells);
+        }
+
+        double maxNeighborDisplacement = 0;
+        for (int i = 0; i < NUM_BOXES; ++i) {
+            maxNeighborDisplacement = (std::max)(maxNeighborDisplacement, cells[i]->maxDisplacement);
+        }
+        drift += maxNeighborDisplacement;
+    }
+
+    /**
+     * Drops all particles which have strayed too far from this box
+     * and picks up those which have left neighboring boxes for this
+     * one. Both decisions are based on the same data, so each
+     * particle ends up in exactly one box.
+     */
+    inline void exchangeParticles(const VerletBoxCell *const *cells)
+    {
+        Container newParticles;
+        bool changed = false;
+
+        for (const_iterator i = particles.begin(); i != particles.end(); ++i) {
+            if (contains(*i, 0.5 * skin)) {
+                newParticles << *i;
+            } else {
+                changed = true;
+            }
+        }
+
+        for (int n = 0; n < NUM_BOXES; ++n) {
+            const VerletBoxCell& neighbor = *cells[n];
+            if ((n == CENTER) || !neighbor.hasEmigrants) {
+                continue;
+            }
+
+            for (const_iterator i = neighbor.begin(); i != neighbor.end(); ++i) {
+                if (!neighbor.contains(*i, 0.5 * neighbor.skin) && contains(*i, 0)) {
+                    newParticles << *i;
+                    changed = true;
+                }
+            }
+        }
+
+        if (changed) {
+            particles = newParticles;
+            ++generation;
+        }
+    }
+
+    inline bool listOutdated(const VerletBoxCell *const *cells) const
+    {
+        if (!listValid || (generation != cells[CENTER]->generation) || (drift > (0.5 * skin))) {
+            return true;
+        }
+
+        for (int i = 0; i < NUM_BOXES; ++i) {
+            if (cells[i]->generation != neighborGenerations[i]) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    inline void rebuildList(const VerletBoxCell *const *cells)
+    {
+        double radius = cutoff + skin;
+        double radius2 = radius * radius;
+
+        pairs.clear();
+        drift = 0;
+        listValid = true;
+        neighborGenerations.clear();
+        for (int i = 0; i < NUM_BOXES; ++i) {
+            neighborGenerations << cells[i]->generation;
+        }
+
+        for (std::size_t i = 0; i < particles.size(); ++i) {
+            FloatCoord<DIM> pos = particles[i].getPos();
+
+            for (int n = 0; n < NUM_BOXES; ++n) {
+                const VerletBoxCell& neighbor = *cells[n];
+
+                for (std::size_t j = 0; j < neighbor.size(); ++j) {
+                    FloatCoord<DIM> delta = neighbor[j].getPos() - pos;
+                    if ((delta * delta) >= radius2) {
+                        continue;
+                    }
+
+                    if (pairs.size() == std::size_t(MAX_PAIRS)) {
+                        listValid = false;
+                        return;
+                    }
+                    pairs << Pair(i, n, j);
+                }
+            }
+        }
+    }
+
+    inline void updateWithVerletList(const VerletBoxCell *const *cells, const int nanoStep)
+    {
+        const Pair *pair = pairs.begin();
+        // we need to fix end here so particles inserted by update()
+        // won't be immediately updated, too:
+        std::size_t end = particles.size();
+        maxDisplacement = 0;
+
+        for (std::size_t i = 0; i < end; ++i) {
+            const Pair *begin = pair;
+            while ((pair != pairs.end()) && (pair->particle == i)) {
+                ++pair;
+            }
+
+            VerletBoxCellHelpers::Neighbors<VerletBoxCell> neighbors(this, cells, begin, pair);
+            updateParticle(i, neighbors, nanoStep);
+        }
+
+        checkEmigrants(end);
+    }
+
+    template<class NEIGHBORHOOD_ADAPTER_ALL>
+    inline void updateCargo(NEIGHBORHOOD_ADAPTER_ALL& allNeighbors, const int nanoStep)
+    {
+        std::size_t end = particles.size();
+        maxDisplacement = 0;
+
+        for (std::size_t i = 0; i < end; ++i) {
+            updateParticle(i, allNeighbors, nanoStep);
+        }
+
+        checkEmigrants(end);
+    }
+
+    template<class NEIGHBORS>
+    inline void updateParticle(const std::size_t i, NEIGHBORS& neighbors, const int nanoStep)
+    {
+        FloatCoord<DIM> oldPos = particles[i].getPos();
+        particles[i].update(neighbors, nanoStep);
+        FloatCoord<DIM> delta = particles[i].getPos() - oldPos;
+        maxDisplacement = (std::max)(maxDisplacement, delta.length());
+    }
+
+    inline void checkEmigrants(const std::size_t end)
+    {
+        hasEmigrants = false;
+        for (std::size_t i = 0; i < end; ++i) {
+            if (!contains(particles[i], 0.5 * skin)) {
+                hasEmigrants = true;
+                return;
+            }
+        }
+    }
+
+    /**
+     * Checks whether particle lies within this box, extended by
+     * margin in all directions.
+     */
+    inline bool contains(const Cargo& particle, const double margin) const
+    {
+        FloatCoord<DIM> extension = FloatCoord<DIM>::diagonal(margin);
+        return APITraits::SelectPositionChecker<Cargo>::value(
+            particle,
+            origin - extension,
+            origin + dimension + extension);
+    }
+};
+
+}
+
+#endif
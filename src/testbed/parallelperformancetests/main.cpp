@@ -182,6 +182,97 @@ private:
 
 };
 
+/**
+ * Measures the latency of ghost zone exchanges for small subdomains,
+ * as found in strong scaling runs: both nodes send one face of their
+ * subdomain to each other, over and over again. Compares regular
+ * sends to persistent requests.
+ */
+template<typename CELL_TYPE>
+class PatchLinkGhostZonePerfTest : public CPUBenchmark
+{
+public:
+    PatchLinkGhostZonePerfTest(const std::string& modelName, bool persistentRequests) :
+        modelName(modelName),
+        persistentRequests(persistentRequests)
+    {}
+
+    std::string family()
+    {
+        return std::string(persistentRequests ? "PatchLinkGhostZonePersistent<" : "PatchLinkGhostZone<") +
+            modelName + ">";
+    }
+
+    std::string species()
+    {
+        return "gold";
+    }
+
+    double performance(std::vector<int> rawDim)
+    {
+        MPILayer mpiLayer;
+        Coord<3> dim(rawDim[0], rawDim[1], rawDim[2]);
+
+        typedef typename Stepper<CELL_TYPE>::GridType GridType;
+
+        CoordBox<3> gridBox(Coord<3>(), dim);
+        GridType grid(gridBox, CELL_TYPE(), CELL_TYPE(), dim);
+        Region<3> wholeGridRegion;
+        wholeGridRegion << gridBox;
+
+        // a y-z face is the worst case as each of its cells forms a
+        // streak of its own:
+        Region<3> face;
+        face << CoordBox<3>(Coord<3>(), Coord<3>(1, dim.y(), dim.z()));
+
+        int other = 1 - mpiLayer.rank();
+        int repeats = 1000;
+        double seconds = 0;
+
+        if (mpiLayer.rank() > 1) {
+            return 0;
+        }
+
+        typename PatchLink<GridType>::Accepter accepter(
+            face,
+            other,
+            777 + mpiLayer.rank(),
+            APITraits::SelectMPIDataType<CELL_TYPE>::value(),
+            MPI_COMM_WORLD,
+            persistentRequests);
+        typename PatchLink<GridType>::Provider provider(
+            face,
+            other,
+            777 + other,
+            APITraits::SelectMPIDataType<CELL_TYPE>::value(),
+            MPI_COMM_WORLD,
+            persistentRequests);
+        accepter.charge(0, repeats, 1);
+        provider.charge(0, repeats, 1);
+
+        {
+            ScopedTimer t(&seconds);
+
+            for (int i = 0; i < repeats; ++i) {
+                accepter.put(grid, wholeGridRegion, dim, i, 0);
+                provider.get(&grid, wholeGridRegion, dim, i, 0, true);
+            }
+            accepter.cleanup();
+        }
+
+        return seconds / repeats * 1e6;
+    }
+
+    std::string unit()
+    {
+        return "us";
+    }
+
+private:
+    std::string modelName;
+    bool persistentRequests;
+};
+
 template<typename PARTITION>
 class PartitionManagerBig3DPerfTest : public CPUBenchmark
 {
@@ -291,6 +382,10 @@ int main(int argc, char **argv)
     eval(CollectingWriterPerfTest<TestCell<3> >("TestCell<3> "),                               toVector(Coord<3>::diagonal(64)),  output);
     eval(PatchLinkPerfTest<MySimpleCell>("MySimpleCell"),                                      toVector(Coord<3>::diagonal(200)), output);
     eval(PatchLinkPerfTest<TestCell<3> >("TestCell<3> "),                                      toVector(Coord<3>::diagonal(64)),  output);
+    eval(PatchLinkGhostZonePerfTest<MySimpleCell>("MySimpleCell", false),                      toVector(Coord<3>::diagonal(32)),  output);
+    eval(PatchLinkGhostZonePerfTest<MySimpleCell>("MySimpleCell", true),                       toVector(Coord<3>::diagonal(32)),  output);
+    eval(PatchLinkGhostZonePerfTest<MySimpleCell>("MySimpleCell", false),                      toVector(Coord<3>::diagonal(128)), output);
+    eval(PatchLinkGhostZonePerfTest<MySimpleCell>("MySimpleCell", true),                       toVector(Coord<3>::diagonal(128)), output);
     eval(PartitionManagerBig3DPerfTest<RecursiveBisectionPartition<3> >("RecursiveBisection"), toVector(Coord<3>::diagonal(100)), output);
     eval(PartitionManagerBig3DPerfTest<ZCurvePartition<3> >("ZCurve"),                         toVector(Coord<3>::diagonal(100)), output);
 
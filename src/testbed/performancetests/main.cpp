@@ -39,6 +39,10 @@
 #include <iostream>
 #include <stdio.h>
 
+#ifdef LIBGEODECOMP_WITH_THREADS
+#include <omp.h>
+#endif
+
 using namespace LibGeoDecomp;
 using namespace LibFlatArray;
 
@@ -328,6 +332,73 @@ public:
     }
 };
 
+/**
+ * Unlike RegionIntersect, RegionSubtract and RegionUnion this
+ * benchmark excludes the construction of the operands and only
+ * measures the in-place set operations, as done by the
+ * PartitionManager when computing ghost zones.
+ */
+class RegionInPlaceOperations : public CPUBenchmark
+{
+public:
+    std::string family()
+    {
+        return "RegionInPlaceOps";
+    }
+
+    std::string species()
+    {
+        return "gold";
+    }
+
+    double performance(std::vector<int> rawDim)
+    {
+        Coord<3> dim(rawDim[0], rawDim[1], rawDim[2]);
+        double seconds = 0;
+        {
+            Region<3> r1;
+            Region<3> r2;
+
+            for (int z = 0; z < dim.z(); ++z) {
+                for (int y = 0; y < dim.y(); ++y) {
+                    r1 << Streak<3>(Coord<3>(0, y, z), dim.x());
+                }
+            }
+
+            for (int z = 1; z < (dim.z() - 1); ++z) {
+                for (int y = 1; y < (dim.y() - 1); ++y) {
+                    r2 << Streak<3>(Coord<3>(1, y, z), dim.x() - 1);
+                }
+            }
+
+            Region<3> akku = r1;
+            std::size_t sum = 0;
+
+            {
+                ScopedTimer t(&seconds);
+
+                akku -= r2;
+                sum += akku.size();
+                akku += r2;
+                sum += akku.size();
+                akku &= r2;
+                sum += akku.size();
+            }
+
+            if (sum == 0) {
+                std::cout << "pure debug statement to prevent the compiler from optimizing away the previous operations";
+            }
+        }
+
+        return seconds;
+    }
+
+    std::string unit()
+    {
+        return "s";
+    }
+};
+
 class RegionExpand : public CPUBenchmark
 {
 public:
@@ -1544,6 +1615,192 @@ public:
     }
 };
 
+/**
+ * 3D Laplacian of 8th order (radius 4 star stencil), as used in
+ * high-order finite-difference codes. BLOCK_SIZE short_vecs are
+ * updated per iteration: as the x-neighbors of adjacent vectors
+ * overlap, each vector along x is loaded only once per block
+ * ((BLOCK_SIZE - 1) * WIDTH + 2 * RADIUS + 1 loads instead of
+ * BLOCK_SIZE * (2 * RADIUS + 1)). BLOCK_SIZE = 1 disables this
+ * register blocking.
+ */
+template<int BLOCK_SIZE>
+class LaplacianCellHighOrder
+{
+public:
+    static const int RADIUS = 4;
+    static const int WIDTH = 4;
+    typedef LibFlatArray::short_vec<double, WIDTH> ShortVec;
+
+    class API :
+        public APITraits::HasFixedCoordsOnlyUpdate,
+        public APITraits::HasUpdateLineX,
+        public APITraits::HasStencil<Stencils::VonNeumann<3, RADIUS> >,
+        public APITraits::HasCubeTopology<3>,
+        public APITraits::HasSoA
+    {};
+
+    explicit LaplacianCellHighOrder(double temp = 0) :
+        temp(temp)
+    {}
+
+    template<typename HOOD_OLD, typename HOOD_NEW>
+    static void updateSingle(HOOD_OLD& hoodOld, HOOD_NEW& hoodNew)
+    {
+        double center = hoodOld[FixedCoord<0, 0, 0>()].temp();
+        double laplacian = 3 * coefficient(0) * center +
+            coefficient(1) * (
+                hoodOld[FixedCoord<-1,  0,  0>()].temp() + hoodOld[FixedCoord< 1,  0,  0>()].temp() +
+                hoodOld[FixedCoord< 0, -1,  0>()].temp() + hoodOld[FixedCoord< 0,  1,  0>()].temp() +
+                hoodOld[FixedCoord< 0,  0, -1>()].temp() + hoodOld[FixedCoord< 0,  0,  1>()].temp()) +
+            coefficient(2) * (
+                hoodOld[FixedCoord<-2,  0,  0>()].temp() + hoodOld[FixedCoord< 2,  0,  0>()].temp() +
+                hoodOld[FixedCoord< 0, -2,  0>()].temp() + hoodOld[FixedCoord< 0,  2,  0>()].temp() +
+                hoodOld[FixedCoord< 0,  0, -2>()].temp() + hoodOld[FixedCoord< 0,  0,  2>()].temp()) +
+            coefficient(3) * (
+                hoodOld[FixedCoord<-3,  0,  0>()].temp() + hoodOld[FixedCoord< 3,  0,  0>()].temp() +
+                hoodOld[FixedCoord< 0, -3,  0>()].temp() + hoodOld[FixedCoord< 0,  3,  0>()].temp() +
+                hoodOld[FixedCoord< 0,  0, -3>()].temp() + hoodOld[FixedCoord< 0,  0,  3>()].temp()) +
+            coefficient(4) * (
+                hoodOld[FixedCoord<-4,  0,  0>()].temp() + hoodOld[FixedCoord< 4,  0,  0>()].temp() +
+                hoodOld[FixedCoord< 0, -4,  0>()].temp() + hoodOld[FixedCoord< 0,  4,  0>()].temp() +
+                hoodOld[FixedCoord< 0,  0, -4>()].temp() + hoodOld[FixedCoord< 0,  0,  4>()].temp());
+
+        hoodNew.temp() = center + ALPHA * laplacian;
+    }
+
+    template<typename HOOD_OLD, typename HOOD_NEW>
+    static void updateLineX(HOOD_OLD& hoodOld, int indexEnd,
+                            HOOD_NEW& hoodNew, int /* nanoStep */)
+    {
+        const int cellsPerBlock = BLOCK_SIZE * WIDTH;
+        const int windowSize = cellsPerBlock + 2 * RADIUS;
+
+        for (; hoodOld.index() < (indexEnd - cellsPerBlock + 1);
+             hoodOld.index() += cellsPerBlock, hoodNew.index += cellsPerBlock) {
+            // the functor only calls us for more than one cell if no
+            // neighbor in x-direction wraps around, so plain pointer
+            // arithmetic is fine along x:
+            const double *west = &hoodOld[FixedCoord<-RADIUS, 0, 0>()].temp();
+            ShortVec window[windowSize - WIDTH + 1];
+            for (int i = 0; i < (windowSize - WIDTH + 1); ++i) {
+                window[i] = ShortVec(west + i);
+            }
+
+            ShortVec sum[BLOCK_SIZE];
+            for (int b = 0; b < BLOCK_SIZE; ++b) {
+                const ShortVec *x = window + b * WIDTH + RADIUS;
+                sum[b] = x[0] * (3 * coefficient(0));
+                for (int d = 1; d <= RADIUS; ++d) {
+                    sum[b] += (x[-d] + x[d]) * coefficient(d);
+                }
+            }
+
+            addNeighbors<1>(hoodOld, sum);
+            addNeighbors<2>(hoodOld, sum);
+            addNeighbors<3>(hoodOld, sum);
+            addNeighbors<4>(hoodOld, sum);
+
+            double *target = &hoodNew.temp();
+            for (int b = 0; b < BLOCK_SIZE; ++b) {
+                ShortVec result = window[b * WIDTH + RADIUS] + sum[b] * ALPHA;
+                result.store(target + b * WIDTH);
+            }
+        }
+
+        for (; hoodOld.index() < indexEnd; ++hoodOld.index(), ++hoodNew.index) {
+            updateSingle(hoodOld, hoodNew);
+        }
+    }
+
+    double temp;
+
+private:
+    static const double ALPHA;
+
+    static inline double coefficient(int distance)
+    {
+        static const double coefficients[] = {
+            -205.0 / 72.0, 8.0 / 5.0, -1.0 / 5.0, 8.0 / 315.0, -1.0 / 560.0 };
+        return coefficients[distance];
+    }
+
+    /**
+     * Adds the neighbors at the given distance along y and z.
+     */
+    template<int DISTANCE, typename HOOD_OLD>
+    static void addNeighbors(HOOD_OLD& hoodOld, ShortVec *sum)
+    {
+        const double *top    = &hoodOld[FixedCoord<0, -DISTANCE, 0>()].temp();
+        const double *bottom = &hoodOld[FixedCoord<0,  DISTANCE, 0>()].temp();
+        const double *south  = &hoodOld[FixedCoord<0, 0, -DISTANCE>()].temp();
+        const double *north  = &hoodOld[FixedCoord<0, 0,  DISTANCE>()].temp();
+
+        for (int b = 0; b < BLOCK_SIZE; ++b) {
+            int offset = b * WIDTH;
+            sum[b] += (ShortVec(top + offset) + ShortVec(bottom + offset) +
+                       ShortVec(south + offset) + ShortVec(north + offset)) * coefficient(DISTANCE);
+        }
+    }
+};
+
+template<int BLOCK_SIZE>
+const double LaplacianCellHighOrder<BLOCK_SIZE>::ALPHA = 0.01;
+
+LIBFLATARRAY_REGISTER_SOA(LaplacianCellHighOrder<1>, ((double)(temp)))
+LIBFLATARRAY_REGISTER_SOA(LaplacianCellHighOrder<3>, ((double)(temp)))
+
+template<typename CELL>
+class Laplacian3DHighOrder : public CPUBenchmark
+{
+public:
+    explicit Laplacian3DHighOrder(const std::string& species) :
+        mySpecies(species)
+    {}
+
+    std::string family()
+    {
+        return "Laplacian3DOrder8";
+    }
+
+    std::string species()
+    {
+        return mySpecies;
+    }
+
+    double performance(std::vector<int> rawDim)
+    {
+        Coord<3> dim(rawDim[0], rawDim[1], rawDim[2]);
+        int maxT = 20;
+        SerialSimulator<CELL> sim(new NoOpInitializer<CELL>(dim, maxT));
+
+        double seconds = 0;
+        {
+            ScopedTimer t(&seconds);
+
+            sim.run();
+        }
+
+        if (sim.getGrid()->get(Coord<3>(1, 1, 1)).temp == 4711) {
+            std::cout << "this statement just serves to prevent the compiler from"
+                      << "optimizing away the loops above\n";
+        }
+
+        double updates = 1.0 * maxT * dim.prod();
+        double gLUPS = 1e-9 * updates / seconds;
+
+        return gLUPS;
+    }
+
+    std::string unit()
+    {
+        return "GLUPS";
+    }
+
+private:
+    std::string mySpecies;
+};
+
 class LBMCell
 {
 public:
@@ -2640,6 +2897,71 @@ public:
     }
 };
 
+/**
+ * Compares OpenMPSimulator with and without NUMA-aware grid placement
+ * (and thread pinning). The difference will only show on multi-socket
+ * machines with OMP_NUM_THREADS spanning all sockets. Pinning
+ * persists for the remainder of the process, so pinned runs should
+ * be evaluated last.
+ */
+template<typename CELL>
+class OpenMPSimulatorNUMA : public CPUBenchmark
+{
+public:
+    OpenMPSimulatorNUMA(const std::string& family, bool firstTouch, bool pinThreads) :
+        myFamily(family),
+        firstTouch(firstTouch),
+        pinThreads(pinThreads)
+    {}
+
+    std::string family()
+    {
+        return myFamily;
+    }
+
+    std::string species()
+    {
+        if (!firstTouch) {
+            return "OpenMP";
+        }
+
+        return pinThreads ? "OpenMPNUMAPinned" : "OpenMPNUMA";
+    }
+
+    double performance(std::vector<int> rawDim)
+    {
+        Coord<3> dim(rawDim[0], rawDim[1], rawDim[2]);
+        int maxT = 50;
+        OpenMPSimulator<CELL> sim(
+            new NoOpInitializer<CELL>(dim, maxT),
+            false,
+            firstTouch,
+            pinThreads);
+
+        double seconds = 0;
+        {
+            ScopedTimer t(&seconds);
+
+            sim.run();
+        }
+
+        double updates = 1.0 * maxT * dim.prod();
+        double gLUPS = 1e-9 * updates / seconds;
+
+        return gLUPS;
+    }
+
+    std::string unit()
+    {
+        return "GLUPS";
+    }
+
+private:
+    std::string myFamily;
+    bool firstTouch;
+    bool pinThreads;
+};
+
 template<class PARTITION>
 class PartitionBenchmark : public CPUBenchmark
 {
@@ -3154,6 +3476,91 @@ public:
 };
 
 #ifdef __AVX__
+/**
+ * Same as SparseMatrixVectorMultiplicationVectorized, but with
+ * chunk-parallel execution. rawDim[1] selects the number of OpenMP
+ * threads, so runs with varying thread counts show the scaling.
+ */
+class SparseMatrixVectorMultiplicationVectorizedThreaded : public CPUBenchmark
+{
+private:
+    template<typename CELL, typename GRID>
+    void updateFunctor(
+        const Region<1>& region,
+        const GRID& gridOld,
+        GRID *gridNew,
+        unsigned nanoStep)
+    {
+        gridOld.callback(
+            gridNew,
+            UnstructuredUpdateFunctorHelpers::UnstructuredGridSoAUpdateHelper<CELL>(
+                gridOld,
+                gridNew,
+                region,
+                nanoStep,
+                UpdateFunctorHelpers::ConcurrencyEnableOpenMP(false, false),
+                typename APITraits::SelectThreadedUpdate<CELL>::Value()));
+    }
+
+public:
+    std::string family()
+    {
+        return "SPMVM";
+    }
+
+    std::string species()
+    {
+        return "titanium";
+    }
+
+    double performance(std::vector<int> rawDim)
+    {
+        Coord<3> dim(rawDim[0], rawDim[1], rawDim[2]);
+#ifdef LIBGEODECOMP_WITH_THREADS
+        int oldNumThreads = omp_get_max_threads();
+        omp_set_num_threads(dim.y());
+#endif
+
+        // 1. create grids
+        typedef UnstructuredSoAGrid<SPMVMSoACell, MATRICES, ValueType, C, SIGMA> Grid;
+        const CoordBox<1> size(Coord<1>(0), Coord<1>(dim.x()));
+        Grid gridOld(size);
+        Grid gridNew(size);
+
+        // 2. init grid old
+        const int maxT = 1;
+        SparseMatrixInitializer<SPMVMSoACell, Grid> init(dim, maxT);
+        init.grid(&gridOld);
+
+        // 3. call updateFunctor()
+        double seconds = 0;
+        Region<1> region;
+        region << Streak<1>(Coord<1>(0), size.dimensions.x());
+        {
+            ScopedTimer t(&seconds);
+            updateFunctor<SPMVMSoACell, Grid>(region, gridOld, &gridNew, 0);
+        }
+
+        if (gridNew.get(Coord<1>(1)).sum == 4711) {
+            std::cout << "this statement just serves to prevent the compiler from"
+                      << "optimizing away the loops above\n";
+        }
+
+#ifdef LIBGEODECOMP_WITH_THREADS
+        omp_set_num_threads(oldNumThreads);
+#endif
+
+        const double numOps = 2. * (size.dimensions.x() / 100) * (size.dimensions.x());
+        const double gflops = 1.0e-9 * numOps / seconds;
+        return gflops;
+    }
+
+    std::string unit()
+    {
+        return "GFLOP/s";
+    }
+};
+
 class SparseMatrixVectorMultiplicationNative : public CPUBenchmark
 {
 private:
@@ -3317,6 +3724,15 @@ int main(int argc, char **argv)
     for (std::size_t i = 0; i < sizes.size(); ++i) {
         eval(SparseMatrixVectorMultiplicationVectorizedInf(), toVector(sizes[i]));
     }
+
+#ifdef LIBGEODECOMP_WITH_THREADS
+    for (std::size_t i = 0; i < sizes.size(); ++i) {
+        for (int threads = 1; threads <= omp_get_max_threads(); threads *= 2) {
+            eval(SparseMatrixVectorMultiplicationVectorizedThreaded(),
+                 toVector(Coord<3>(sizes[i].x(), threads, 1)));
+        }
+    }
+#endif
     sizes.clear();
 #endif
 
@@ -3344,6 +3760,10 @@ int main(int argc, char **argv)
     eval(RegionAppend(), toVector(Coord<3>( 512,  512,  512)));
     eval(RegionAppend(), toVector(Coord<3>(2048, 2048, 2048)));
 
+    eval(RegionInPlaceOperations(), toVector(Coord<3>( 128,  128,  128)));
+    eval(RegionInPlaceOperations(), toVector(Coord<3>( 512,  512,  512)));
+    eval(RegionInPlaceOperations(), toVector(Coord<3>(2048, 2048, 2048)));
+
     eval(RegionExpand(1), toVector(Coord<3>( 128,  128,  128)));
     eval(RegionExpand(1), toVector(Coord<3>( 512,  512,  512)));
     eval(RegionExpand(1), toVector(Coord<3>(2048, 2048, 2048)));
@@ -3429,6 +3849,23 @@ int main(int argc, char **argv)
         eval(Jacobi3DStreakUpdateFunctor(), toVector(sizes[i]));
     }
 
+    for (std::size_t i = 0; i < sizes.size(); ++i) {
+        eval(Laplacian3DHighOrder<LaplacianCellHighOrder<1> >("vectorized"), toVector(sizes[i]));
+    }
+
+    for (std::size_t i = 0; i < sizes.size(); ++i) {
+        eval(Laplacian3DHighOrder<LaplacianCellHighOrder<3> >("blocked"), toVector(sizes[i]));
+    }
+
+    for (std::size_t i = 0; i < sizes.size(); ++i) {
+        eval(OpenMPSimulatorNUMA<JacobiCellStreakUpdate>("Jacobi3D", false, false), toVector(sizes[i]));
+    }
+
+    for (std::size_t i = 0; i < sizes.size(); ++i) {
+        eval(OpenMPSimulatorNUMA<JacobiCellStreakUpdate>("Jacobi3D", true, false), toVector(sizes[i]));
+    }
+
+    std::vector<Coord<3> > jacobiSizes = sizes;
     sizes.clear();
 
     sizes << Coord<3>(22, 22, 22)
@@ -3447,6 +3884,23 @@ int main(int argc, char **argv)
         eval(LBMSoA(), toVector(sizes[i]));
     }
 
+    for (std::size_t i = 0; i < sizes.size(); ++i) {
+        eval(OpenMPSimulatorNUMA<LBMSoACell>("LBM", false, false), toVector(sizes[i]));
+    }
+
+    for (std::size_t i = 0; i < sizes.size(); ++i) {
+        eval(OpenMPSimulatorNUMA<LBMSoACell>("LBM", true, false), toVector(sizes[i]));
+    }
+
+    // pinning can't be undone, hence these go last:
+    for (std::size_t i = 0; i < jacobiSizes.size(); ++i) {
+        eval(OpenMPSimulatorNUMA<JacobiCellStreakUpdate>("Jacobi3D", true, true), toVector(jacobiSizes[i]));
+    }
+
+    for (std::size_t i = 0; i < sizes.size(); ++i) {
+        eval(OpenMPSimulatorNUMA<LBMSoACell>("LBM", true, true), toVector(sizes[i]));
+    }
+
     std::vector<int> dim = toVector(Coord<3>(32 * 1024, 32 * 1024, 1));
     eval(PartitionBenchmark<HIndexingPartition   >("PartitionHIndexing"), dim);
     eval(PartitionBenchmark<StripingPartition<2> >("PartitionStriping"),  dim);